@@ -216,6 +216,7 @@ const UserDef U_default = {
     .sequencer_disk_cache_size_limit = 100,
     .sequencer_disk_cache_flag = 0,
     .sequencer_proxy_setup = USER_SEQ_PROXY_SETUP_AUTOMATIC,
+    .sequencer_prefetch_threads = 1,
 
     .collection_instance_empty_size = 1.0f,
 
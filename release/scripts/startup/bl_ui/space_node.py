@@ -769,6 +769,9 @@ class NODE_PT_quality(bpy.types.Panel):
         col = layout.column()
         col.prop(tree, "use_opencl")
         col.prop(tree, "use_groupnode_buffer")
+        sub = col.column()
+        sub.active = tree.execution_mode == 'FULL_FRAME'
+        sub.prop(tree, "use_half_buffers")
         col.prop(tree, "use_two_pass")
         col.prop(tree, "use_viewer_border")
         col.separator()
@@ -682,6 +682,7 @@ class USERPREF_PT_system_video_sequencer(SystemPanel, CenterAlignMixIn, Panel):
         # edit = prefs.edit
 
         layout.prop(system, "memory_cache_limit")
+        layout.prop(system, "sequencer_prefetch_threads")
 
         layout.separator()
 
@@ -2340,6 +2341,7 @@ class USERPREF_PT_experimental_prototypes(ExperimentalPanel, Panel):
                 ({"property": "use_full_frame_compositor"}, "T88150"),
                 ({"property": "enable_eevee_next"}, "T93220"),
                 ({"property": "enable_workbench_next"}, "T101619"),
+                ({"property": "use_geometry_nodes_result_cache"}, None),
             ),
         )
 
@@ -2377,6 +2379,8 @@ class USERPREF_PT_experimental_debugging(ExperimentalPanel, Panel):
                 ({"property": "show_asset_debug_info"}, None),
                 ({"property": "use_asset_indexing"}, None),
                 ({"property": "use_viewport_debug"}, None),
+                ({"property": "use_mapped_file_data"}, None),
+                ({"property": "use_delta_save"}, None),
             ),
         )
 
@@ -60,6 +60,11 @@ class GeometryComponent {
   static GeometryComponent *create(GeometryComponentType component_type);
 
   int attribute_domain_size(eAttrDomain domain) const;
+  /**
+   * Memory used by the values of all attributes, an estimate of the memory used by the
+   * component that doesn't account for data outside of attributes.
+   */
+  int64_t attributes_size_in_bytes() const;
 
   /**
    * Get access to the attributes in this geometry component. May return none if the geometry does
@@ -176,6 +181,10 @@ struct GeometrySet {
    * Get all geometry components in this geometry set for read-only access.
    */
   blender::Vector<const GeometryComponent *> get_components_for_read() const;
+  /**
+   * Sum of #GeometryComponent::attributes_size_in_bytes of all components.
+   */
+  int64_t attributes_size_in_bytes() const;
 
   bool compute_boundbox_without_instances(blender::float3 *r_min, blender::float3 *r_max) const;
 
@@ -3035,15 +3035,16 @@ static void *customData_duplicate_referenced_layer_index(CustomData *data,
      */
     const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
 
+    void *dst_data = MEM_malloc_arrayN(size_t(totelem), typeInfo->size, "CD duplicate ref layer");
     if (typeInfo->copy) {
-      void *dst_data = MEM_malloc_arrayN(
-          size_t(totelem), typeInfo->size, "CD duplicate ref layer");
       typeInfo->copy(layer->data, dst_data, totelem);
-      layer->data = dst_data;
     }
     else {
-      layer->data = MEM_dupallocN(layer->data);
+      /* Not #MEM_dupallocN, referenced data may not be allocated by #MEM_mallocN,
+       * see #CustomData_blend_read. */
+      memcpy(dst_data, layer->data, size_t(totelem) * typeInfo->size);
     }
+    layer->data = dst_data;
 
     layer->flag &= ~CD_FLAG_NOFREE;
   }
@@ -4445,7 +4446,8 @@ bool CustomData_layer_validate(CustomDataLayer *layer, const uint totitems, cons
   }
 
   BLI_assert((totitems == 0) || layer->data);
-  BLI_assert(MEM_allocN_len(layer->data) >= totitems * typeInfo->size);
+  BLI_assert((layer->flag & CD_FLAG_NOFREE) ||
+             MEM_allocN_len(layer->data) >= totitems * typeInfo->size);
 
   if (typeInfo->validate != nullptr) {
     return typeInfo->validate(layer->data, totitems, do_fixes);
@@ -5160,6 +5162,17 @@ static void blend_read_paint_mask(BlendDataReader *reader,
   }
 }
 
+/**
+ * Whether the layer's data can be used directly from a memory-mapped file,
+ * only for simple types without data owned by the elements.
+ */
+static bool customdata_layer_read_as_view(const CustomDataLayer *layer)
+{
+  const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+  return !(layer->flag & CD_FLAG_EXTERNAL) && typeInfo->copy == nullptr &&
+         typeInfo->free == nullptr;
+}
+
 void CustomData_blend_read(BlendDataReader *reader, CustomData *data, const int count)
 {
   BLO_read_data_address(reader, &data->layers);
@@ -5184,7 +5197,18 @@ void CustomData_blend_read(BlendDataReader *reader, CustomData *data, const int
     layer->flag &= ~CD_FLAG_NOFREE;
 
     if (CustomData_verify_versions(data, i)) {
-      BLO_read_data_address(reader, &layer->data);
+      if (customdata_layer_read_as_view(layer)) {
+        bool is_view;
+        layer->data = BLO_read_get_new_data_address_view(reader, layer->data, &is_view);
+        if (is_view) {
+          /* Copied on write like referenced layers, see
+           * #customData_duplicate_referenced_layer_index. */
+          layer->flag |= CD_FLAG_NOFREE;
+        }
+      }
+      else {
+        BLO_read_data_address(reader, &layer->data);
+      }
       if (CustomData_layer_ensure_data_exists(layer, count)) {
         /* Under normal operations, this shouldn't happen, but...
          * For a CD_PROP_BOOL example, see T84935.
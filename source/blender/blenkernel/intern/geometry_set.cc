@@ -75,6 +75,25 @@ int GeometryComponent::attribute_domain_size(const eAttrDomain domain) const
   return 0;
 }
 
+int64_t GeometryComponent::attributes_size_in_bytes() const
+{
+  const std::optional<blender::bke::AttributeAccessor> attributes = this->attributes();
+  if (!attributes) {
+    return 0;
+  }
+  int64_t size = 0;
+  attributes->for_all([&](const blender::bke::AttributeIDRef & /*attribute_id*/,
+                          const blender::bke::AttributeMetaData &meta_data) {
+    const blender::CPPType *type = blender::bke::custom_data_type_to_cpp_type(
+        meta_data.data_type);
+    if (type != nullptr) {
+      size += int64_t(attributes->domain_size(meta_data.domain)) * type->size();
+    }
+    return true;
+  });
+  return size;
+}
+
 std::optional<blender::bke::AttributeAccessor> GeometryComponent::attributes() const
 {
   return std::nullopt;
@@ -213,6 +232,17 @@ Vector<const GeometryComponent *> GeometrySet::get_components_for_read() const
   return components;
 }
 
+int64_t GeometrySet::attributes_size_in_bytes() const
+{
+  int64_t size = 0;
+  for (const GeometryComponentPtr &component_ptr : components_) {
+    if (component_ptr) {
+      size += component_ptr->attributes_size_in_bytes();
+    }
+  }
+  return size;
+}
+
 bool GeometrySet::compute_boundbox_without_instances(float3 *r_min, float3 *r_max) const
 {
   using namespace blender;
@@ -2231,7 +2231,9 @@ void BKE_keyblock_mesh_calc_normals(const KeyBlock *kb,
     return;
   }
 
-  float(*positions)[3] = static_cast<float(*)[3]>(MEM_dupallocN(BKE_mesh_vert_positions(mesh)));
+  float(*positions)[3] = static_cast<float(*)[3]>(
+      MEM_malloc_arrayN(size_t(mesh->totvert), sizeof(float[3]), __func__));
+  memcpy(positions, BKE_mesh_vert_positions(mesh), sizeof(float[3]) * size_t(mesh->totvert));
   BKE_keyblock_convert_to_mesh(kb, positions, mesh->totvert);
   const MEdge *edges = BKE_mesh_edges(mesh);
   const MPoly *polys = BKE_mesh_polys(mesh);
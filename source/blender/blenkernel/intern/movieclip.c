@@ -927,6 +927,7 @@ static bool put_imbuf_cache(
                                          moviecache_getprioritydata,
                                          moviecache_getitempriority,
                                          moviecache_prioritydeleter);
+    IMB_moviecache_set_compress(moviecache, true);
 
     clip->cache->moviecache = moviecache;
     clip->cache->sequence_offset = -1;
@@ -73,6 +73,7 @@
 #include "NOD_common.h"
 #include "NOD_composite.h"
 #include "NOD_geometry.h"
+#include "NOD_geometry_nodes_cache.hh"
 #include "NOD_geometry_nodes_lazy_function.hh"
 #include "NOD_node_declaration.hh"
 #include "NOD_register.hh"
@@ -4078,6 +4079,8 @@ void BKE_node_system_init()
 
 void BKE_node_system_exit()
 {
+  blender::nodes::geo_eval_cache::clear();
+
   if (nodetypes_hash) {
     NODE_TYPES_BEGIN (nt) {
       if (nt->rna_ext.free) {
@@ -3234,7 +3234,10 @@ void BKE_pbvh_vert_coords_apply(PBVH *pbvh, const float (*vertCos)[3], const int
       /* original data and applying new coords to this arrays would lead to */
       /* unneeded deformation -- duplicate verts/faces to avoid this */
 
-      pbvh->vert_positions = static_cast<float(*)[3]>(MEM_dupallocN(pbvh->vert_positions));
+      float(*vert_positions)[3] = static_cast<float(*)[3]>(
+          MEM_malloc_arrayN(size_t(totvert), sizeof(float[3]), __func__));
+      memcpy(vert_positions, pbvh->vert_positions, sizeof(float[3]) * size_t(totvert));
+      pbvh->vert_positions = vert_positions;
       /* No need to dupalloc pbvh->looptri, this one is 'totally owned' by pbvh,
        * it's never some mesh data. */
 
@@ -273,4 +273,10 @@ template<typename T1, typename T2> struct DefaultHash<std::pair<T1, T2>> {
   }
 };
 
+/**
+ * Hash the bytes of a large buffer, like pixels or attribute values read from outside of an
+ * evaluation. Chunks are hashed in parallel, since such buffers may be hashed on every evaluation.
+ */
+uint64_t hash_buffer(const void *data, int64_t size);
+
 }  // namespace blender
@@ -86,6 +86,8 @@ enum {
 enum {
   /* calculate IsectRayPrecalc data */
   BVH_RAYCAST_WATERTIGHT = (1 << 0),
+  /* Traverse one child at a time instead of using the SIMD wide nodes (for testing). */
+  BVH_RAYCAST_NO_WIDE_NODES = (1 << 1),
 };
 #define BVH_RAYCAST_DEFAULT (BVH_RAYCAST_WATERTIGHT)
 #define BVH_RAYCAST_DIST_MAX (FLT_MAX / 2.0f)
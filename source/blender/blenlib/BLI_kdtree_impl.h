@@ -33,6 +33,22 @@ void BLI_kdtree_nd_(insert)(KDTree *tree, int index, const float co[KD_DIMS]) AT
 int BLI_kdtree_nd_(find_nearest)(const KDTree *tree,
                                  const float co[KD_DIMS],
                                  KDTreeNearest *r_nearest) ATTR_NONNULL(1, 2);
+/**
+ * Find the nearest point for each of the \a co_len coordinates in \a co, using multiple threads.
+ * Queries are sorted spatially, so consecutive queries visit the same parts of the tree
+ * and each one can start with the result of the previous one as an upper bound.
+ *
+ * \param r_index: Optional, the nearest index per query (-1 when the tree is empty).
+ * \param r_nearest: Optional, the nearest point per query.
+ *
+ * \note Results are deterministic, but where multiple points are equally near,
+ * a different one than #BLI_kdtree_3d_find_nearest returns may be found.
+ */
+void BLI_kdtree_nd_(find_nearest_batch)(const KDTree *tree,
+                                        const float (*co)[KD_DIMS],
+                                        int co_len,
+                                        int *r_index,
+                                        KDTreeNearest *r_nearest) ATTR_NONNULL(1, 2);
 
 int BLI_kdtree_nd_(find_nearest_n)(const KDTree *tree,
                                    const float co[KD_DIMS],
@@ -82,6 +82,48 @@ void *BLI_mempool_as_arrayN(BLI_mempool *pool,
 void BLI_mempool_set_memory_debug(void);
 #endif
 
+/**
+ * Concurrent allocation.
+ *
+ * Each thread allocating or freeing elements uses its own #BLI_mempool_local,
+ * which caches a private free-list so most operations don't touch shared state.
+ * Elements are taken from and handed back to the pool's free-list in batches (lock-free),
+ * new chunks are appended to the pool with atomic operations too.
+ *
+ * - Elements may be freed from a different thread than the one they were allocated from.
+ * - The regular (non `_local`) functions must not be used while other threads
+ *   use local caches, #BLI_mempool_len is only accurate once all caches have been flushed.
+ * - Iteration (with #BLI_MEMPOOL_ALLOW_ITER) works as usual once all caches have been flushed.
+ *
+ * Typically the cache is the TLS chunk of #BLI_task_parallel_range,
+ * initialized once with #BLI_mempool_local_init and flushed from #TaskParallelSettings.func_free.
+ */
+
+/** \note Private structure, copying an initialized but unused cache is allowed. */
+typedef struct BLI_mempool_local {
+  BLI_mempool *pool;
+  struct BLI_freenode *free;
+  struct BLI_freenode *free_tail;
+  unsigned int free_len;
+  /** Elements allocated minus freed through this cache, added to the pool on flush. */
+  int used_delta;
+} BLI_mempool_local;
+
+void BLI_mempool_local_init(BLI_mempool *pool, BLI_mempool_local *local) ATTR_NONNULL(1, 2);
+void *BLI_mempool_local_alloc(BLI_mempool_local *local)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_RETURNS_NONNULL ATTR_NONNULL(1);
+void *BLI_mempool_local_calloc(BLI_mempool_local *local)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_RETURNS_NONNULL ATTR_NONNULL(1);
+/**
+ * Free an element allocated from the pool of \a local (by any thread).
+ */
+void BLI_mempool_local_free(BLI_mempool_local *local, void *addr) ATTR_NONNULL(1, 2);
+/**
+ * Hand back all cached free elements to the pool and update its number of used elements.
+ * Must be called before the cache goes out of scope, the cache may be used again afterwards.
+ */
+void BLI_mempool_local_flush(BLI_mempool_local *local) ATTR_NONNULL(1);
+
 /**
  * Iteration stuff.
  * \note this may easy to produce bugs with.
@@ -32,11 +32,36 @@ struct BLI_mempool;
  * \{ */
 
 void BLI_task_scheduler_init(void);
+/**
+ * \note Also writes the trace file when #BLI_task_trace_begin was called.
+ */
 void BLI_task_scheduler_exit(void);
 int BLI_task_scheduler_num_threads(void);
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Task Tracing
+ *
+ * Optionally record when tasks of pools, graphs and parallel ranges run on which thread,
+ * to inspect scheduling in a timeline (`chrome://tracing` or https://ui.perfetto.dev).
+ * When tracing is disabled the overhead is a single relaxed atomic load per task.
+ * \{ */
+
+/**
+ * Start recording, the trace is written as Chrome trace event JSON to \a filepath
+ * by #BLI_task_trace_end.
+ */
+void BLI_task_trace_begin(const char *filepath);
+/**
+ * Stop recording and write the trace file, does nothing when not recording.
+ * \return False when writing the file failed.
+ */
+bool BLI_task_trace_end(void);
+bool BLI_task_trace_is_enabled(void);
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Task Pool
  *
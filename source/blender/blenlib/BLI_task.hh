@@ -32,6 +32,7 @@
 
 #include "BLI_index_range.hh"
 #include "BLI_lazy_threading.hh"
+#include "BLI_task_trace.hh"
 #include "BLI_utildefines.h"
 
 namespace blender::threading {
@@ -61,13 +62,15 @@ void parallel_for(IndexRange range, int64_t grain_size, const Function &function
     tbb::parallel_for(
         tbb::blocked_range<int64_t>(range.first(), range.one_after_last(), grain_size),
         [&](const tbb::blocked_range<int64_t> &subrange) {
+          trace::ScopedEvent trace_event(
+              "parallel_for", "parallel_for", &function, subrange.size(), grain_size);
           function(IndexRange(subrange.begin(), subrange.size()));
         });
     return;
   }
-#else
-  UNUSED_VARS(grain_size);
 #endif
+  trace::ScopedEvent trace_event(
+      "parallel_for", "parallel_for", &function, range.size(), grain_size);
   function(range);
 }
 
@@ -0,0 +1,85 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#pragma once
+
+/** \file
+ * \ingroup bli
+ *
+ * Recording of task execution for #BLI_task_trace_begin.
+ *
+ * Every thread records its events into its own fixed size ring buffer (only the oldest events
+ * are lost when it overflows), so recording doesn't need any locks. Event names and categories
+ * are not copied and must be static strings.
+ */
+
+#include <atomic>
+#include <cstdint>
+
+#include "BLI_compiler_compat.h"
+
+namespace blender::threading::trace {
+
+extern std::atomic<bool> is_enabled_flag;
+
+inline bool is_enabled()
+{
+  return is_enabled_flag.load(std::memory_order_relaxed);
+}
+
+uint64_t time_ns();
+
+/**
+ * \param id: Identifies the pool/graph/range the event belongs to (may be null).
+ * \param size: Number of items handled by the event, -1 when unknown.
+ * \param grain_size: Grain size used to split the work, -1 when unknown.
+ */
+void record(const char *name,
+            const char *category,
+            const void *id,
+            uint64_t start_ns,
+            int64_t size,
+            int64_t grain_size);
+/** Record an event without duration. */
+void record_instant(const char *name, const char *category);
+
+/**
+ * Records the lifetime of this object as a single event, when tracing is enabled.
+ */
+class ScopedEvent {
+ private:
+  const char *name_ = nullptr;
+  const char *category_;
+  const void *id_;
+  int64_t size_;
+  int64_t grain_size_;
+  uint64_t start_ns_;
+
+ public:
+  ScopedEvent(const char *name,
+              const char *category,
+              const void *id = nullptr,
+              const int64_t size = -1,
+              const int64_t grain_size = -1)
+  {
+    if (UNLIKELY(is_enabled())) {
+      name_ = name;
+      category_ = category;
+      id_ = id;
+      size_ = size;
+      grain_size_ = grain_size;
+      start_ns_ = time_ns();
+    }
+  }
+
+  ~ScopedEvent()
+  {
+    if (UNLIKELY(name_ != nullptr)) {
+      record(name_, category_, id_, start_ns_, size_, grain_size_);
+    }
+  }
+
+  ScopedEvent(const ScopedEvent &other) = delete;
+  ScopedEvent &operator=(const ScopedEvent &other) = delete;
+};
+
+}  // namespace blender::threading::trace
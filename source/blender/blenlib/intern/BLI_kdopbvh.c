@@ -20,6 +20,10 @@
  *   #BLI_bvhtree_overlap, #BVHOverlapData_Shared, #BVHOverlapData_Thread
  * - Range Query:
  *   #BLI_bvhtree_range_query
+ *
+ * Trees using x/y/z slabs with up to 8 children per node additionally store the bounds of
+ * each branch's children in structure-of-arrays form (see #BVHTree.nodewide),
+ * so ray-cast and overlap traversal can test all children of a node at once using SIMD.
  */
 
 #include "MEM_guardedalloc.h"
@@ -28,6 +32,7 @@
 #include "BLI_heap_simple.h"
 #include "BLI_kdopbvh.h"
 #include "BLI_math.h"
+#include "BLI_simd.h"
 #include "BLI_stack.h"
 #include "BLI_task.h"
 #include "BLI_utildefines.h"
@@ -45,6 +50,9 @@
 
 #define MAX_TREETYPE 32
 
+/* Maximum tree type which stores child bounds in SIMD friendly "wide" nodes. */
+#define MAX_TREETYPE_WIDE 8
+
 /* Setting zero so we can catch bugs in BLI_task/KDOPBVH.
  * TODO(sergey): Deduplicate the limits with PBVH from BKE.
  */
@@ -72,12 +80,17 @@ typedef struct BVHNode {
   char main_axis; /* Axis used to split this node */
 } BVHNode;
 
-/* keep under 26 bytes for speed purposes */
+/* keep small for speed purposes */
 struct BVHTree {
   BVHNode **nodes;
   BVHNode *nodearray;  /* pre-alloc branch nodes */
   BVHNode **nodechild; /* pre-alloc children for nodes */
   float *nodebv;       /* pre-alloc bounding-volumes for nodes */
+  /**
+   * Children bounds of every branch as x/y/z min/max rows (`float[6][lanes]` per branch),
+   * see #bvhtree_wide_lanes. NULL when the tree type or axis doesn't support it.
+   */
+  float *nodewide;
   float epsilon;       /* Epsilon is used for inflation of the K-DOP. */
   int leaf_num;        /* leafs */
   int branch_num;
@@ -87,8 +100,8 @@ struct BVHTree {
 };
 
 /* optimization, ensure we stay small */
-BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 48) ||
-                      (sizeof(void *) == 4 && sizeof(BVHTree) <= 32),
+BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 56) ||
+                      (sizeof(void *) == 4 && sizeof(BVHTree) <= 36),
                   "over sized")
 
 /* avoid duplicating vars in BVHOverlapData_Thread */
@@ -673,6 +686,238 @@ static void split_leafs(BVHNode **leafs_array,
   }
 }
 
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Parallel Split & Refit
+ *
+ * Branches close to the root contain most of the leafs and are processed by a single task,
+ * so their bounds and leaf partitioning are multi-threaded on their own.
+ * \{ */
+
+/** Number of nodes handled by a single task when looping over many leafs or branches. */
+#define KDOPBVH_THREAD_CHUNK_SIZE 16384
+/** Number of bins used to sort the leafs of a large branch along the split axis. */
+#define KDOPBVH_SPLIT_BINS 256
+
+/** Only split with multiple threads when a branch has many leafs. */
+#define KDOPBVH_PARALLEL_SPLIT_LEAF_THRESHOLD (KDOPBVH_THREAD_CHUNK_SIZE * 4)
+
+typedef struct BVHRefitData {
+  const BVHTree *tree;
+  int start, end;
+} BVHRefitData;
+
+typedef struct BVHRefitChunk {
+  float bv[26];
+} BVHRefitChunk;
+
+static void bv_minmax_join(const BVHTree *tree, float *__restrict bv, const float *__restrict bv_b)
+{
+  axis_t axis_iter;
+
+  for (axis_iter = tree->start_axis; axis_iter < tree->stop_axis; axis_iter++) {
+    bv[(2 * axis_iter)] = min_ff(bv[(2 * axis_iter)], bv_b[(2 * axis_iter)]);
+    bv[(2 * axis_iter) + 1] = max_ff(bv[(2 * axis_iter) + 1], bv_b[(2 * axis_iter) + 1]);
+  }
+}
+
+static void refit_kdop_hull_task_cb(void *__restrict userdata,
+                                    const int chunk,
+                                    const TaskParallelTLS *__restrict tls)
+{
+  const BVHRefitData *data = userdata;
+  BVHRefitChunk *refit_chunk = tls->userdata_chunk;
+  const int start = data->start + chunk * KDOPBVH_THREAD_CHUNK_SIZE;
+  const int end = min_ii(start + KDOPBVH_THREAD_CHUNK_SIZE, data->end);
+
+  for (int j = start; j < end; j++) {
+    bv_minmax_join(data->tree, refit_chunk->bv, data->tree->nodes[j]->bv);
+  }
+}
+
+static void refit_kdop_hull_reduce(const void *__restrict userdata,
+                                   void *__restrict chunk_join,
+                                   void *__restrict chunk)
+{
+  const BVHRefitData *data = userdata;
+  bv_minmax_join(data->tree, ((BVHRefitChunk *)chunk_join)->bv, ((BVHRefitChunk *)chunk)->bv);
+}
+
+/**
+ * Multi-threaded version of #refit_kdop_hull, for branches with many leafs.
+ */
+static void refit_kdop_hull_parallel(const BVHTree *tree, BVHNode *node, int start, int end)
+{
+  BVHRefitData data = {
+      .tree = tree,
+      .start = start,
+      .end = end,
+  };
+  BVHRefitChunk refit_chunk;
+  axis_t axis_iter;
+
+  for (axis_iter = tree->start_axis; axis_iter < tree->stop_axis; axis_iter++) {
+    refit_chunk.bv[(2 * axis_iter)] = FLT_MAX;
+    refit_chunk.bv[(2 * axis_iter) + 1] = -FLT_MAX;
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.userdata_chunk = &refit_chunk;
+  settings.userdata_chunk_size = sizeof(refit_chunk);
+  settings.func_reduce = refit_kdop_hull_reduce;
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0,
+                          (int)divide_ceil_u((uint)(end - start), KDOPBVH_THREAD_CHUNK_SIZE),
+                          &data,
+                          refit_kdop_hull_task_cb,
+                          &settings);
+
+  node_minmax_init(tree, node);
+  bv_minmax_join(tree, node->bv, refit_chunk.bv);
+}
+
+typedef struct BVHSplitBinsData {
+  BVHNode **leafs_array;
+  BVHNode **leafs_sorted;
+  int start, end;
+  int split_axis;
+  float bin_min, bin_scale;
+  /** Per chunk bin counts, converted to per chunk bin offsets into #leafs_sorted. */
+  int (*chunk_bins)[KDOPBVH_SPLIT_BINS];
+} BVHSplitBinsData;
+
+BLI_INLINE int split_bins_index(const BVHSplitBinsData *data, const BVHNode *node)
+{
+  const float bin = (node->bv[data->split_axis] - data->bin_min) * data->bin_scale;
+  /* Written so NaN maps to the first bin. */
+  if (!(bin > 0.0f)) {
+    return 0;
+  }
+  if (bin >= (float)(KDOPBVH_SPLIT_BINS - 1)) {
+    return KDOPBVH_SPLIT_BINS - 1;
+  }
+  return (int)bin;
+}
+
+static void split_bins_count_task_cb(void *__restrict userdata,
+                                     const int chunk,
+                                     const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHSplitBinsData *data = userdata;
+  int *bins = data->chunk_bins[chunk];
+  const int start = data->start + chunk * KDOPBVH_THREAD_CHUNK_SIZE;
+  const int end = min_ii(start + KDOPBVH_THREAD_CHUNK_SIZE, data->end);
+
+  memset(bins, 0, sizeof(*data->chunk_bins));
+  for (int j = start; j < end; j++) {
+    bins[split_bins_index(data, data->leafs_array[j])]++;
+  }
+}
+
+static void split_bins_scatter_task_cb(void *__restrict userdata,
+                                       const int chunk,
+                                       const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHSplitBinsData *data = userdata;
+  int *bins = data->chunk_bins[chunk];
+  const int start = data->start + chunk * KDOPBVH_THREAD_CHUNK_SIZE;
+  const int end = min_ii(start + KDOPBVH_THREAD_CHUNK_SIZE, data->end);
+
+  for (int j = start; j < end; j++) {
+    BVHNode *node = data->leafs_array[j];
+    data->leafs_sorted[bins[split_bins_index(data, node)]++] = node;
+  }
+}
+
+/**
+ * Multi-threaded version of #split_leafs, for branches with many leafs.
+ *
+ * The leafs are first sorted into bins along the split axis (a parallel counting sort),
+ * so only the leafs in the bins containing a partition boundary
+ * need to be partitioned with #partition_nth_element.
+ *
+ * \param bv: The bounds of all leafs in the range, used to place the bins.
+ */
+static void split_leafs_parallel(BVHNode **leafs_array,
+                                 const int nth[],
+                                 const int partitions,
+                                 const int split_axis,
+                                 const float *bv)
+{
+  const int start = nth[0];
+  const int end = nth[partitions];
+  /* The split axis is the index of the maximum of the axis, see #get_largest_axis. */
+  const float bin_min = bv[split_axis - 1];
+  const float bin_max = bv[split_axis];
+
+  if (!(bin_max > bin_min)) {
+    split_leafs(leafs_array, nth, partitions, split_axis);
+    return;
+  }
+
+  const int chunks_num = (int)divide_ceil_u((uint)(end - start), KDOPBVH_THREAD_CHUNK_SIZE);
+  BVHSplitBinsData data = {
+      .leafs_array = leafs_array,
+      .leafs_sorted = MEM_mallocN(sizeof(BVHNode *) * (size_t)(end - start), __func__),
+      .start = start,
+      .end = end,
+      .split_axis = split_axis,
+      .bin_min = bin_min,
+      .bin_scale = (float)KDOPBVH_SPLIT_BINS / (bin_max - bin_min),
+      .chunk_bins = MEM_mallocN(sizeof(*data.chunk_bins) * (size_t)chunks_num, __func__),
+  };
+  int bin_starts[KDOPBVH_SPLIT_BINS + 1];
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+
+  BLI_task_parallel_range(0, chunks_num, &data, split_bins_count_task_cb, &settings);
+
+  /* Turn the counts into offsets, ordered by bin first so the sort is stable per chunk. */
+  int offset = 0;
+  for (int bin = 0; bin < KDOPBVH_SPLIT_BINS; bin++) {
+    bin_starts[bin] = start + offset;
+    for (int chunk = 0; chunk < chunks_num; chunk++) {
+      const int count = data.chunk_bins[chunk][bin];
+      data.chunk_bins[chunk][bin] = offset;
+      offset += count;
+    }
+  }
+  bin_starts[KDOPBVH_SPLIT_BINS] = end;
+  BLI_assert(offset == end - start);
+
+  BLI_task_parallel_range(0, chunks_num, &data, split_bins_scatter_task_cb, &settings);
+  memcpy(&leafs_array[start], data.leafs_sorted, sizeof(BVHNode *) * (size_t)(end - start));
+
+  /* Any leaf in a bin is greater or equal to the leafs in the previous bins,
+   * so only the bins containing a partition boundary need to be partitioned. */
+  int bin = 0;
+  int partition_start = start;
+  for (int i = 1; i < partitions; i++) {
+    if (nth[i] >= end) {
+      break;
+    }
+    while (bin_starts[bin + 1] <= nth[i]) {
+      bin++;
+    }
+    partition_start = max_ii(partition_start, bin_starts[bin]);
+    partition_nth_element(leafs_array, partition_start, bin_starts[bin + 1], nth[i], split_axis);
+    partition_start = nth[i];
+  }
+
+  MEM_freeN(data.leafs_sorted);
+  MEM_freeN(data.chunk_bins);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Implicit Tree Build
+ * \{ */
+
 typedef struct BVHDivNodesData {
   const BVHTree *tree;
   BVHNode *branches_array;
@@ -688,24 +933,39 @@ typedef struct BVHDivNodesData {
   int first_of_next_level;
 } BVHDivNodesData;
 
-static void non_recursive_bvh_div_nodes_task_cb(void *__restrict userdata,
-                                                const int j,
-                                                const TaskParallelTLS *__restrict UNUSED(tls))
+/**
+ * Split the leafs of branch \a j between its children.
+ *
+ * \param depth: The depth of the branch in the tree.
+ * \param level_start: The index of the first branch at this depth.
+ */
+static void bvh_div_node(const BVHDivNodesData *data,
+                         const int j,
+                         const int depth,
+                         const int level_start)
 {
-  BVHDivNodesData *data = userdata;
-
   int k;
-  const int parent_level_index = j - data->i;
+  const int parent_level_index = j - level_start;
+  const int first_of_next_level = level_start * data->tree_type + data->tree_offset;
   BVHNode *parent = &data->branches_array[j];
   int nth_positions[MAX_TREETYPE + 1];
   char split_axis;
 
-  int parent_leafs_begin = implicit_leafs_index(data->data, data->depth, parent_level_index);
-  int parent_leafs_end = implicit_leafs_index(data->data, data->depth, parent_level_index + 1);
+  int parent_leafs_begin = implicit_leafs_index(data->data, depth, parent_level_index);
+  int parent_leafs_end = implicit_leafs_index(data->data, depth, parent_level_index + 1);
+
+  /* Branches near the root hold most leafs, split those using multiple threads too. */
+  const bool use_parallel_split = (parent_leafs_end - parent_leafs_begin) >
+                                  KDOPBVH_PARALLEL_SPLIT_LEAF_THRESHOLD;
 
   /* This calculates the bounding box of this branch
    * and chooses the largest axis as the axis to divide leafs */
-  refit_kdop_hull(data->tree, parent, parent_leafs_begin, parent_leafs_end);
+  if (use_parallel_split) {
+    refit_kdop_hull_parallel(data->tree, parent, parent_leafs_begin, parent_leafs_end);
+  }
+  else {
+    refit_kdop_hull(data->tree, parent, parent_leafs_begin, parent_leafs_end);
+  }
   split_axis = get_largest_axis(parent->bv);
 
   /* Save split axis (this can be used on ray-tracing to speedup the query time) */
@@ -720,11 +980,17 @@ static void non_recursive_bvh_div_nodes_task_cb(void *__restrict userdata,
   for (k = 1; k < data->tree_type; k++) {
     const int child_index = j * data->tree_type + data->tree_offset + k;
     /* child level index */
-    const int child_level_index = child_index - data->first_of_next_level;
-    nth_positions[k] = implicit_leafs_index(data->data, data->depth + 1, child_level_index);
+    const int child_level_index = child_index - first_of_next_level;
+    nth_positions[k] = implicit_leafs_index(data->data, depth + 1, child_level_index);
   }
 
-  split_leafs(data->leafs_array, nth_positions, data->tree_type, split_axis);
+  if (use_parallel_split) {
+    split_leafs_parallel(
+        data->leafs_array, nth_positions, data->tree_type, split_axis, parent->bv);
+  }
+  else {
+    split_leafs(data->leafs_array, nth_positions, data->tree_type, split_axis);
+  }
 
   /* Setup `children` and `node_num` counters
    * Not really needed but currently most of BVH code
@@ -732,12 +998,11 @@ static void non_recursive_bvh_div_nodes_task_cb(void *__restrict userdata,
   for (k = 0; k < data->tree_type; k++) {
     const int child_index = j * data->tree_type + data->tree_offset + k;
     /* child level index */
-    const int child_level_index = child_index - data->first_of_next_level;
+    const int child_level_index = child_index - first_of_next_level;
 
-    const int child_leafs_begin = implicit_leafs_index(
-        data->data, data->depth + 1, child_level_index);
+    const int child_leafs_begin = implicit_leafs_index(data->data, depth + 1, child_level_index);
     const int child_leafs_end = implicit_leafs_index(
-        data->data, data->depth + 1, child_level_index + 1);
+        data->data, depth + 1, child_level_index + 1);
 
     if (child_leafs_end - child_leafs_begin > 1) {
       parent->children[k] = &data->branches_array[child_index];
@@ -754,6 +1019,69 @@ static void non_recursive_bvh_div_nodes_task_cb(void *__restrict userdata,
   parent->node_num = (char)k;
 }
 
+static void non_recursive_bvh_div_nodes_task_cb(void *__restrict userdata,
+                                                const int j,
+                                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHDivNodesData *data = userdata;
+  bvh_div_node(data, j, data->depth, data->i);
+}
+
+typedef struct BVHDivSubtreeTask {
+  int j;
+  int depth;
+  int level_start;
+} BVHDivSubtreeTask;
+
+static void bvh_div_nodes_subtree_task(TaskPool *__restrict pool, void *taskdata);
+
+/**
+ * Split branch \a j, then recurse into its child branches,
+ * pushing a new task for every child with enough leafs to be worth it.
+ */
+static void bvh_div_nodes_subtree(TaskPool *pool,
+                                  const BVHDivNodesData *data,
+                                  const int j,
+                                  const int depth,
+                                  const int level_start)
+{
+  const BVHNode *parent = &data->branches_array[j];
+  const int first_of_next_level = level_start * data->tree_type + data->tree_offset;
+
+  bvh_div_node(data, j, depth, level_start);
+
+  for (int k = 0; k < parent->node_num; k++) {
+    const int child_index = j * data->tree_type + data->tree_offset + k;
+    if (parent->children[k] != &data->branches_array[child_index]) {
+      /* Leaf. */
+      continue;
+    }
+
+    const int child_level_index = child_index - first_of_next_level;
+    const int child_leafs_num = implicit_leafs_index(
+                                    data->data, depth + 1, child_level_index + 1) -
+                                implicit_leafs_index(data->data, depth + 1, child_level_index);
+
+    if (child_leafs_num > KDOPBVH_THREAD_LEAF_THRESHOLD) {
+      BVHDivSubtreeTask *task = MEM_mallocN(sizeof(*task), __func__);
+      task->j = child_index;
+      task->depth = depth + 1;
+      task->level_start = first_of_next_level;
+      BLI_task_pool_push(pool, bvh_div_nodes_subtree_task, task, true, NULL);
+    }
+    else {
+      bvh_div_nodes_subtree(pool, data, child_index, depth + 1, first_of_next_level);
+    }
+  }
+}
+
+static void bvh_div_nodes_subtree_task(TaskPool *__restrict pool, void *taskdata)
+{
+  const BVHDivNodesData *data = BLI_task_pool_user_data(pool);
+  const BVHDivSubtreeTask *task = taskdata;
+  bvh_div_nodes_subtree(pool, data, task->j, task->depth, task->level_start);
+}
+
 /**
  * This functions builds an optimal implicit tree from the given leafs.
  * Where optimal stands for:
@@ -764,9 +1092,10 @@ static void non_recursive_bvh_div_nodes_task_cb(void *__restrict userdata,
  * This function creates an implicit tree on branches_array,
  * the leafs are given on the leafs_array.
  *
- * The tree is built per depth levels. First branches at depth 1.. then branches at depth 2.. etc..
- * The reason is that we can build level N+1 from level N without any data dependencies..
- * thus it allows to use multi-thread building.
+ * The splits of different branches have no data dependencies,
+ * so large trees are built by recursing into sub-trees from tasks,
+ * without waiting for a whole tree level to be finished.
+ * Small trees are built per depth levels, first branches at depth 1, then branches at depth 2..
  *
  * To archive this is necessary to find how much leafs are accessible from a certain branch,
  * #BVHBuildHelper, #implicit_needed_branches and #implicit_leafs_index
@@ -819,6 +1148,14 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
       .i = 0,
   };
 
+  if (leafs_num > KDOPBVH_THREAD_LEAF_THRESHOLD) {
+    TaskPool *task_pool = BLI_task_pool_create(&cb_data, TASK_PRIORITY_HIGH);
+    bvh_div_nodes_subtree(task_pool, &cb_data, 1, 1, 1);
+    BLI_task_pool_work_and_wait(task_pool);
+    BLI_task_pool_free(task_pool);
+    return;
+  }
+
   /* Loop tree levels (log N) loops */
   for (i = 1, depth = 1; i <= branches_num; i = i * tree_type + tree_offset, depth++) {
     const int first_of_next_level = i * tree_type + tree_offset;
@@ -830,22 +1167,120 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
     cb_data.i = i;
     cb_data.depth = depth;
 
-    if (true) {
-      TaskParallelSettings settings;
-      BLI_parallel_range_settings_defaults(&settings);
-      settings.use_threading = (leafs_num > KDOPBVH_THREAD_LEAF_THRESHOLD);
-      BLI_task_parallel_range(i, i_stop, &cb_data, non_recursive_bvh_div_nodes_task_cb, &settings);
+    TaskParallelTLS tls = {0};
+    for (int i_task = i; i_task < i_stop; i_task++) {
+      non_recursive_bvh_div_nodes_task_cb(&cb_data, i_task, &tls);
     }
-    else {
-      /* Less hassle for debugging. */
-      TaskParallelTLS tls = {0};
-      for (int i_task = i; i_task < i_stop; i_task++) {
-        non_recursive_bvh_div_nodes_task_cb(&cb_data, i_task, &tls);
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Wide Node Bounds
+ *
+ * The bounds of the children of each branch are stored per slab in rows of 4 or 8 lanes,
+ * so the children of a node can be tested against a ray or another node with a few SIMD
+ * instructions instead of one child at a time. Unused lanes hold inverted (empty) bounds.
+ *
+ * Only the x/y/z slabs are stored, other k-DOP axes fall back to the scalar tests.
+ * \{ */
+
+/**
+ * \return the number of lanes of a wide node row, zero when the tree doesn't use wide nodes.
+ */
+static int bvhtree_wide_lanes(const BVHTree *tree)
+{
+  if ((tree->start_axis != 0) || (tree->tree_type > MAX_TREETYPE_WIDE)) {
+    return 0;
+  }
+  return (tree->tree_type <= 4) ? 4 : 8;
+}
+
+static const float *bvhtree_wide_bounds(const BVHTree *tree, const BVHNode *node)
+{
+  const int branch_index = (int)(node - tree->nodearray) - tree->leaf_num;
+  BLI_assert(tree->nodewide != NULL);
+  BLI_assert(branch_index >= 0 && branch_index < tree->branch_num);
+  return &tree->nodewide[(size_t)branch_index * 6 * (size_t)bvhtree_wide_lanes(tree)];
+}
+
+/**
+ * Copy the bounds of the children of the branches in `[branch_start, branch_end)`
+ * into their wide nodes, must run after the branch bounds have been (re)calculated.
+ */
+static void bvhtree_wide_nodes_update_range(const BVHTree *tree,
+                                            const int branch_start,
+                                            const int branch_end)
+{
+  const int lanes = bvhtree_wide_lanes(tree);
+
+  for (int i = branch_start; i < branch_end; i++) {
+    const BVHNode *node = tree->nodes[tree->leaf_num + i];
+    float *wide = &tree->nodewide[(size_t)i * 6 * (size_t)lanes];
+
+    for (int k = 0; k < lanes; k++) {
+      if (k < node->node_num) {
+        const float *bv = node->children[k]->bv;
+        for (int row = 0; row < 6; row++) {
+          wide[row * lanes + k] = bv[row];
+        }
+      }
+      else {
+        for (int row = 0; row < 6; row += 2) {
+          wide[row * lanes + k] = FLT_MAX;
+          wide[(row + 1) * lanes + k] = -FLT_MAX;
+        }
       }
     }
   }
 }
 
+static void bvhtree_wide_nodes_update_task_cb(void *__restrict userdata,
+                                              const int chunk,
+                                              const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHTree *tree = userdata;
+  const int branch_start = chunk * KDOPBVH_THREAD_CHUNK_SIZE;
+  bvhtree_wide_nodes_update_range(
+      tree, branch_start, min_ii(branch_start + KDOPBVH_THREAD_CHUNK_SIZE, tree->branch_num));
+}
+
+static void bvhtree_wide_nodes_update(BVHTree *tree)
+{
+  if (tree->nodewide == NULL) {
+    return;
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (tree->leaf_num > KDOPBVH_THREAD_LEAF_THRESHOLD);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(
+      0,
+      (int)divide_ceil_u((uint)tree->branch_num, KDOPBVH_THREAD_CHUNK_SIZE),
+      tree,
+      bvhtree_wide_nodes_update_task_cb,
+      &settings);
+}
+
+/** Allocate wide nodes for a balanced tree, when the tree type and axis support them. */
+static void bvhtree_wide_nodes_ensure(BVHTree *tree)
+{
+  const int lanes = bvhtree_wide_lanes(tree);
+
+  /* Balancing is expected to happen once, but never leak the previous wide nodes. */
+  MEM_SAFE_FREE(tree->nodewide);
+
+  if ((lanes == 0) || (tree->leaf_num == 0)) {
+    return;
+  }
+
+  tree->nodewide = MEM_mallocN_aligned(
+      sizeof(float) * 6 * (size_t)lanes * (size_t)tree->branch_num, 16, "BVHNodeWide");
+  bvhtree_wide_nodes_update(tree);
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -931,6 +1366,7 @@ void BLI_bvhtree_free(BVHTree *tree)
     MEM_SAFE_FREE(tree->nodearray);
     MEM_SAFE_FREE(tree->nodebv);
     MEM_SAFE_FREE(tree->nodechild);
+    MEM_SAFE_FREE(tree->nodewide);
     MEM_freeN(tree);
   }
 }
@@ -954,6 +1390,8 @@ void BLI_bvhtree_balance(BVHTree *tree)
     tree->nodes[tree->leaf_num + i] = &tree->nodearray[tree->leaf_num + i];
   }
 
+  bvhtree_wide_nodes_ensure(tree);
+
 #ifdef USE_SKIP_LINKS
   build_skip_links(tree, tree->nodes[tree->leaf_num], NULL, NULL);
 #endif
@@ -1019,18 +1457,51 @@ bool BLI_bvhtree_update_node(
   return true;
 }
 
+static void bvhtree_update_tree_task_cb(void *__restrict userdata,
+                                        const int i,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHTree *tree = userdata;
+  node_join(tree, tree->nodes[tree->leaf_num + i]);
+}
+
 void BLI_bvhtree_update_tree(BVHTree *tree)
 {
   /* Update bottom=>top
    * TRICKY: the way we build the tree all the children have an index greater than the parent
    * This allows us todo a bottom up update by starting on the bigger numbered branch. */
 
-  BVHNode **root = tree->nodes + tree->leaf_num;
-  BVHNode **index = tree->nodes + tree->leaf_num + tree->branch_num - 1;
+  if (tree->leaf_num > KDOPBVH_THREAD_LEAF_THRESHOLD) {
+    /* The children of a tree level are all on the next level (or leafs),
+     * so the branches of each level can be joined in parallel, starting with the deepest. */
+    const int tree_offset = 2 - tree->tree_type;
+    int level_starts[32];
+    int levels_num = 0;
+    for (int i = 1; i <= tree->branch_num; i = i * tree->tree_type + tree_offset) {
+      level_starts[levels_num++] = i;
+    }
+
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = KDOPBVH_THREAD_LEAF_THRESHOLD;
 
-  for (; index >= root; index--) {
-    node_join(tree, *index);
+    for (int level = levels_num - 1; level >= 0; level--) {
+      const int i = level_starts[level];
+      const int i_stop = min_ii(i * tree->tree_type + tree_offset, tree->branch_num + 1);
+      /* Level indices start at 1 (the root). */
+      BLI_task_parallel_range(i - 1, i_stop - 1, tree, bvhtree_update_tree_task_cb, &settings);
+    }
   }
+  else {
+    BVHNode **root = tree->nodes + tree->leaf_num;
+    BVHNode **index = tree->nodes + tree->leaf_num + tree->branch_num - 1;
+
+    for (; index >= root; index--) {
+      node_join(tree, *index);
+    }
+  }
+
+  bvhtree_wide_nodes_update(tree);
 }
 int BLI_bvhtree_get_len(const BVHTree *tree)
 {
@@ -1091,6 +1562,68 @@ static bool tree_overlap_test(const BVHNode *node1,
   return 1;
 }
 
+/**
+ * Test all children of the branch \a node (from \a tree) against \a other,
+ * using the wide node bounds when the overlap test only needs the x/y/z slabs.
+ *
+ * \return a bit-mask of the overlapping children.
+ */
+static uint tree_overlap_test_children(const BVHOverlapData_Shared *data,
+                                       const BVHTree *tree,
+                                       const BVHNode *node,
+                                       const BVHNode *other)
+{
+  uint mask = 0;
+
+  if (tree->nodewide && data->start_axis == 0 && data->stop_axis == 3) {
+    const int lanes = bvhtree_wide_lanes(tree);
+    const float *wide = bvhtree_wide_bounds(tree, node);
+    const float *bv = other->bv;
+#ifdef BLI_HAVE_SSE2
+    const __m128 other_min[3] = {_mm_set1_ps(bv[0]), _mm_set1_ps(bv[2]), _mm_set1_ps(bv[4])};
+    const __m128 other_max[3] = {_mm_set1_ps(bv[1]), _mm_set1_ps(bv[3]), _mm_set1_ps(bv[5])};
+    for (int k = 0; k < lanes; k += 4) {
+      __m128 overlap = _mm_castsi128_ps(_mm_set1_epi32(-1));
+      for (int axis = 0; axis < 3; axis++) {
+        const __m128 child_min = _mm_load_ps(&wide[(2 * axis) * lanes + k]);
+        const __m128 child_max = _mm_load_ps(&wide[(2 * axis + 1) * lanes + k]);
+        overlap = _mm_and_ps(overlap, _mm_cmple_ps(other_min[axis], child_max));
+        overlap = _mm_and_ps(overlap, _mm_cmple_ps(child_min, other_max[axis]));
+      }
+      mask |= (uint)_mm_movemask_ps(overlap) << k;
+    }
+#else
+    for (int k = 0; k < lanes; k++) {
+      bool overlap = true;
+      for (int axis = 0; axis < 3; axis++) {
+        if ((bv[2 * axis] > wide[(2 * axis + 1) * lanes + k]) ||
+            (wide[(2 * axis) * lanes + k] > bv[2 * axis + 1])) {
+          overlap = false;
+          break;
+        }
+      }
+      if (overlap) {
+        mask |= 1u << k;
+      }
+    }
+#endif
+    mask &= (1u << node->node_num) - 1u;
+  }
+  else {
+    for (int j = 0; j < node->node_num; j++) {
+      if (tree_overlap_test(node->children[j], other, data->start_axis, data->stop_axis)) {
+        mask |= 1u << j;
+      }
+    }
+  }
+
+  return mask;
+}
+
+/**
+ * Recursively find the overlapping leaves of \a node1 and \a node2,
+ * the nodes themselves are expected to overlap.
+ */
 static void tree_overlap_traverse(BVHOverlapData_Thread *data_thread,
                                   const BVHNode *node1,
                                   const BVHNode *node2)
@@ -1098,38 +1631,38 @@ static void tree_overlap_traverse(BVHOverlapData_Thread *data_thread,
   BVHOverlapData_Shared *data = data_thread->shared;
   int j;
 
-  if (tree_overlap_test(node1, node2, data->start_axis, data->stop_axis)) {
-    /* check if node1 is a leaf */
-    if (!node1->node_num) {
-      /* check if node2 is a leaf */
-      if (!node2->node_num) {
-        BVHTreeOverlap *overlap;
+  /* check if node1 is a leaf */
+  if (!node1->node_num) {
+    /* check if node2 is a leaf */
+    if (!node2->node_num) {
+      BVHTreeOverlap *overlap;
 
-        if (UNLIKELY(node1 == node2)) {
-          return;
-        }
-
-        /* both leafs, insert overlap! */
-        overlap = BLI_stack_push_r(data_thread->overlap);
-        overlap->indexA = node1->index;
-        overlap->indexB = node2->index;
-      }
-      else {
-        for (j = 0; j < data->tree2->tree_type; j++) {
-          if (node2->children[j]) {
-            tree_overlap_traverse(data_thread, node1, node2->children[j]);
-          }
-        }
+      if (UNLIKELY(node1 == node2)) {
+        return;
       }
+
+      /* both leafs, insert overlap! */
+      overlap = BLI_stack_push_r(data_thread->overlap);
+      overlap->indexA = node1->index;
+      overlap->indexB = node2->index;
     }
     else {
-      for (j = 0; j < data->tree1->tree_type; j++) {
-        if (node1->children[j]) {
-          tree_overlap_traverse(data_thread, node1->children[j], node2);
+      const uint mask = tree_overlap_test_children(data, data->tree2, node2, node1);
+      for (j = 0; j < node2->node_num; j++) {
+        if (mask & (1u << j)) {
+          tree_overlap_traverse(data_thread, node1, node2->children[j]);
         }
       }
     }
   }
+  else {
+    const uint mask = tree_overlap_test_children(data, data->tree1, node1, node2);
+    for (j = 0; j < node1->node_num; j++) {
+      if (mask & (1u << j)) {
+        tree_overlap_traverse(data_thread, node1->children[j], node2);
+      }
+    }
+  }
 }
 
 /**
@@ -1142,41 +1675,41 @@ static void tree_overlap_traverse_cb(BVHOverlapData_Thread *data_thread,
   BVHOverlapData_Shared *data = data_thread->shared;
   int j;
 
-  if (tree_overlap_test(node1, node2, data->start_axis, data->stop_axis)) {
-    /* check if node1 is a leaf */
-    if (!node1->node_num) {
-      /* check if node2 is a leaf */
-      if (!node2->node_num) {
-        BVHTreeOverlap *overlap;
+  /* check if node1 is a leaf */
+  if (!node1->node_num) {
+    /* check if node2 is a leaf */
+    if (!node2->node_num) {
+      BVHTreeOverlap *overlap;
 
-        if (UNLIKELY(node1 == node2)) {
-          return;
-        }
-
-        /* only difference to tree_overlap_traverse! */
-        if (data->callback(data->userdata, node1->index, node2->index, data_thread->thread)) {
-          /* both leafs, insert overlap! */
-          overlap = BLI_stack_push_r(data_thread->overlap);
-          overlap->indexA = node1->index;
-          overlap->indexB = node2->index;
-        }
+      if (UNLIKELY(node1 == node2)) {
+        return;
       }
-      else {
-        for (j = 0; j < data->tree2->tree_type; j++) {
-          if (node2->children[j]) {
-            tree_overlap_traverse_cb(data_thread, node1, node2->children[j]);
-          }
-        }
+
+      /* only difference to tree_overlap_traverse! */
+      if (data->callback(data->userdata, node1->index, node2->index, data_thread->thread)) {
+        /* both leafs, insert overlap! */
+        overlap = BLI_stack_push_r(data_thread->overlap);
+        overlap->indexA = node1->index;
+        overlap->indexB = node2->index;
       }
     }
     else {
-      for (j = 0; j < data->tree1->tree_type; j++) {
-        if (node1->children[j]) {
-          tree_overlap_traverse_cb(data_thread, node1->children[j], node2);
+      const uint mask = tree_overlap_test_children(data, data->tree2, node2, node1);
+      for (j = 0; j < node2->node_num; j++) {
+        if (mask & (1u << j)) {
+          tree_overlap_traverse_cb(data_thread, node1, node2->children[j]);
         }
       }
     }
   }
+  else {
+    const uint mask = tree_overlap_test_children(data, data->tree1, node1, node2);
+    for (j = 0; j < node1->node_num; j++) {
+      if (mask & (1u << j)) {
+        tree_overlap_traverse_cb(data_thread, node1->children[j], node2);
+      }
+    }
+  }
 }
 
 /**
@@ -1189,46 +1722,48 @@ static bool tree_overlap_traverse_num(BVHOverlapData_Thread *data_thread,
   BVHOverlapData_Shared *data = data_thread->shared;
   int j;
 
-  if (tree_overlap_test(node1, node2, data->start_axis, data->stop_axis)) {
-    /* check if node1 is a leaf */
-    if (!node1->node_num) {
-      /* check if node2 is a leaf */
-      if (!node2->node_num) {
-        BVHTreeOverlap *overlap;
-
-        if (UNLIKELY(node1 == node2)) {
-          return false;
-        }
+  /* check if node1 is a leaf */
+  if (!node1->node_num) {
+    /* check if node2 is a leaf */
+    if (!node2->node_num) {
+      BVHTreeOverlap *overlap;
 
-        /* only difference to tree_overlap_traverse! */
-        if (!data->callback ||
-            data->callback(data->userdata, node1->index, node2->index, data_thread->thread)) {
-          /* both leafs, insert overlap! */
-          if (data_thread->overlap) {
-            overlap = BLI_stack_push_r(data_thread->overlap);
-            overlap->indexA = node1->index;
-            overlap->indexB = node2->index;
-          }
-          return (--data_thread->max_interactions) == 0;
-        }
+      if (UNLIKELY(node1 == node2)) {
+        return false;
       }
-      else {
-        for (j = 0; j < node2->node_num; j++) {
-          if (tree_overlap_traverse_num(data_thread, node1, node2->children[j])) {
-            return true;
-          }
+
+      /* only difference to tree_overlap_traverse! */
+      if (!data->callback ||
+          data->callback(data->userdata, node1->index, node2->index, data_thread->thread)) {
+        /* both leafs, insert overlap! */
+        if (data_thread->overlap) {
+          overlap = BLI_stack_push_r(data_thread->overlap);
+          overlap->indexA = node1->index;
+          overlap->indexB = node2->index;
         }
+        return (--data_thread->max_interactions) == 0;
       }
     }
     else {
-      const uint max_interactions = data_thread->max_interactions;
-      for (j = 0; j < node1->node_num; j++) {
-        if (tree_overlap_traverse_num(data_thread, node1->children[j], node2)) {
-          data_thread->max_interactions = max_interactions;
+      const uint mask = tree_overlap_test_children(data, data->tree2, node2, node1);
+      for (j = 0; j < node2->node_num; j++) {
+        if ((mask & (1u << j)) &&
+            tree_overlap_traverse_num(data_thread, node1, node2->children[j])) {
+          return true;
         }
       }
     }
   }
+  else {
+    const uint max_interactions = data_thread->max_interactions;
+    const uint mask = tree_overlap_test_children(data, data->tree1, node1, node2);
+    for (j = 0; j < node1->node_num; j++) {
+      if ((mask & (1u << j)) &&
+          tree_overlap_traverse_num(data_thread, node1->children[j], node2)) {
+        data_thread->max_interactions = max_interactions;
+      }
+    }
+  }
   return false;
 }
 
@@ -1237,10 +1772,15 @@ static void tree_overlap_invoke_traverse(BVHOverlapData_Thread *data,
                                          const BVHNode *node1,
                                          const BVHNode *node2)
 {
+  const BVHOverlapData_Shared *data_shared = data->shared;
+  if (!tree_overlap_test(node1, node2, data_shared->start_axis, data_shared->stop_axis)) {
+    return;
+  }
+
   if (data->max_interactions) {
     tree_overlap_traverse_num(data, node1, node2);
   }
-  else if (data->shared->callback) {
+  else if (data_shared->callback) {
     tree_overlap_traverse_cb(data, node1, node2);
   }
   else {
@@ -1251,13 +1791,20 @@ static void tree_overlap_invoke_traverse(BVHOverlapData_Thread *data,
 /** Self-overlap traversal with callback. */
 static void tree_overlap_traverse_self_cb(BVHOverlapData_Thread *data_thread, const BVHNode *node)
 {
+  const BVHOverlapData_Shared *data = data_thread->shared;
+
   for (int i = 0; i < node->node_num; i++) {
     /* Recursively compute self-overlap within each child. */
     tree_overlap_traverse_self_cb(data_thread, node->children[i]);
 
     /* Compute overlap of pairs of children, testing each one only once (assume symmetry). */
-    for (int j = i + 1; j < node->node_num; j++) {
-      tree_overlap_traverse_cb(data_thread, node->children[i], node->children[j]);
+    if (i + 1 < node->node_num) {
+      const uint mask = tree_overlap_test_children(data, data->tree1, node, node->children[i]);
+      for (int j = i + 1; j < node->node_num; j++) {
+        if (mask & (1u << j)) {
+          tree_overlap_traverse_cb(data_thread, node->children[i], node->children[j]);
+        }
+      }
     }
   }
 }
@@ -1265,13 +1812,20 @@ static void tree_overlap_traverse_self_cb(BVHOverlapData_Thread *data_thread, co
 /** Self-overlap traversal without callback. */
 static void tree_overlap_traverse_self(BVHOverlapData_Thread *data_thread, const BVHNode *node)
 {
+  const BVHOverlapData_Shared *data = data_thread->shared;
+
   for (int i = 0; i < node->node_num; i++) {
     /* Recursively compute self-overlap within each child. */
     tree_overlap_traverse_self(data_thread, node->children[i]);
 
     /* Compute overlap of pairs of children, testing each one only once (assume symmetry). */
-    for (int j = i + 1; j < node->node_num; j++) {
-      tree_overlap_traverse(data_thread, node->children[i], node->children[j]);
+    if (i + 1 < node->node_num) {
+      const uint mask = tree_overlap_test_children(data, data->tree1, node, node->children[i]);
+      for (int j = i + 1; j < node->node_num; j++) {
+        if (mask & (1u << j)) {
+          tree_overlap_traverse(data_thread, node->children[i], node->children[j]);
+        }
+      }
     }
   }
 }
@@ -1860,6 +2414,74 @@ static float fast_ray_nearest_hit(const BVHRayCastData *data, const BVHNode *nod
   return max_fff(t1x, t1y, t1z);
 }
 
+/**
+ * Test a ray against all children of a branch,
+ * matching #fast_ray_nearest_hit for each of them.
+ *
+ * \return a bit-mask of the children that are hit closer than the current hit,
+ * the distance to each of them is written to \a r_dist.
+ */
+static uint wide_ray_nearest_hit(const BVHRayCastData *data,
+                                 const BVHNode *node,
+                                 float r_dist[MAX_TREETYPE_WIDE])
+{
+  const int lanes = bvhtree_wide_lanes(data->tree);
+  const float *wide = bvhtree_wide_bounds(data->tree, node);
+  /* Rows of the near & far slabs for each axis, see #bvhtree_ray_cast_data_precalc. */
+  const float *row[6];
+  uint mask = 0;
+
+  for (int i = 0; i < 6; i++) {
+    row[i] = &wide[data->index[i] * lanes];
+  }
+
+#ifdef BLI_HAVE_SSE2
+  const __m128 origin[3] = {_mm_set1_ps(data->ray.origin[0]),
+                            _mm_set1_ps(data->ray.origin[1]),
+                            _mm_set1_ps(data->ray.origin[2])};
+  const __m128 idot_axis[3] = {_mm_set1_ps(data->idot_axis[0]),
+                               _mm_set1_ps(data->idot_axis[1]),
+                               _mm_set1_ps(data->idot_axis[2])};
+  const __m128 hit_dist = _mm_set1_ps(data->hit.dist);
+  const __m128 zero = _mm_setzero_ps();
+
+  for (int k = 0; k < lanes; k += 4) {
+    __m128 t_near = _mm_set1_ps(-FLT_MAX);
+    __m128 t_far = _mm_set1_ps(FLT_MAX);
+    for (int axis = 0; axis < 3; axis++) {
+      const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&row[2 * axis][k]), origin[axis]),
+                                   idot_axis[axis]);
+      const __m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&row[2 * axis + 1][k]), origin[axis]),
+                                   idot_axis[axis]);
+      t_near = _mm_max_ps(t_near, t1);
+      t_far = _mm_min_ps(t_far, t2);
+    }
+    const __m128 hit = _mm_and_ps(
+        _mm_and_ps(_mm_cmple_ps(t_near, t_far), _mm_cmpge_ps(t_far, zero)),
+        _mm_cmplt_ps(t_near, hit_dist));
+    _mm_storeu_ps(&r_dist[k], t_near);
+    mask |= (uint)_mm_movemask_ps(hit) << k;
+  }
+#else
+  for (int k = 0; k < lanes; k++) {
+    float t_near = -FLT_MAX;
+    float t_far = FLT_MAX;
+    for (int axis = 0; axis < 3; axis++) {
+      const float t1 = (row[2 * axis][k] - data->ray.origin[axis]) * data->idot_axis[axis];
+      const float t2 = (row[2 * axis + 1][k] - data->ray.origin[axis]) * data->idot_axis[axis];
+      t_near = max_ff(t_near, t1);
+      t_far = min_ff(t_far, t2);
+    }
+    r_dist[k] = t_near;
+    if ((t_near <= t_far) && (t_far >= 0.0f) && (t_near < data->hit.dist)) {
+      mask |= 1u << k;
+    }
+  }
+#endif
+
+  return mask & ((1u << node->node_num) - 1u);
+}
+
 static void dfs_raycast(BVHRayCastData *data, BVHNode *node)
 {
   int i;
@@ -1936,6 +2558,86 @@ static void dfs_raycast_all(BVHRayCastData *data, BVHNode *node)
   }
 }
 
+/**
+ * A version of #dfs_raycast that tests all children of a branch at once using the wide nodes.
+ * \a node must be a branch which is already known to be hit by the ray.
+ */
+static void dfs_raycast_wide(BVHRayCastData *data, const BVHNode *node)
+{
+  float dist[MAX_TREETYPE_WIDE];
+  const uint mask = wide_ray_nearest_hit(data, node, dist);
+  if (mask == 0) {
+    return;
+  }
+
+  /* pick loop direction to dive into the tree (based on ray direction and split axis) */
+  const bool forward = data->ray_dot_axis[node->main_axis] > 0.0f;
+  for (int iter = 0; iter != node->node_num; iter++) {
+    const int i = forward ? iter : node->node_num - 1 - iter;
+    /* The hit distance may have shrunk while traversing the previous children. */
+    if (!(mask & (1u << i)) || (dist[i] >= data->hit.dist)) {
+      continue;
+    }
+
+    const BVHNode *child = node->children[i];
+    if (child->node_num == 0) {
+      if (data->callback) {
+        data->callback(data->userdata, child->index, &data->ray, &data->hit);
+      }
+      else {
+        data->hit.index = child->index;
+        data->hit.dist = dist[i];
+        madd_v3_v3v3fl(data->hit.co, data->ray.origin, data->ray.direction, dist[i]);
+      }
+    }
+    else {
+      dfs_raycast_wide(data, child);
+    }
+  }
+}
+
+/**
+ * A version of #dfs_raycast_all that tests all children of a branch at once using the wide nodes.
+ */
+static void dfs_raycast_all_wide(BVHRayCastData *data, const BVHNode *node)
+{
+  float dist[MAX_TREETYPE_WIDE];
+  const uint mask = wide_ray_nearest_hit(data, node, dist);
+  if (mask == 0) {
+    return;
+  }
+
+  /* pick loop direction to dive into the tree (based on ray direction and split axis) */
+  const bool forward = data->ray_dot_axis[node->main_axis] > 0.0f;
+  for (int iter = 0; iter != node->node_num; iter++) {
+    const int i = forward ? iter : node->node_num - 1 - iter;
+    if (!(mask & (1u << i))) {
+      continue;
+    }
+
+    const BVHNode *child = node->children[i];
+    if (child->node_num == 0) {
+      /* no need to check for 'data->callback' (using 'all' only makes sense with a callback). */
+      const float hit_dist = data->hit.dist;
+      data->callback(data->userdata, child->index, &data->ray, &data->hit);
+      data->hit.index = -1;
+      data->hit.dist = hit_dist;
+    }
+    else {
+      dfs_raycast_all_wide(data, child);
+    }
+  }
+}
+
+/**
+ * The wide traversal doesn't support a ray radius (neither does #fast_ray_nearest_hit).
+ */
+static bool bvhtree_ray_cast_use_wide(const BVHRayCastData *data, int flag)
+{
+  return (data->tree->nodewide != NULL) && (data->ray.radius == 0.0f) &&
+         ((flag & BVH_RAYCAST_NO_WIDE_NODES) == 0);
+}
+
 static void bvhtree_ray_cast_data_precalc(BVHRayCastData *data, int flag)
 {
   int i;
@@ -2005,7 +2707,14 @@ int BLI_bvhtree_ray_cast_ex(const BVHTree *tree,
   }
 
   if (root) {
-    dfs_raycast(&data, root);
+    if (bvhtree_ray_cast_use_wide(&data, flag)) {
+      if (fast_ray_nearest_hit(&data, root) < data.hit.dist) {
+        dfs_raycast_wide(&data, root);
+      }
+    }
+    else {
+      dfs_raycast(&data, root);
+    }
     //      iterative_raycast(&data, root);
   }
 
@@ -2085,7 +2794,14 @@ void BLI_bvhtree_ray_cast_all_ex(const BVHTree *tree,
   data.hit.dist = hit_dist;
 
   if (root) {
-    dfs_raycast_all(&data, root);
+    if (bvhtree_ray_cast_use_wide(&data, flag)) {
+      if (fast_ray_nearest_hit(&data, root) < data.hit.dist) {
+        dfs_raycast_all_wide(&data, root);
+      }
+    }
+    else {
+      dfs_raycast_all(&data, root);
+    }
   }
 }
 
@@ -11,6 +11,7 @@
  * - Freeing chunks.
  * - Iterating over allocated chunks
  *   (optionally when using the #BLI_MEMPOOL_ALLOW_ITER flag).
+ * - Allocating and freeing from multiple threads, using #BLI_mempool_local caches.
  */
 
 #include <stdlib.h>
@@ -169,6 +170,40 @@ static BLI_mempool_chunk *mempool_chunk_alloc(BLI_mempool *pool)
   return MEM_mallocN(sizeof(BLI_mempool_chunk) + (size_t)pool->csize, "BLI_Mempool Chunk");
 }
 
+/**
+ * Link all elements of a new chunk into a free-list.
+ *
+ * \return The last element of the chunk (terminating the list).
+ */
+static BLI_freenode *mempool_chunk_init_nodes(BLI_mempool *pool, BLI_mempool_chunk *mpchunk)
+{
+  const uint esize = pool->esize;
+  BLI_freenode *curnode = CHUNK_DATA(mpchunk);
+  uint j;
+
+  /* loop through the allocated data, building the pointer structures */
+  j = pool->pchunk;
+  if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+    while (j--) {
+      curnode->next = NODE_STEP_NEXT(curnode);
+      curnode->freeword = FREEWORD;
+      curnode = curnode->next;
+    }
+  }
+  else {
+    while (j--) {
+      curnode->next = NODE_STEP_NEXT(curnode);
+      curnode = curnode->next;
+    }
+  }
+
+  /* terminate the list (rewind one) */
+  curnode = NODE_STEP_PREV(curnode);
+  curnode->next = NULL;
+
+  return curnode;
+}
+
 /**
  * Initialize a chunk and add into \a pool->chunks
  *
@@ -182,9 +217,7 @@ static BLI_freenode *mempool_chunk_add(BLI_mempool *pool,
                                        BLI_mempool_chunk *mpchunk,
                                        BLI_freenode *last_tail)
 {
-  const uint esize = pool->esize;
   BLI_freenode *curnode = CHUNK_DATA(mpchunk);
-  uint j;
 
   /* append */
   if (pool->chunk_tail) {
@@ -202,26 +235,8 @@ static BLI_freenode *mempool_chunk_add(BLI_mempool *pool,
     pool->free = curnode;
   }
 
-  /* loop through the allocated data, building the pointer structures */
-  j = pool->pchunk;
-  if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
-    while (j--) {
-      curnode->next = NODE_STEP_NEXT(curnode);
-      curnode->freeword = FREEWORD;
-      curnode = curnode->next;
-    }
-  }
-  else {
-    while (j--) {
-      curnode->next = NODE_STEP_NEXT(curnode);
-      curnode = curnode->next;
-    }
-  }
-
-  /* terminate the list (rewind one)
-   * will be overwritten if 'curnode' gets passed in again as 'last_tail' */
-  curnode = NODE_STEP_PREV(curnode);
-  curnode->next = NULL;
+  /* will be overwritten if 'curnode' gets passed in again as 'last_tail' */
+  curnode = mempool_chunk_init_nodes(pool, mpchunk);
 
 #ifdef USE_TOTALLOC
   pool->totalloc += pool->pchunk;
@@ -431,6 +446,207 @@ void BLI_mempool_free(BLI_mempool *pool, void *addr)
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Concurrent Allocation
+ *
+ * The pool's free-list is shared between threads, only ever modified by pushing a whole list
+ * or by taking the whole list, which (unlike popping single elements) is free of the ABA problem.
+ * \{ */
+
+/** Take the entire shared free-list. */
+static BLI_freenode *mempool_shared_free_take(BLI_mempool *pool)
+{
+  BLI_freenode *head;
+  do {
+    head = atomic_load_ptr((void **)&pool->free);
+  } while (head && (atomic_cas_ptr((void **)&pool->free, head, NULL) != head));
+  return head;
+}
+
+/** Push the list from \a head to \a tail onto the shared free-list. */
+static void mempool_shared_free_push(BLI_mempool *pool, BLI_freenode *head, BLI_freenode *tail)
+{
+  BLI_freenode *head_prev;
+  do {
+    head_prev = atomic_load_ptr((void **)&pool->free);
+    tail->next = head_prev;
+  } while (atomic_cas_ptr((void **)&pool->free, head_prev, head) != head_prev);
+}
+
+/**
+ * Put back the remainder of a taken free-list starting at \a head, without walking it.
+ * Usually no other thread pushed elements since the list was taken, otherwise those are taken
+ * and prepended, so only elements pushed in the meantime are walked to find their tail.
+ */
+static void mempool_shared_free_put_back(BLI_mempool *pool, BLI_freenode *head)
+{
+  while (atomic_cas_ptr((void **)&pool->free, NULL, head) != NULL) {
+    BLI_freenode *pushed_head = mempool_shared_free_take(pool);
+    if (pushed_head == NULL) {
+      continue;
+    }
+    BLI_freenode *pushed_tail = pushed_head;
+    while (pushed_tail->next) {
+      pushed_tail = pushed_tail->next;
+    }
+    pushed_tail->next = head;
+    head = pushed_head;
+  }
+}
+
+/** Append a chunk to the pool, keeping the chunk order for iteration. */
+static void mempool_chunk_append_concurrent(BLI_mempool *pool, BLI_mempool_chunk *mpchunk)
+{
+  BLI_mempool_chunk *chunk_tail_prev;
+  mpchunk->next = NULL;
+  do {
+    chunk_tail_prev = atomic_load_ptr((void **)&pool->chunk_tail);
+  } while (atomic_cas_ptr((void **)&pool->chunk_tail, chunk_tail_prev, mpchunk) !=
+           chunk_tail_prev);
+
+  /* Only this thread links to the new chunk, concurrent appends link to its successors. */
+  if (chunk_tail_prev) {
+    chunk_tail_prev->next = mpchunk;
+  }
+  else {
+    pool->chunks = mpchunk;
+  }
+}
+
+/** Fill the empty free-list of \a local, with at most one chunk worth of elements. */
+static void mempool_local_refill(BLI_mempool_local *local)
+{
+  BLI_mempool *pool = local->pool;
+  BLI_freenode *head = mempool_shared_free_take(pool);
+
+  if (head) {
+    /* Keep one chunk worth of elements, so other threads don't have to allocate new chunks. */
+    BLI_freenode *tail = head;
+    uint len = 1;
+    while (tail->next && len < pool->pchunk) {
+      tail = tail->next;
+      len++;
+    }
+    /* Only the detached elements are walked, the shared list can be much longer. */
+    if (tail->next) {
+      BLI_freenode *rest_head = tail->next;
+      tail->next = NULL;
+      mempool_shared_free_put_back(pool, rest_head);
+    }
+    local->free = head;
+    local->free_tail = tail;
+    local->free_len = len;
+    return;
+  }
+
+  BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
+  local->free_tail = mempool_chunk_init_nodes(pool, mpchunk);
+  local->free = CHUNK_DATA(mpchunk);
+  local->free_len = pool->pchunk;
+  mempool_chunk_append_concurrent(pool, mpchunk);
+}
+
+void BLI_mempool_local_init(BLI_mempool *pool, BLI_mempool_local *local)
+{
+  local->pool = pool;
+  local->free = NULL;
+  local->free_tail = NULL;
+  local->free_len = 0;
+  local->used_delta = 0;
+}
+
+void *BLI_mempool_local_alloc(BLI_mempool_local *local)
+{
+  BLI_freenode *free_pop;
+
+  if (UNLIKELY(local->free == NULL)) {
+    mempool_local_refill(local);
+  }
+
+  free_pop = local->free;
+
+  if (local->pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+    free_pop->freeword = USEDWORD;
+  }
+
+  local->free = free_pop->next;
+  local->free_len--;
+  local->used_delta++;
+
+#ifdef WITH_MEM_VALGRIND
+  VALGRIND_MEMPOOL_ALLOC(local->pool, free_pop, local->pool->esize);
+#endif
+
+  return (void *)free_pop;
+}
+
+void *BLI_mempool_local_calloc(BLI_mempool_local *local)
+{
+  void *retval = BLI_mempool_local_alloc(local);
+  memset(retval, 0, (size_t)local->pool->esize);
+  return retval;
+}
+
+void BLI_mempool_local_free(BLI_mempool_local *local, void *addr)
+{
+  BLI_mempool *pool = local->pool;
+  BLI_freenode *newhead = addr;
+
+#ifndef NDEBUG
+  /* Enable for debugging. */
+  if (UNLIKELY(mempool_debug_memset)) {
+    memset(addr, 255, pool->esize);
+  }
+#endif
+
+  if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+#ifndef NDEBUG
+    /* This will detect double free's. */
+    BLI_assert(newhead->freeword != FREEWORD);
+#endif
+    newhead->freeword = FREEWORD;
+  }
+
+  if (local->free == NULL) {
+    local->free_tail = newhead;
+  }
+  newhead->next = local->free;
+  local->free = newhead;
+  local->free_len++;
+  local->used_delta--;
+
+#ifdef WITH_MEM_VALGRIND
+  VALGRIND_MEMPOOL_FREE(pool, addr);
+#endif
+
+  /* Don't let a thread which mostly frees hold on to the memory. */
+  if (UNLIKELY(local->free_len >= pool->pchunk * 2)) {
+    mempool_shared_free_push(pool, local->free, local->free_tail);
+    local->free = NULL;
+    local->free_tail = NULL;
+    local->free_len = 0;
+  }
+}
+
+void BLI_mempool_local_flush(BLI_mempool_local *local)
+{
+  BLI_mempool *pool = local->pool;
+
+  if (local->free) {
+    mempool_shared_free_push(pool, local->free, local->free_tail);
+    local->free = NULL;
+    local->free_tail = NULL;
+    local->free_len = 0;
+  }
+  if (local->used_delta) {
+    /* Wrapping unsigned arithmetic handles negative values too. */
+    atomic_add_and_fetch_u(&pool->totused, (uint)local->used_delta);
+    local->used_delta = 0;
+  }
+}
+
+/** \} */
+
 int BLI_mempool_len(const BLI_mempool *pool)
 {
   return (int)pool->totused;
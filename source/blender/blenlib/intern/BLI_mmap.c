@@ -5,6 +5,10 @@
  * \ingroup bli
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE /* For mremap. */
+#endif
+
 #include "BLI_mmap.h"
 #include "BLI_fileops.h"
 #include "BLI_listbase.h"
@@ -32,6 +36,11 @@ struct BLI_mmap_file {
   /* Platform-specific handle for the mapping. */
   void *handle;
 
+  /* The mapped memory can be written to, see #BLI_mmap_open_copy_on_write. */
+  bool copy_on_write;
+  /* The memory doesn't map the file anymore, see #BLI_mmap_detach. */
+  bool is_detached;
+
   /* Flag to indicate IO errors. Needs to be volatile since it's being set from
    * within the signal handler, which is not part of the normal execution flow. */
   volatile bool io_error;
@@ -128,7 +137,7 @@ static void sigbus_handler_remove(BLI_mmap_file *file)
 }
 #endif
 
-BLI_mmap_file *BLI_mmap_open(int fd)
+static BLI_mmap_file *mmap_open_ex(int fd, const bool copy_on_write)
 {
   void *memory, *handle = NULL;
   size_t length = BLI_lseek(fd, 0, SEEK_END);
@@ -140,7 +149,8 @@ BLI_mmap_file *BLI_mmap_open(int fd)
   }
 
   /* Map the given file to memory. */
-  memory = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  memory = mmap(
+      NULL, length, copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
   if (memory == MAP_FAILED) {
     return NULL;
   }
@@ -150,11 +160,12 @@ BLI_mmap_file *BLI_mmap_open(int fd)
   /* Memory mapping on Windows is a two-step process - first we create a mapping,
    * then we create a view into that mapping.
    * In our case, one view that spans the entire file is enough. */
-  handle = CreateFileMapping(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+  handle = CreateFileMapping(
+      file_handle, NULL, copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
   if (handle == NULL) {
     return NULL;
   }
-  memory = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0);
+  memory = MapViewOfFile(handle, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
   if (memory == NULL) {
     CloseHandle(handle);
     return NULL;
@@ -166,6 +177,7 @@ BLI_mmap_file *BLI_mmap_open(int fd)
   file->memory = memory;
   file->handle = handle;
   file->length = length;
+  file->copy_on_write = copy_on_write;
 
 #ifndef WIN32
   /* Register the file with the error handler. */
@@ -175,6 +187,16 @@ BLI_mmap_file *BLI_mmap_open(int fd)
   return file;
 }
 
+BLI_mmap_file *BLI_mmap_open(int fd)
+{
+  return mmap_open_ex(fd, false);
+}
+
+BLI_mmap_file *BLI_mmap_open_copy_on_write(int fd)
+{
+  return mmap_open_ex(fd, true);
+}
+
 bool BLI_mmap_read(BLI_mmap_file *file, void *dest, size_t offset, size_t length)
 {
   /* If a previous read has already failed or we try to read past the end,
@@ -207,14 +229,90 @@ void *BLI_mmap_get_pointer(BLI_mmap_file *file)
   return file->memory;
 }
 
-void BLI_mmap_free(BLI_mmap_file *file)
+bool BLI_mmap_detach(BLI_mmap_file *file)
 {
+  if (file->is_detached) {
+    return true;
+  }
+
 #ifndef WIN32
-  munmap((void *)file->memory, file->length);
+  void *memory = mmap(
+      NULL, file->length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) {
+    return false;
+  }
+  if (!BLI_mmap_read(file, memory, 0, file->length)) {
+    munmap(memory, file->length);
+    return false;
+  }
+#  ifdef __linux__
+  /* Replace the mapping at once, other threads may still read the memory. */
+  if (mremap(memory, file->length, file->length, MREMAP_MAYMOVE | MREMAP_FIXED, file->memory) ==
+      MAP_FAILED) {
+    munmap(memory, file->length);
+    return false;
+  }
+#  else
+  if (mmap(file->memory,
+           file->length,
+           PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED,
+           -1,
+           0) == MAP_FAILED) {
+    munmap(memory, file->length);
+    return false;
+  }
+  memcpy(file->memory, memory, file->length);
+  munmap(memory, file->length);
+#  endif
   sigbus_handler_remove(file);
 #else
+  void *memory = MEM_mallocN(file->length, __func__);
+  if (!BLI_mmap_read(file, memory, 0, file->length)) {
+    MEM_freeN(memory);
+    return false;
+  }
   UnmapViewOfFile(file->memory);
+  if (VirtualAlloc(file->memory, file->length, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE) ==
+      NULL) {
+    /* The address range got used in the meantime, map the file again. */
+    if (MapViewOfFileEx(file->handle,
+                        file->copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ,
+                        0,
+                        0,
+                        0,
+                        file->memory) == NULL) {
+      fprintf(stderr, "Error restoring memory-mapped file after failing to detach it\n");
+      abort();
+    }
+    MEM_freeN(memory);
+    return false;
+  }
+  memcpy(file->memory, memory, file->length);
+  MEM_freeN(memory);
   CloseHandle(file->handle);
+  file->handle = NULL;
+#endif
+
+  file->is_detached = true;
+  return true;
+}
+
+void BLI_mmap_free(BLI_mmap_file *file)
+{
+#ifndef WIN32
+  munmap((void *)file->memory, file->length);
+  if (!file->is_detached) {
+    sigbus_handler_remove(file);
+  }
+#else
+  if (file->is_detached) {
+    VirtualFree(file->memory, 0, MEM_RELEASE);
+  }
+  else {
+    UnmapViewOfFile(file->memory);
+    CloseHandle(file->handle);
+  }
 #endif
 
   MEM_freeN(file);
@@ -12,9 +12,51 @@
 #include "BLI_endian_switch.h"
 #include "BLI_filereader.h"
 #include "BLI_math_base.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
+/**
+ * Upper limit for the number of frames kept in memory for prefetching,
+ * frames are usually 1MB (see `ZSTD_CHUNK_SIZE` in `writefile.cc`).
+ */
+#define ZSTD_PREFETCH_FRAMES_MAX 8
+/**
+ * Number of frames read in a row before reading ahead. Reading only the header or a few
+ * data-blocks (e.g. for previews or linking) shouldn't decompress frames which are never used.
+ */
+#define ZSTD_PREFETCH_SEQUENTIAL_MIN 2
+
+typedef enum eZstdFrameState {
+  ZSTD_FRAME_EMPTY = 0,
+  /** Compressed data was read, waiting to be decompressed by whoever takes it first. */
+  ZSTD_FRAME_QUEUED,
+  ZSTD_FRAME_RUNNING,
+  ZSTD_FRAME_READY,
+  ZSTD_FRAME_ERROR,
+} eZstdFrameState;
+
+/** A frame being prefetched, slots are reused for every #ZstdReader.prefetch.slots_num frame. */
+typedef struct ZstdFrameSlot {
+  int frame;
+  /**
+   * #eZstdFrameState. Taking a queued frame is done atomically, finishing it is done while
+   * holding #ZstdReader.prefetch.mutex.
+   */
+  int32_t state;
+
+  ZSTD_DCtx *ctx;
+  char *compressed_data;
+  size_t compressed_size;
+  size_t compressed_size_alloc;
+  char *uncompressed_data;
+  size_t uncompressed_size;
+  size_t uncompressed_size_alloc;
+} ZstdFrameSlot;
+
 typedef struct {
   FileReader reader;
 
@@ -32,6 +74,22 @@ typedef struct {
     char *cached_content;
     int cached_frame;
   } seek;
+
+  /**
+   * Decompression of the frames following the frame being read, used for seekable files when
+   * multiple threads are available. Reading from the base file is only done by the thread
+   * calling #FileReader.read, only decompression is done by the task pool.
+   */
+  struct {
+    TaskPool *pool;
+    ZstdFrameSlot *slots;
+    int slots_num;
+    int last_frame;
+    /** Number of frames read in a row following #last_frame. */
+    int sequential_num;
+    ThreadMutex mutex;
+    ThreadCondition condition;
+  } prefetch;
 } ZstdReader;
 
 static bool zstd_read_u32(FileReader *base, uint32_t *val)
@@ -154,6 +212,178 @@ static int zstd_frame_from_pos(ZstdReader *zstd, size_t pos)
   return low;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Frame Prefetching
+ * \{ */
+
+static void zstd_prefetch_decompress(ZstdReader *zstd, ZstdFrameSlot *slot)
+{
+  if (slot->ctx == NULL) {
+    slot->ctx = ZSTD_createDCtx();
+  }
+  size_t res = ZSTD_decompressDCtx(slot->ctx,
+                                   slot->uncompressed_data,
+                                   slot->uncompressed_size,
+                                   slot->compressed_data,
+                                   slot->compressed_size);
+  const bool success = !ZSTD_isError(res) && res >= slot->uncompressed_size;
+
+  BLI_mutex_lock(&zstd->prefetch.mutex);
+  slot->state = success ? ZSTD_FRAME_READY : ZSTD_FRAME_ERROR;
+  BLI_condition_notify_all(&zstd->prefetch.condition);
+  BLI_mutex_unlock(&zstd->prefetch.mutex);
+}
+
+static void zstd_prefetch_task(TaskPool *__restrict pool, void *taskdata)
+{
+  ZstdReader *zstd = BLI_task_pool_user_data(pool);
+  ZstdFrameSlot *slot = taskdata;
+  /* The frame may already have been taken by the reading thread or canceled. */
+  if (atomic_cas_int32(&slot->state, ZSTD_FRAME_QUEUED, ZSTD_FRAME_RUNNING) ==
+      ZSTD_FRAME_QUEUED) {
+    zstd_prefetch_decompress(zstd, slot);
+  }
+}
+
+/**
+ * Wait until the slot isn't used by a task anymore.
+ * \return true when it contains decompressed data.
+ */
+static bool zstd_prefetch_wait(ZstdReader *zstd, ZstdFrameSlot *slot)
+{
+  /* Decompress here instead of waiting for a task that didn't start yet. */
+  if (atomic_cas_int32(&slot->state, ZSTD_FRAME_QUEUED, ZSTD_FRAME_RUNNING) ==
+      ZSTD_FRAME_QUEUED) {
+    zstd_prefetch_decompress(zstd, slot);
+  }
+
+  BLI_mutex_lock(&zstd->prefetch.mutex);
+  while (slot->state == ZSTD_FRAME_RUNNING) {
+    BLI_condition_wait(&zstd->prefetch.condition, &zstd->prefetch.mutex);
+  }
+  const bool success = (slot->state == ZSTD_FRAME_READY);
+  BLI_mutex_unlock(&zstd->prefetch.mutex);
+  return success;
+}
+
+/** Take back the slot from the task pool, so it can be reused for another frame. */
+static void zstd_prefetch_release(ZstdReader *zstd, ZstdFrameSlot *slot)
+{
+  if (atomic_cas_int32(&slot->state, ZSTD_FRAME_QUEUED, ZSTD_FRAME_EMPTY) != ZSTD_FRAME_QUEUED) {
+    zstd_prefetch_wait(zstd, slot);
+  }
+  slot->state = ZSTD_FRAME_EMPTY;
+  slot->frame = -1;
+}
+
+/** Read the compressed data of the frame, leaving the slot queued for decompression. */
+static bool zstd_prefetch_queue(ZstdReader *zstd, ZstdFrameSlot *slot, int frame)
+{
+  zstd_prefetch_release(zstd, slot);
+
+  slot->compressed_size = zstd->seek.compressed_ofs[frame + 1] -
+                          zstd->seek.compressed_ofs[frame];
+  slot->uncompressed_size = zstd->seek.uncompressed_ofs[frame + 1] -
+                            zstd->seek.uncompressed_ofs[frame];
+  if (slot->compressed_size > slot->compressed_size_alloc) {
+    MEM_SAFE_FREE(slot->compressed_data);
+    slot->compressed_data = MEM_mallocN(slot->compressed_size, __func__);
+    slot->compressed_size_alloc = slot->compressed_size;
+  }
+  if (slot->uncompressed_size > slot->uncompressed_size_alloc) {
+    MEM_SAFE_FREE(slot->uncompressed_data);
+    slot->uncompressed_data = MEM_mallocN(slot->uncompressed_size, __func__);
+    slot->uncompressed_size_alloc = slot->uncompressed_size;
+  }
+
+  slot->frame = frame;
+  if (zstd->base->seek(zstd->base, zstd->seek.compressed_ofs[frame], SEEK_SET) < 0 ||
+      zstd->base->read(zstd->base, slot->compressed_data, slot->compressed_size) <
+          slot->compressed_size) {
+    slot->state = ZSTD_FRAME_ERROR;
+    return false;
+  }
+  /* Publishes the data above to the task taking the frame. */
+  atomic_cas_int32(&slot->state, ZSTD_FRAME_EMPTY, ZSTD_FRAME_QUEUED);
+  return true;
+}
+
+static const char *zstd_prefetch_ensure_frame(ZstdReader *zstd, int frame)
+{
+  const int slots_num = zstd->prefetch.slots_num;
+  ZstdFrameSlot *slot = &zstd->prefetch.slots[frame % slots_num];
+  if (slot->frame != frame && !zstd_prefetch_queue(zstd, slot, frame)) {
+    return NULL;
+  }
+
+  /* Only read ahead when reading sequentially, on-demand reading of data-blocks jumps around
+   * in the file and would throw away most of the prefetched frames. */
+  zstd->prefetch.sequential_num = (frame == zstd->prefetch.last_frame + 1) ?
+                                      zstd->prefetch.sequential_num + 1 :
+                                      0;
+  if (zstd->prefetch.sequential_num >= ZSTD_PREFETCH_SEQUENTIAL_MIN) {
+    const int frame_end = min_ii(frame + slots_num, zstd->seek.frames_num);
+    for (int next_frame = frame + 1; next_frame < frame_end; next_frame++) {
+      ZstdFrameSlot *next_slot = &zstd->prefetch.slots[next_frame % slots_num];
+      if (next_slot->frame == next_frame) {
+        continue;
+      }
+      if (!zstd_prefetch_queue(zstd, next_slot, next_frame)) {
+        break;
+      }
+      BLI_task_pool_push(zstd->prefetch.pool, zstd_prefetch_task, next_slot, false, NULL);
+    }
+  }
+  zstd->prefetch.last_frame = frame;
+
+  if (!zstd_prefetch_wait(zstd, slot)) {
+    return NULL;
+  }
+  return slot->uncompressed_data;
+}
+
+static void zstd_prefetch_init(ZstdReader *zstd)
+{
+  const int threads_num = BLI_task_scheduler_num_threads();
+  if (threads_num < 2 || zstd->seek.frames_num < 2) {
+    return;
+  }
+  zstd->prefetch.slots_num = min_ii(threads_num + 1, ZSTD_PREFETCH_FRAMES_MAX);
+  zstd->prefetch.slots = MEM_calloc_arrayN(
+      zstd->prefetch.slots_num, sizeof(ZstdFrameSlot), __func__);
+  for (int i = 0; i < zstd->prefetch.slots_num; i++) {
+    zstd->prefetch.slots[i].frame = -1;
+  }
+  zstd->prefetch.last_frame = -1;
+  BLI_mutex_init(&zstd->prefetch.mutex);
+  BLI_condition_init(&zstd->prefetch.condition);
+  zstd->prefetch.pool = BLI_task_pool_create(zstd, TASK_PRIORITY_HIGH);
+}
+
+static void zstd_prefetch_free(ZstdReader *zstd)
+{
+  for (int i = 0; i < zstd->prefetch.slots_num; i++) {
+    zstd_prefetch_release(zstd, &zstd->prefetch.slots[i]);
+  }
+  /* Remaining tasks find their slot released and return immediately. */
+  BLI_task_pool_work_and_wait(zstd->prefetch.pool);
+  BLI_task_pool_free(zstd->prefetch.pool);
+
+  for (int i = 0; i < zstd->prefetch.slots_num; i++) {
+    ZstdFrameSlot *slot = &zstd->prefetch.slots[i];
+    if (slot->ctx) {
+      ZSTD_freeDCtx(slot->ctx);
+    }
+    MEM_SAFE_FREE(slot->compressed_data);
+    MEM_SAFE_FREE(slot->uncompressed_data);
+  }
+  MEM_freeN(zstd->prefetch.slots);
+  BLI_mutex_end(&zstd->prefetch.mutex);
+  BLI_condition_end(&zstd->prefetch.condition);
+}
+
+/** \} */
+
 /* Ensure that the currently loaded frame is the correct one. */
 static const char *zstd_ensure_cache(ZstdReader *zstd, int frame)
 {
@@ -162,6 +392,14 @@ static const char *zstd_ensure_cache(ZstdReader *zstd, int frame)
     return zstd->seek.cached_content;
   }
 
+  if (zstd->prefetch.pool) {
+    /* The content is owned by the prefetch slot, it stays valid until another frame is read. */
+    const char *content = zstd_prefetch_ensure_frame(zstd, frame);
+    zstd->seek.cached_frame = content ? frame : -1;
+    zstd->seek.cached_content = (char *)content;
+    return content;
+  }
+
   /* Cached frame doesn't match, so discard it and cache the wanted one instead. */
   MEM_SAFE_FREE(zstd->seek.cached_content);
 
@@ -281,8 +519,11 @@ static void zstd_close(FileReader *reader)
   if (zstd->reader.seek) {
     MEM_freeN(zstd->seek.uncompressed_ofs);
     MEM_freeN(zstd->seek.compressed_ofs);
+    if (zstd->prefetch.pool) {
+      zstd_prefetch_free(zstd);
+    }
     /* When an error has occurred this may be NULL, see: T99744. */
-    if (zstd->seek.cached_content) {
+    else if (zstd->seek.cached_content) {
       MEM_freeN(zstd->seek.cached_content);
     }
   }
@@ -304,6 +545,7 @@ FileReader *BLI_filereader_new_zstd(FileReader *base)
   if (zstd_read_seek_table(zstd)) {
     zstd->reader.read = zstd_read_seekable;
     zstd->reader.seek = zstd_seek;
+    zstd_prefetch_init(zstd);
   }
   else {
     zstd->reader.read = zstd_read;
@@ -0,0 +1,33 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include <algorithm>
+
+#include "BLI_array.hh"
+#include "BLI_hash.hh"
+#include "BLI_hash_mm2a.h"
+#include "BLI_task.hh"
+
+namespace blender {
+
+uint64_t hash_buffer(const void *data, const int64_t size)
+{
+  constexpr int64_t chunk_size = 1 << 20;
+  const int64_t chunks_num = (size + chunk_size - 1) / chunk_size;
+  Array<uint32_t> chunk_hashes(chunks_num);
+  threading::parallel_for(IndexRange(chunks_num), 1, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      const int64_t offset = i * chunk_size;
+      chunk_hashes[i] = BLI_hash_mm2(static_cast<const uchar *>(data) + offset,
+                                     size_t(std::min(chunk_size, size - offset)),
+                                     0);
+    }
+  });
+
+  uint64_t hash = get_default_hash(size);
+  for (const uint32_t chunk_hash : chunk_hashes) {
+    hash = get_default_hash_2(hash, chunk_hash);
+  }
+  return hash;
+}
+
+}  // namespace blender
@@ -9,6 +9,7 @@
 #include "BLI_kdtree_impl.h"
 #include "BLI_math.h"
 #include "BLI_strict_flags.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #define _BLI_KDTREE_CONCAT_AUX(MACRO_ARG1, MACRO_ARG2) MACRO_ARG1##MACRO_ARG2
@@ -50,6 +51,9 @@ struct KDTree {
  */
 #define KD_NODE_ROOT_IS_INIT ((uint)-2)
 
+/** Balance sub-trees with at least this many nodes in a separate task. */
+#define KD_BALANCE_THREAD_THRESHOLD 8192
+
 /* -------------------------------------------------------------------- */
 /** \name Local Math API
  * \{ */
@@ -131,7 +135,18 @@ void BLI_kdtree_nd_(insert)(KDTree *tree, int index, const float co[KD_DIMS])
 #endif
 }
 
-static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs)
+static void kdtree_balance_subtree(TaskPool *pool,
+                                   uint *r_node,
+                                   KDTreeNode *nodes,
+                                   uint nodes_len,
+                                   uint axis,
+                                   uint ofs);
+
+/**
+ * \param pool: When not NULL, large sub-trees are balanced in tasks pushed to this pool.
+ */
+static uint kdtree_balance(
+    TaskPool *pool, KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs)
 {
   KDTreeNode *node;
   float co;
@@ -180,13 +195,50 @@ static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const u
   node = &nodes[median];
   node->d = axis;
   axis = (axis + 1) % KD_DIMS;
-  node->left = kdtree_balance(nodes, median, axis, ofs);
-  node->right = kdtree_balance(
-      nodes + median + 1, (nodes_len - (median + 1)), axis, (median + 1) + ofs);
+  /* The sub-trees only reorder nodes in their own range, so they can be balanced in parallel,
+   * writing their root into the (already placed) median node. */
+  kdtree_balance_subtree(pool, &node->left, nodes, median, axis, ofs);
+  kdtree_balance_subtree(
+      pool, &node->right, nodes + median + 1, (nodes_len - (median + 1)), axis, (median + 1) + ofs);
 
   return median + ofs;
 }
 
+typedef struct KDTreeBalanceTask {
+  uint *r_node;
+  KDTreeNode *nodes;
+  uint nodes_len;
+  uint axis;
+  uint ofs;
+} KDTreeBalanceTask;
+
+static void kdtree_balance_task(TaskPool *__restrict pool, void *taskdata)
+{
+  const KDTreeBalanceTask *task = taskdata;
+  *task->r_node = kdtree_balance(pool, task->nodes, task->nodes_len, task->axis, task->ofs);
+}
+
+static void kdtree_balance_subtree(TaskPool *pool,
+                                   uint *r_node,
+                                   KDTreeNode *nodes,
+                                   uint nodes_len,
+                                   uint axis,
+                                   uint ofs)
+{
+  if (pool && (nodes_len >= KD_BALANCE_THREAD_THRESHOLD)) {
+    KDTreeBalanceTask *task = MEM_mallocN(sizeof(*task), __func__);
+    task->r_node = r_node;
+    task->nodes = nodes;
+    task->nodes_len = nodes_len;
+    task->axis = axis;
+    task->ofs = ofs;
+    BLI_task_pool_push(pool, kdtree_balance_task, task, true, NULL);
+  }
+  else {
+    *r_node = kdtree_balance(pool, nodes, nodes_len, axis, ofs);
+  }
+}
+
 void BLI_kdtree_nd_(balance)(KDTree *tree)
 {
   if (tree->root != KD_NODE_ROOT_IS_INIT) {
@@ -196,7 +248,15 @@ void BLI_kdtree_nd_(balance)(KDTree *tree)
     }
   }
 
-  tree->root = kdtree_balance(tree->nodes, tree->nodes_len, 0, 0);
+  if (tree->nodes_len >= KD_BALANCE_THREAD_THRESHOLD * 2) {
+    TaskPool *task_pool = BLI_task_pool_create(NULL, TASK_PRIORITY_HIGH);
+    tree->root = kdtree_balance(task_pool, tree->nodes, tree->nodes_len, 0, 0);
+    BLI_task_pool_work_and_wait(task_pool);
+    BLI_task_pool_free(task_pool);
+  }
+  else {
+    tree->root = kdtree_balance(NULL, tree->nodes, tree->nodes_len, 0, 0);
+  }
 
 #ifdef DEBUG
   tree->is_balanced = true;
@@ -217,11 +277,15 @@ static uint *realloc_nodes(uint *stack, uint *stack_len_capacity, const bool is_
 }
 
 /**
- * Find nearest returns index, and -1 if no node is found.
+ * Find the node nearest to \a co.
+ *
+ * \param hint: Optional node known to be close to \a co (the result of a nearby query),
+ * used to skip sub-trees which can't contain anything nearer early on.
  */
-int BLI_kdtree_nd_(find_nearest)(const KDTree *tree,
-                                 const float co[KD_DIMS],
-                                 KDTreeNearest *r_nearest)
+static const KDTreeNode *kdtree_find_nearest_node(const KDTree *tree,
+                                                  const float co[KD_DIMS],
+                                                  const KDTreeNode *hint,
+                                                  float *r_dist_sq)
 {
   const KDTreeNode *nodes = tree->nodes;
   const KDTreeNode *root, *min_node;
@@ -229,14 +293,6 @@ int BLI_kdtree_nd_(find_nearest)(const KDTree *tree,
   float min_dist, cur_dist;
   uint stack_len_capacity, cur = 0;
 
-#ifdef DEBUG
-  BLI_assert(tree->is_balanced == true);
-#endif
-
-  if (UNLIKELY(tree->root == KD_NODE_UNSET)) {
-    return -1;
-  }
-
   stack = stack_default;
   stack_len_capacity = KD_STACK_INIT;
 
@@ -244,6 +300,14 @@ int BLI_kdtree_nd_(find_nearest)(const KDTree *tree,
   min_node = root;
   min_dist = len_squared_vnvn(root->co, co);
 
+  if (hint) {
+    cur_dist = len_squared_vnvn(hint->co, co);
+    if (cur_dist < min_dist) {
+      min_dist = cur_dist;
+      min_node = hint;
+    }
+  }
+
   if (co[root->d] < root->co[root->d]) {
     if (root->right != KD_NODE_UNSET) {
       stack[cur++] = root->right;
@@ -305,16 +369,40 @@ int BLI_kdtree_nd_(find_nearest)(const KDTree *tree,
     }
   }
 
+  if (stack != stack_default) {
+    MEM_freeN(stack);
+  }
+
+  *r_dist_sq = min_dist;
+  return min_node;
+}
+
+/**
+ * Find nearest returns index, and -1 if no node is found.
+ */
+int BLI_kdtree_nd_(find_nearest)(const KDTree *tree,
+                                 const float co[KD_DIMS],
+                                 KDTreeNearest *r_nearest)
+{
+  const KDTreeNode *min_node;
+  float min_dist;
+
+#ifdef DEBUG
+  BLI_assert(tree->is_balanced == true);
+#endif
+
+  if (UNLIKELY(tree->root == KD_NODE_UNSET)) {
+    return -1;
+  }
+
+  min_node = kdtree_find_nearest_node(tree, co, NULL, &min_dist);
+
   if (r_nearest) {
     r_nearest->index = min_node->index;
     r_nearest->dist = sqrtf(min_dist);
     copy_vn_vn(r_nearest->co, min_node->co);
   }
 
-  if (stack != stack_default) {
-    MEM_freeN(stack);
-  }
-
   return min_node->index;
 }
 
@@ -806,6 +894,179 @@ static uint *kdtree_order(const KDTree *tree)
   return order;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name BLI_kdtree_3d_find_nearest_batch
+ * \{ */
+
+/** Number of (sorted) queries each task handles, the previous result seeds the next query. */
+#define KD_BATCH_CHUNK_SIZE 1024
+/**
+ * Bits per axis of the quantized coordinates used for the spatial sort (fits in 64 bits).
+ * At most 24, the largest quantized value must be exact as a float, otherwise clamping to it
+ * rounds up to a value with one more bit, which is dropped from the key.
+ */
+#define KD_BATCH_SORT_BITS (63 / KD_DIMS < 24 ? 63 / KD_DIMS : 24)
+BLI_STATIC_ASSERT(KD_BATCH_SORT_BITS * KD_DIMS <= 64 && KD_BATCH_SORT_BITS <= 24,
+                  "quantized coordinates must fit the sort key and be exact as floats")
+
+typedef struct KDTreeBatchQuery {
+  uint64_t key;
+  int index;
+} KDTreeBatchQuery;
+
+typedef struct KDTreeBatchData {
+  const KDTree *tree;
+  const float (*co)[KD_DIMS];
+  /** Spatially sorted queries, NULL to process the queries in their own order. */
+  const KDTreeBatchQuery *queries;
+  int co_len;
+  int *r_index;
+  KDTreeNearest *r_nearest;
+} KDTreeBatchData;
+
+static int kdtree_batch_query_cmp(const void *a_p, const void *b_p)
+{
+  const KDTreeBatchQuery *a = a_p;
+  const KDTreeBatchQuery *b = b_p;
+  if (a->key < b->key) {
+    return -1;
+  }
+  if (a->key > b->key) {
+    return 1;
+  }
+  /* Stable, so the order (and so the results) don't depend on the sort implementation. */
+  return (a->index > b->index) - (a->index < b->index);
+}
+
+/**
+ * Interleave the bits of the quantized coordinates (a Morton code),
+ * so queries near each other in space end up near each other once sorted.
+ */
+static uint64_t kdtree_batch_sort_key(const float co[KD_DIMS],
+                                      const float min[KD_DIMS],
+                                      const float scale[KD_DIMS])
+{
+  const float quantize_max = (float)((1ull << KD_BATCH_SORT_BITS) - 1);
+  uint64_t q[KD_DIMS];
+  uint64_t key = 0;
+
+  for (uint j = 0; j < KD_DIMS; j++) {
+    const float f = (co[j] - min[j]) * scale[j];
+    q[j] = (uint64_t)((f > 0.0f) ? min_ff(f, quantize_max) : 0.0f);
+  }
+  for (int bit = KD_BATCH_SORT_BITS - 1; bit >= 0; bit--) {
+    for (uint j = 0; j < KD_DIMS; j++) {
+      key = (key << 1) | ((q[j] >> bit) & 1);
+    }
+  }
+  return key;
+}
+
+static void kdtree_find_nearest_batch_cb(void *__restrict userdata,
+                                         const int chunk,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBatchData *data = userdata;
+  const int start = chunk * KD_BATCH_CHUNK_SIZE;
+  const int end = min_ii(start + KD_BATCH_CHUNK_SIZE, data->co_len);
+  const KDTreeNode *hint = NULL;
+
+  for (int i = start; i < end; i++) {
+    const int q = data->queries ? data->queries[i].index : i;
+    float dist_sq;
+
+    hint = kdtree_find_nearest_node(data->tree, data->co[q], hint, &dist_sq);
+
+    if (data->r_index) {
+      data->r_index[q] = hint->index;
+    }
+    if (data->r_nearest) {
+      KDTreeNearest *nearest = &data->r_nearest[q];
+      nearest->index = hint->index;
+      nearest->dist = sqrtf(dist_sq);
+      copy_vn_vn(nearest->co, hint->co);
+    }
+  }
+}
+
+void BLI_kdtree_nd_(find_nearest_batch)(const KDTree *tree,
+                                        const float (*co)[KD_DIMS],
+                                        const int co_len,
+                                        int *r_index,
+                                        KDTreeNearest *r_nearest)
+{
+#ifdef DEBUG
+  BLI_assert(tree->is_balanced == true);
+#endif
+
+  if (co_len <= 0) {
+    return;
+  }
+
+  if (UNLIKELY(tree->root == KD_NODE_UNSET)) {
+    for (int i = 0; i < co_len; i++) {
+      if (r_index) {
+        r_index[i] = -1;
+      }
+      if (r_nearest) {
+        r_nearest[i].index = -1;
+        r_nearest[i].dist = 0.0f;
+        copy_vn_fl(r_nearest[i].co, KD_DIMS, 0.0f);
+      }
+    }
+    return;
+  }
+
+  KDTreeBatchData data = {
+      .tree = tree,
+      .co = co,
+      .queries = NULL,
+      .co_len = co_len,
+      .r_index = r_index,
+      .r_nearest = r_nearest,
+  };
+
+  KDTreeBatchQuery *queries = NULL;
+  if (co_len > KD_BATCH_CHUNK_SIZE) {
+    float min[KD_DIMS], max[KD_DIMS], scale[KD_DIMS];
+    copy_vn_vn(min, co[0]);
+    copy_vn_vn(max, co[0]);
+    for (int i = 1; i < co_len; i++) {
+      for (uint j = 0; j < KD_DIMS; j++) {
+        min[j] = min_ff(min[j], co[i][j]);
+        max[j] = max_ff(max[j], co[i][j]);
+      }
+    }
+    for (uint j = 0; j < KD_DIMS; j++) {
+      const float range = max[j] - min[j];
+      scale[j] = (range > 0.0f) ? (float)((1ull << KD_BATCH_SORT_BITS) - 1) / range : 0.0f;
+    }
+
+    queries = MEM_mallocN(sizeof(*queries) * (size_t)co_len, __func__);
+    for (int i = 0; i < co_len; i++) {
+      queries[i].key = kdtree_batch_sort_key(co[i], min, scale);
+      queries[i].index = i;
+    }
+    qsort(queries, (size_t)co_len, sizeof(*queries), kdtree_batch_query_cmp);
+    data.queries = queries;
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0,
+                          (co_len + KD_BATCH_CHUNK_SIZE - 1) / KD_BATCH_CHUNK_SIZE,
+                          &data,
+                          kdtree_find_nearest_batch_cb,
+                          &settings);
+
+  if (queries) {
+    MEM_freeN(queries);
+  }
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_kdtree_3d_calc_duplicates_fast
  * \{ */
@@ -2,6 +2,7 @@
 
 #include "BLI_lazy_threading.hh"
 #include "BLI_stack.hh"
+#include "BLI_task_trace.hh"
 #include "BLI_vector.hh"
 
 namespace blender::lazy_threading {
@@ -21,6 +22,9 @@ thread_local HintReceivers hint_receivers = []() {
 
 void send_hint()
 {
+  if (UNLIKELY(threading::trace::is_enabled())) {
+    threading::trace::record_instant("send_hint", "lazy_threading");
+  }
   for (const FunctionRef<void()> &fn : hint_receivers.peek()) {
     fn();
   }
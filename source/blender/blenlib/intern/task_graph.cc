@@ -9,6 +9,7 @@
 #include "MEM_guardedalloc.h"
 
 #include "BLI_task.h"
+#include "BLI_task_trace.hh"
 
 #include <memory>
 #include <vector>
@@ -77,6 +78,7 @@ struct TaskNode {
 #ifdef WITH_TBB
   tbb::flow::continue_msg run(const tbb::flow::continue_msg /*input*/)
   {
+    blender::threading::trace::ScopedEvent trace_event("TaskGraph node", "task_graph", this);
     run_func(task_data);
     return tbb::flow::continue_msg();
   }
@@ -84,7 +86,10 @@ struct TaskNode {
 
   void run_serial()
   {
-    run_func(task_data);
+    {
+      blender::threading::trace::ScopedEvent trace_event("TaskGraph node", "task_graph", this);
+      run_func(task_data);
+    }
     for (TaskNode *successor : successors) {
       successor->run_serial();
     }
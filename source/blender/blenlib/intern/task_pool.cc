@@ -17,6 +17,7 @@
 #include "BLI_math.h"
 #include "BLI_mempool.h"
 #include "BLI_task.h"
+#include "BLI_task_trace.hh"
 #include "BLI_threads.h"
 
 #ifdef WITH_TBB
@@ -158,9 +159,28 @@ struct TaskPool {
   volatile bool background_is_canceling;
 };
 
+static const char *task_pool_type_name(const TaskPoolType type)
+{
+  switch (type) {
+    case TASK_POOL_TBB:
+      return "TaskPool";
+    case TASK_POOL_TBB_SUSPENDED:
+      return "TaskPool (suspended)";
+    case TASK_POOL_NO_THREADS:
+      return "TaskPool (no threads)";
+    case TASK_POOL_BACKGROUND:
+      return "TaskPool (background)";
+    case TASK_POOL_BACKGROUND_SERIAL:
+      return "TaskPool (background serial)";
+  }
+  return "TaskPool";
+}
+
 /* Execute task. */
 void Task::operator()() const
 {
+  blender::threading::trace::ScopedEvent trace_event(
+      task_pool_type_name(pool->type), "task_pool", pool);
   run(pool, taskdata);
 }
 
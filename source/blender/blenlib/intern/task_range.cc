@@ -14,6 +14,7 @@
 
 #include "BLI_lazy_threading.hh"
 #include "BLI_task.h"
+#include "BLI_task_trace.hh"
 #include "BLI_threads.h"
 
 #include "atomic_ops.h"
@@ -77,6 +78,11 @@ struct RangeTask {
 
   void operator()(const tbb::blocked_range<int> &r) const
   {
+    blender::threading::trace::ScopedEvent trace_event("BLI_task_parallel_range",
+                                                       "parallel_range",
+                                                       userdata,
+                                                       r.size(),
+                                                       settings->min_iter_per_thread);
     TaskParallelTLS tls;
     tls.userdata_chunk = userdata_chunk;
     for (int i = r.begin(); i != r.end(); ++i) {
@@ -122,10 +128,17 @@ void BLI_task_parallel_range(const int start,
 
   /* Single threaded. Nothing to reduce as everything is accumulated into the
    * main userdata chunk directly. */
-  TaskParallelTLS tls;
-  tls.userdata_chunk = settings->userdata_chunk;
-  for (int i = start; i < stop; i++) {
-    func(userdata, i, &tls);
+  {
+    blender::threading::trace::ScopedEvent trace_event("BLI_task_parallel_range",
+                                                       "parallel_range",
+                                                       userdata,
+                                                       stop - start,
+                                                       settings->min_iter_per_thread);
+    TaskParallelTLS tls;
+    tls.userdata_chunk = settings->userdata_chunk;
+    for (int i = start; i < stop; i++) {
+      func(userdata, i, &tls);
+    }
   }
   if (settings->func_free != nullptr) {
     settings->func_free(userdata, settings->userdata_chunk);
@@ -55,8 +55,11 @@ void BLI_task_scheduler_init()
 
 void BLI_task_scheduler_exit()
 {
+  BLI_task_trace_end();
+
 #ifdef WITH_TBB_GLOBAL_CONTROL
   MEM_delete(task_scheduler_global_control);
+  task_scheduler_global_control = nullptr;
 #endif
 }
 
@@ -0,0 +1,207 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup bli
+ *
+ * Task tracing, writing the Chrome trace event format:
+ * https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "BLI_fileops.h"
+#include "BLI_task.h"
+#include "BLI_task_trace.hh"
+#include "BLI_threads.h"
+
+namespace blender::threading::trace {
+
+/** Number of events kept per thread, about 1MB of memory. */
+static constexpr int64_t THREAD_EVENTS_MAX = 1 << 14;
+
+struct TraceEvent {
+  const char *name;
+  const char *category;
+  const void *id;
+  uint64_t start_ns;
+  uint64_t end_ns;
+  int64_t size;
+  int64_t grain_size;
+  bool is_instant;
+};
+
+struct ThreadTrace {
+  int thread_index;
+  bool is_main;
+  /** Total number of events recorded, only written by the owning thread. */
+  std::atomic<int64_t> events_num = 0;
+  TraceEvent events[THREAD_EVENTS_MAX];
+};
+
+std::atomic<bool> is_enabled_flag = false;
+
+/** Protects everything below, only used when starting & stopping and for new threads. */
+static std::mutex trace_mutex;
+static std::string trace_filepath;
+static uint64_t trace_begin_ns = 0;
+/**
+ * Buffers are kept (and reused) until exit, so threads still finishing an event
+ * while the trace ends never write into freed memory.
+ */
+static std::vector<std::unique_ptr<ThreadTrace>> thread_traces;
+
+static thread_local ThreadTrace *thread_trace = nullptr;
+
+uint64_t time_ns()
+{
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count());
+}
+
+static ThreadTrace &thread_trace_get()
+{
+  if (UNLIKELY(thread_trace == nullptr)) {
+    std::lock_guard lock{trace_mutex};
+    std::unique_ptr<ThreadTrace> trace = std::make_unique<ThreadTrace>();
+    trace->thread_index = int(thread_traces.size());
+    trace->is_main = BLI_thread_is_main();
+    thread_trace = trace.get();
+    thread_traces.push_back(std::move(trace));
+  }
+  return *thread_trace;
+}
+
+static void thread_trace_append(const TraceEvent &event)
+{
+  ThreadTrace &trace = thread_trace_get();
+  const int64_t events_num = trace.events_num.load(std::memory_order_relaxed);
+  trace.events[events_num % THREAD_EVENTS_MAX] = event;
+  trace.events_num.store(events_num + 1, std::memory_order_release);
+}
+
+void record(const char *name,
+            const char *category,
+            const void *id,
+            const uint64_t start_ns,
+            const int64_t size,
+            const int64_t grain_size)
+{
+  thread_trace_append({name, category, id, start_ns, time_ns(), size, grain_size, false});
+}
+
+void record_instant(const char *name, const char *category)
+{
+  const uint64_t now_ns = time_ns();
+  thread_trace_append({name, category, nullptr, now_ns, now_ns, -1, -1, true});
+}
+
+static void trace_write_event(FILE *file, const ThreadTrace &trace, const TraceEvent &event)
+{
+  const double ts_us = double(int64_t(event.start_ns - trace_begin_ns)) / 1000.0;
+  if (event.is_instant) {
+    fprintf(file,
+            ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,"
+            "\"tid\":%d}",
+            event.name,
+            event.category,
+            ts_us,
+            trace.thread_index);
+    return;
+  }
+  const double dur_us = double(event.end_ns - event.start_ns) / 1000.0;
+  fprintf(file,
+          ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,"
+          "\"tid\":%d,\"args\":{\"id\":\"%p\",\"size\":%lld,\"grain_size\":%lld}}",
+          event.name,
+          event.category,
+          ts_us,
+          dur_us,
+          trace.thread_index,
+          event.id,
+          (long long)event.size,
+          (long long)event.grain_size);
+}
+
+static bool trace_write(const char *filepath)
+{
+  FILE *file = BLI_fopen(filepath, "w");
+  if (file == nullptr) {
+    fprintf(stderr, "Task trace: unable to write '%s'\n", filepath);
+    return false;
+  }
+
+  fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  fprintf(file,
+          "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+          "\"args\":{\"name\":\"Blender\"}}");
+
+  for (const std::unique_ptr<ThreadTrace> &trace : thread_traces) {
+    const int64_t events_num = trace->events_num.load(std::memory_order_acquire);
+    const int64_t events_dropped = std::max<int64_t>(events_num - THREAD_EVENTS_MAX, 0);
+    if (trace->is_main) {
+      fprintf(file,
+              ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+              "\"args\":{\"name\":\"Main\"}}",
+              trace->thread_index);
+    }
+    else {
+      fprintf(file,
+              ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+              "\"args\":{\"name\":\"Thread %d\"}}",
+              trace->thread_index,
+              trace->thread_index);
+    }
+    if (events_dropped) {
+      fprintf(stderr,
+              "Task trace: %lld oldest events of thread %d were dropped\n",
+              (long long)events_dropped,
+              trace->thread_index);
+    }
+    for (int64_t i = events_dropped; i < events_num; i++) {
+      trace_write_event(file, *trace, trace->events[i % THREAD_EVENTS_MAX]);
+    }
+  }
+
+  fprintf(file, "\n]}\n");
+  const bool success = (ferror(file) == 0);
+  fclose(file);
+  return success;
+}
+
+}  // namespace blender::threading::trace
+
+using namespace blender::threading::trace;
+
+void BLI_task_trace_begin(const char *filepath)
+{
+  std::lock_guard lock{trace_mutex};
+  trace_filepath = filepath;
+  for (std::unique_ptr<ThreadTrace> &trace : thread_traces) {
+    trace->events_num.store(0, std::memory_order_relaxed);
+  }
+  trace_begin_ns = time_ns();
+  is_enabled_flag.store(true, std::memory_order_release);
+}
+
+bool BLI_task_trace_end()
+{
+  if (!is_enabled()) {
+    return true;
+  }
+  is_enabled_flag.store(false, std::memory_order_release);
+
+  std::lock_guard lock{trace_mutex};
+  return trace_write(trace_filepath.c_str());
+}
+
+bool BLI_task_trace_is_enabled()
+{
+  return is_enabled();
+}
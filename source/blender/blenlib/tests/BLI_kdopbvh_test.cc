@@ -2,14 +2,14 @@
 
 #include "testing/testing.h"
 
-/* TODO: ray intersection, overlap ... etc. */
-
 #include "MEM_guardedalloc.h"
 
 #include "BLI_compiler_attrs.h"
 #include "BLI_kdopbvh.h"
+#include "BLI_math_geom.h"
 #include "BLI_math_vector.h"
 #include "BLI_rand.h"
+#include "BLI_timeit.hh"
 
 /* -------------------------------------------------------------------- */
 /* Helper Functions */
@@ -132,3 +132,302 @@ TEST(kdopbvh, OptimalFindNearest_500)
 {
   find_nearest_points_test(500, 1.0, 1000, 12, true);
 }
+
+/* Large enough to split the branches near the root with multiple threads. */
+TEST(kdopbvh, FindNearest_70000)
+{
+  find_nearest_points_test(70000, 1.0, 100000, 123456);
+}
+
+/**
+ * Move all points and refit the tree, each point must still be found.
+ */
+static void update_tree_test(int points_len, char tree_type, int random_seed)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, tree_type, 6);
+
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 100000, 1.0f);
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+
+  for (int i = 0; i < points_len; i++) {
+    float offset[3];
+    rng_v3_round(offset, 3, rng, 100000, 0.1f);
+    add_v3_v3(points[i], offset);
+    BLI_bvhtree_update_node(tree, i, points[i], nullptr, 1);
+  }
+  BLI_bvhtree_update_tree(tree);
+
+  for (int i = 0; i < points_len; i++) {
+    const int j = BLI_bvhtree_find_nearest(tree, points[i], nullptr, nullptr, nullptr);
+    if (j != i) {
+      EXPECT_GE(j, 0);
+      EXPECT_LT(j, points_len);
+      EXPECT_EQ_ARRAY(points[i], points[j], 3);
+    }
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+}
+
+TEST(kdopbvh, UpdateTree_500)
+{
+  update_tree_test(500, 4, 12);
+}
+TEST(kdopbvh, UpdateTree_70000)
+{
+  update_tree_test(70000, 4, 123);
+}
+TEST(kdopbvh, UpdateTree_Binary_70000)
+{
+  update_tree_test(70000, 2, 1234);
+}
+
+/* -------------------------------------------------------------------- */
+/* Ray-cast & Overlap
+ *
+ * Compare the SIMD wide node traversal with the scalar one (and brute force). */
+
+static float (*random_tris_new(int tris_len, float tri_size, int random_seed))[3]
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  float(*tris)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3][3]) * tris_len, __func__);
+  for (int i = 0; i < tris_len; i++) {
+    float center[3];
+    rng_v3_round(center, 3, rng, 1000, 1.0f);
+    for (int j = 0; j < 3; j++) {
+      rng_v3_round(tris[i * 3 + j], 3, rng, 1000, tri_size);
+      add_v3_v3(tris[i * 3 + j], center);
+    }
+  }
+  BLI_rng_free(rng);
+  return tris;
+}
+
+static BVHTree *tris_tree_new(const float (*tris)[3], int tris_len, char tree_type, char axis)
+{
+  BVHTree *tree = BLI_bvhtree_new(tris_len, 0.0f, tree_type, axis);
+  for (int i = 0; i < tris_len; i++) {
+    BLI_bvhtree_insert(tree, i, tris[i * 3], 3);
+  }
+  BLI_bvhtree_balance(tree);
+  return tree;
+}
+
+static void tris_raycast_callback(void *userdata,
+                                  int index,
+                                  const BVHTreeRay *ray,
+                                  BVHTreeRayHit *hit)
+{
+  const float(*tris)[3] = (const float(*)[3])userdata;
+  float dist;
+  if (isect_ray_tri_v3(ray->origin,
+                       ray->direction,
+                       tris[index * 3],
+                       tris[index * 3 + 1],
+                       tris[index * 3 + 2],
+                       &dist,
+                       nullptr) &&
+      dist < hit->dist) {
+    hit->index = index;
+    hit->dist = dist;
+  }
+}
+
+static void random_ray(struct RNG *rng, float r_co[3], float r_dir[3])
+{
+  BLI_rng_get_float_unit_v3(rng, r_dir);
+  copy_v3_v3(r_co, r_dir);
+  mul_v3_fl(r_co, -2.0f);
+  /* Jitter the origin so rays don't all pass through the center. */
+  float jitter[3];
+  rng_v3_round(jitter, 3, rng, 1000, 0.5f);
+  add_v3_v3(r_co, jitter);
+}
+
+static void raycast_wide_test(int tris_len, char tree_type, char axis, int random_seed)
+{
+  float(*tris)[3] = random_tris_new(tris_len, 0.1f, random_seed);
+  BVHTree *tree = tris_tree_new(tris, tris_len, tree_type, axis);
+  struct RNG *rng = BLI_rng_new(random_seed);
+
+  for (int i = 0; i < 1000; i++) {
+    float co[3], dir[3];
+    random_ray(rng, co, dir);
+
+    BVHTreeRayHit hit_wide = {-1};
+    hit_wide.dist = BVH_RAYCAST_DIST_MAX;
+    BVHTreeRayHit hit_scalar = hit_wide;
+
+    BLI_bvhtree_ray_cast_ex(
+        tree, co, dir, 0.0f, &hit_wide, tris_raycast_callback, tris, BVH_RAYCAST_DEFAULT);
+    BLI_bvhtree_ray_cast_ex(tree,
+                            co,
+                            dir,
+                            0.0f,
+                            &hit_scalar,
+                            tris_raycast_callback,
+                            tris,
+                            BVH_RAYCAST_DEFAULT | BVH_RAYCAST_NO_WIDE_NODES);
+    EXPECT_EQ(hit_wide.index, hit_scalar.index);
+    EXPECT_EQ(hit_wide.dist, hit_scalar.dist);
+
+    /* Brute force. */
+    BVHTreeRayHit hit_brute = {-1};
+    hit_brute.dist = BVH_RAYCAST_DIST_MAX;
+    BVHTreeRay ray = {{0}};
+    copy_v3_v3(ray.origin, co);
+    copy_v3_v3(ray.direction, dir);
+    for (int j = 0; j < tris_len; j++) {
+      tris_raycast_callback(tris, j, &ray, &hit_brute);
+    }
+    EXPECT_EQ(hit_wide.index, hit_brute.index);
+  }
+
+  BLI_rng_free(rng);
+  BLI_bvhtree_free(tree);
+  MEM_freeN(tris);
+}
+
+TEST(kdopbvh, RayCastWide_Binary)
+{
+  raycast_wide_test(1000, 2, 6, 12);
+}
+TEST(kdopbvh, RayCastWide_Quad)
+{
+  raycast_wide_test(1000, 4, 6, 123);
+}
+TEST(kdopbvh, RayCastWide_Octree)
+{
+  raycast_wide_test(1000, 8, 8, 1234);
+}
+TEST(kdopbvh, RayCastWide_Odd)
+{
+  raycast_wide_test(999, 3, 26, 1234);
+}
+TEST(kdopbvh, RayCastWide_Single)
+{
+  raycast_wide_test(1, 4, 6, 12345);
+}
+
+/**
+ * Wide nodes are only used when overlapping on the first 3 axes,
+ * so `axis_b` must be 6 or 8 for `tree_a` to take the wide path.
+ */
+static void overlap_wide_test(
+    int tris_len, char tree_type, char axis_a, char axis_b, int random_seed)
+{
+  float(*tris_a)[3] = random_tris_new(tris_len, 0.05f, random_seed);
+  float(*tris_b)[3] = random_tris_new(tris_len, 0.05f, random_seed + 1);
+  BVHTree *tree_a = tris_tree_new(tris_a, tris_len, tree_type, axis_a);
+  BVHTree *tree_b = tris_tree_new(tris_b, tris_len, tree_type, axis_b);
+
+  /* Trees with more than 8 children per node don't use wide nodes. */
+  BVHTree *tree_a_scalar = tris_tree_new(tris_a, tris_len, 16, axis_a);
+  BVHTree *tree_b_scalar = tris_tree_new(tris_b, tris_len, 16, axis_b);
+  uint overlap_scalar_len = 0;
+  BVHTreeOverlap *overlap_scalar = BLI_bvhtree_overlap(
+      tree_a_scalar, tree_b_scalar, &overlap_scalar_len, nullptr, nullptr);
+  MEM_SAFE_FREE(overlap_scalar);
+  BLI_bvhtree_free(tree_a_scalar);
+  BLI_bvhtree_free(tree_b_scalar);
+
+  uint overlap_len = 0;
+  BVHTreeOverlap *overlap = BLI_bvhtree_overlap(tree_a, tree_b, &overlap_len, nullptr, nullptr);
+  EXPECT_EQ(overlap_len, overlap_scalar_len);
+  MEM_SAFE_FREE(overlap);
+
+  /* Self overlap reports every pair once, excluding a leaf with itself. */
+  uint overlap_self_len = 0;
+  overlap = BLI_bvhtree_overlap(tree_b, tree_b, &overlap_len, nullptr, nullptr);
+  MEM_SAFE_FREE(overlap);
+  overlap = BLI_bvhtree_overlap_self(tree_b, &overlap_self_len, nullptr, nullptr);
+  EXPECT_EQ(overlap_self_len * 2, overlap_len);
+  MEM_SAFE_FREE(overlap);
+
+  BLI_bvhtree_free(tree_a);
+  BLI_bvhtree_free(tree_b);
+  MEM_freeN(tris_a);
+  MEM_freeN(tris_b);
+}
+
+TEST(kdopbvh, OverlapWide_Binary)
+{
+  overlap_wide_test(500, 2, 6, 6, 12);
+}
+TEST(kdopbvh, OverlapWide_Quad)
+{
+  overlap_wide_test(500, 4, 6, 6, 123);
+}
+TEST(kdopbvh, OverlapWide_Octree)
+{
+  overlap_wide_test(500, 8, 6, 6, 1234);
+}
+TEST(kdopbvh, OverlapWide_KDOP)
+{
+  /* A 26-DOP tree overlapped with an AABB tree only compares the first 3 axes. */
+  overlap_wide_test(2000, 4, 26, 6, 1234);
+}
+
+/**
+ * Set this to 1 to activate the benchmark. It is disabled by default, because it prints a lot.
+ */
+#if 0
+static void raycast_benchmark(int tris_len, int rays_len, char tree_type, char axis)
+{
+  float(*tris)[3] = random_tris_new(tris_len, 0.01f, 0);
+  BVHTree *tree = tris_tree_new(tris, tris_len, tree_type, axis);
+  struct RNG *rng = BLI_rng_new(0);
+  float(*rays)[2][3] = (float(*)[2][3])MEM_mallocN(sizeof(float[2][3]) * rays_len, __func__);
+  for (int i = 0; i < rays_len; i++) {
+    random_ray(rng, rays[i][0], rays[i][1]);
+  }
+
+  const std::string name = "tree_type " + std::to_string(tree_type) + ", axis " +
+                           std::to_string(axis);
+  const int flags[2] = {BVH_RAYCAST_DEFAULT | BVH_RAYCAST_NO_WIDE_NODES, BVH_RAYCAST_DEFAULT};
+  for (const int flag : flags) {
+    int hits = 0;
+    {
+      SCOPED_TIMER(name + ((flag & BVH_RAYCAST_NO_WIDE_NODES) ? " scalar" : " wide  "));
+      for (int i = 0; i < rays_len; i++) {
+        BVHTreeRayHit hit = {-1};
+        hit.dist = BVH_RAYCAST_DIST_MAX;
+        BLI_bvhtree_ray_cast_ex(
+            tree, rays[i][0], rays[i][1], 0.0f, &hit, tris_raycast_callback, tris, flag);
+        hits += (hit.index != -1);
+      }
+    }
+    std::cout << "Hits: " << hits << "\n";
+  }
+
+  MEM_freeN(rays);
+  BLI_rng_free(rng);
+  BLI_bvhtree_free(tree);
+  MEM_freeN(tris);
+}
+
+TEST(kdopbvh, RayCastBenchmark)
+{
+  raycast_benchmark(300000, 300000, 4, 6);
+  raycast_benchmark(300000, 300000, 8, 6);
+  raycast_benchmark(300000, 300000, 2, 6);
+}
+
+#endif /* Benchmark */
+
+/**
+ * Timer 'tree_type 4, axis 6 scalar' took 10.6 s
+ * Timer 'tree_type 4, axis 6 wide  ' took 3801.6 ms
+ * Timer 'tree_type 8, axis 6 scalar' took 9.1 s
+ * Timer 'tree_type 8, axis 6 wide  ' took 3175.7 ms
+ * Timer 'tree_type 2, axis 6 scalar' took 11.7 s
+ * Timer 'tree_type 2, axis 6 wide  ' took 6.8 s
+ */
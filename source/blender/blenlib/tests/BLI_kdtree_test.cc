@@ -2,7 +2,11 @@
 
 #include "testing/testing.h"
 
+#include "MEM_guardedalloc.h"
+
 #include "BLI_kdtree.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
 
 #include <cmath>
 
@@ -52,6 +56,80 @@ static void deduplicate_test()
   }
 }
 
+static KDTree_3d *random_tree_new(RNG *rng, const int tree_size, float (**r_co)[3])
+{
+  float(*co)[3] = static_cast<float(*)[3]>(MEM_mallocN(sizeof(*co) * tree_size, __func__));
+  KDTree_3d *tree = BLI_kdtree_3d_new(tree_size);
+  for (int i = 0; i < tree_size; i++) {
+    BLI_rng_get_float_unit_v3(rng, co[i]);
+    BLI_kdtree_3d_insert(tree, i, co[i]);
+  }
+  BLI_kdtree_3d_balance(tree);
+  *r_co = co;
+  return tree;
+}
+
+static void find_nearest_test(const int tree_size, const int queries_num)
+{
+  RNG *rng = BLI_rng_new(tree_size);
+  float(*co)[3];
+  KDTree_3d *tree = random_tree_new(rng, tree_size, &co);
+
+  for (int i = 0; i < queries_num; i++) {
+    float co_search[3];
+    BLI_rng_get_float_unit_v3(rng, co_search);
+    mul_v3_fl(co_search, 1.2f);
+
+    float dist_sq_best = FLT_MAX;
+    for (int j = 0; j < tree_size; j++) {
+      dist_sq_best = min_ff(dist_sq_best, len_squared_v3v3(co[j], co_search));
+    }
+
+    KDTreeNearest_3d nearest;
+    const int index = BLI_kdtree_3d_find_nearest(tree, co_search, &nearest);
+    EXPECT_EQ(index, nearest.index);
+    EXPECT_EQ(len_squared_v3v3(co[index], co_search), dist_sq_best);
+  }
+
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(co);
+  BLI_rng_free(rng);
+}
+
+static void find_nearest_batch_test(const int tree_size, const int queries_num)
+{
+  RNG *rng = BLI_rng_new(tree_size);
+  float(*co)[3];
+  KDTree_3d *tree = random_tree_new(rng, tree_size, &co);
+
+  float(*co_search)[3] = static_cast<float(*)[3]>(
+      MEM_mallocN(sizeof(*co_search) * queries_num, __func__));
+  for (int i = 0; i < queries_num; i++) {
+    BLI_rng_get_float_unit_v3(rng, co_search[i]);
+    mul_v3_fl(co_search[i], 1.2f);
+  }
+
+  int *index = static_cast<int *>(MEM_mallocN(sizeof(*index) * queries_num, __func__));
+  KDTreeNearest_3d *nearest = static_cast<KDTreeNearest_3d *>(
+      MEM_mallocN(sizeof(*nearest) * queries_num, __func__));
+  BLI_kdtree_3d_find_nearest_batch(tree, co_search, queries_num, index, nearest);
+
+  for (int i = 0; i < queries_num; i++) {
+    KDTreeNearest_3d nearest_single;
+    BLI_kdtree_3d_find_nearest(tree, co_search[i], &nearest_single);
+    EXPECT_EQ(index[i], nearest[i].index);
+    EXPECT_EQ(nearest[i].dist, nearest_single.dist);
+    EXPECT_V3_NEAR(nearest[i].co, co[index[i]], 0.0f);
+  }
+
+  MEM_freeN(index);
+  MEM_freeN(nearest);
+  MEM_freeN(co_search);
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(co);
+  BLI_rng_free(rng);
+}
+
 TEST(kdtree, Standard)
 {
   standard_test();
@@ -61,3 +139,24 @@ TEST(kdtree, Deduplicate)
 {
   deduplicate_test();
 }
+
+TEST(kdtree, FindNearest_1000)
+{
+  find_nearest_test(1000, 100);
+}
+
+/* Large enough to balance the tree using multiple threads. */
+TEST(kdtree, FindNearest_100000)
+{
+  find_nearest_test(100000, 100);
+}
+
+TEST(kdtree, FindNearestBatch_100)
+{
+  find_nearest_batch_test(100, 100);
+}
+
+TEST(kdtree, FindNearestBatch_100000)
+{
+  find_nearest_batch_test(100000, 20000);
+}
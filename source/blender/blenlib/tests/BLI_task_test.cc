@@ -3,6 +3,7 @@
 #include "testing/testing.h"
 #include <atomic>
 #include <cstring>
+#include <thread>
 
 #include "atomic_ops.h"
 
@@ -10,10 +11,12 @@
 
 #include "BLI_utildefines.h"
 
+#include "BLI_fileops.h"
 #include "BLI_listbase.h"
 #include "BLI_mempool.h"
 #include "BLI_task.h"
 #include "BLI_task.hh"
+#include "BLI_threads.h"
 
 #define ITEMS_NUM 10000
 
@@ -291,3 +294,94 @@ TEST(task, ParallelInvoke)
                                       [&]() { counter++; });
   EXPECT_EQ(counter, 6);
 }
+
+/* *** Background task pool with a single thread. *** */
+
+static void task_background_pool_func(TaskPool *__restrict pool, void * /*taskdata*/)
+{
+  std::thread::id *thread_id = static_cast<std::thread::id *>(BLI_task_pool_user_data(pool));
+  *thread_id = std::this_thread::get_id();
+}
+
+#ifdef WITH_TBB
+/* Callers may push background tasks while holding a lock that the tasks need, so the tasks must
+ * not run in the pushing thread, even when there is only a single thread. */
+TEST(task, BackgroundPoolSingleThread)
+{
+  BLI_system_num_threads_override_set(1);
+  BLI_task_scheduler_init();
+  ASSERT_EQ(BLI_task_scheduler_num_threads(), 1);
+
+  std::thread::id task_thread_id;
+  TaskPool *pool = BLI_task_pool_create_background(&task_thread_id, TASK_PRIORITY_LOW);
+  BLI_task_pool_push(pool, task_background_pool_func, nullptr, false, nullptr);
+  BLI_task_pool_work_and_wait(pool);
+  BLI_task_pool_free(pool);
+  EXPECT_NE(task_thread_id, std::thread::id());
+  EXPECT_NE(task_thread_id, std::this_thread::get_id());
+
+  BLI_task_scheduler_exit();
+  BLI_system_num_threads_override_set(0);
+  BLI_task_scheduler_init();
+}
+#endif
+
+static void task_trace_pool_func(TaskPool *__restrict /*pool*/, void *taskdata)
+{
+  atomic_add_and_fetch_uint32((uint32_t *)taskdata, 1);
+}
+
+TEST(task, Trace)
+{
+  const std::string filepath = testing::TempDir() + "BLI_task_trace_test.json";
+
+  BLI_threadapi_init();
+  BLI_task_trace_begin(filepath.c_str());
+  EXPECT_TRUE(BLI_task_trace_is_enabled());
+
+  std::atomic<int> items_num = 0;
+  blender::threading::parallel_for(
+      blender::IndexRange(ITEMS_NUM), 100, [&](const blender::IndexRange range) {
+        items_num += int(range.size());
+      });
+
+  uint32_t tasks_num = 0;
+  TaskPool *pool = BLI_task_pool_create(&tasks_num, TASK_PRIORITY_HIGH);
+  for (int i = 0; i < 10; i++) {
+    BLI_task_pool_push(pool, task_trace_pool_func, &tasks_num, false, nullptr);
+  }
+  BLI_task_pool_work_and_wait(pool);
+  BLI_task_pool_free(pool);
+
+  EXPECT_TRUE(BLI_task_trace_end());
+  EXPECT_FALSE(BLI_task_trace_is_enabled());
+  EXPECT_EQ(items_num, ITEMS_NUM);
+  EXPECT_EQ(tasks_num, 10);
+
+  /* Events are only recorded while tracing. */
+  blender::threading::parallel_for(
+      blender::IndexRange(ITEMS_NUM), 100, [&](const blender::IndexRange range) {
+        items_num += int(range.size());
+      });
+
+  FILE *file = BLI_fopen(filepath.c_str(), "r");
+  ASSERT_NE(file, nullptr);
+  std::string trace;
+  char buf[4096];
+  size_t len;
+  while ((len = fread(buf, 1, sizeof(buf), file)) > 0) {
+    trace.append(buf, len);
+  }
+  fclose(file);
+  BLI_delete(filepath.c_str(), false, false);
+  BLI_threadapi_exit();
+
+  EXPECT_EQ(trace.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0), 0);
+  EXPECT_NE(trace.find("\"name\":\"parallel_for\""), std::string::npos);
+  EXPECT_NE(trace.find("\"name\":\"TaskPool"), std::string::npos);
+#ifdef WITH_TBB
+  /* Hints are only sent when work is passed to TBB. */
+  EXPECT_NE(trace.find("\"name\":\"send_hint\""), std::string::npos);
+#endif
+  EXPECT_EQ(trace.substr(trace.size() - 4), "\n]}\n");
+}
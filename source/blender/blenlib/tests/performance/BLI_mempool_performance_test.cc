@@ -0,0 +1,232 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+
+#include "BLI_mempool.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "PIL_time.h"
+
+#define NUM_RUN_AVERAGED 10
+
+/* Number of elements allocated by each iteration. */
+#define ELEM_PER_ITER 64
+
+struct MempoolTestElem {
+  int index;
+  int sub_index;
+  float data[6];
+};
+
+struct MempoolTestData {
+  BLI_mempool *pool;
+  /** Only used for the spin-locked comparison. */
+  SpinLock lock;
+  /** Elements to free (every other one), gathered after allocating. */
+  void **elems_free;
+};
+
+/* *** Concurrent allocation using thread local caches. *** */
+
+static void mempool_local_alloc_iter_func(void *__restrict /*userdata*/,
+                                          const int index,
+                                          const TaskParallelTLS *__restrict tls)
+{
+  BLI_mempool_local *local = static_cast<BLI_mempool_local *>(tls->userdata_chunk);
+
+  for (int i = 0; i < ELEM_PER_ITER; i++) {
+    MempoolTestElem *elem = static_cast<MempoolTestElem *>(BLI_mempool_local_alloc(local));
+    elem->index = index;
+    elem->sub_index = i;
+  }
+}
+
+/* Elements are freed by other threads than the ones which allocated them. */
+static void mempool_local_free_iter_func(void *__restrict userdata,
+                                         const int index,
+                                         const TaskParallelTLS *__restrict tls)
+{
+  const MempoolTestData *data = static_cast<const MempoolTestData *>(userdata);
+  BLI_mempool_local *local = static_cast<BLI_mempool_local *>(tls->userdata_chunk);
+  BLI_mempool_local_free(local, data->elems_free[index]);
+}
+
+static void mempool_local_free_func(const void *__restrict /*userdata*/, void *__restrict chunk)
+{
+  BLI_mempool_local_flush(static_cast<BLI_mempool_local *>(chunk));
+}
+
+/* *** Regular allocation, protected by a lock. *** */
+
+static void mempool_locked_alloc_iter_func(void *__restrict userdata,
+                                           const int index,
+                                           const TaskParallelTLS *__restrict /*tls*/)
+{
+  MempoolTestData *data = static_cast<MempoolTestData *>(userdata);
+
+  for (int i = 0; i < ELEM_PER_ITER; i++) {
+    BLI_spin_lock(&data->lock);
+    MempoolTestElem *elem = static_cast<MempoolTestElem *>(BLI_mempool_alloc(data->pool));
+    BLI_spin_unlock(&data->lock);
+    elem->index = index;
+    elem->sub_index = i;
+  }
+}
+
+static void mempool_locked_free_iter_func(void *__restrict userdata,
+                                          const int index,
+                                          const TaskParallelTLS *__restrict /*tls*/)
+{
+  MempoolTestData *data = static_cast<MempoolTestData *>(userdata);
+  BLI_spin_lock(&data->lock);
+  BLI_mempool_free(data->pool, data->elems_free[index]);
+  BLI_spin_unlock(&data->lock);
+}
+
+/**
+ * Gather every other element of each iteration, in the (chunk) order of the pool.
+ */
+static int mempool_test_gather_free(MempoolTestData *data)
+{
+  int elems_free_num = 0;
+  data->elems_free = static_cast<void **>(
+      MEM_malloc_arrayN(BLI_mempool_len(data->pool), sizeof(void *), __func__));
+
+  BLI_mempool_iter iter;
+  BLI_mempool_iternew(data->pool, &iter);
+  while (MempoolTestElem *elem = static_cast<MempoolTestElem *>(BLI_mempool_iterstep(&iter))) {
+    if (elem->sub_index % 2) {
+      data->elems_free[elems_free_num++] = elem;
+    }
+  }
+  return elems_free_num;
+}
+
+/**
+ * Check every iteration allocated (and kept) the expected elements, exactly once.
+ */
+static void mempool_test_check(BLI_mempool *pool, const int iter_num, const bool use_free)
+{
+  const int elem_per_iter = use_free ? ELEM_PER_ITER / 2 : ELEM_PER_ITER;
+  EXPECT_EQ(BLI_mempool_len(pool), iter_num * elem_per_iter);
+
+  int *elem_found = static_cast<int *>(MEM_calloc_arrayN(iter_num, sizeof(int), __func__));
+  int elem_num = 0;
+
+  BLI_mempool_iter iter;
+  BLI_mempool_iternew(pool, &iter);
+  while (const MempoolTestElem *elem = static_cast<MempoolTestElem *>(
+             BLI_mempool_iterstep(&iter))) {
+    EXPECT_TRUE(elem->index >= 0 && elem->index < iter_num);
+    if (use_free) {
+      EXPECT_EQ(elem->sub_index % 2, 0);
+    }
+    elem_found[elem->index]++;
+    elem_num++;
+  }
+  EXPECT_EQ(elem_num, iter_num * elem_per_iter);
+
+  for (int i = 0; i < iter_num; i++) {
+    EXPECT_EQ(elem_found[i], elem_per_iter);
+  }
+  MEM_freeN(elem_found);
+}
+
+static void mempool_test_do(const char *id,
+                            const int iter_num,
+                            const bool use_local,
+                            const bool use_threads,
+                            const bool use_free)
+{
+  MempoolTestData data;
+  BLI_spin_init(&data.lock);
+
+  double averaged_timing = 0.0;
+  for (int run = 0; run < NUM_RUN_AVERAGED; run++) {
+    data.pool = BLI_mempool_create(sizeof(MempoolTestElem), 0, 512, BLI_MEMPOOL_ALLOW_ITER);
+
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.use_threading = use_threads;
+    BLI_mempool_local local;
+    if (use_local) {
+      BLI_mempool_local_init(data.pool, &local);
+      settings.userdata_chunk = &local;
+      settings.userdata_chunk_size = sizeof(local);
+      settings.func_free = mempool_local_free_func;
+    }
+
+    double init_time = PIL_check_seconds_timer();
+    BLI_task_parallel_range(0,
+                            iter_num,
+                            &data,
+                            use_local ? mempool_local_alloc_iter_func :
+                                        mempool_locked_alloc_iter_func,
+                            &settings);
+    averaged_timing += PIL_check_seconds_timer() - init_time;
+
+    if (use_free) {
+      const int elems_free_num = mempool_test_gather_free(&data);
+      init_time = PIL_check_seconds_timer();
+      BLI_task_parallel_range(0,
+                              elems_free_num,
+                              &data,
+                              use_local ? mempool_local_free_iter_func :
+                                          mempool_locked_free_iter_func,
+                              &settings);
+      averaged_timing += PIL_check_seconds_timer() - init_time;
+      MEM_freeN(data.elems_free);
+    }
+
+    mempool_test_check(data.pool, iter_num, use_free);
+    BLI_mempool_destroy(data.pool);
+  }
+
+  BLI_spin_end(&data.lock);
+
+  printf("\t%s: done in %fs on average over %d runs\n",
+         id,
+         averaged_timing / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+}
+
+static void mempool_test(const char *id, const int iter_num, const bool use_free)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  BLI_threadapi_init();
+
+  mempool_test_do("Single thread", iter_num, false, false, use_free);
+  mempool_test_do("Threaded, spin-locked", iter_num, false, true, use_free);
+  mempool_test_do("Single thread, local cache", iter_num, true, false, use_free);
+  mempool_test_do("Threaded, local cache", iter_num, true, true, use_free);
+
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(mempool, ConcurrentAlloc10k)
+{
+  mempool_test("Mempool concurrent allocation - 10000 iterations", 10000, false);
+}
+
+TEST(mempool, ConcurrentAlloc100k)
+{
+  mempool_test("Mempool concurrent allocation - 100000 iterations", 100000, false);
+}
+
+TEST(mempool, ConcurrentAllocFree10k)
+{
+  mempool_test("Mempool concurrent allocation & free - 10000 iterations", 10000, true);
+}
+
+TEST(mempool, ConcurrentAllocFree100k)
+{
+  mempool_test("Mempool concurrent allocation & free - 100000 iterations", 100000, true);
+}
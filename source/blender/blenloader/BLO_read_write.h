@@ -210,6 +210,14 @@ bool BLO_write_is_undo(BlendWriter *writer);
 
 void *BLO_read_get_new_data_address(BlendDataReader *reader, const void *old_address);
 void *BLO_read_get_new_data_address_no_us(BlendDataReader *reader, const void *old_address);
+/**
+ * Same as #BLO_read_get_new_data_address, but when the file is memory-mapped the result may point
+ * into the mapped file instead of being a copy (see #UserDef_Experimental.use_mapped_file_data).
+ * Such data is read-only and must not be freed, \a r_is_view is set for it.
+ */
+void *BLO_read_get_new_data_address_view(BlendDataReader *reader,
+                                         const void *old_address,
+                                         bool *r_is_view);
 void *BLO_read_get_new_packed_address(BlendDataReader *reader, const void *old_address);
 
 #define BLO_read_data_address(reader, ptr_p) \
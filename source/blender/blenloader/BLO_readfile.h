@@ -172,6 +172,17 @@ BlendFileData *BLO_read_from_memfile(struct Main *oldmain,
  */
 void BLO_blendfiledata_free(BlendFileData *bfd);
 
+/**
+ * Unmap the files which data was used without reading it,
+ * see #UserDef_Experimental.use_mapped_file_data. Only call on exit, after all data is freed.
+ */
+void BLO_read_data_views_free(void);
+/**
+ * Make data read as views of \a filepath independent of the file,
+ * so it can be overwritten while the data is still used.
+ */
+void BLO_read_data_views_release(const char *filepath);
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -11,6 +11,7 @@
 #include "BLI_filereader.h"
 
 struct GHash;
+struct MemFileCompress;
 struct Scene;
 
 typedef struct {
@@ -18,6 +19,11 @@ typedef struct {
   const char *buf;
   /** Size in bytes. */
   size_t size;
+  /**
+   * When not zero, #buf is compressed to this size in bytes (see #BLO_memfile_compress_begin),
+   * #size remains the uncompressed size. Chunks sharing the memory share the compression too.
+   */
+  size_t compressed_size;
   /** When true, this chunk doesn't own the memory, it's shared with a previous #MemFileChunk */
   bool is_identical;
   /** When true, this chunk is also identical to the one in the next step (used by undo code to
@@ -32,6 +38,8 @@ typedef struct {
 typedef struct MemFile {
   ListBase chunks;
   size_t size;
+  /** Compression running in the background, see #BLO_memfile_compress_begin. */
+  struct MemFileCompress *compress;
 } MemFile;
 
 typedef struct MemFileWriteData {
@@ -43,6 +51,10 @@ typedef struct MemFileWriteData {
 
   /** Maps an ID session uuid to its first reference MemFileChunk, if existing. */
   struct GHash *id_session_uuid_mapping;
+
+  /** Decompressed data of compressed reference chunks, for comparison. */
+  char *reference_buf;
+  size_t reference_buf_size;
 } MemFileWriteData;
 
 typedef struct MemFileUndoData {
@@ -59,6 +71,11 @@ typedef struct {
   int undo_direction;
 
   bool memchunk_identical;
+
+  /** Decompressed data of the compressed chunk being read. */
+  const MemFileChunk *decompressed_chunk;
+  char *decompressed_buf;
+  size_t decompressed_buf_size;
 } UndoReader;
 
 #ifdef __cplusplus
@@ -91,6 +108,22 @@ extern void BLO_memfile_merge(MemFile *first, MemFile *second);
  * Clear is_identical_future before adding next memfile.
  */
 extern void BLO_memfile_clear_future(MemFile *memfile);
+/**
+ * Compress the chunks owned by \a memfile which are not shared with the next undo step
+ * (see #MemFileChunk.is_identical_future), using idle worker threads.
+ * Only compress steps which are not the last one, once the following step has been written.
+ *
+ * The compressed chunks replace the original ones in #BLO_memfile_compress_update, which also
+ * reduces #MemFile.size. Functions accessing the chunks apply or cancel compression first.
+ */
+extern void BLO_memfile_compress_begin(MemFile *memfile);
+/**
+ * Apply the result of #BLO_memfile_compress_begin.
+ *
+ * \param wait: Wait for the compression to finish,
+ * otherwise it's only applied when it already finished.
+ */
+extern void BLO_memfile_compress_update(MemFile *memfile, bool wait);
 
 /* Utilities. */
 
@@ -45,6 +45,11 @@ struct BlendFileWriteParams {
   /** On write, restore paths after editing them (see #BLO_WRITE_PATH_REMAP_RELATIVE). */
   uint use_save_as_copy : 1;
   uint use_userdef : 1;
+  /**
+   * Copy data which didn't change since the previous save of the same file from that file,
+   * instead of writing it. Only used for uncompressed files.
+   */
+  uint use_delta : 1;
   const struct BlendThumbnail *thumb;
 };
 
@@ -65,6 +70,11 @@ extern bool BLO_write_file_mem(struct Main *mainvar,
                                struct MemFile *current,
                                int write_flags);
 
+/**
+ * Free the information about the last saved file kept for #BlendFileWriteParams.use_delta.
+ */
+extern void BLO_write_delta_save_free(void);
+
 /** \} */
 
 #ifdef __cplusplus
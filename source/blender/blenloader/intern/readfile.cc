@@ -13,6 +13,7 @@
 #include <cstdlib> /* for atoi. */
 #include <ctime>   /* for gmtime. */
 #include <fcntl.h> /* for open flags (O_BINARY, O_RDONLY). */
+#include <mutex>
 
 #include "BLI_utildefines.h"
 #ifndef WIN32
@@ -40,12 +41,14 @@
 #include "DNA_packedFile_types.h"
 #include "DNA_sdna_types.h"
 #include "DNA_sound_types.h"
+#include "DNA_userdef_types.h"
 #include "DNA_vfont_types.h"
 #include "DNA_volume_types.h"
 #include "DNA_workspace_types.h"
 
 #include "MEM_guardedalloc.h"
 
+#include "BLI_array.hh"
 #include "BLI_blenlib.h"
 #include "BLI_endian_defines.h"
 #include "BLI_endian_switch.h"
@@ -55,7 +58,10 @@
 #include "BLI_math.h"
 #include "BLI_memarena.h"
 #include "BLI_mempool.h"
+#include "BLI_mmap.h"
+#include "BLI_task.hh"
 #include "BLI_threads.h"
+#include "BLI_vector.hh"
 
 #include "PIL_time.h"
 
@@ -64,6 +70,7 @@
 #include "BKE_anim_data.h"
 #include "BKE_animsys.h"
 #include "BKE_asset.h"
+#include "BKE_blender_version.h"
 #include "BKE_collection.h"
 #include "BKE_global.h" /* for G */
 #include "BKE_idprop.h"
@@ -238,6 +245,8 @@ struct NewAddress {
 
 struct OldNewMap {
   blender::Map<const void *, NewAddress> map;
+  /** Size of new addresses pointing into the mapped file, see #read_data_view. */
+  blender::Map<const void *, int64_t> view_sizes;
 };
 
 static OldNewMap *oldnewmap_new()
@@ -298,11 +307,12 @@ static void oldnewmap_clear(OldNewMap *onm)
   /* Free unused data. */
   for (NewAddress &new_addr : onm->map.values()) {
     // printf("FD MAP %llx   addr %llx  nr  %d  \n", (uintptr_t)(onm), new_addr.newp, new_addr.nr);
-    if (new_addr.nr == 0) {
+    if (new_addr.nr == 0 && !onm->view_sizes.contains(new_addr.newp)) {
       MEM_freeN(new_addr.newp);
     }
   }
   onm->map.clear_and_shrink();
+  onm->view_sizes.clear_and_shrink();
 }
 
 static void oldnewmap_free(OldNewMap *onm)
@@ -312,6 +322,123 @@ static void oldnewmap_free(OldNewMap *onm)
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Memory-Mapped Data Views
+ *
+ * When enabled (see #UserDef_Experimental.use_mapped_file_data), large data-blocks of
+ * uncompressed files aren't read into memory when building the data-map. Their new address
+ * points into a mapping of the file instead. Data only gets copied when it's looked up by
+ * regular reading code, only #BLO_read_get_new_data_address_view hands out the mapped memory
+ * itself, for data which is only copied when modified (e.g. #CD_FLAG_NOFREE custom-data layers).
+ * Data-blocks which are never looked up are not read at all.
+ *
+ * The file is mapped copy-on-write, so code writing to the data (e.g. versioning) only changes
+ * its own copy of the affected pages instead of crashing.
+ *
+ * Mapped memory may still be used after reading finished (even after the #Main is freed, as
+ * undo can reuse unchanged data-blocks), so mappings are kept until #BLO_read_data_views_free.
+ * Before a mapped file is overwritten, #BLO_read_data_views_release replaces the mapping with
+ * a copy of the data at the same address.
+ * \{ */
+
+/** Smaller data-blocks are read as usual. */
+#define READ_DATA_VIEW_MIN_SIZE (256 * 1024)
+
+struct DataViewsMapping {
+  BLI_mmap_file *mmap_file;
+  /** Empty once the mapping doesn't depend on the file anymore. */
+  char filepath[1024];
+};
+
+/** Mappings with data still in use. */
+static std::mutex data_views_mutex;
+static blender::Vector<DataViewsMapping> data_views_mmaps;
+
+static void read_data_views_keep(BLI_mmap_file *mmap_file, const char *filepath)
+{
+  std::lock_guard lock{data_views_mutex};
+  DataViewsMapping mapping;
+  mapping.mmap_file = mmap_file;
+  STRNCPY(mapping.filepath, filepath);
+  data_views_mmaps.append(mapping);
+}
+
+void BLO_read_data_views_free()
+{
+  std::lock_guard lock{data_views_mutex};
+  for (DataViewsMapping &mapping : data_views_mmaps) {
+    BLI_mmap_free(mapping.mmap_file);
+  }
+  data_views_mmaps.clear_and_shrink();
+}
+
+void BLO_read_data_views_release(const char *filepath)
+{
+  std::lock_guard lock{data_views_mutex};
+  for (DataViewsMapping &mapping : data_views_mmaps) {
+    if (mapping.filepath[0] == '\0' || BLI_path_cmp(mapping.filepath, filepath) != 0) {
+      continue;
+    }
+    if (BLI_mmap_detach(mapping.mmap_file)) {
+      mapping.filepath[0] = '\0';
+    }
+    else {
+      CLOG_ERROR(&LOG, "Failed to release the memory mapping of '%s'", filepath);
+    }
+  }
+}
+
+/**
+ * Only files which don't need versioning can be used as-is,
+ * versioning code may modify the data in place.
+ */
+static void read_data_views_allowed_update(FileData *fd, const int subversion)
+{
+  fd->data_views_allowed = fd->data_views_mmap && !(fd->flags & FD_FLAGS_SWITCH_ENDIAN) &&
+                           !fd->has_reconstruct &&
+                           (fd->fileversion > BLENDER_FILE_VERSION ||
+                            (fd->fileversion == BLENDER_FILE_VERSION &&
+                             subversion >= BLENDER_FILE_SUBVERSION));
+}
+
+/**
+ * \return The data of \a bh in the mapped file when it can be used without reading it.
+ */
+static void *read_data_view(FileData *fd, BHead *bh)
+{
+  if (fd->data_views_mmap == nullptr || bh->len < READ_DATA_VIEW_MIN_SIZE ||
+      (fd->flags & FD_FLAGS_SWITCH_ENDIAN) || fd->compflags[bh->SDNAnr] != SDNA_CMP_EQUAL) {
+    return nullptr;
+  }
+#ifdef USE_BHEAD_READ_ON_DEMAND
+  const BHeadN *new_bhead = BHEADN_FROM_BHEAD(bh);
+  /* Arrays are expected to be aligned to their elements, the file only guarantees 4 bytes. */
+  if (new_bhead->has_data || new_bhead->file_offset % 4 != 0) {
+    return nullptr;
+  }
+  return POINTER_OFFSET(BLI_mmap_get_pointer(fd->data_views_mmap), new_bhead->file_offset);
+#else
+  return nullptr;
+#endif
+}
+
+/** Replace the mapped data of a data-map entry by a copy, for code which owns its data. */
+static void read_data_view_copy(FileData *fd, NewAddress *entry, const int64_t size)
+{
+  void *data = MEM_mallocN(size_t(size), "read data view");
+  const size_t offset = size_t(
+      static_cast<char *>(entry->newp) -
+      static_cast<char *>(BLI_mmap_get_pointer(fd->data_views_mmap)));
+  if (UNLIKELY(!BLI_mmap_read(fd->data_views_mmap, data, offset, size_t(size)))) {
+    fd->flags &= ~FD_FLAGS_FILE_OK;
+    memset(data, 0, size_t(size));
+  }
+  fd->datamap->view_sizes.remove(entry->newp);
+  entry->newp = data;
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Helper Functions
  * \{ */
@@ -425,6 +552,7 @@ static void read_file_version(FileData *fd, Main *main)
         main->subversionfile = fg->subversion;
         main->minversionfile = fg->minversion;
         main->minsubversionfile = fg->minsubversion;
+        read_data_views_allowed_update(fd, fg->subversion);
         MEM_freeN(fg);
       }
       else if (bhead->code == ENDB) {
@@ -963,6 +1091,12 @@ static bool read_file_dna(FileData *fd, const char **r_error_message)
         fd->compflags = DNA_struct_get_compareflags(fd->filesdna, fd->memsdna);
         fd->reconstruct_info = DNA_reconstruct_info_create(
             fd->filesdna, fd->memsdna, fd->compflags);
+        for (int i = 0; i < fd->filesdna->structs_len; i++) {
+          if (fd->compflags[i] == SDNA_CMP_NOT_EQUAL) {
+            fd->has_reconstruct = true;
+            break;
+          }
+        }
         /* used to retrieve ID names from (bhead+1) */
         fd->id_name_offset = DNA_elem_offset(fd->filesdna, "ID", "char", "name[]");
         BLI_assert(fd->id_name_offset != -1);
@@ -1076,6 +1210,7 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
   char header[7];
   FileReader *rawfile = BLI_filereader_new_file(filedes);
   FileReader *file = nullptr;
+  BLI_mmap_file *data_views_mmap = nullptr;
 
   errno = 0;
   /* If opening the file failed or we can't read the header, give up. */
@@ -1106,6 +1241,10 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
       file = rawfile;
       rawfile = nullptr;
     }
+    else if (USER_EXPERIMENTAL_TEST(&U, use_mapped_file_data)) {
+      /* A separate mapping, as it may need to outlive the #FileReader. */
+      data_views_mmap = BLI_mmap_open_copy_on_write(filedes);
+    }
   }
   else if (BLI_file_magic_is_gzip(header)) {
     file = BLI_filereader_new_gzip(rawfile);
@@ -1131,6 +1270,10 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   FileData *fd = filedata_new(reports);
   fd->file = file;
+  fd->data_views_mmap = data_views_mmap;
+  if (data_views_mmap != nullptr) {
+    STRNCPY(fd->data_views_filepath, filepath);
+  }
 
   return fd;
 }
@@ -1258,6 +1401,14 @@ void blo_filedata_free(FileData *fd)
     if (fd->datamap) {
       oldnewmap_free(fd->datamap);
     }
+    if (fd->data_views_mmap) {
+      if (fd->data_views_used) {
+        read_data_views_keep(fd->data_views_mmap, fd->data_views_filepath);
+      }
+      else {
+        BLI_mmap_free(fd->data_views_mmap);
+      }
+    }
     if (fd->globmap) {
       oldnewmap_free(fd->globmap);
     }
@@ -1393,16 +1544,44 @@ BlendThumbnail *BLO_thumbnail_from_file(const char *filepath)
 /** \name Old/New Pointer Map
  * \{ */
 
+/**
+ * Only direct data-blocks.
+ * \param r_is_view: When not null, the data may point into the mapped file, see #read_data_view.
+ */
+static void *newdataadr_ex(FileData *fd,
+                           const void *adr,
+                           const bool increase_users,
+                           bool *r_is_view)
+{
+  NewAddress *entry = fd->datamap->map.lookup_ptr(adr);
+  if (entry == nullptr) {
+    return nullptr;
+  }
+  if (increase_users) {
+    entry->nr++;
+  }
+  if (const int64_t *view_size = fd->datamap->view_sizes.lookup_ptr(entry->newp)) {
+    if (r_is_view) {
+      *r_is_view = true;
+      fd->data_views_used = true;
+    }
+    else {
+      read_data_view_copy(fd, entry, *view_size);
+    }
+  }
+  return entry->newp;
+}
+
 /* Only direct data-blocks. */
 static void *newdataadr(FileData *fd, const void *adr)
 {
-  return oldnewmap_lookup_and_inc(fd->datamap, adr, true);
+  return newdataadr_ex(fd, adr, true, nullptr);
 }
 
 /* Only direct data-blocks. */
 static void *newdataadr_no_us(FileData *fd, const void *adr)
 {
-  return oldnewmap_lookup_and_inc(fd->datamap, adr, false);
+  return newdataadr_ex(fd, adr, false, nullptr);
 }
 
 void *blo_read_get_new_globaldata_address(FileData *fd, const void *adr)
@@ -1417,7 +1596,7 @@ static void *newpackedadr(FileData *fd, const void *adr)
     return oldnewmap_lookup_and_inc(fd->packedmap, adr, true);
   }
 
-  return oldnewmap_lookup_and_inc(fd->datamap, adr, true);
+  return newdataadr(fd, adr);
 }
 
 /* only lib data */
@@ -1744,18 +1923,16 @@ void blo_cache_storage_end(FileData *fd)
 
 static void switch_endian_structs(const SDNA *filesdna, BHead *bhead)
 {
-  int blocksize, nblocks;
-  char *data;
+  char *data = (char *)(bhead + 1);
+  const int blocksize = filesdna->types_size[filesdna->structs[bhead->SDNAnr]->type];
 
-  data = (char *)(bhead + 1);
-  blocksize = filesdna->types_size[filesdna->structs[bhead->SDNAnr]->type];
-
-  nblocks = bhead->nr;
-  while (nblocks--) {
-    DNA_struct_switch_endian(filesdna, bhead->SDNAnr, data);
-
-    data += blocksize;
-  }
+  /* Structs are independent, large arrays are split over threads. */
+  blender::threading::parallel_for(
+      blender::IndexRange(bhead->nr), 4096, [&](const blender::IndexRange range) {
+        for (const int64_t i : range) {
+          DNA_struct_switch_endian(filesdna, bhead->SDNAnr, data + i * blocksize);
+        }
+      });
 }
 
 static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
@@ -1829,6 +2006,36 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
   return temp;
 }
 
+/**
+ * Whether reading the data of \a bh needs more than copying it, see #read_struct.
+ */
+static bool read_struct_needs_conversion(const FileData *fd, const BHead *bh)
+{
+  if (bh->len == 0 || fd->compflags[bh->SDNAnr] == SDNA_CMP_REMOVED) {
+    return false;
+  }
+  return (bh->SDNAnr && (fd->flags & FD_FLAGS_SWITCH_ENDIAN)) ||
+         (fd->compflags[bh->SDNAnr] == SDNA_CMP_NOT_EQUAL);
+}
+
+/**
+ * The conversion part of #read_struct for a block with its data in memory,
+ * doesn't modify \a fd so it can run on multiple blocks in parallel.
+ */
+static void *read_struct_convert(const FileData *fd, BHead *bh, const char *blockname)
+{
+  BLI_assert(read_struct_needs_conversion(fd, bh));
+  if (bh->SDNAnr && (fd->flags & FD_FLAGS_SWITCH_ENDIAN)) {
+    switch_endian_structs(fd->filesdna, bh);
+  }
+  if (fd->compflags[bh->SDNAnr] == SDNA_CMP_NOT_EQUAL) {
+    return DNA_struct_reconstruct(fd->reconstruct_info, bh->SDNAnr, bh->nr, (bh + 1));
+  }
+  void *temp = MEM_mallocN(bh->len, blockname);
+  memcpy(temp, (bh + 1), bh->len);
+  return temp;
+}
+
 /* Like read_struct, but gets a pointer without allocating. Only works for
  * undo since DNA must match. */
 static const void *peek_struct_undo(FileData *fd, BHead *bhead)
@@ -3016,11 +3223,110 @@ static bool direct_link_id(FileData *fd, Main *main, const int tag, ID *id, ID *
   return success;
 }
 
+/** Only convert data in parallel when there is enough of it to be worth the overhead. */
+#define READ_DATA_PARALLEL_MIN_SIZE (256 * 1024)
+/** Limit the memory used for file data held in memory while converting in parallel. */
+#define READ_DATA_PARALLEL_BATCH_SIZE (64 * 1024 * 1024)
+
+/**
+ * Read the data blocks which need DNA conversion (see #read_struct_needs_conversion),
+ * converting them in parallel. Reading from the file itself is done in order by this thread.
+ *
+ * \param r_data: The result for each of \a bheads, converted blocks are set,
+ * others are left unchanged.
+ */
+static void read_data_convert_parallel(FileData *fd,
+                                       const blender::Span<BHead *> bheads,
+                                       const char *allocname,
+                                       blender::MutableSpan<void *> r_data)
+{
+  using namespace blender;
+
+  /* Blocks to convert, pointing to the data in memory. */
+  Vector<int64_t> batch_indices;
+  Vector<BHead *> batch_bheads;
+  /* Blocks read into memory for the conversion only, freed afterwards. */
+  Vector<BHead *> batch_bheads_temp;
+  int64_t batch_size = 0;
+
+  auto batch_convert = [&]() {
+    threading::parallel_for(batch_indices.index_range(), 1, [&](const IndexRange range) {
+      for (const int64_t i : range) {
+        r_data[batch_indices[i]] = read_struct_convert(fd, batch_bheads[i], allocname);
+      }
+    });
+    for (BHead *bh : batch_bheads_temp) {
+      MEM_freeN(BHEADN_FROM_BHEAD(bh));
+    }
+    batch_indices.clear();
+    batch_bheads.clear();
+    batch_bheads_temp.clear();
+    batch_size = 0;
+  };
+
+  for (const int64_t i : bheads.index_range()) {
+    BHead *bh = bheads[i];
+    if (!read_struct_needs_conversion(fd, bh)) {
+      continue;
+    }
+#ifdef USE_BHEAD_READ_ON_DEMAND
+    if (BHEADN_FROM_BHEAD(bh)->has_data == false) {
+      bh = blo_bhead_read_full(fd, bh);
+      if (UNLIKELY(bh == nullptr)) {
+        fd->flags &= ~FD_FLAGS_FILE_OK;
+        continue;
+      }
+      batch_bheads_temp.append(bh);
+    }
+#endif
+    batch_indices.append(i);
+    batch_bheads.append(bh);
+    batch_size += bh->len;
+    if (batch_size >= READ_DATA_PARALLEL_BATCH_SIZE) {
+      batch_convert();
+    }
+  }
+  batch_convert();
+}
+
 /* Read all data associated with a datablock into datamap. */
 static BHead *read_data_into_datamap(FileData *fd, BHead *bhead, const char *allocname)
 {
+  using namespace blender;
+
   bhead = blo_bhead_next(fd, bhead);
 
+  /* When the data needs DNA conversion (e.g. files from older versions or other platforms),
+   * convert in parallel, keeping the order of insertion into the map deterministic. */
+  if (bhead && bhead->code == DATA &&
+      ((fd->flags & FD_FLAGS_SWITCH_ENDIAN) || fd->has_reconstruct)) {
+    Vector<BHead *> bheads;
+    int64_t convert_size = 0;
+    for (; bhead && bhead->code == DATA; bhead = blo_bhead_next(fd, bhead)) {
+      bheads.append(bhead);
+      if (read_struct_needs_conversion(fd, bhead)) {
+        convert_size += bhead->len;
+      }
+    }
+
+    Array<void *> bheads_data(bheads.size(), nullptr);
+    Array<bool> is_converted(bheads.size(), false);
+    if (bheads.size() > 1 && convert_size >= READ_DATA_PARALLEL_MIN_SIZE) {
+      read_data_convert_parallel(fd, bheads, allocname, bheads_data);
+      for (const int64_t i : bheads.index_range()) {
+        is_converted[i] = read_struct_needs_conversion(fd, bheads[i]);
+      }
+    }
+
+    for (const int64_t i : bheads.index_range()) {
+      void *data = is_converted[i] ? bheads_data[i] : read_struct(fd, bheads[i], allocname);
+      if (data) {
+        oldnewmap_insert(fd->datamap, bheads[i]->old, data, 0);
+      }
+    }
+    return bhead;
+  }
+
   while (bhead && bhead->code == DATA) {
     /* The code below is useful for debugging leaks in data read from the blend file.
      * Without this the messages only tell us what ID-type the memory came from,
@@ -3042,8 +3348,11 @@ static BHead *read_data_into_datamap(FileData *fd, BHead *bhead, const char *all
     }
 #endif
 
-    void *data = read_struct(fd, bhead, allocname);
-    if (data) {
+    if (void *data = read_data_view(fd, bhead)) {
+      oldnewmap_insert(fd->datamap, bhead->old, data, 0);
+      fd->datamap->view_sizes.add(data, bhead->len);
+    }
+    else if (void *data = read_struct(fd, bhead, allocname)) {
       oldnewmap_insert(fd->datamap, bhead->old, data, 0);
     }
 
@@ -3472,6 +3781,7 @@ static BHead *read_global(BlendFileData *bfd, FileData *fd, BHead *bhead)
   bfd->main->minversionfile = fg->minversion;
   bfd->main->minsubversionfile = fg->minsubversion;
   bfd->main->build_commit_timestamp = fg->build_commit_timestamp;
+  read_data_views_allowed_update(fd, fg->subversion);
   BLI_strncpy(bfd->main->build_hash, fg->build_hash, sizeof(bfd->main->build_hash));
 
   bfd->fileflags = fg->fileflags;
@@ -4979,6 +5289,15 @@ void *BLO_read_get_new_data_address_no_us(BlendDataReader *reader, const void *o
   return newdataadr_no_us(reader->fd, old_address);
 }
 
+void *BLO_read_get_new_data_address_view(BlendDataReader *reader,
+                                         const void *old_address,
+                                         bool *r_is_view)
+{
+  FileData *fd = reader->fd;
+  *r_is_view = false;
+  return newdataadr_ex(fd, old_address, true, fd->data_views_allowed ? r_is_view : nullptr);
+}
+
 void *BLO_read_get_new_packed_address(BlendDataReader *reader, const void *old_address)
 {
   return newpackedadr(reader->fd, old_address);
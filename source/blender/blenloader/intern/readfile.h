@@ -23,6 +23,7 @@
 extern "C" {
 #endif
 
+struct BLI_mmap_file;
 struct BLOCacheStorage;
 struct IDNameLib_Map;
 struct Key;
@@ -71,6 +72,8 @@ typedef struct FileData {
   /** Array of #eSDNA_StructCompare. */
   const char *compflags;
   struct DNA_ReconstructInfo *reconstruct_info;
+  /** Some structs in the file differ from the current DNA and need reconstruction. */
+  bool has_reconstruct;
 
   int fileversion;
   /** Used to retrieve ID names from (bhead+1). */
@@ -98,6 +101,18 @@ typedef struct FileData {
   struct OldNewMap *packedmap;
   struct BLOCacheStorage *cache_storage;
 
+  /**
+   * Mapping of the whole file which large data-blocks point into instead of being read,
+   * see #BLO_read_get_new_data_address_view. Unlike the mapping of the #FileReader,
+   * it's kept after reading when any data still points into it.
+   */
+  struct BLI_mmap_file *data_views_mmap;
+  /** Path of the mapped file, to release the mapping before it's overwritten. */
+  char data_views_filepath[1024];
+  /** The file's data can be used as-is (without versioning or DNA conversion). */
+  bool data_views_allowed;
+  bool data_views_used;
+
   struct BHeadSort *bheadmap;
   int tot_bheadmap;
 
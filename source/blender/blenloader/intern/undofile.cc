@@ -5,12 +5,14 @@
  * \ingroup blenloader
  */
 
+#include <atomic>
 #include <cerrno>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fcntl.h>
+#include <zstd.h>
 
 /* open/close */
 #ifndef _WIN32
@@ -25,6 +27,9 @@
 
 #include "BLI_blenlib.h"
 #include "BLI_ghash.h"
+#include "BLI_index_range.hh"
+#include "BLI_task.h"
+#include "BLI_vector.hh"
 
 #include "BLO_readfile.h"
 #include "BLO_undofile.h"
@@ -36,12 +41,181 @@
 /* keep last */
 #include "BLI_strict_flags.h"
 
+/* -------------------------------------------------------------------- */
+/** \name Chunk Compression
+ * \{ */
+
+/** Fast compression, to keep up with undo pushes. */
+#define MEMFILE_COMPRESSION_LEVEL 1
+/** Smaller chunks aren't worth compressing. */
+#define MEMFILE_COMPRESS_MIN_SIZE 512
+/** Amount of uncompressed data handled by a single task. */
+#define MEMFILE_COMPRESS_TASK_SIZE (4 * 1024 * 1024)
+
+struct MemFileCompressItem {
+  MemFileChunk *chunk;
+  /** Copied from the chunk, which may be modified while compressing. */
+  const char *buf;
+  size_t size;
+  /** Result, null when compression failed or wasn't worth it. */
+  char *compressed_buf;
+  size_t compressed_size;
+};
+
+struct MemFileCompress {
+  TaskPool *pool;
+  blender::Vector<MemFileCompressItem> items;
+  /** Ranges of #items compressed by each task. */
+  blender::Vector<blender::IndexRange> tasks;
+  std::atomic<int64_t> tasks_done = 0;
+};
+
+static void memfile_compress_task(TaskPool *__restrict pool, void *taskdata)
+{
+  MemFileCompress *compress = static_cast<MemFileCompress *>(BLI_task_pool_user_data(pool));
+  const blender::IndexRange range = *static_cast<const blender::IndexRange *>(taskdata);
+
+  ZSTD_CCtx *ctx = ZSTD_createCCtx();
+  for (const int64_t i : range) {
+    if (BLI_task_pool_current_canceled(pool)) {
+      break;
+    }
+    MemFileCompressItem &item = compress->items[i];
+    const size_t buf_size = ZSTD_compressBound(item.size);
+    char *buf = static_cast<char *>(MEM_mallocN(buf_size, "Chunk buffer compressed"));
+    const size_t size = ZSTD_compressCCtx(
+        ctx, buf, buf_size, item.buf, item.size, MEMFILE_COMPRESSION_LEVEL);
+    /* Only keep the result when it saves a reasonable amount of memory. */
+    if (ZSTD_isError(size) || size > item.size - item.size / 8) {
+      MEM_freeN(buf);
+      continue;
+    }
+    item.compressed_buf = static_cast<char *>(MEM_reallocN(buf, size));
+    item.compressed_size = size;
+  }
+  ZSTD_freeCCtx(ctx);
+
+  compress->tasks_done.fetch_add(1, std::memory_order_release);
+}
+
+void BLO_memfile_compress_begin(MemFile *memfile)
+{
+  BLO_memfile_compress_update(memfile, true);
+
+  MemFileCompress *compress = MEM_new<MemFileCompress>(__func__);
+  size_t task_size = 0;
+  LISTBASE_FOREACH (MemFileChunk *, chunk, &memfile->chunks) {
+    /* Chunks shared with the next step must stay as they are, the next step points to them. */
+    if (chunk->is_identical || chunk->is_identical_future || chunk->compressed_size != 0 ||
+        chunk->size < MEMFILE_COMPRESS_MIN_SIZE) {
+      continue;
+    }
+    compress->items.append({chunk, chunk->buf, chunk->size, nullptr, 0});
+    task_size += chunk->size;
+    if (task_size >= MEMFILE_COMPRESS_TASK_SIZE) {
+      const int64_t start = compress->tasks.is_empty() ? 0 : compress->tasks.last().one_after_last();
+      compress->tasks.append(blender::IndexRange(start, compress->items.size() - start));
+      task_size = 0;
+    }
+  }
+  if (task_size > 0) {
+    const int64_t start = compress->tasks.is_empty() ? 0 : compress->tasks.last().one_after_last();
+    compress->tasks.append(blender::IndexRange(start, compress->items.size() - start));
+  }
+
+  if (compress->tasks.is_empty()) {
+    MEM_delete(compress);
+    return;
+  }
+
+  /* Low priority, so this only uses threads which are idle otherwise. */
+  compress->pool = BLI_task_pool_create_background(compress, TASK_PRIORITY_LOW);
+  for (blender::IndexRange &range : compress->tasks) {
+    BLI_task_pool_push(compress->pool, memfile_compress_task, &range, false, nullptr);
+  }
+  memfile->compress = compress;
+}
+
+static void memfile_compress_free(MemFile *memfile)
+{
+  MemFileCompress *compress = memfile->compress;
+  BLI_task_pool_free(compress->pool);
+  MEM_delete(compress);
+  memfile->compress = nullptr;
+}
+
+void BLO_memfile_compress_update(MemFile *memfile, const bool wait)
+{
+  MemFileCompress *compress = memfile->compress;
+  if (compress == nullptr) {
+    return;
+  }
+  if (wait) {
+    BLI_task_pool_work_and_wait(compress->pool);
+  }
+  else if (compress->tasks_done.load(std::memory_order_acquire) < compress->tasks.size()) {
+    return;
+  }
+
+  for (MemFileCompressItem &item : compress->items) {
+    if (item.compressed_buf == nullptr) {
+      continue;
+    }
+    MemFileChunk *chunk = item.chunk;
+    BLI_assert(chunk->buf == item.buf && !chunk->is_identical);
+    MEM_freeN((void *)chunk->buf);
+    chunk->buf = item.compressed_buf;
+    chunk->compressed_size = item.compressed_size;
+    memfile->size -= chunk->size - chunk->compressed_size;
+  }
+  memfile_compress_free(memfile);
+}
+
+/** Stop compressing, without applying any results. */
+static void memfile_compress_cancel(MemFile *memfile)
+{
+  MemFileCompress *compress = memfile->compress;
+  if (compress == nullptr) {
+    return;
+  }
+  BLI_task_pool_cancel(compress->pool);
+  for (MemFileCompressItem &item : compress->items) {
+    MEM_SAFE_FREE(item.compressed_buf);
+  }
+  memfile_compress_free(memfile);
+}
+
+/**
+ * \return The uncompressed data of \a chunk. For compressed chunks it's decompressed into
+ * \a buf, which is reallocated when it's smaller than the chunk.
+ */
+static const char *memfile_chunk_data(const MemFileChunk *chunk, char **buf, size_t *buf_size)
+{
+  if (chunk->compressed_size == 0) {
+    return chunk->buf;
+  }
+  if (*buf_size < chunk->size) {
+    MEM_SAFE_FREE(*buf);
+    *buf = static_cast<char *>(MEM_mallocN(chunk->size, "Chunk buffer decompressed"));
+    *buf_size = chunk->size;
+  }
+  const size_t size = ZSTD_decompress(*buf, chunk->size, chunk->buf, chunk->compressed_size);
+  if (ZSTD_isError(size) || size != chunk->size) {
+    return nullptr;
+  }
+  return *buf;
+}
+
+/** \} */
+
 /* **************** support for memory-write, for undo buffers *************** */
 
 void BLO_memfile_free(MemFile *memfile)
 {
   MemFileChunk *chunk;
 
+  memfile_compress_cancel(memfile);
+
   while ((chunk = static_cast<MemFileChunk *>(BLI_pophead(&memfile->chunks)))) {
     if (chunk->is_identical == false) {
       MEM_freeN((void *)chunk->buf);
@@ -58,6 +232,8 @@ void BLO_memfile_merge(MemFile *first, MemFile *second)
   GHash *buffer_to_second_memchunk = BLI_ghash_new(
       BLI_ghashutil_ptrhash, BLI_ghashutil_ptrcmp, __func__);
 
+  BLO_memfile_compress_update(second, true);
+
   /* First, detect all memchunks in second memfile that are not owned by it. */
   for (MemFileChunk *sc = static_cast<MemFileChunk *>(second->chunks.first); sc != nullptr;
        sc = static_cast<MemFileChunk *>(sc->next)) {
@@ -91,6 +267,7 @@ void BLO_memfile_merge(MemFile *first, MemFile *second)
 
 void BLO_memfile_clear_future(MemFile *memfile)
 {
+  BLO_memfile_compress_update(memfile, true);
   LISTBASE_FOREACH (MemFileChunk *, chunk, &memfile->chunks) {
     chunk->is_identical_future = false;
   }
@@ -102,6 +279,8 @@ void BLO_memfile_write_init(MemFileWriteData *mem_data,
 {
   mem_data->written_memfile = written_memfile;
   mem_data->reference_memfile = reference_memfile;
+  mem_data->reference_buf = nullptr;
+  mem_data->reference_buf_size = 0;
   mem_data->reference_current_chunk = reference_memfile ? static_cast<MemFileChunk *>(
                                                               reference_memfile->chunks.first) :
                                                           nullptr;
@@ -112,6 +291,9 @@ void BLO_memfile_write_init(MemFileWriteData *mem_data,
    * current Main data-base broke the order matching with the memchunks from previous step.
    */
   if (reference_memfile != nullptr) {
+    /* Chunks may be shared with the new memfile, they must not change anymore. */
+    BLO_memfile_compress_update(reference_memfile, true);
+
     mem_data->id_session_uuid_mapping = BLI_ghash_new(
         BLI_ghashutil_inthash_p_simple, BLI_ghashutil_intcmp, __func__);
     uint current_session_uuid = MAIN_ID_SESSION_UUID_UNSET;
@@ -137,6 +319,7 @@ void BLO_memfile_write_finalize(MemFileWriteData *mem_data)
   if (mem_data->id_session_uuid_mapping != nullptr) {
     BLI_ghash_free(mem_data->id_session_uuid_mapping, nullptr, nullptr);
   }
+  MEM_SAFE_FREE(mem_data->reference_buf);
 }
 
 void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t size)
@@ -147,6 +330,7 @@ void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t s
   MemFileChunk *curchunk = static_cast<MemFileChunk *>(
       MEM_mallocN(sizeof(MemFileChunk), "MemFileChunk"));
   curchunk->size = size;
+  curchunk->compressed_size = 0;
   curchunk->buf = nullptr;
   curchunk->is_identical = false;
   /* This is unsafe in the sense that an app handler or other code that does not
@@ -160,8 +344,11 @@ void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t s
   if (*compchunk_step != nullptr) {
     MemFileChunk *compchunk = *compchunk_step;
     if (compchunk->size == curchunk->size) {
-      if (memcmp(compchunk->buf, buf, size) == 0) {
+      const char *compchunk_data = memfile_chunk_data(
+          compchunk, &mem_data->reference_buf, &mem_data->reference_buf_size);
+      if (compchunk_data && memcmp(compchunk_data, buf, size) == 0) {
         curchunk->buf = compchunk->buf;
+        curchunk->compressed_size = compchunk->compressed_size;
         curchunk->is_identical = true;
         compchunk->is_identical_future = true;
       }
@@ -203,6 +390,10 @@ bool BLO_memfile_write_file(struct MemFile *memfile, const char *filepath)
 {
   MemFileChunk *chunk;
   int file, oflags;
+  char *chunk_buf = nullptr;
+  size_t chunk_buf_size = 0;
+
+  BLO_memfile_compress_update(memfile, true);
 
   /* NOTE: This is currently used for autosave and 'quit.blend',
    * where _not_ following symlinks is OK,
@@ -232,10 +423,14 @@ bool BLO_memfile_write_file(struct MemFile *memfile, const char *filepath)
 
   for (chunk = static_cast<MemFileChunk *>(memfile->chunks.first); chunk;
        chunk = static_cast<MemFileChunk *>(chunk->next)) {
+    const char *chunk_data = memfile_chunk_data(chunk, &chunk_buf, &chunk_buf_size);
+    if (chunk_data == nullptr) {
+      break;
+    }
 #ifdef _WIN32
-    if (size_t(write(file, chunk->buf, uint(chunk->size))) != chunk->size)
+    if (size_t(write(file, chunk_data, uint(chunk->size))) != chunk->size)
 #else
-    if (size_t(write(file, chunk->buf, chunk->size)) != chunk->size)
+    if (size_t(write(file, chunk_data, chunk->size)) != chunk->size)
 #endif
     {
       break;
@@ -243,6 +438,7 @@ bool BLO_memfile_write_file(struct MemFile *memfile, const char *filepath)
   }
 
   close(file);
+  MEM_SAFE_FREE(chunk_buf);
 
   if (chunk) {
     fprintf(stderr,
@@ -310,7 +506,21 @@ static ssize_t undo_read(FileReader *reader, void *buffer, size_t size)
         readsize = chunk->size - chunkoffset;
       }
 
-      memcpy(POINTER_OFFSET(buffer, totread), chunk->buf + chunkoffset, readsize);
+      const char *chunk_data = chunk->buf;
+      if (chunk->compressed_size != 0) {
+        if (undo->decompressed_chunk != chunk) {
+          undo->decompressed_chunk = nullptr;
+          if (!memfile_chunk_data(
+                  chunk, &undo->decompressed_buf, &undo->decompressed_buf_size)) {
+            printf("illegal read, chunk decompression failed\n");
+            return 0;
+          }
+          undo->decompressed_chunk = chunk;
+        }
+        chunk_data = undo->decompressed_buf;
+      }
+
+      memcpy(POINTER_OFFSET(buffer, totread), chunk_data + chunkoffset, readsize);
       totread += readsize;
       undo->reader.offset += (off64_t)readsize;
       seek += readsize;
@@ -331,6 +541,8 @@ static ssize_t undo_read(FileReader *reader, void *buffer, size_t size)
 
 static void undo_close(FileReader *reader)
 {
+  UndoReader *undo = (UndoReader *)reader;
+  MEM_SAFE_FREE(undo->decompressed_buf);
   MEM_freeN(reader);
 }
 
@@ -338,6 +550,8 @@ FileReader *BLO_memfile_new_filereader(MemFile *memfile, int undo_direction)
 {
   UndoReader *undo = static_cast<UndoReader *>(MEM_callocN(sizeof(UndoReader), __func__));
 
+  BLO_memfile_compress_update(memfile, true);
+
   undo->memfile = memfile;
   undo->undo_direction = undo_direction;
 
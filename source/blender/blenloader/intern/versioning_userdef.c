@@ -784,6 +784,9 @@ void blo_do_versions_userdef(UserDef *userdef)
    */
   {
     /* Keep this block, even when empty. */
+    if (userdef->sequencer_prefetch_threads == 0) {
+      userdef->sequencer_prefetch_threads = 1;
+    }
   }
 
   LISTBASE_FOREACH (bTheme *, btheme, &userdef->themes) {
@@ -89,9 +89,11 @@
 #include "BLI_endian_switch.h"
 #include "BLI_link_utils.h"
 #include "BLI_linklist.h"
+#include "BLI_map.hh"
 #include "BLI_math_base.h"
 #include "BLI_mempool.h"
 #include "BLI_threads.h"
+#include "BLI_vector.hh"
 #include "MEM_guardedalloc.h" /* MEM_freeN */
 
 #include "BKE_blender_version.h"
@@ -139,6 +141,12 @@ static CLG_LogRef LOG = {"blo.writefile"};
 /** Use if we want to store how many bytes have been written to the file. */
 // #define USE_WRITE_DATA_LEN
 
+#ifdef __GLIBC__
+#  if __GLIBC_PREREQ(2, 27)
+#    define USE_COPY_FILE_RANGE
+#  endif
+#endif
+
 /* -------------------------------------------------------------------- */
 /** \name Internal Write Wrapper's (Abstracts Compression)
  * \{ */
@@ -390,6 +398,96 @@ static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Delta Save Types
+ *
+ * When saving a file again (see #BlendFileWriteParams.use_delta), data which didn't change
+ * since the previous save is copied from the previous file instead of being written, which
+ * avoids most of the disk writes, and shares the storage on file-systems supporting it.
+ *
+ * Every ID is serialized as usual, and the written data is compared with the data of the same
+ * ID in the previous file. Data is only copied as long as it is identical, so the result is the
+ * same as a full save, whatever changed the ID since then. Data which isn't part of an ID (like
+ * the file header and #FileGlobal) is always written.
+ * \{ */
+
+struct DeltaSaveID {
+  /** Range of the data of the ID in the file. */
+  size_t offset;
+  size_t size;
+};
+
+struct DeltaSaveFile {
+  char filepath[FILE_MAX];
+  /** To detect changes by others, the file is only used as long as these match. */
+  int64_t file_size;
+  int64_t file_mtime;
+  uint64_t file_inode;
+
+  /** Written IDs by session uuid. */
+  blender::Map<uint, DeltaSaveID> ids;
+};
+
+/** The last saved file, only accessed from the main thread. */
+static DeltaSaveFile *delta_save_file = nullptr;
+
+static bool delta_save_file_stat(const char *filepath,
+                                 int64_t *r_size,
+                                 int64_t *r_mtime,
+                                 uint64_t *r_inode)
+{
+  BLI_stat_t st;
+  if (BLI_stat(filepath, &st) == -1) {
+    return false;
+  }
+  *r_size = int64_t(st.st_size);
+  *r_mtime = int64_t(st.st_mtime);
+  *r_inode = uint64_t(st.st_ino);
+  return true;
+}
+
+/**
+ * \return The previous save of the file written to by \a current, when the file didn't change
+ * since then.
+ */
+static const DeltaSaveFile *delta_save_file_reference_get(const DeltaSaveFile *current)
+{
+  if (delta_save_file == nullptr ||
+      BLI_path_cmp(delta_save_file->filepath, current->filepath) != 0) {
+    return nullptr;
+  }
+  int64_t size, mtime;
+  uint64_t inode;
+  if (!delta_save_file_stat(current->filepath, &size, &mtime, &inode) ||
+      size != delta_save_file->file_size || mtime != delta_save_file->file_mtime ||
+      inode != delta_save_file->file_inode) {
+    return nullptr;
+  }
+  return delta_save_file;
+}
+
+/**
+ * Keep \a current for the next save, once it has been written to its final location.
+ * Passing null only forgets the previous save of \a filepath.
+ */
+static void delta_save_file_store(const char *filepath, DeltaSaveFile *current)
+{
+  if (current != nullptr &&
+      !delta_save_file_stat(
+          filepath, &current->file_size, &current->file_mtime, &current->file_inode)) {
+    MEM_delete(current);
+    current = nullptr;
+  }
+  if (current == nullptr && (delta_save_file == nullptr ||
+                             BLI_path_cmp(delta_save_file->filepath, filepath) != 0)) {
+    return;
+  }
+  MEM_delete(delta_save_file);
+  delta_save_file = current;
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Write Data Type & Functions
  * \{ */
@@ -422,6 +520,35 @@ struct WriteData {
   /** When true, write to #WriteData.current, could also call 'is_undo'. */
   bool use_memfile;
 
+  /** Delta save, see #BlendFileWriteParams.use_delta. */
+  struct {
+    /** The previously saved file, nullptr when it can't be used. */
+    const DeltaSaveFile *reference;
+    int reference_file;
+    /** Data read from #reference_file, to compare with the written data. */
+    char *reference_buf;
+
+    /**
+     * Range of the data of the ID being written in the reference file which hasn't been
+     * compared yet. Empty when the ID is new or its data differs.
+     */
+    size_t compare_offset;
+    size_t compare_size;
+
+    /** Range of the reference file which still has to be copied. */
+    size_t copy_offset;
+    size_t copy_size;
+
+    /** IDs of the file being written. */
+    DeltaSaveFile *current;
+    /** Size of the file being written so far, including the data still to be copied. */
+    size_t offset;
+    /** Offset of the ID currently being written. */
+    size_t id_offset;
+  } delta;
+  /** When true, record written IDs in #WriteData.delta while writing to the file. */
+  bool use_delta;
+
   /**
    * Wrap writing, so we can use zstd or
    * other compression types later, see: G_FILE_COMPRESS
@@ -441,6 +568,7 @@ static WriteData *writedata_new(WriteWrap *ww)
   wd->sdna = DNA_sdna_current_get();
 
   wd->ww = ww;
+  wd->delta.reference_file = -1;
 
   if ((ww == nullptr) || (ww->use_buf)) {
     if (ww == nullptr) {
@@ -457,6 +585,105 @@ static WriteData *writedata_new(WriteWrap *ww)
   return wd;
 }
 
+/**
+ * Copy \a size bytes at \a offset of \a file_src to the current position of \a file_dst.
+ */
+static bool delta_save_copy_range(int file_src, size_t offset, size_t size, int file_dst)
+{
+#ifdef USE_COPY_FILE_RANGE
+  /* Let the kernel copy, file-systems supporting it share the data with the previous file. */
+  off64_t offset_src = off64_t(offset);
+  while (size > 0) {
+    const ssize_t copied = copy_file_range(file_src, &offset_src, file_dst, nullptr, size, 0);
+    if (copied <= 0) {
+      /* Not supported (e.g. across file-systems), copy the rest below. */
+      break;
+    }
+    size -= size_t(copied);
+  }
+  offset = size_t(offset_src);
+#endif
+
+  if (size == 0) {
+    return true;
+  }
+  if (BLI_lseek(file_src, int64_t(offset), SEEK_SET) == -1) {
+    return false;
+  }
+  const size_t buf_size = MIN2(size, size_t(ZSTD_BUFFER_SIZE));
+  char *buf = static_cast<char *>(MEM_mallocN(buf_size, __func__));
+  bool success = true;
+  while (success && size > 0) {
+    const size_t len = MIN2(size, buf_size);
+    success = (size_t(read(file_src, buf, len)) == len) &&
+              (size_t(write(file_dst, buf, len)) == len);
+    size -= len;
+  }
+  MEM_freeN(buf);
+  return success;
+}
+
+static bool delta_save_copy_flush(WriteData *wd)
+{
+  if (wd->delta.copy_size == 0) {
+    return true;
+  }
+  const bool success = delta_save_copy_range(wd->delta.reference_file,
+                                             wd->delta.copy_offset,
+                                             wd->delta.copy_size,
+                                             wd->ww->file_handle);
+  wd->delta.copy_size = 0;
+  return success;
+}
+
+/**
+ * \return True when the next \a size bytes of the ID in the reference file are identical to
+ * \a buf, see #WriteData.delta.compare_offset.
+ */
+static bool delta_save_chunk_is_identical(WriteData *wd, const char *buf, size_t size)
+{
+  if (wd->delta.compare_size < size) {
+    return false;
+  }
+  BLI_assert(size <= wd->buffer.max_size);
+  if (BLI_lseek(wd->delta.reference_file, int64_t(wd->delta.compare_offset), SEEK_SET) == -1 ||
+      size_t(read(wd->delta.reference_file, wd->delta.reference_buf, size)) != size) {
+    return false;
+  }
+  return memcmp(wd->delta.reference_buf, buf, size) == 0;
+}
+
+/**
+ * Write a chunk of data, or extend the range copied from the previous file when it's identical.
+ */
+static bool delta_save_chunk_add(WriteData *wd, const char *buf, size_t size)
+{
+  if (delta_save_chunk_is_identical(wd, buf, size)) {
+    if (wd->delta.copy_size != 0 &&
+        wd->delta.copy_offset + wd->delta.copy_size != wd->delta.compare_offset) {
+      if (!delta_save_copy_flush(wd)) {
+        return false;
+      }
+    }
+    if (wd->delta.copy_size == 0) {
+      wd->delta.copy_offset = wd->delta.compare_offset;
+    }
+    wd->delta.copy_size += size;
+    wd->delta.compare_offset += size;
+    wd->delta.compare_size -= size;
+    wd->delta.offset += size;
+    return true;
+  }
+
+  /* The rest of the ID is written, even if parts of it are identical again. */
+  wd->delta.compare_size = 0;
+  if (!delta_save_copy_flush(wd)) {
+    return false;
+  }
+  wd->delta.offset += size;
+  return wd->ww->write(wd->ww, buf, size) == size;
+}
+
 static void writedata_do_write(WriteData *wd, const void *mem, size_t memlen)
 {
   if ((wd == nullptr) || wd->error || (mem == nullptr) || memlen < 1) {
@@ -476,6 +703,11 @@ static void writedata_do_write(WriteData *wd, const void *mem, size_t memlen)
   if (wd->use_memfile) {
     BLO_memfile_chunk_add(&wd->mem, static_cast<const char *>(mem), memlen);
   }
+  else if (wd->use_delta) {
+    if (!delta_save_chunk_add(wd, static_cast<const char *>(mem), memlen)) {
+      wd->error = true;
+    }
+  }
   else {
     if (wd->ww->write(wd->ww, static_cast<const char *>(mem), memlen) != memlen) {
       wd->error = true;
@@ -485,6 +717,12 @@ static void writedata_do_write(WriteData *wd, const void *mem, size_t memlen)
 
 static void writedata_free(WriteData *wd)
 {
+  if (wd->delta.reference_file != -1) {
+    close(wd->delta.reference_file);
+  }
+  if (wd->delta.reference_buf) {
+    MEM_freeN(wd->delta.reference_buf);
+  }
   if (wd->buffer.buf) {
     MEM_freeN(wd->buffer.buf);
   }
@@ -598,6 +836,11 @@ static bool mywrite_end(WriteData *wd)
   if (wd->use_memfile) {
     BLO_memfile_write_finalize(&wd->mem);
   }
+  else if (wd->use_delta) {
+    if (!delta_save_copy_flush(wd)) {
+      wd->error = true;
+    }
+  }
 
   const bool err = wd->error;
   writedata_free(wd);
@@ -608,10 +851,22 @@ static bool mywrite_end(WriteData *wd)
 /**
  * Start writing of data related to a single ID.
  *
- * Only does something when storing an undo step.
+ * Only does something when storing an undo step or delta saving.
  */
 static void mywrite_id_begin(WriteData *wd, ID *id)
 {
+  if (wd->use_delta) {
+    mywrite_flush(wd);
+    wd->delta.id_offset = wd->delta.offset;
+
+    /* Compare with the data of the same ID in the previous file. */
+    const DeltaSaveID *reference_id = wd->delta.reference ?
+                                          wd->delta.reference->ids.lookup_ptr(id->session_uuid) :
+                                          nullptr;
+    wd->delta.compare_offset = reference_id ? reference_id->offset : 0;
+    wd->delta.compare_size = reference_id ? reference_id->size : 0;
+  }
+
   if (wd->use_memfile) {
     wd->mem.current_id_session_uuid = id->session_uuid;
 
@@ -638,12 +893,19 @@ static void mywrite_id_begin(WriteData *wd, ID *id)
 }
 
 /**
- * Start writing of data related to a single ID.
+ * End writing of data related to a single ID.
  *
- * Only does something when storing an undo step.
+ * Only does something when storing an undo step or delta saving.
  */
-static void mywrite_id_end(WriteData *wd, ID * /*id*/)
+static void mywrite_id_end(WriteData *wd, ID *id)
 {
+  if (wd->use_delta) {
+    mywrite_flush(wd);
+    wd->delta.current->ids.add(id->session_uuid,
+                               {wd->delta.id_offset, wd->delta.offset - wd->delta.id_offset});
+    wd->delta.compare_size = 0;
+  }
+
   if (wd->use_memfile) {
     /* Very important to do it after every ID write now, otherwise we cannot know whether a
      * specific ID changed or not. */
@@ -1113,10 +1375,15 @@ static int write_id_direct_linked_data_process_cb(LibraryIDLinkCallbackData *cb_
 }
 
 /* if MemFile * there's filesave to memory */
+/**
+ * \param delta_current: Record the written chunks for delta saving (can be nullptr).
+ * Data which didn't change since the previous save of the same file is copied from it.
+ */
 static bool write_file_handle(Main *mainvar,
                               WriteWrap *ww,
                               MemFile *compare,
                               MemFile *current,
+                              DeltaSaveFile *delta_current,
                               int write_flags,
                               bool use_userdef,
                               const BlendThumbnail *thumb)
@@ -1129,6 +1396,26 @@ static bool write_file_handle(Main *mainvar,
   wd = mywrite_begin(ww, compare, current);
   BlendWriter writer = {wd};
 
+  if (delta_current != nullptr) {
+    wd->use_delta = true;
+    wd->delta.current = delta_current;
+    /* Buffer the written data, so it's compared with the previous file in large chunks. */
+    if (wd->buffer.buf == nullptr) {
+      wd->buffer.max_size = ZSTD_BUFFER_SIZE;
+      wd->buffer.chunk_size = ZSTD_CHUNK_SIZE;
+      wd->buffer.buf = static_cast<uchar *>(MEM_mallocN(wd->buffer.max_size, "wd->buffer.buf"));
+    }
+    const DeltaSaveFile *reference = delta_save_file_reference_get(delta_current);
+    if (reference != nullptr) {
+      wd->delta.reference_file = BLI_open(reference->filepath, O_BINARY | O_RDONLY, 0);
+      if (wd->delta.reference_file != -1) {
+        wd->delta.reference = reference;
+        wd->delta.reference_buf = static_cast<char *>(
+            MEM_mallocN(wd->buffer.max_size, "wd->delta.reference_buf"));
+      }
+    }
+  }
+
   /* Clear 'directly linked' flag for all linked data, these are not necessarily valid/up-to-date
    * info, they will be re-generated while write code is processing local IDs below. */
   if (!wd->use_memfile) {
@@ -1412,14 +1699,26 @@ bool BLO_write_file(Main *mainvar,
     BLO_main_validate_shapekeys(mainvar, reports);
   }
 
+  /* Data may still point into a mapping of the file, which can't be replaced on all platforms
+   * and shouldn't change under that data. */
+  BLO_read_data_views_release(filepath);
+
   /* open temporary file, so we preserve the original in case we crash */
   BLI_snprintf(tempname, sizeof(tempname), "%s@", filepath);
 
   ww_handle_init((write_flags & G_FILE_COMPRESS) ? WW_WRAP_ZSTD : WW_WRAP_NONE, &ww);
 
+  /* Copying from the previous file isn't possible for compressed files. */
+  DeltaSaveFile *delta_current = nullptr;
+  if (params->use_delta && !(write_flags & G_FILE_COMPRESS)) {
+    delta_current = MEM_new<DeltaSaveFile>(__func__);
+    STRNCPY(delta_current->filepath, filepath);
+  }
+
   if (ww.open(&ww, tempname) == false) {
     BKE_reportf(
         reports, RPT_ERROR, "Cannot open file %s for writing: %s", tempname, strerror(errno));
+    MEM_delete(delta_current);
     return false;
   }
 
@@ -1508,7 +1807,7 @@ bool BLO_write_file(Main *mainvar,
 
   /* actual file writing */
   const bool err = write_file_handle(
-      mainvar, &ww, nullptr, nullptr, write_flags, use_userdef, thumb);
+      mainvar, &ww, nullptr, nullptr, delta_current, write_flags, use_userdef, thumb);
 
   ww.close(&ww);
 
@@ -1520,6 +1819,7 @@ bool BLO_write_file(Main *mainvar,
   if (err) {
     BKE_report(reports, RPT_ERROR, strerror(errno));
     remove(tempname);
+    MEM_delete(delta_current);
 
     return false;
   }
@@ -1530,15 +1830,21 @@ bool BLO_write_file(Main *mainvar,
     const bool err_hist = do_history(filepath, reports);
     if (err_hist) {
       BKE_report(reports, RPT_ERROR, "Version backup failed (file saved with @)");
+      delta_save_file_store(filepath, nullptr);
+      MEM_delete(delta_current);
       return false;
     }
   }
 
   if (BLI_rename(tempname, filepath) != 0) {
     BKE_report(reports, RPT_ERROR, "Cannot change old file (file saved with @)");
+    delta_save_file_store(filepath, nullptr);
+    MEM_delete(delta_current);
     return false;
   }
 
+  delta_save_file_store(filepath, delta_current);
+
   if (G.debug & G_DEBUG_IO && mainvar->lock != nullptr) {
     BKE_report(reports, RPT_INFO, "Checking sanity of current .blend file *AFTER* save to disk");
     BLO_main_validate_libraries(mainvar, reports);
@@ -1552,11 +1858,17 @@ bool BLO_write_file_mem(Main *mainvar, MemFile *compare, MemFile *current, int w
   bool use_userdef = false;
 
   const bool err = write_file_handle(
-      mainvar, nullptr, compare, current, write_flags, use_userdef, nullptr);
+      mainvar, nullptr, compare, current, nullptr, write_flags, use_userdef, nullptr);
 
   return (err == 0);
 }
 
+void BLO_write_delta_save_free()
+{
+  MEM_delete(delta_save_file);
+  delta_save_file = nullptr;
+}
+
 void BLO_write_raw(BlendWriter *writer, size_t size_in_bytes, const void *data_ptr)
 {
   writedata(writer->wd, DATA, size_in_bytes, data_ptr);
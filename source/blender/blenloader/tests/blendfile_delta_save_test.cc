@@ -0,0 +1,134 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "blendfile_loading_base_test.h"
+
+#include <string>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_fileops.h"
+#include "BLI_listbase.h"
+#include "BLI_path_util.h"
+
+#include "BKE_appdir.h"
+#include "BKE_idprop.h"
+#include "BKE_lib_id.h"
+#include "BKE_main.h"
+
+#include "BLO_readfile.h"
+#include "BLO_writefile.h"
+
+#include "DNA_ID.h"
+#include "DNA_mesh_types.h"
+
+class BlendfileDeltaSaveTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  Mesh *meshes[3] = {nullptr};
+  char filepath_delta[FILE_MAX];
+  char filepath_full[FILE_MAX];
+
+  void SetUp() override
+  {
+    BKE_tempdir_init("");
+    BLI_path_join(
+        filepath_delta, sizeof(filepath_delta), BKE_tempdir_session(), "delta_save_delta.blend");
+    BLI_path_join(
+        filepath_full, sizeof(filepath_full), BKE_tempdir_session(), "delta_save_full.blend");
+
+    bmain = BKE_main_new();
+    for (Mesh *&mesh : meshes) {
+      mesh = static_cast<Mesh *>(BKE_id_new(bmain, ID_ME, "Mesh"));
+      id_fake_user_set(&mesh->id);
+    }
+  }
+
+  void TearDown() override
+  {
+    BLO_write_delta_save_free();
+    BKE_main_free(bmain);
+    BLI_delete(filepath_delta, false, false);
+    BLI_delete(filepath_full, false, false);
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  void save(const char *filepath, const bool use_delta)
+  {
+    BlendFileWriteParams params{};
+    params.use_delta = use_delta;
+    ASSERT_TRUE(BLO_write_file(bmain, filepath, 0, &params, nullptr));
+  }
+
+  std::string file_read(const char *filepath)
+  {
+    size_t size = 0;
+    void *data = BLI_file_read_binary_as_mem(filepath, 0, &size);
+    std::string result(static_cast<const char *>(data), size);
+    MEM_SAFE_FREE(data);
+    return result;
+  }
+
+  /** Save with and without delta, and check that both files are identical. */
+  void expect_delta_save_matches_full_save()
+  {
+    save(filepath_delta, true);
+    save(filepath_full, false);
+    EXPECT_EQ(file_read(filepath_delta), file_read(filepath_full));
+  }
+
+  /** Read \a filepath back, and check that the meshes match those in #bmain. */
+  void expect_meshes_read_back(const char *filepath)
+  {
+    BlendFileReadReport bf_reports = {nullptr};
+    BlendFileData *bfd = BLO_read_from_file(filepath, BLO_READ_SKIP_NONE, &bf_reports);
+    ASSERT_NE(bfd, nullptr);
+    ASSERT_EQ(BLI_listbase_count(&bfd->main->meshes), BLI_listbase_count(&bmain->meshes));
+    const Mesh *mesh_read = static_cast<const Mesh *>(bfd->main->meshes.first);
+    LISTBASE_FOREACH (const Mesh *, mesh, &bmain->meshes) {
+      EXPECT_STREQ(mesh_read->id.name, mesh->id.name);
+      EXPECT_EQ(mesh_read->smoothresh, mesh->smoothresh);
+      mesh_read = static_cast<const Mesh *>(mesh_read->id.next);
+    }
+    BLO_blendfiledata_free(bfd);
+  }
+};
+
+TEST_F(BlendfileDeltaSaveTest, MatchesFullSave)
+{
+  save(filepath_delta, true);
+  expect_delta_save_matches_full_save();
+
+  meshes[1]->smoothresh = 0.5f;
+  expect_delta_save_matches_full_save();
+  expect_meshes_read_back(filepath_delta);
+}
+
+TEST_F(BlendfileDeltaSaveTest, MatchesFullSaveAfterUntrackedChange)
+{
+  save(filepath_delta, true);
+
+  /* Changed directly, without an undo push or a depsgraph tag, like from a Python handler. */
+  meshes[0]->smoothresh = 0.25f;
+  expect_delta_save_matches_full_save();
+  expect_meshes_read_back(filepath_delta);
+
+  /* The data of an ID grows. */
+  IDPropertyTemplate value = {0};
+  value.i = 1;
+  IDP_AddToGroup(IDP_GetProperties(&meshes[2]->id, true), IDP_New(IDP_INT, &value, "prop"));
+  meshes[2]->smoothresh = 0.75f;
+  expect_delta_save_matches_full_save();
+  expect_meshes_read_back(filepath_delta);
+}
+
+TEST_F(BlendfileDeltaSaveTest, MatchesFullSaveAfterAddingAndRemovingIDs)
+{
+  save(filepath_delta, true);
+
+  BKE_id_delete(bmain, meshes[1]);
+  meshes[1] = static_cast<Mesh *>(BKE_id_new(bmain, ID_ME, "Mesh New"));
+  id_fake_user_set(&meshes[1]->id);
+  meshes[1]->smoothresh = 0.125f;
+  expect_delta_save_matches_full_save();
+  expect_meshes_read_back(filepath_delta);
+}
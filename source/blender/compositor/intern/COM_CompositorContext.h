@@ -224,6 +224,10 @@ class CompositorContext {
   {
     return (this->get_bnodetree()->flag & NTREE_COM_GROUPNODE_BUFFER) != 0;
   }
+  bool use_half_buffers() const
+  {
+    return (this->get_bnodetree()->flag & NTREE_COM_HALF_BUFFERS) != 0;
+  }
 
   /**
    * \brief Get the render percentage as a factor.
@@ -0,0 +1,502 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+#include "BLI_array.hh"
+#include "BLI_math_base.h"
+#include "BLI_math_vector_types.hh"
+#include "BLI_task.hh"
+#include "BLI_vector.hh"
+
+#include "COM_FFTConvolution.h"
+#include "COM_MemoryBuffer.h"
+
+namespace blender::compositor {
+
+/* -------------------------------------------------------------------- */
+/** \name Fast Hartley Transform
+ * \{ */
+
+/* Returns next highest power of 2 of x, as well its log2 in L2. */
+static uint next_pow2(uint x, uint *L2)
+{
+  uint pw, x_notpow2 = x & (x - 1);
+  *L2 = 0;
+  while (x >>= 1) {
+    ++(*L2);
+  }
+  pw = 1 << (*L2);
+  if (x_notpow2) {
+    (*L2)++;
+    pw <<= 1;
+  }
+  return pw;
+}
+
+/* From FXT library by Joerg Arndt, faster in order bit-reversal
+ * use: `r = revbin_upd(r, h)` where `h = N>>1`. */
+static uint revbin_upd(uint r, uint h)
+{
+  while (!((r ^= h) & h)) {
+    h >>= 1;
+  }
+  return r;
+}
+
+static void FHT(float *data, uint M, uint inverse)
+{
+  double tt, fc, dc, fs, ds, a = M_PI;
+  float t1, t2;
+  int n2, bd, bl, istep, k, len = 1 << M, n = 1;
+
+  int i, j = 0;
+  uint Nh = len >> 1;
+  for (i = 1; i < (len - 1); i++) {
+    j = revbin_upd(j, Nh);
+    if (j > i) {
+      t1 = data[i];
+      data[i] = data[j];
+      data[j] = t1;
+    }
+  }
+
+  do {
+    float *data_n = &data[n];
+
+    istep = n << 1;
+    for (k = 0; k < len; k += istep) {
+      t1 = data_n[k];
+      data_n[k] = data[k] - t1;
+      data[k] += t1;
+    }
+
+    n2 = n >> 1;
+    if (n > 2) {
+      fc = dc = cos(a);
+      fs = ds = sqrt(1.0 - fc * fc);  // sin(a);
+      bd = n - 2;
+      for (bl = 1; bl < n2; bl++) {
+        float *data_nbd = &data_n[bd];
+        float *data_bd = &data[bd];
+        for (k = bl; k < len; k += istep) {
+          t1 = fc * double(data_n[k]) + fs * double(data_nbd[k]);
+          t2 = fs * double(data_n[k]) - fc * double(data_nbd[k]);
+          data_n[k] = data[k] - t1;
+          data_nbd[k] = data_bd[k] - t2;
+          data[k] += t1;
+          data_bd[k] += t2;
+        }
+        tt = fc * dc - fs * ds;
+        fs = fs * dc + fc * ds;
+        fc = tt;
+        bd -= 2;
+      }
+    }
+
+    if (n > 1) {
+      for (k = n2; k < len; k += istep) {
+        t1 = data_n[k];
+        data_n[k] = data[k] - t1;
+        data[k] += t1;
+      }
+    }
+
+    n = istep;
+    a *= 0.5;
+  } while (n < len);
+
+  if (inverse) {
+    float sc = 1.0f / float(len);
+    for (k = 0; k < len; k++) {
+      data[k] *= sc;
+    }
+  }
+}
+
+/* 2D Fast Hartley Transform, Mx/My -> log2 of width/height,
+ * nzp -> the row where zero pad data starts,
+ * inverse -> see above. */
+static void FHT2D(float *data, uint Mx, uint My, uint nzp, uint inverse)
+{
+  uint i, j, Nx, Ny, maxy;
+
+  Nx = 1 << Mx;
+  Ny = 1 << My;
+
+  /* Rows (forward transform skips 0 pad data). */
+  maxy = inverse ? Ny : nzp;
+  threading::parallel_for(IndexRange(maxy), 16, [&](const IndexRange rows) {
+    for (const int64_t row : rows) {
+      FHT(&data[Nx * row], Mx, inverse);
+    }
+  });
+
+  /* Transpose data. */
+  if (Nx == Ny) { /* Square. */
+    for (j = 0; j < Ny; j++) {
+      for (i = j + 1; i < Nx; i++) {
+        uint op = i + (j << Mx), np = j + (i << My);
+        std::swap(data[op], data[np]);
+      }
+    }
+  }
+  else { /* Rectangular. */
+    uint k, Nym = Ny - 1, stm = 1 << (Mx + My);
+    for (i = 0; stm > 0; i++) {
+#define PRED(k) (((k & Nym) << Mx) + (k >> My))
+      for (j = PRED(i); j > i; j = PRED(j)) {
+        /* Pass. */
+      }
+      if (j < i) {
+        continue;
+      }
+      for (k = i, j = PRED(i); j != i; k = j, j = PRED(j), stm--) {
+        std::swap(data[j], data[k]);
+      }
+#undef PRED
+      stm--;
+    }
+  }
+
+  std::swap(Nx, Ny);
+  std::swap(Mx, My);
+
+  /* Now columns == transposed rows. */
+  threading::parallel_for(IndexRange(Ny), 16, [&](const IndexRange rows) {
+    for (const int64_t row : rows) {
+      FHT(&data[Nx * row], Mx, inverse);
+    }
+  });
+
+  /* Finalize. */
+  for (j = 0; j <= (Ny >> 1); j++) {
+    uint jm = (Ny - j) & (Ny - 1);
+    uint ji = j << Mx;
+    uint jmi = jm << Mx;
+    for (i = 0; i <= (Nx >> 1); i++) {
+      uint im = (Nx - i) & (Nx - 1);
+      float A = data[ji + i];
+      float B = data[jmi + i];
+      float C = data[ji + im];
+      float D = data[jmi + im];
+      float E = 0.5f * ((A + D) - (B + C));
+      data[ji + i] = A - E;
+      data[jmi + i] = B + E;
+      data[ji + im] = C + E;
+      data[jmi + im] = D - E;
+    }
+  }
+}
+
+/* 2D convolution calc, d1 *= d2, M/N - > log2 of width/height. */
+static void fht_convolve(float *d1, const float *d2, uint M, uint N)
+{
+  float a, b;
+  uint i, j, k, L, mj, mL;
+  uint m = 1 << M, n = 1 << N;
+  uint m2 = 1 << (M - 1), n2 = 1 << (N - 1);
+  uint mn2 = m << (N - 1);
+
+  d1[0] *= d2[0];
+  d1[mn2] *= d2[mn2];
+  d1[m2] *= d2[m2];
+  d1[m2 + mn2] *= d2[m2 + mn2];
+  for (i = 1; i < m2; i++) {
+    k = m - i;
+    a = d1[i] * d2[i] - d1[k] * d2[k];
+    b = d1[k] * d2[i] + d1[i] * d2[k];
+    d1[i] = (b + a) * 0.5f;
+    d1[k] = (b - a) * 0.5f;
+    a = d1[i + mn2] * d2[i + mn2] - d1[k + mn2] * d2[k + mn2];
+    b = d1[k + mn2] * d2[i + mn2] + d1[i + mn2] * d2[k + mn2];
+    d1[i + mn2] = (b + a) * 0.5f;
+    d1[k + mn2] = (b - a) * 0.5f;
+  }
+  for (j = 1; j < n2; j++) {
+    L = n - j;
+    mj = j << M;
+    mL = L << M;
+    a = d1[mj] * d2[mj] - d1[mL] * d2[mL];
+    b = d1[mL] * d2[mj] + d1[mj] * d2[mL];
+    d1[mj] = (b + a) * 0.5f;
+    d1[mL] = (b - a) * 0.5f;
+    a = d1[m2 + mj] * d2[m2 + mj] - d1[m2 + mL] * d2[m2 + mL];
+    b = d1[m2 + mL] * d2[m2 + mj] + d1[m2 + mj] * d2[m2 + mL];
+    d1[m2 + mj] = (b + a) * 0.5f;
+    d1[m2 + mL] = (b - a) * 0.5f;
+  }
+  for (i = 1; i < m2; i++) {
+    k = m - i;
+    for (j = 1; j < n2; j++) {
+      L = n - j;
+      mj = j << M;
+      mL = L << M;
+      a = d1[i + mj] * d2[i + mj] - d1[k + mL] * d2[k + mL];
+      b = d1[k + mL] * d2[i + mj] + d1[i + mj] * d2[k + mL];
+      d1[i + mj] = (b + a) * 0.5f;
+      d1[k + mL] = (b - a) * 0.5f;
+      a = d1[i + mL] * d2[i + mL] - d1[k + mj] * d2[k + mj];
+      b = d1[k + mj] * d2[i + mL] + d1[i + mL] * d2[k + mj];
+      d1[i + mL] = (b + a) * 0.5f;
+      d1[k + mj] = (b - a) * 0.5f;
+    }
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Kernel Spectra
+ * \{ */
+
+/* Number of kernel spectra kept between convolutions. */
+constexpr int SPECTRA_CACHE_SIZE = 4;
+
+struct KernelSpectrum {
+  int width;
+  int height;
+  int channels;
+  uint log2_w;
+  uint log2_h;
+  /** Copy of the kernel weights, to find the spectrum again. */
+  Array<float> kernel;
+  /** Transposed transform of the flipped kernel, for every kernel channel. */
+  Array<float> spectrum;
+
+  bool matches(const ConvolutionKernel &other, const uint other_log2_w, const uint other_log2_h)
+  {
+    return width == other.width && height == other.height && channels == other.channels &&
+           log2_w == other_log2_w && log2_h == other_log2_h &&
+           memcmp(kernel.data(), other.data.data(), kernel.as_span().size_in_bytes()) == 0;
+  }
+};
+
+static std::mutex spectra_mutex;
+/* Most recently used spectrum is last. */
+static Vector<std::shared_ptr<KernelSpectrum>> spectra;
+
+static std::shared_ptr<KernelSpectrum> kernel_spectrum_get(const ConvolutionKernel &kernel,
+                                                           const uint log2_w,
+                                                           const uint log2_h)
+{
+  {
+    std::scoped_lock lock(spectra_mutex);
+    for (const int i : spectra.index_range()) {
+      if (spectra[i]->matches(kernel, log2_w, log2_h)) {
+        std::shared_ptr<KernelSpectrum> spectrum = spectra[i];
+        spectra.remove(i);
+        spectra.append(spectrum);
+        return spectrum;
+      }
+    }
+  }
+
+  const int tile_w = 1 << log2_w;
+  const int64_t tile_len = int64_t(tile_w) << log2_h;
+
+  std::shared_ptr<KernelSpectrum> spectrum = std::make_shared<KernelSpectrum>();
+  spectrum->width = kernel.width;
+  spectrum->height = kernel.height;
+  spectrum->channels = kernel.channels;
+  spectrum->log2_w = log2_w;
+  spectrum->log2_h = log2_h;
+  spectrum->kernel = kernel.data;
+  spectrum->spectrum = Array<float>(tile_len * kernel.channels, 0.0f);
+
+  /* Flipping turns the convolution of the transform into a correlation. */
+  threading::parallel_for(IndexRange(kernel.channels), 1, [&](const IndexRange channels) {
+    for (const int64_t channel : channels) {
+      float *data = &spectrum->spectrum[channel * tile_len];
+      for (int y = 0; y < kernel.height; y++) {
+        const int flipped_y = kernel.height - 1 - y;
+        for (int x = 0; x < kernel.width; x++) {
+          const int flipped_x = kernel.width - 1 - x;
+          data[y * tile_w + x] =
+              kernel.data[(flipped_y * kernel.width + flipped_x) * kernel.channels + channel];
+        }
+      }
+      FHT2D(data, log2_w, log2_h, kernel.height, 0);
+    }
+  });
+
+  std::scoped_lock lock(spectra_mutex);
+  if (spectra.size() >= SPECTRA_CACHE_SIZE) {
+    spectra.remove(0);
+  }
+  spectra.append(spectrum);
+  return spectrum;
+}
+
+void fft_convolution_free_cache()
+{
+  std::scoped_lock lock(spectra_mutex);
+  spectra.clear_and_shrink();
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Convolution
+ * \{ */
+
+/* Smallest tile size, smaller tiles are only used for small inputs. */
+constexpr int TILE_SIZE_MIN = 512;
+
+/**
+ * Divide output pixels by the sum of kernel weights applied to pixels inside of the input.
+ * Weights are summed from a summed-area table of the kernel, because the weights used by a pixel
+ * are always a rectangle of the kernel.
+ */
+static void normalize_by_weights(const ConvolutionKernel &kernel,
+                                 const rcti &input_rect,
+                                 MemoryBuffer &output,
+                                 const rcti &area,
+                                 const int channels_num)
+{
+  const int sat_w = kernel.width + 1;
+  const int channels = kernel.channels;
+  Array<double> sat(int64_t(sat_w) * (kernel.height + 1) * channels, 0.0);
+  for (int j = 0; j < kernel.height; j++) {
+    for (int i = 0; i < kernel.width; i++) {
+      for (int c = 0; c < channels; c++) {
+        sat[((j + 1) * sat_w + i + 1) * channels + c] =
+            kernel.data[(j * kernel.width + i) * channels + c] +
+            sat[(j * sat_w + i + 1) * channels + c] + sat[((j + 1) * sat_w + i) * channels + c] -
+            sat[(j * sat_w + i) * channels + c];
+      }
+    }
+  }
+
+  threading::parallel_for(IndexRange(BLI_rcti_size_y(&area)), 8, [&](const IndexRange rows) {
+    for (const int64_t row : rows) {
+      const int y = area.ymin + row;
+      const int j0 = clamp_i(input_rect.ymin - y + kernel.center_y, 0, kernel.height);
+      const int j1 = clamp_i(input_rect.ymax - y + kernel.center_y, 0, kernel.height);
+      for (int x = area.xmin; x < area.xmax; x++) {
+        const int i0 = clamp_i(input_rect.xmin - x + kernel.center_x, 0, kernel.width);
+        const int i1 = clamp_i(input_rect.xmax - x + kernel.center_x, 0, kernel.width);
+        float *out = output.get_elem(x, y);
+        for (int c = 0; c < channels_num; c++) {
+          const int kc = channels == 1 ? 0 : c;
+          const double weight = sat[(j1 * sat_w + i1) * channels + kc] -
+                                sat[(j0 * sat_w + i1) * channels + kc] -
+                                sat[(j1 * sat_w + i0) * channels + kc] +
+                                sat[(j0 * sat_w + i0) * channels + kc];
+          out[c] = weight > 0.0 ? float(out[c] / weight) : 0.0f;
+        }
+      }
+    }
+  });
+}
+
+void fft_convolve(const MemoryBuffer &input,
+                  const ConvolutionKernel &kernel,
+                  MemoryBuffer &output,
+                  const rcti &area,
+                  const bool normalize,
+                  const int channels_num)
+{
+  BLI_assert(input.get_num_channels() == COM_DATA_TYPE_COLOR_CHANNELS);
+  BLI_assert(output.get_num_channels() == COM_DATA_TYPE_COLOR_CHANNELS);
+  BLI_assert(ELEM(kernel.channels, 1, COM_DATA_TYPE_COLOR_CHANNELS));
+  BLI_assert(kernel.data.size() == int64_t(kernel.width) * kernel.height * kernel.channels);
+  BLI_assert(channels_num >= 1 && channels_num <= COM_DATA_TYPE_COLOR_CHANNELS);
+
+  const float zero[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  output.fill(area, zero);
+
+  /* Input pixels used by the area, outside of the input they are zero. */
+  const rcti &input_rect = input.get_rect();
+  const int flipped_center_x = kernel.width - 1 - kernel.center_x;
+  const int flipped_center_y = kernel.height - 1 - kernel.center_y;
+  rcti used_rect;
+  used_rect.xmin = max_ii(area.xmin - kernel.center_x, input_rect.xmin);
+  used_rect.xmax = min_ii(area.xmax + flipped_center_x, input_rect.xmax);
+  used_rect.ymin = max_ii(area.ymin - kernel.center_y, input_rect.ymin);
+  used_rect.ymax = min_ii(area.ymax + flipped_center_y, input_rect.ymax);
+  if (BLI_rcti_is_empty(&used_rect)) {
+    return;
+  }
+
+  /* Tiles must be at least twice the kernel size, so that the result of a tile only overlaps
+   * its direct neighbors. */
+  const int used_w = BLI_rcti_size_x(&used_rect);
+  const int used_h = BLI_rcti_size_y(&used_rect);
+  uint log2_w, log2_h;
+  const int tile_w = next_pow2(
+      max_ii(2 * kernel.width - 1, min_ii(used_w + kernel.width - 1, TILE_SIZE_MIN)), &log2_w);
+  const int tile_h = next_pow2(
+      max_ii(2 * kernel.height - 1, min_ii(used_h + kernel.height - 1, TILE_SIZE_MIN)), &log2_h);
+  const int64_t tile_len = int64_t(tile_w) * tile_h;
+  const int block_w = tile_w + 1 - kernel.width;
+  const int block_h = tile_h + 1 - kernel.height;
+  const int blocks_x = divide_ceil_u(used_w, block_w);
+  const int blocks_y = divide_ceil_u(used_h, block_h);
+
+  const std::shared_ptr<KernelSpectrum> spectrum = kernel_spectrum_get(kernel, log2_w, log2_h);
+
+  /* Neighboring tiles add to the same output pixels, so only every other tile in each direction
+   * is processed at the same time. Channels are independent. */
+  for (int phase = 0; phase < 4; phase++) {
+    Vector<int2> blocks;
+    for (int by = phase / 2; by < blocks_y; by += 2) {
+      for (int bx = phase % 2; bx < blocks_x; bx += 2) {
+        blocks.append(int2(bx, by));
+      }
+    }
+
+    const int64_t tasks_num = blocks.size() * channels_num;
+    threading::parallel_for(IndexRange(tasks_num), 1, [&](const IndexRange tasks) {
+      Array<float> data(tile_len);
+      for (const int64_t task : tasks) {
+        const int2 block = blocks[task / channels_num];
+        const int channel = task % channels_num;
+        const int kernel_channel = kernel.channels == 1 ? 0 : channel;
+        const int start_x = used_rect.xmin + block.x * block_w;
+        const int start_y = used_rect.ymin + block.y * block_h;
+        const int size_x = min_ii(block_w, used_rect.xmax - start_x);
+        const int size_y = min_ii(block_h, used_rect.ymax - start_y);
+
+        data.fill(0.0f);
+        for (int y = 0; y < size_y; y++) {
+          float *row = &data[y * tile_w];
+          const float *color = input.get_elem(start_x, start_y + y) + channel;
+          for (int x = 0; x < size_x; x++, color += input.elem_stride) {
+            row[x] = *color;
+          }
+        }
+
+        /* Transform is transposed, so rows and columns are swapped for the convolution. */
+        FHT2D(data.data(), log2_w, log2_h, size_y, 0);
+        fht_convolve(
+            data.data(), &spectrum->spectrum[kernel_channel * tile_len], log2_h, log2_w);
+        FHT2D(data.data(), log2_h, log2_w, 0, 1);
+
+        /* Overlap-add result. */
+        const int out_x = start_x - flipped_center_x;
+        const int out_y = start_y - flipped_center_y;
+        const int ymin = max_ii(out_y, area.ymin);
+        const int ymax = min_ii(out_y + size_y + kernel.height - 1, area.ymax);
+        const int xmin = max_ii(out_x, area.xmin);
+        const int xmax = min_ii(out_x + size_x + kernel.width - 1, area.xmax);
+        for (int y = ymin; y < ymax; y++) {
+          const float *row = &data[(y - out_y) * tile_w];
+          float *color = output.get_elem(xmin, y) + channel;
+          for (int x = xmin; x < xmax; x++, color += output.elem_stride) {
+            *color += row[x - out_x];
+          }
+        }
+      }
+    });
+  }
+
+  if (normalize) {
+    normalize_by_weights(kernel, input_rect, output, area, channels_num);
+  }
+}
+
+/** \} */
+
+}  // namespace blender::compositor
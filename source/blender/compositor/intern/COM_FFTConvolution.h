@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#pragma once
+
+#include "BLI_rect.h"
+#include "BLI_span.hh"
+
+#include "COM_defines.h"
+
+namespace blender::compositor {
+
+class MemoryBuffer;
+
+/**
+ * Kernels with at least this many elements in both dimensions are faster to convolve in
+ * frequency space than directly.
+ */
+constexpr int FFT_CONVOLUTION_MIN_KERNEL_SIZE = 24;
+
+struct ConvolutionKernel {
+  /** Weights in row major order, #channels floats per element. */
+  Span<float> data;
+  int width;
+  int height;
+  /** Either 1, using the same weights for all color channels, or 4. */
+  int channels;
+  /** Kernel element aligned with the output pixel. */
+  int center_x;
+  int center_y;
+};
+
+/**
+ * Correlate a color buffer with a kernel using the fast Hartley transform:
+ * `output(x, y) = sum(kernel(i, j) * input(x + i - center_x, y + j - center_y))`.
+ *
+ * The input is processed in tiles which are convolved in parallel and overlap-added into the
+ * output, so memory use only depends on the kernel size. Spectra of recently used kernels are
+ * cached, so kernels which stay the same between frames are only transformed once.
+ *
+ * Pixels outside of the input are zero. When \a normalize is set, every output pixel is divided
+ * by the sum of the weights applied to pixels inside of the input, which matches direct
+ * convolutions skipping those pixels.
+ *
+ * Only the first \a channels_num channels are convolved, the others are set to zero.
+ */
+void fft_convolve(const MemoryBuffer &input,
+                  const ConvolutionKernel &kernel,
+                  MemoryBuffer &output,
+                  const rcti &area,
+                  bool normalize,
+                  int channels_num = COM_DATA_TYPE_COLOR_CHANNELS);
+
+/** Free cached kernel spectra. */
+void fft_convolution_free_cache();
+
+}  // namespace blender::compositor
@@ -37,10 +37,79 @@ void FullFrameExecutionModel::execute(ExecutionSystem &exec_system)
 
   DebugInfo::graphviz(&exec_system, "compositor_prior_rendering");
 
+  use_cached_results();
   determine_areas_to_render_and_reads();
   render_operations();
 }
 
+/** Whether the result of given operation is worth keeping for later executions. */
+static bool is_result_cacheable(const NodeOperation *op)
+{
+  return op->get_flags().complex;
+}
+
+void FullFrameExecutionModel::use_cached_results()
+{
+  for (NodeOperation *op : operations_) {
+    if (is_result_cacheable(op)) {
+      std::optional<size_t> hash = get_result_hash(op);
+      if (hash) {
+        active_buffers_.use_cached_result(op, *hash);
+      }
+    }
+  }
+}
+
+bool FullFrameExecutionModel::is_result_hashable(NodeOperation *op)
+{
+  if (const bool *is_hashable = results_hashable_.lookup_ptr(op)) {
+    return *is_hashable;
+  }
+
+  bool is_hashable = op->can_generate_result_hash();
+  for (int i = 0; i < op->get_number_of_input_sockets() && is_hashable; i++) {
+    NodeOperation *input_op = op->get_input_operation(i);
+    is_hashable = input_op == nullptr || is_result_hashable(input_op);
+  }
+  results_hashable_.add_new(op, is_hashable);
+  return is_hashable;
+}
+
+std::optional<size_t> FullFrameExecutionModel::get_result_hash(NodeOperation *op)
+{
+  /* Checked first, as hashing some inputs requires hashing their pixels. */
+  if (!is_result_hashable(op)) {
+    return std::nullopt;
+  }
+  if (const std::optional<size_t> *hash = result_hashes_.lookup_ptr(op)) {
+    return *hash;
+  }
+
+  std::optional<size_t> hash;
+  Vector<size_t> input_hashes;
+  bool has_input_hashes = true;
+  for (int i = 0; i < op->get_number_of_input_sockets() && has_input_hashes; i++) {
+    NodeOperation *input_op = op->get_input_operation(i);
+    const std::optional<size_t> input_hash = input_op ? get_result_hash(input_op) :
+                                                        std::optional<size_t>(0);
+    has_input_hashes = input_hash.has_value();
+    input_hashes.append(input_hash.value_or(0));
+  }
+  if (has_input_hashes) {
+    hash = op->generate_result_hash(input_hashes);
+  }
+  if (hash) {
+    /* Results also depend on the execution settings. Half buffers lose precision of inputs. */
+    *hash = get_default_hash_4(*hash,
+                               context_.get_quality(),
+                               context_.is_fast_calculation(),
+                               context_.use_half_buffers());
+  }
+
+  result_hashes_.add_new(op, hash);
+  return hash;
+}
+
 void FullFrameExecutionModel::determine_areas_to_render_and_reads()
 {
   const bool is_rendering = context_.is_rendering();
@@ -70,6 +139,9 @@ Vector<MemoryBuffer *> FullFrameExecutionModel::get_input_buffers(NodeOperation
     const int offset_x = (input->get_canvas().xmin - op->get_canvas().xmin) + output_x;
     const int offset_y = (input->get_canvas().ymin - op->get_canvas().ymin) + output_y;
     MemoryBuffer *buf = active_buffers_.get_rendered_buffer(input);
+    if (buf->is_packed()) {
+      buf->unpack_half();
+    }
 
     rcti rect = buf->get_rect();
     BLI_rcti_translate(&rect, offset_x, offset_y);
@@ -116,9 +188,40 @@ void FullFrameExecutionModel::render_operation(NodeOperation *op)
    * TranslateOperation from convert resolutions if linked to an operation with resolution. */
   active_buffers_.set_rendered_buffer(op, std::unique_ptr<MemoryBuffer>(op_buf));
 
+  /* Results of cancelled executions may be incomplete. */
+  const bNodeTree *node_tree = context_.get_bnodetree();
+  if (is_result_cacheable(op) && !node_tree->runtime->test_break(node_tree->runtime->tbh)) {
+    const std::optional<size_t> hash = get_result_hash(op);
+    if (hash) {
+      active_buffers_.cache_result(op, *hash);
+    }
+  }
+
+  pack_buffer(op);
   operation_finished(op);
 }
 
+void FullFrameExecutionModel::pack_buffer(NodeOperation *op)
+{
+  if (!context_.use_half_buffers()) {
+    return;
+  }
+
+  /* Buffers are disposed after their last read, and operations without outputs have none. */
+  MemoryBuffer *buf = active_buffers_.get_rendered_buffer(op);
+  if (buf == nullptr || buf->is_packed() || buf->is_a_single_elem()) {
+    return;
+  }
+  /* Packing in place would lose precision of the cached result for later executions. */
+  if (active_buffers_.is_result_cached(op)) {
+    return;
+  }
+  /* Values and vectors are often depths or positions, which need the float range. */
+  if (buf->get_num_channels() == COM_DATA_TYPE_COLOR_CHANNELS) {
+    buf->pack_half();
+  }
+}
+
 void FullFrameExecutionModel::render_operations()
 {
   const bool is_rendering = context_.is_rendering();
@@ -143,9 +246,10 @@ void FullFrameExecutionModel::render_operations()
 
 /**
  * Returns all dependencies from inputs to outputs. A dependency may be repeated when
- * several operations depend on it.
+ * several operations depend on it. Dependencies of rendered operations are skipped.
  */
-static Vector<NodeOperation *> get_operation_dependencies(NodeOperation *operation)
+static Vector<NodeOperation *> get_operation_dependencies(SharedOperationBuffers &active_buffers,
+                                                          NodeOperation *operation)
 {
   /* Get dependencies from outputs to inputs. */
   Vector<NodeOperation *> dependencies;
@@ -155,6 +259,9 @@ static Vector<NodeOperation *> get_operation_dependencies(NodeOperation *operati
     Vector<NodeOperation *> outputs(next_outputs);
     next_outputs.clear();
     for (NodeOperation *output : outputs) {
+      if (output != operation && active_buffers.is_operation_rendered(output)) {
+        continue;
+      }
       for (int i = 0; i < output->get_number_of_input_sockets(); i++) {
         next_outputs.append(output->get_input_operation(i));
       }
@@ -171,7 +278,7 @@ static Vector<NodeOperation *> get_operation_dependencies(NodeOperation *operati
 void FullFrameExecutionModel::render_output_dependencies(NodeOperation *output_op)
 {
   BLI_assert(output_op->is_output_operation(context_.is_rendering()));
-  Vector<NodeOperation *> dependencies = get_operation_dependencies(output_op);
+  Vector<NodeOperation *> dependencies = get_operation_dependencies(active_buffers_, output_op);
   for (NodeOperation *op : dependencies) {
     if (!active_buffers_.is_operation_rendered(op)) {
       render_operation(op);
@@ -197,6 +304,11 @@ void FullFrameExecutionModel::determine_areas_to_render(NodeOperation *output_op
 
     active_buffers_.register_area(operation, render_area);
 
+    /* Cached results don't need their inputs. */
+    if (active_buffers_.is_operation_rendered(operation)) {
+      continue;
+    }
+
     const int num_inputs = operation->get_number_of_input_sockets();
     for (int i = 0; i < num_inputs; i++) {
       NodeOperation *input_op = operation->get_input_operation(i);
@@ -219,6 +331,9 @@ void FullFrameExecutionModel::determine_reads(NodeOperation *output_op)
   stack.append(output_op);
   while (stack.size() > 0) {
     NodeOperation *operation = stack.pop_last();
+    if (active_buffers_.is_operation_rendered(operation)) {
+      continue;
+    }
     const int num_inputs = operation->get_number_of_input_sockets();
     for (int i = 0; i < num_inputs; i++) {
       NodeOperation *input_op = operation->get_input_operation(i);
@@ -261,7 +376,10 @@ void FullFrameExecutionModel::operation_finished(NodeOperation *operation)
   /* Report inputs reads so that buffers may be freed/reused. */
   const int num_inputs = operation->get_number_of_input_sockets();
   for (int i = 0; i < num_inputs; i++) {
-    active_buffers_.read_finished(operation->get_input_operation(i));
+    NodeOperation *input_op = operation->get_input_operation(i);
+    active_buffers_.read_finished(input_op);
+    /* Unpacked to be read, pack again until the next read. */
+    pack_buffer(input_op);
   }
 
   num_operations_finished_++;
@@ -3,6 +3,9 @@
 
 #pragma once
 
+#include <optional>
+
+#include "BLI_map.hh"
 #include "BLI_vector.hh"
 
 #include "COM_Enums.h"
@@ -42,6 +45,16 @@ class FullFrameExecutionModel : public ExecutionModel {
    */
   Vector<eCompositorPriority> priorities_;
 
+  /**
+   * Result hashes of operations, see #NodeOperation::generate_result_hash.
+   */
+  Map<NodeOperation *, std::optional<size_t>> result_hashes_;
+  /**
+   * Whether the results of operations and all their inputs can be hashed,
+   * see #NodeOperation::can_generate_result_hash.
+   */
+  Map<NodeOperation *, bool> results_hashable_;
+
  public:
   FullFrameExecutionModel(CompositorContext &context,
                           SharedOperationBuffers &shared_buffers,
@@ -50,6 +63,13 @@ class FullFrameExecutionModel : public ExecutionModel {
   void execute(ExecutionSystem &exec_system) override;
 
  private:
+  /**
+   * Use results of expensive operations cached by previous executions, so that they and the
+   * operations they depend on don't need to be rendered.
+   */
+  void use_cached_results();
+  bool is_result_hashable(NodeOperation *op);
+  std::optional<size_t> get_result_hash(NodeOperation *op);
   void determine_areas_to_render_and_reads();
   /**
    * Render output operations in order of priority.
@@ -63,6 +83,11 @@ class FullFrameExecutionModel : public ExecutionModel {
   Vector<MemoryBuffer *> get_input_buffers(NodeOperation *op, int output_x, int output_y);
   MemoryBuffer *create_operation_buffer(NodeOperation *op, int output_x, int output_y);
   void render_operation(NodeOperation *op);
+  /**
+   * Store given operation buffer in half float precision until it's read, when enabled by the
+   * node tree. Only used for color buffers not shared with the results cache.
+   */
+  void pack_buffer(NodeOperation *op);
 
   void operation_finished(NodeOperation *operation);
 
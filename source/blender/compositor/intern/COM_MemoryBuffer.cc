@@ -5,6 +5,9 @@
 
 #include "COM_MemoryProxy.h"
 
+#include "BLI_math_bits.h"
+#include "BLI_task.hh"
+
 #include "IMB_colormanagement.h"
 #include "IMB_imbuf_types.h"
 
@@ -37,6 +40,7 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memory_proxy, const rcti &rect, MemoryBu
   num_channels_ = COM_data_type_num_channels(memory_proxy->get_data_type());
   buffer_ = (float *)MEM_mallocN_aligned(
       sizeof(float) * buffer_len() * num_channels_, 16, "COM_MemoryBuffer");
+  half_buffer_ = nullptr;
   owns_data_ = true;
   state_ = state;
   datatype_ = memory_proxy->get_data_type();
@@ -52,6 +56,7 @@ MemoryBuffer::MemoryBuffer(DataType data_type, const rcti &rect, bool is_a_singl
   num_channels_ = COM_data_type_num_channels(data_type);
   buffer_ = (float *)MEM_mallocN_aligned(
       sizeof(float) * buffer_len() * num_channels_, 16, "COM_MemoryBuffer");
+  half_buffer_ = nullptr;
   owns_data_ = true;
   state_ = MemoryBufferState::Temporary;
   datatype_ = data_type;
@@ -76,6 +81,7 @@ MemoryBuffer::MemoryBuffer(float *buffer,
   num_channels_ = num_channels;
   datatype_ = COM_num_channels_data_type(num_channels);
   buffer_ = buffer;
+  half_buffer_ = nullptr;
   owns_data_ = false;
   state_ = MemoryBufferState::Temporary;
 
@@ -171,6 +177,95 @@ MemoryBuffer::~MemoryBuffer()
     MEM_freeN(buffer_);
     buffer_ = nullptr;
   }
+  MEM_SAFE_FREE(half_buffer_);
+}
+
+/**
+ * Round to nearest even half float, see "float_to_half_fast3_rtne" by Fabian Giesen.
+ * Finite values out of range are clamped to the largest half float instead of becoming infinite,
+ * so that they don't turn into NaN in later operations.
+ */
+static uint16_t float_to_half(const float value)
+{
+  constexpr uint32_t f32_infinity = 255u << 23;
+  constexpr uint32_t f16_max_exp = (127u + 16u) << 23;
+  constexpr uint32_t denorm_magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+  constexpr uint16_t f16_max = 0x7bff;
+  constexpr uint16_t f16_infinity = 0x7c00;
+  constexpr uint16_t f16_nan = 0x7e00;
+
+  uint32_t bits = float_as_uint(value);
+  const uint32_t sign = bits & 0x80000000u;
+  bits ^= sign;
+
+  uint16_t result;
+  if (bits >= f16_max_exp) {
+    result = bits > f32_infinity ? f16_nan : (bits == f32_infinity ? f16_infinity : f16_max);
+  }
+  else if (bits < (113u << 23)) {
+    /* Sub-normal or zero, let the float addition do the rounding. */
+    bits = float_as_uint(uint_as_float(bits) + uint_as_float(denorm_magic));
+    result = uint16_t(bits - denorm_magic);
+  }
+  else {
+    const uint32_t mantissa_odd = (bits >> 13) & 1;
+    bits += ((15u - 127u) << 23) + 0xfff + mantissa_odd;
+    /* Values rounding up past the largest half float. */
+    result = std::min(uint16_t(bits >> 13), f16_max);
+  }
+  return result | uint16_t(sign >> 16);
+}
+
+static float half_to_float(const uint16_t value)
+{
+  constexpr uint32_t shifted_exp = 0x7c00u << 13;
+  constexpr uint32_t magic = 113u << 23;
+
+  uint32_t bits = uint32_t(value & 0x7fff) << 13;
+  const uint32_t exp = bits & shifted_exp;
+  bits += (127u - 15u) << 23;
+  if (exp == shifted_exp) {
+    /* Infinity or NaN. */
+    bits += (128u - 16u) << 23;
+  }
+  else if (exp == 0) {
+    /* Sub-normal or zero, renormalize. */
+    bits = float_as_uint(uint_as_float(bits + (1u << 23)) - uint_as_float(magic));
+  }
+  return uint_as_float(bits | (uint32_t(value & 0x8000) << 16));
+}
+
+void MemoryBuffer::pack_half()
+{
+  BLI_assert(owns_data_ && !is_a_single_elem_);
+  if (is_packed()) {
+    return;
+  }
+
+  const int64_t len = int64_t(buffer_len()) * num_channels_;
+  half_buffer_ = (uint16_t *)MEM_mallocN_aligned(
+      sizeof(uint16_t) * len, 16, "COM_MemoryBuffer half");
+  threading::parallel_for(IndexRange(len), 1 << 16, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      half_buffer_[i] = float_to_half(buffer_[i]);
+    }
+  });
+  MEM_freeN(buffer_);
+  buffer_ = nullptr;
+}
+
+void MemoryBuffer::unpack_half()
+{
+  BLI_assert(is_packed());
+  const int64_t len = int64_t(buffer_len()) * num_channels_;
+  buffer_ = (float *)MEM_mallocN_aligned(sizeof(float) * len, 16, "COM_MemoryBuffer");
+  threading::parallel_for(IndexRange(len), 1 << 16, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      buffer_[i] = half_to_float(half_buffer_[i]);
+    }
+  });
+  MEM_freeN(half_buffer_);
+  half_buffer_ = nullptr;
 }
 
 void MemoryBuffer::copy_from(const MemoryBuffer *src, const rcti &area)
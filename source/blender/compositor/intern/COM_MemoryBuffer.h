@@ -86,6 +86,11 @@ class MemoryBuffer {
    */
   float *buffer_;
 
+  /**
+   * Buffer data in half float precision when packed, see #pack_half.
+   */
+  uint16_t *half_buffer_;
+
   /**
    * \brief the number of channels of a single value in the buffer.
    * For value buffers this is 1, vector 3 and color 4
@@ -367,10 +372,33 @@ class MemoryBuffer {
 
   float *release_ownership_buffer()
   {
+    BLI_assert(!is_packed());
     owns_data_ = false;
     return buffer_;
   }
 
+  /**
+   * Store buffer data in half float precision, halving its memory. The float data is freed until
+   * #unpack_half is called. Values are rounded to 11 significant bits and clamped to the half
+   * float range, which is fine for colors but not for depths or positions.
+   * Buffer must own its data and not be a single element.
+   */
+  void pack_half();
+
+  /**
+   * Restore the float data of a packed buffer, freeing the half float data. Precision lost when
+   * packing isn't recovered.
+   */
+  void unpack_half();
+
+  /**
+   * Whether buffer data is stored in half float precision and must be unpacked to be used.
+   */
+  bool is_packed() const
+  {
+    return half_buffer_ != nullptr;
+  }
+
   /**
    * Converts a single elem buffer to a full size buffer (allocates memory for all
    * elements in resolution).
@@ -7,7 +7,15 @@
 
 namespace blender::compositor {
 
+namespace tests {
+class FusedPixelOperationTest;
+}
+
 class MultiThreadedOperation : public NodeOperation {
+  /* Evaluates fused operations on small areas without spawning work. */
+  friend class FusedPixelOperation;
+  friend class tests::FusedPixelOperationTest;
+
  protected:
   /**
    * Number of execution passes.
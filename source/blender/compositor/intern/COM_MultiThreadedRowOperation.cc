@@ -5,6 +5,11 @@
 
 namespace blender::compositor {
 
+MultiThreadedRowOperation::MultiThreadedRowOperation()
+{
+  flags_.is_pixel_operation = true;
+}
+
 MultiThreadedRowOperation::PixelCursor::PixelCursor(const int num_inputs)
     : out(nullptr), out_stride(0), row_end(nullptr), ins(num_inputs), in_strides(num_inputs)
 {
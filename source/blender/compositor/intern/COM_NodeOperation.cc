@@ -84,6 +84,25 @@ std::optional<NodeOperationHash> NodeOperation::generate_hash()
   return hash;
 }
 
+bool NodeOperation::can_generate_result_hash()
+{
+  return generate_hash().has_value();
+}
+
+std::optional<size_t> NodeOperation::generate_result_hash(Span<size_t> input_hashes)
+{
+  std::optional<NodeOperationHash> hash = generate_hash();
+  if (!hash) {
+    return std::nullopt;
+  }
+
+  size_t result_hash = get_default_hash_2(hash->type_hash_, hash->params_hash_);
+  for (const size_t input_hash : input_hashes) {
+    combine_hashes(result_hash, input_hash);
+  }
+  return result_hash;
+}
+
 NodeOperationOutput *NodeOperation::get_output_socket(uint index)
 {
   return &outputs_[index];
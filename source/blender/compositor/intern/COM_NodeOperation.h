@@ -239,6 +239,13 @@ struct NodeOperationFlags {
    */
   bool can_be_constant : 1;
 
+  /**
+   * Whether every output pixel only depends on the input pixels at the same coordinates and the
+   * operation only implements #MultiThreadedOperation::update_memory_buffer_partial. Chains of
+   * such operations are fused into a #FusedPixelOperation on full-frame execution.
+   */
+  bool is_pixel_operation : 1;
+
   NodeOperationFlags()
   {
     complex = false;
@@ -257,6 +264,7 @@ struct NodeOperationFlags {
     is_fullframe_operation = false;
     is_constant_operation = false;
     can_be_constant = false;
+    is_pixel_operation = false;
   }
 };
 
@@ -392,6 +400,20 @@ class NodeOperation {
    */
   std::optional<NodeOperationHash> generate_hash();
 
+  /**
+   * Generate a hash that identifies the operation result across executions, combining its type
+   * and parameters with the result hashes of its inputs, given in input socket order.
+   * Returns `std::nullopt` when the result can't be identified, by default when
+   * `hash_output_params` is not implemented.
+   */
+  virtual std::optional<size_t> generate_result_hash(Span<size_t> input_hashes);
+
+  /**
+   * Whether #generate_result_hash can identify the result when given the hashes of all inputs.
+   * Checked before generating the hashes of the inputs, which may be expensive.
+   */
+  virtual bool can_generate_result_hash();
+
   unsigned int get_number_of_input_sockets() const
   {
     return inputs_.size();
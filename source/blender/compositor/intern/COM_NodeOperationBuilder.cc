@@ -4,6 +4,7 @@
 #include <set>
 
 #include "BLI_multi_value_map.hh"
+#include "BLI_set.hh"
 
 #include "BKE_node_runtime.hh"
 
@@ -11,6 +12,7 @@
 #include "COM_Debug.h"
 
 #include "COM_ExecutionGroup.h"
+#include "COM_FusedPixelOperation.h"
 #include "COM_PreviewOperation.h"
 #include "COM_ReadBufferOperation.h"
 #include "COM_SetColorOperation.h"
@@ -94,6 +96,11 @@ void NodeOperationBuilder::convert_to_operations(ExecutionSystem *system)
   save_graphviz("compositor_prior_merging");
   merge_equal_operations();
 
+  if (context_->get_execution_model() == eExecutionModel::FullFrame) {
+    save_graphviz("compositor_prior_fusing");
+    fuse_pixel_operations();
+  }
+
   if (context_->get_execution_model() == eExecutionModel::Tiled) {
     /* surround complex ops with read/write buffer */
     add_complex_operation_buffers();
@@ -501,6 +508,92 @@ void NodeOperationBuilder::merge_equal_operations(NodeOperation *from, NodeOpera
   delete from;
 }
 
+/**
+ * Whether \a input_op can be evaluated as part of \a op. It must only be read once, so its
+ * result is not needed anywhere else.
+ */
+static bool can_fuse_pixel_operation(const NodeOperation &input_op,
+                                     const NodeOperation &op,
+                                     const Map<const NodeOperation *, int> &reads_num)
+{
+  return input_op.get_flags().is_pixel_operation && op.get_flags().is_pixel_operation &&
+         reads_num.lookup_default(&input_op, 0) == 1 &&
+         BLI_rcti_compare(&input_op.get_canvas(), &op.get_canvas());
+}
+
+/** Add \a op and all operations which can be fused into it, sorted by dependency. */
+static void collect_fused_operations(NodeOperation *op,
+                                     const Map<const NodeOperation *, int> &reads_num,
+                                     Vector<NodeOperation *> &r_operations)
+{
+  for (int i = 0; i < op->get_number_of_input_sockets(); i++) {
+    NodeOperationInput *input = op->get_input_socket(i);
+    if (input->is_connected()) {
+      NodeOperation *input_op = &input->get_link()->get_operation();
+      if (can_fuse_pixel_operation(*input_op, *op, reads_num)) {
+        collect_fused_operations(input_op, reads_num, r_operations);
+      }
+    }
+  }
+  r_operations.append(op);
+}
+
+void NodeOperationBuilder::fuse_pixel_operations()
+{
+  Map<const NodeOperation *, int> reads_num;
+  for (const Link &link : links_) {
+    reads_num.lookup_or_add_default(&link.from()->get_operation())++;
+  }
+
+  /* Operations which are not fused into their reader are the outputs of fused trees. */
+  Set<const NodeOperation *> fused_into_reader;
+  for (const Link &link : links_) {
+    if (can_fuse_pixel_operation(
+            link.from()->get_operation(), link.to()->get_operation(), reads_num)) {
+      fused_into_reader.add(&link.from()->get_operation());
+    }
+  }
+
+  Vector<NodeOperation *> outputs;
+  for (NodeOperation *op : operations_) {
+    if (op->get_flags().is_pixel_operation && !fused_into_reader.contains(op)) {
+      outputs.append(op);
+    }
+  }
+
+  for (NodeOperation *output_op : outputs) {
+    Vector<NodeOperation *> fused_ops;
+    collect_fused_operations(output_op, reads_num, fused_ops);
+    if (fused_ops.size() < 2) {
+      continue;
+    }
+
+    FusedPixelOperation *fused_op = new FusedPixelOperation(fused_ops);
+
+    /* Links between fused operations are kept by their sockets, which are not part of the graph
+     * anymore. */
+    links_.remove_if(
+        [&](const Link &link) { return fused_ops.contains(&link.to()->get_operation()); });
+    for (const int i : fused_op->get_fused_inputs().index_range()) {
+      NodeOperationInput *input = fused_op->get_fused_inputs()[i];
+      if (input->is_connected()) {
+        add_link(input->get_link(), fused_op->get_input_socket(i));
+      }
+    }
+    for (Link &link : links_) {
+      if (&link.from()->get_operation() == output_op) {
+        link.to()->set_link(fused_op->get_output_socket());
+        link = Link(fused_op->get_output_socket(), link.to());
+      }
+    }
+
+    for (NodeOperation *op : fused_ops) {
+      operations_.remove_first_occurrence_and_reorder(op);
+    }
+    add_operation(fused_op);
+  }
+}
+
 Vector<NodeOperationInput *> NodeOperationBuilder::cache_output_links(
     NodeOperationOutput *output) const
 {
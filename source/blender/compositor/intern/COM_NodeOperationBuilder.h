@@ -27,7 +27,13 @@ class WriteBufferOperation;
 class ViewerOperation;
 class ConstantOperation;
 
+namespace tests {
+class FusedPixelOperationTest;
+}
+
 class NodeOperationBuilder {
+  friend class tests::FusedPixelOperationTest;
+
  public:
   class Link {
    private:
@@ -157,6 +163,8 @@ class NodeOperationBuilder {
   /** Merge operations with same type, inputs and parameters that produce the same result. */
   void merge_equal_operations();
   void merge_equal_operations(NodeOperation *from, NodeOperation *into);
+  /** Replace trees of pixel operations with a #FusedPixelOperation each. */
+  void fuse_pixel_operations();
   void save_graphviz(StringRefNull name = "");
 #ifdef WITH_CXX_GUARDEDALLOC
   MEM_CXX_CLASS_ALLOC_FUNCS("COM:NodeCompilerImpl")
@@ -1,13 +1,49 @@
 /* SPDX-License-Identifier: GPL-2.0-or-later
  * Copyright 2021 Blender Foundation. */
 
+#include <algorithm>
+#include <typeinfo>
+
 #include "COM_SharedOperationBuffers.h"
 #include "COM_NodeOperation.h"
 
 namespace blender::compositor {
 
+/** Memory budget of the results kept between executions. */
+static constexpr int64_t CACHED_RESULTS_MAX_BYTES = int64_t(1) << 30;
+
+struct CachedResult {
+  std::shared_ptr<MemoryBuffer> buffer;
+  int64_t size;
+  uint64_t last_used;
+  /** Compared on lookup, so that a hash collision doesn't use a result of another operation. */
+  const std::type_info *type;
+  rcti canvas;
+  DataType data_type;
+
+  bool matches(NodeOperation *op) const
+  {
+    return *type == typeid(*op) && BLI_rcti_compare(&canvas, &op->get_canvas()) &&
+           data_type == op->get_output_socket()->get_data_type();
+  }
+};
+
+/**
+ * Results of previous executions by result hash, see #NodeOperation::generate_result_hash.
+ * Only accessed while executing, which is serialized by the compositor lock.
+ */
+static struct {
+  Map<size_t, CachedResult> results;
+  int64_t size = 0;
+  uint64_t clock = 0;
+} g_cached_results;
+
 SharedOperationBuffers::BufferData::BufferData()
-    : buffer(nullptr), registered_reads(0), received_reads(0), is_rendered(false)
+    : buffer(nullptr),
+      registered_reads(0),
+      received_reads(0),
+      is_rendered(false),
+      is_cached(false)
 {
 }
 
@@ -90,4 +126,76 @@ void SharedOperationBuffers::read_finished(NodeOperation *read_op)
   }
 }
 
+bool SharedOperationBuffers::use_cached_result(NodeOperation *op, const size_t result_hash)
+{
+  CachedResult *result = g_cached_results.results.lookup_ptr(result_hash);
+  if (result == nullptr || !result->matches(op)) {
+    return false;
+  }
+
+  BufferData &buf_data = get_buffer_data(op);
+  BLI_assert(!buf_data.is_rendered);
+  buf_data.buffer = result->buffer;
+  buf_data.is_rendered = true;
+  buf_data.is_cached = true;
+  result->last_used = ++g_cached_results.clock;
+  return true;
+}
+
+void SharedOperationBuffers::cache_result(NodeOperation *op, const size_t result_hash)
+{
+  BufferData &buf_data = get_buffer_data(op);
+  if (!buf_data.buffer || buf_data.buffer->is_a_single_elem() ||
+      g_cached_results.results.contains(result_hash)) {
+    return;
+  }
+
+  const rcti &canvas = op->get_canvas();
+  const bool is_fully_rendered = std::any_of(
+      buf_data.render_areas.begin(), buf_data.render_areas.end(), [&](const rcti &area) {
+        return BLI_rcti_inside_rcti(&area, &canvas);
+      });
+  const MemoryBuffer &buffer = *buf_data.buffer;
+  const int64_t size = int64_t(buffer.get_width()) * buffer.get_height() *
+                       buffer.get_num_channels() * sizeof(float);
+  if (!is_fully_rendered || size > CACHED_RESULTS_MAX_BYTES) {
+    return;
+  }
+
+  /* Evict least recently used results. */
+  while (g_cached_results.size + size > CACHED_RESULTS_MAX_BYTES) {
+    size_t lru_hash = 0;
+    uint64_t lru_last_used = UINT64_MAX;
+    for (const auto item : g_cached_results.results.items()) {
+      if (item.value.last_used < lru_last_used) {
+        lru_hash = item.key;
+        lru_last_used = item.value.last_used;
+      }
+    }
+    g_cached_results.size -= g_cached_results.results.lookup(lru_hash).size;
+    g_cached_results.results.remove_contained(lru_hash);
+  }
+
+  g_cached_results.results.add_new(result_hash,
+                                   {buf_data.buffer,
+                                    size,
+                                    ++g_cached_results.clock,
+                                    &typeid(*op),
+                                    canvas,
+                                    op->get_output_socket()->get_data_type()});
+  g_cached_results.size += size;
+  buf_data.is_cached = true;
+}
+
+bool SharedOperationBuffers::is_result_cached(NodeOperation *op)
+{
+  return get_buffer_data(op).is_cached;
+}
+
+void SharedOperationBuffers::free_cached_results()
+{
+  g_cached_results.results.clear_and_shrink();
+  g_cached_results.size = 0;
+}
+
 }  // namespace blender::compositor
@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <memory>
+
 #include "BLI_map.hh"
 #include "BLI_vector.hh"
 
@@ -26,11 +28,14 @@ class SharedOperationBuffers {
   typedef struct BufferData {
    public:
     BufferData();
-    std::unique_ptr<MemoryBuffer> buffer;
+    /** Shared with the results cache when cached. */
+    std::shared_ptr<MemoryBuffer> buffer;
     blender::Vector<rcti> render_areas;
     int registered_reads;
     int received_reads;
     bool is_rendered;
+    /** Whether the buffer is shared with the results cache. */
+    bool is_cached;
   } BufferData;
   blender::Map<NodeOperation *, BufferData> buffers_;
 
@@ -77,6 +82,25 @@ class SharedOperationBuffers {
    */
   void read_finished(NodeOperation *read_op);
 
+  /**
+   * Use the buffer cached by a previous execution for an operation result with given hash, if
+   * any. Returns whether the operation buffer is rendered.
+   */
+  bool use_cached_result(NodeOperation *op, size_t result_hash);
+  /**
+   * Keep given operation rendered buffer for later executions, within a memory budget.
+   * Only buffers rendered for the whole operation canvas are kept.
+   */
+  void cache_result(NodeOperation *op, size_t result_hash);
+  /**
+   * Whether given operation buffer is shared with the results cache, so it must not be modified.
+   */
+  bool is_result_cached(NodeOperation *op);
+  /**
+   * Free all buffers kept for later executions.
+   */
+  static void free_cached_results();
+
  private:
   BufferData &get_buffer_data(NodeOperation *op);
 
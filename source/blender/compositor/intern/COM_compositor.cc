@@ -10,6 +10,8 @@
 #include "BKE_scene.h"
 
 #include "COM_ExecutionSystem.h"
+#include "COM_FFTConvolution.h"
+#include "COM_SharedOperationBuffers.h"
 #include "COM_WorkScheduler.h"
 #include "COM_compositor.h"
 
@@ -101,6 +103,8 @@ void COM_deinitialize()
   if (g_compositor.is_initialized) {
     BLI_mutex_lock(&g_compositor.mutex);
     blender::compositor::WorkScheduler::deinitialize();
+    blender::compositor::fft_convolution_free_cache();
+    blender::compositor::SharedOperationBuffers::free_cached_results();
     g_compositor.is_initialized = false;
     BLI_mutex_unlock(&g_compositor.mutex);
     BLI_mutex_end(&g_compositor.mutex);
@@ -1,8 +1,12 @@
 /* SPDX-License-Identifier: GPL-2.0-or-later
  * Copyright 2011 Blender Foundation. */
 
+#include "BLI_array.hh"
+#include "BLI_task.hh"
+
 #include "COM_BokehBlurOperation.h"
 #include "COM_ConstantOperation.h"
+#include "COM_FFTConvolution.h"
 
 #include "COM_OpenCLDevice.h"
 
@@ -31,6 +35,7 @@ BokehBlurOperation::BokehBlurOperation()
   input_bounding_box_reader_ = nullptr;
 
   extend_bounds_ = false;
+  use_fft_ = false;
 }
 
 void BokehBlurOperation::init_data()
@@ -306,6 +311,45 @@ void BokehBlurOperation::get_area_of_interest(const int input_idx,
   }
 }
 
+void BokehBlurOperation::update_memory_buffer_started(MemoryBuffer *output,
+                                                      const rcti &area,
+                                                      Span<MemoryBuffer *> inputs)
+{
+  const float max_dim = MAX2(this->get_width(), this->get_height());
+  const int pixel_size = size_ * max_dim / 100.0f;
+  const int kernel_size = 2 * pixel_size;
+
+  /* Large kernels are convolved for the whole area at once, pixels outside of the bounding box
+   * are replaced afterwards. */
+  use_fft_ = kernel_size >= FFT_CONVOLUTION_MIN_KERNEL_SIZE;
+  if (!use_fft_) {
+    return;
+  }
+
+  const MemoryBuffer *bokeh_input = inputs[BOKEH_INPUT_INDEX];
+  const float m = bokehDimension_ / pixel_size;
+  Array<float> kernel_data(kernel_size * kernel_size * COM_DATA_TYPE_COLOR_CHANNELS);
+  threading::parallel_for(IndexRange(kernel_size), 16, [&](const IndexRange rows) {
+    for (const int64_t j : rows) {
+      const float v = bokeh_mid_y_ - (j - pixel_size) * m;
+      for (int i = 0; i < kernel_size; i++) {
+        const float u = bokeh_mid_x_ - (i - pixel_size) * m;
+        bokeh_input->read_elem_checked(
+            u, v, &kernel_data[(j * kernel_size + i) * COM_DATA_TYPE_COLOR_CHANNELS]);
+      }
+    }
+  });
+
+  ConvolutionKernel kernel;
+  kernel.data = kernel_data;
+  kernel.width = kernel_size;
+  kernel.height = kernel_size;
+  kernel.channels = COM_DATA_TYPE_COLOR_CHANNELS;
+  kernel.center_x = pixel_size;
+  kernel.center_y = pixel_size;
+  fft_convolve(*inputs[IMAGE_INPUT_INDEX], kernel, *output, area, true);
+}
+
 void BokehBlurOperation::update_memory_buffer_partial(MemoryBuffer *output,
                                                       const rcti &area,
                                                       Span<MemoryBuffer *> inputs)
@@ -327,6 +371,9 @@ void BokehBlurOperation::update_memory_buffer_partial(MemoryBuffer *output,
       image_input->read_elem(x, y, it.out);
       continue;
     }
+    if (use_fft_) {
+      continue;
+    }
 
     float color_accum[4] = {0};
     float multiplier_accum[4] = {0};
@@ -21,6 +21,8 @@ class BokehBlurOperation : public MultiThreadedOperation, public QualityStepHelp
   float bokeh_mid_y_;
   float bokehDimension_;
   bool extend_bounds_;
+  /** Whether the image is convolved in frequency space, see #update_memory_buffer_started. */
+  bool use_fft_;
 
  public:
   BokehBlurOperation();
@@ -68,6 +70,9 @@ class BokehBlurOperation : public MultiThreadedOperation, public QualityStepHelp
   void determine_canvas(const rcti &preferred_area, rcti &r_area) override;
 
   void get_area_of_interest(int input_idx, const rcti &output_area, rcti &r_input_area) override;
+  void update_memory_buffer_started(MemoryBuffer *output,
+                                    const rcti &area,
+                                    Span<MemoryBuffer *> inputs) override;
   void update_memory_buffer_partial(MemoryBuffer *output,
                                     const rcti &area,
                                     Span<MemoryBuffer *> inputs) override;
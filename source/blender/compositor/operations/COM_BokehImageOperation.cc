@@ -139,4 +139,11 @@ void BokehImageOperation::determine_canvas(const rcti &preferred_area, rcti &r_a
                 preferred_area.ymin + COM_BLUR_BOKEH_PIXELS);
 }
 
+void BokehImageOperation::hash_output_params()
+{
+  hash_params(data_->angle, data_->flaps);
+  hash_params(data_->rounding, data_->catadioptric);
+  hash_param(data_->lensshift);
+}
+
 }  // namespace blender::compositor
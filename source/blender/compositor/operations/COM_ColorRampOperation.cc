@@ -15,6 +15,7 @@ ColorRampOperation::ColorRampOperation()
   input_program_ = nullptr;
   color_band_ = nullptr;
   flags_.can_be_constant = true;
+  flags_.is_pixel_operation = true;
 }
 void ColorRampOperation::init_execution()
 {
@@ -17,6 +17,27 @@ bool ConstantOperation::can_get_constant_elem() const
   return !needs_canvas_to_get_constant_ || flags_.is_canvas_set;
 }
 
+bool ConstantOperation::can_generate_result_hash()
+{
+  return can_get_constant_elem();
+}
+
+std::optional<size_t> ConstantOperation::generate_result_hash(Span<size_t> /*input_hashes*/)
+{
+  if (!can_get_constant_elem()) {
+    return std::nullopt;
+  }
+
+  const DataType data_type = get_output_socket()->get_data_type();
+  size_t hash = get_default_hash_2(typeid(*this).hash_code(), data_type);
+  combine_hashes(hash, get_default_hash_4(canvas_.xmin, canvas_.xmax, canvas_.ymin, canvas_.ymax));
+  const float *elem = get_constant_elem();
+  for (const int i : IndexRange(COM_data_type_num_channels(data_type))) {
+    combine_hashes(hash, get_default_hash(elem[i]));
+  }
+  return hash;
+}
+
 void ConstantOperation::update_memory_buffer(MemoryBuffer *output,
                                              const rcti &area,
                                              Span<MemoryBuffer *> /*inputs*/)
@@ -25,6 +25,9 @@ class ConstantOperation : public NodeOperation {
   virtual const float *get_constant_elem() = 0;
   bool can_get_constant_elem() const;
 
+  bool can_generate_result_hash() override;
+  std::optional<size_t> generate_result_hash(Span<size_t> input_hashes) override;
+
   void update_memory_buffer(MemoryBuffer *output,
                             const rcti &area,
                             Span<MemoryBuffer *> inputs) final;
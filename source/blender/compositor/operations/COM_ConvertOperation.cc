@@ -13,6 +13,7 @@ ConvertBaseOperation::ConvertBaseOperation()
 {
   input_operation_ = nullptr;
   flags_.can_be_constant = true;
+  flags_.is_pixel_operation = true;
 }
 
 void ConvertBaseOperation::init_execution()
@@ -585,6 +586,7 @@ SeparateChannelOperation::SeparateChannelOperation()
   this->add_input_socket(DataType::Color);
   this->add_output_socket(DataType::Value);
   input_operation_ = nullptr;
+  flags_.is_pixel_operation = true;
 }
 void SeparateChannelOperation::init_execution()
 {
@@ -629,6 +631,7 @@ CombineChannelsOperation::CombineChannelsOperation()
   input_channel2_operation_ = nullptr;
   input_channel3_operation_ = nullptr;
   input_channel4_operation_ = nullptr;
+  flags_.is_pixel_operation = true;
 }
 
 void CombineChannelsOperation::init_execution()
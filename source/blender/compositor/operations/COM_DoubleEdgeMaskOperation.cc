@@ -1,8 +1,14 @@
 /* SPDX-License-Identifier: GPL-2.0-or-later
  * Copyright 2011 Blender Foundation. */
 
+#include <cfloat>
+#include <climits>
 #include <cstdlib>
 
+#include "BLI_array.hh"
+#include "BLI_math_bits.h"
+#include "BLI_task.hh"
+
 #include "COM_DoubleEdgeMaskOperation.h"
 
 namespace blender::compositor {
@@ -905,270 +911,129 @@ static void do_adjacentEdgeDetection(uint t,
   rsize[2] = in_gsz;
 }
 
-static void do_createEdgeLocationBuffer(uint t,
-                                        uint rw,
-                                        const uint *lres,
-                                        float *res,
-                                        ushort *gbuf,
-                                        uint *inner_edge_offset,
-                                        uint *outer_edge_offset,
-                                        uint isz,
-                                        uint gsz)
+/**
+ * Compute the squared distance of every pixel to the nearest pixel flagged with \a flag, or
+ * #UINT_MAX when no pixel is flagged.
+ *
+ * This uses the exact separable distance transform by Felzenszwalb and Huttenlocher: distances
+ * are first found along every column, then along every row using the lower envelope of the
+ * parabolas centered on every pixel. Columns and rows are independent and processed in parallel,
+ * for a linear cost instead of comparing every pixel with every flagged pixel.
+ */
+static void do_edgeDistanceTransform(
+    const int rw, const int rh, const uint *lres, const uint flag, MutableSpan<uint> r_dist)
 {
-  int x;     /* Pixel loop counter. */
-  int a;     /* Temporary pixel index buffer loop counter. */
-  uint ud;   /* Unscaled edge distance. */
-  uint dmin; /* Minimum edge distance. */
-
-  uint rsl; /* Long used for finding fast `1.0/sqrt`. */
-  uint gradient_fill_offset;
-
-  /* For looping inner edge pixel indexes, represents current position from offset. */
-  uint inner_accum = 0;
-  /* For looping outer edge pixel indexes, represents current position from offset. */
-  uint outer_accum = 0;
-  /* For looping gradient pixel indexes, represents current position from offset. */
-  uint gradient_accum = 0;
-
-  /* Disable clang-format to prevent line-wrapping. */
-  /* clang-format off */
-  /*
-   * Here we compute the size of buffer needed to hold (row,col) coordinates
-   * for each pixel previously determined to be either gradient, inner edge,
-   * or outer edge.
-   *
-   * Allocation is done by requesting 4 bytes "sizeof(int)" per pixel, even
-   * though gbuf[] is declared as `(ushort *)` (2 bytes) because we don't
-   * store the pixel indexes, we only store x,y location of pixel in buffer.
-   *
-   * This does make the assumption that x and y can fit in 16 unsigned bits
-   * so if Blender starts doing renders greater than 65536 in either direction
-   * this will need to allocate gbuf[] as uint *and allocate 8 bytes
-   * per flagged pixel.
-   *
-   * In general, the buffer on-screen:
-   *
-   * Example:  9 by 9 pixel block
-   *
-   * `.` = Pixel non-white in both outer and inner mask.
-   * `o` = Pixel white in outer, but not inner mask, adjacent to "." pixel.
-   * `g` = Pixel white in outer, but not inner mask, not adjacent to "." pixel.
-   * `i` = Pixel white in inner mask, adjacent to "g" or "." pixel.
-   * `F` = Pixel white in inner mask, only adjacent to other pixels white in the inner mask.
-   *
-   *
-   * .........   <----- pixel #80
-   * ..oooo...
-   * .oggggo..
-   * .oggiggo.
-   * .ogi_figo.
-   * .oggiggo.
-   * .oggggo..
-   * ..oooo...
-   * pixel #00 -----> .........
-   *
-   * gsz = 18   (18 "g" pixels above)
-   * isz = 4    (4 "i" pixels above)
-   * osz = 18   (18 "o" pixels above)
-   *
-   *
-   * The memory in gbuf[] after filling will look like this:
-   *
-   * gradient_fill_offset (0 pixels)                   inner_edge_offset (18 pixels)    outer_edge_offset (22 pixels)
-   * /                                               /                              /
-   * /                                               /                              /
-   * |X   Y   X   Y   X   Y   X   Y   >     <X   Y   X   Y   >     <X   Y   X   Y   X   Y   >     <X   Y   X   Y   | <- (x,y)
-   * +-------------------------------->     <---------------->     <------------------------>     <----------------+
-   * |0   2   4   6   8   10  12  14  > ... <68  70  72  74  > ... <80  82  84  86  88  90  > ... <152 154 156 158 | <- bytes
-   * +-------------------------------->     <---------------->     <------------------------>     <----------------+
-   * |g0  g0  g1  g1  g2  g2  g3  g3  >     <g17 g17 i0  i0  >     <i2  i2  i3  i3  o0  o0  >     <o16 o16 o17 o17 | <- pixel
-   *       /                              /                              /
-   *      /                              /                              /
-   *        /                              /                              /
-   * +---------- gradient_accum (18) ---------+      +--- inner_accum (22) ---+      +--- outer_accum (40) ---+
-   *
-   *
-   * Ultimately we do need the pixel's memory buffer index to set the output
-   * pixel color, but it's faster to reconstruct the memory buffer location
-   * each iteration of the final gradient calculation than it is to deconstruct
-   * a memory location into x,y pairs each round.
-   */
-  /* clang-format on */
-
-  gradient_fill_offset = 0; /* Since there are likely "more" of these, put it first. :). */
-  *inner_edge_offset = gradient_fill_offset + gsz; /* Set start of inner edge indexes. */
-  *outer_edge_offset = (*inner_edge_offset) + isz; /* Set start of outer edge indexes. */
-  /* Set the accumulators to correct positions */  /* Set up some accumulator variables for loops.
-                                                    */
-  gradient_accum = gradient_fill_offset; /* Each accumulator variable starts at its respective. */
-  inner_accum = *inner_edge_offset;      /* Section's offset so when we start filling, each. */
-  outer_accum = *outer_edge_offset;      /* Section fills up its allocated space in gbuf. */
-  /* Uses `dmin=row`, `rsl=col`. */
-  for (x = 0, dmin = 0; x < t; x += rw, dmin++) {
-    for (rsl = 0; rsl < rw; rsl++) {
-      a = x + rsl;
-      if (lres[a] == 2) {         /* It is a gradient pixel flagged by 2. */
-        ud = gradient_accum << 1; /* Double the index to reach correct ushort location. */
-        gbuf[ud] = dmin;          /* Insert pixel's row into gradient pixel location buffer. */
-        gbuf[ud + 1] = rsl;       /* Insert pixel's column into gradient pixel location buffer. */
-        gradient_accum++;         /* Increment gradient index buffer pointer. */
+  constexpr uint inf = UINT_MAX;
+
+  /* Distance to the nearest flagged pixel in the same column. */
+  threading::parallel_for(IndexRange(rw), 256, [&](const IndexRange columns) {
+    for (int y = 0; y < rh; y++) {
+      for (const int x : columns) {
+        const int a = y * rw + x;
+        const uint prev = y > 0 ? r_dist[a - rw] : inf;
+        r_dist[a] = lres[a] == flag ? 0 : (prev == inf ? inf : prev + 1);
+      }
+    }
+    for (int y = rh - 2; y >= 0; y--) {
+      for (const int x : columns) {
+        const int a = y * rw + x;
+        const uint next = r_dist[a + rw];
+        if (next != inf && next + 1 < r_dist[a]) {
+          r_dist[a] = next + 1;
+        }
       }
-      else if (lres[a] == 3) { /* It is an outer edge pixel flagged by 3. */
-        ud = outer_accum << 1; /* Double the index to reach correct ushort location. */
-        gbuf[ud] = dmin;       /* Insert pixel's row into outer edge pixel location buffer. */
-        gbuf[ud + 1] = rsl;    /* Insert pixel's column into outer edge pixel location buffer. */
-        outer_accum++;         /* Increment outer edge index buffer pointer. */
-        res[a] = 0.0f;         /* Set output pixel intensity now since it won't change later. */
+    }
+  });
+
+  /* Lower envelope of `(x - q)^2 + f(q)` along every row, `f` being squared column distances. */
+  threading::parallel_for(IndexRange(rh), 16, [&](const IndexRange rows) {
+    Array<uint> f(rw);
+    Array<int> v(rw);
+    Array<double> z(rw + 1);
+    for (const int y : rows) {
+      uint *row = &r_dist[y * rw];
+      int k = -1;
+      for (int q = 0; q < rw; q++) {
+        f[q] = row[q] == inf ? inf : row[q] * row[q];
+        if (f[q] == inf) {
+          continue;
+        }
+        double s = 0.0;
+        while (k >= 0) {
+          const int p = v[k];
+          s = ((double(f[q]) + double(q) * q) - (double(f[p]) + double(p) * p)) / (2.0 * (q - p));
+          if (s > z[k]) {
+            break;
+          }
+          k--;
+        }
+        k++;
+        v[k] = q;
+        z[k] = k == 0 ? -DBL_MAX : s;
+        z[k + 1] = DBL_MAX;
       }
-      else if (lres[a] == 4) { /* It is an inner edge pixel flagged by 4. */
-        ud = inner_accum << 1; /* Double int index to reach correct ushort location. */
-        gbuf[ud] = dmin;       /* Insert pixel's row into inner edge pixel location buffer. */
-        gbuf[ud + 1] = rsl;    /* Insert pixel's column into inner edge pixel location buffer. */
-        inner_accum++;         /* Increment inner edge index buffer pointer. */
-        res[a] = 1.0f;         /* Set output pixel intensity now since it won't change later. */
+
+      if (k < 0) {
+        std::fill_n(row, rw, inf);
+        continue;
+      }
+      for (int x = 0, j = 0; x < rw; x++) {
+        while (z[j + 1] < x) {
+          j++;
+        }
+        const uint64_t dx = uint64_t(std::abs(x - v[j]));
+        row[x] = uint(std::min(dx * dx + f[v[j]], uint64_t(inf)));
       }
     }
-  }
+  });
 }
 
-static void do_fillGradientBuffer(uint rw,
-                                  float *res,
-                                  const ushort *gbuf,
-                                  uint isz,
-                                  uint osz,
-                                  uint gsz,
-                                  uint inner_edge_offset,
-                                  uint outer_edge_offset)
+/** Reciprocal square root approximation of a squared distance. */
+static float do_inverseDistance(const uint dist_sq)
 {
-  int x;                    /* Pixel loop counter. */
-  int a;                    /* Temporary pixel index buffer loop counter. */
-  int fsz;                  /* Size of the frame. */
-  uint rsl;                 /* Long used for finding fast `1.0/sqrt`. */
-  float rsf;                /* Float used for finding fast `1.0/sqrt`. */
-  const float rsopf = 1.5f; /* Constant float used for finding fast `1.0/sqrt`. */
-
-  uint gradient_fill_offset;
-  uint t;
-  uint ud;     /* Unscaled edge distance. */
-  uint dmin;   /* Minimum edge distance. */
-  float odist; /* Current outer edge distance. */
-  float idist; /* Current inner edge distance. */
-  int dx;      /* X-delta (used for distance proportion calculation) */
-  int dy;      /* Y-delta (used for distance proportion calculation) */
-
-  /*
-   * The general algorithm used to color each gradient pixel is:
-   *
-   * 1.) Loop through all gradient pixels.
-   * A.) For each gradient pixel:
-   * a.) Loop through all outside edge pixels, looking for closest one
-   * to the gradient pixel we are in.
-   * b.) Loop through all inside edge pixels, looking for closest one
-   * to the gradient pixel we are in.
-   * c.) Find proportion of distance from gradient pixel to inside edge
-   * pixel compared to sum of distance to inside edge and distance to
-   * outside edge.
-   *
-   * In an image where:
-   * `.` = Blank (black) pixels, not covered by inner mask or outer mask.
-   * `+` = Desired gradient pixels, covered only by outer mask.
-   * `*` = White full mask pixels, covered by at least inner mask.
-   *
-   * ...............................
-   * ...............+++++++++++.....
-   * ...+O++++++..++++++++++++++....
-   * ..+++\++++++++++++++++++++.....
-   * .+++++G+++++++++*******+++.....
-   * .+++++|+++++++*********+++.....
-   * .++***I****************+++.....
-   * .++*******************+++......
-   * .+++*****************+++.......
-   * ..+++***************+++........
-   * ....+++**********+++...........
-   * ......++++++++++++.............
-   * ...............................
-   *
-   * O = outside edge pixel
-   * \
-   *  G = gradient pixel
-   *  |
-   *  I = inside edge pixel
-   *
-   *   __
-   *  *note that IO does not need to be a straight line, in fact
-   *  many cases can arise where straight lines do not work
-   *  correctly.
-   *
-   *     __       __     __
-   * d.) Pixel color is assigned as |GO| / ( |GI| + |GO| )
-   *
-   * The implementation does not compute distance, but the reciprocal of the
-   * distance. This is done to avoid having to compute a square root, as a
-   * reciprocal square root can be computed faster. Therefore, the code computes
-   * pixel color as |GI| / (|GI| + |GO|). Since these are reciprocals, GI serves the
-   * purpose of GO for the proportion calculation.
-   *
-   * For the purposes of the minimum distance comparisons, we only check
-   * the sums-of-squares against each other, since they are in the same
-   * mathematical sort-order as if we did go ahead and take square roots
-   *
-   * Loop through all gradient pixels.
-   */
+  const float rsopf = 1.5f;
+  const float dist = float(dist_sq);
+  const float rsf = dist * 0.5f;
+  /* Use some peculiar properties of the way bits are stored in floats vs. uints to compute an
+   * approximate reciprocal square root. */
+  const float rs = uint_as_float(0x5f3759df - (float_as_uint(dist) >> 1));
+  return rs * (rsopf - (rsf * rs * rs));
+}
 
-  for (x = gsz - 1; x >= 0; x--) {
-    gradient_fill_offset = x << 1;
-    t = gbuf[gradient_fill_offset];       /* Calculate column of pixel indexed by `gbuf[x]`. */
-    fsz = gbuf[gradient_fill_offset + 1]; /* Calculate row of pixel indexed by `gbuf[x]`. */
-    dmin = 0xffffffff;                    /* Reset min distance to edge pixel. */
-    for (a = outer_edge_offset + osz - 1; a >= outer_edge_offset;
-         a--) { /* Loop through all outer edge buffer pixels. */
-      ud = a << 1;
-      dy = t - gbuf[ud];       /* Set dx to gradient pixel column - outer edge pixel row. */
-      dx = fsz - gbuf[ud + 1]; /* Set dy to gradient pixel row - outer edge pixel column. */
-      ud = dx * dx + dy * dy;  /* Compute sum of squares. */
-      if (ud < dmin) {         /* If our new sum of squares is less than the current minimum. */
-        dmin = ud;             /* Set a new minimum equal to the new lower value. */
-      }
-    }
-    odist = float(dmin); /* Cast outer min to a float. */
-    rsf = odist * 0.5f;
-    rsl = *(uint *)&odist;         /* Use some peculiar properties of the way bits are stored. */
-    rsl = 0x5f3759df - (rsl >> 1); /* In floats vs. uints to compute an approximate. */
-    odist = *(float *)&rsl;        /* Reciprocal square root. */
-    odist = odist * (rsopf - (rsf * odist *
-                              odist)); /* -- This line can be iterated for more accuracy. -- */
-    dmin = 0xffffffff;                 /* Reset min distance to edge pixel. */
-    for (a = inner_edge_offset + isz - 1; a >= inner_edge_offset;
-         a--) { /* Loop through all inside edge pixels. */
-      ud = a << 1;
-      dy = t - gbuf[ud];       /* Compute delta in Y from gradient pixel to inside edge pixel. */
-      dx = fsz - gbuf[ud + 1]; /* Compute delta in X from gradient pixel to inside edge pixel. */
-      ud = dx * dx + dy * dy;  /* Compute sum of squares. */
-      if (ud <
-          dmin) {  /* If our new sum of squares is less than the current minimum we've found. */
-        dmin = ud; /* Set a new minimum equal to the new lower value. */
+/**
+ * Set final intensities of edge pixels and fill gradient pixels.
+ *
+ * Gradient pixels are colored with `|GO| / (|GI| + |GO|)`, where `GO` and `GI` are distances to
+ * the closest outer and inner edge pixels. The implementation uses reciprocals of distances, which
+ * avoids square roots, so the proportion is computed as `|GI| / (|GI| + |GO|)` instead.
+ */
+static void do_fillGradientBuffer(const int rw, const int rh, const uint *lres, float *res)
+{
+  const int64_t size = int64_t(rw) * rh;
+  Array<uint> inner_dist(size);
+  Array<uint> outer_dist(size);
+  do_edgeDistanceTransform(rw, rh, lres, 4, inner_dist);
+  do_edgeDistanceTransform(rw, rh, lres, 3, outer_dist);
+
+  /* Flags are stored in the output buffer, each pixel is only overwritten once it's read. */
+  threading::parallel_for(IndexRange(size), 4096, [&](const IndexRange range) {
+    for (const int64_t a : range) {
+      switch (lres[a]) {
+        case 2: {
+          const float odist = do_inverseDistance(outer_dist[a]);
+          const float idist = do_inverseDistance(inner_dist[a]);
+          res[a] = idist / (idist + odist);
+          break;
+        }
+        case 3:
+          res[a] = 0.0f;
+          break;
+        case 4:
+          res[a] = 1.0f;
+          break;
       }
     }
-
-    /* Cast inner min to a float. */
-    idist = float(dmin);
-    rsf = idist * 0.5f;
-    rsl = *(uint *)&idist;
-
-    /* See notes above. */
-    rsl = 0x5f3759df - (rsl >> 1);
-    idist = *(float *)&rsl;
-    idist = idist * (rsopf - (rsf * idist * idist));
-
-    /* NOTE: once again that since we are using reciprocals of distance values our
-     * proportion is already the correct intensity, and does not need to be
-     * subtracted from 1.0 like it would have if we used real distances. */
-
-    /* Here we reconstruct the pixel's memory location in the CompBuf by
-     * `Pixel Index = Pixel Column + ( Pixel Row * Row Width )`. */
-    res[gbuf[gradient_fill_offset + 1] + (gbuf[gradient_fill_offset] * rw)] =
-        (idist / (idist + odist)); /* Set intensity. */
-  }
+  });
 }
 
 /* End of copy. */
@@ -1180,17 +1045,12 @@ void DoubleEdgeMaskOperation::do_double_edge_mask(float *imask, float *omask, fl
   uint *lomask; /* Pointer to outer mask (for bit operations). */
 
   int rw;  /* Pixel row width. */
-  int t;   /* Total number of pixels in buffer - 1 (used for loop starts). */
-  int fsz; /* Size of the frame. */
+  int t;  /* Total number of pixels in buffer - 1 (used for loop starts). */
 
-  uint isz = 0;               /* Size (in pixels) of inside edge pixel index buffer. */
-  uint osz = 0;               /* Size (in pixels) of outside edge pixel index buffer. */
-  uint gsz = 0;               /* Size (in pixels) of gradient pixel index buffer. */
-  uint rsize[3];              /* Size storage to pass to helper functions. */
-  uint inner_edge_offset = 0; /* Offset into final buffer where inner edge pixel indexes start. */
-  uint outer_edge_offset = 0; /* Offset into final buffer where outer edge pixel indexes start. */
-
-  ushort *gbuf; /* Gradient/inner/outer pixel location index buffer. */
+  uint isz = 0;  /* Size (in pixels) of inside edge pixels. */
+  uint osz = 0;  /* Size (in pixels) of outside edge pixels. */
+  uint gsz = 0;  /* Size (in pixels) of gradient pixels. */
+  uint rsize[3]; /* Size storage to pass to helper functions. */
 
   if (true) { /* If both input sockets have some data coming in... */
 
@@ -1259,24 +1119,7 @@ void DoubleEdgeMaskOperation::do_double_edge_mask(float *imask, float *omask, fl
       do_allEdgeDetection(t, rw, limask, lomask, lres, res, rsize, isz, osz, gsz);
     }
 
-    /* Set edge and gradient buffer sizes once again...
-     * the sizes in rsize[] may have been modified
-     * by the `do_*EdgeDetection()` function. */
-    isz = rsize[0];
-    osz = rsize[1];
-    gsz = rsize[2];
-
-    /* Calculate size of pixel index buffer needed. */
-    fsz = gsz + isz + osz;
-    /* Allocate edge/gradient pixel index buffer. */
-    gbuf = (ushort *)MEM_callocN(sizeof(ushort) * fsz * 2, "DEM");
-
-    do_createEdgeLocationBuffer(
-        t, rw, lres, res, gbuf, &inner_edge_offset, &outer_edge_offset, isz, gsz);
-    do_fillGradientBuffer(rw, res, gbuf, isz, osz, gsz, inner_edge_offset, outer_edge_offset);
-
-    /* Free the gradient index buffer. */
-    MEM_freeN(gbuf);
+    do_fillGradientBuffer(rw, this->get_height(), lres, res);
   }
 }
 
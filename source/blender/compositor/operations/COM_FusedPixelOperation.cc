@@ -0,0 +1,154 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include <algorithm>
+#include <optional>
+
+#include "COM_FusedPixelOperation.h"
+
+namespace blender::compositor {
+
+/** Scratch memory of a chunk, a common L1 data cache size. */
+static constexpr int SCRATCH_MAX_BYTES = 32 * 1024;
+static constexpr int CHUNK_MIN_WIDTH = 16;
+
+FusedPixelOperation::FusedPixelOperation(Span<NodeOperation *> operations)
+{
+  BLI_assert(operations.size() > 1);
+  scratch_elem_len_ = 0;
+  for (const int i : operations.index_range()) {
+    NodeOperation *op = operations[i];
+    BLI_assert(op->get_flags().is_pixel_operation);
+    BLI_assert(BLI_rcti_compare(&op->get_canvas(), &operations.last()->get_canvas()));
+    operations_.append(static_cast<MultiThreadedOperation *>(op));
+
+    sources_.append({});
+    Vector<InputSource> &sources = sources_.last();
+    for (int j = 0; j < op->get_number_of_input_sockets(); j++) {
+      NodeOperationInput *input = op->get_input_socket(j);
+      const int64_t source_index = input->is_connected() ?
+                                       operations.first_index_try(
+                                           &input->get_link()->get_operation()) :
+                                       -1;
+      if (source_index != -1) {
+        BLI_assert(source_index < i);
+        sources.append({int(source_index), -1});
+      }
+      else {
+        sources.append({-1, int(fused_inputs_.size())});
+        fused_inputs_.append(input);
+        add_input_socket(input->get_data_type(), ResizeMode::None);
+      }
+    }
+
+    if (i < operations.size() - 1) {
+      scratch_offsets_.append(scratch_elem_len_);
+      scratch_elem_len_ += COM_data_type_num_channels(op->get_output_socket()->get_data_type());
+    }
+  }
+
+  NodeOperation *last_op = operations.last();
+  add_output_socket(last_op->get_output_socket()->get_data_type());
+  set_canvas(last_op->get_canvas());
+  set_name(last_op->get_name());
+
+  chunk_width_ = std::max(CHUNK_MIN_WIDTH,
+                          SCRATCH_MAX_BYTES / int(scratch_elem_len_ * sizeof(float)));
+}
+
+FusedPixelOperation::~FusedPixelOperation()
+{
+  for (NodeOperation *op : operations_) {
+    delete op;
+  }
+}
+
+bool FusedPixelOperation::can_generate_result_hash()
+{
+  return std::all_of(operations_.begin(), operations_.end(), [](MultiThreadedOperation *operation) {
+    return operation->can_generate_result_hash();
+  });
+}
+
+std::optional<size_t> FusedPixelOperation::generate_result_hash(Span<size_t> input_hashes)
+{
+  Array<size_t> op_hashes(operations_.size());
+  for (const int i : operations_.index_range()) {
+    Vector<size_t> op_input_hashes;
+    for (const InputSource &source : sources_[i]) {
+      op_input_hashes.append(source.operation_index == -1 ? input_hashes[source.input_index] :
+                                                            op_hashes[source.operation_index]);
+    }
+    std::optional<size_t> op_hash = operations_[i]->generate_result_hash(op_input_hashes);
+    if (!op_hash) {
+      return std::nullopt;
+    }
+    op_hashes[i] = *op_hash;
+  }
+  return op_hashes.last();
+}
+
+void FusedPixelOperation::init_data()
+{
+  for (NodeOperation *op : operations_) {
+    op->init_data();
+  }
+}
+
+void FusedPixelOperation::init_execution()
+{
+  for (NodeOperation *op : operations_) {
+    op->init_execution();
+  }
+}
+
+void FusedPixelOperation::deinit_execution()
+{
+  for (NodeOperation *op : operations_) {
+    op->deinit_execution();
+  }
+}
+
+void FusedPixelOperation::update_memory_buffer_partial(MemoryBuffer *output,
+                                                       const rcti &area,
+                                                       Span<MemoryBuffer *> inputs)
+{
+  const int chunk_width = std::min(BLI_rcti_size_x(&area), chunk_width_);
+  const int last_index = operations_.size() - 1;
+
+  rcti chunk;
+  BLI_rcti_init(&chunk, area.xmin, area.xmin + chunk_width, area.ymin, area.ymin + 1);
+
+  /* Intermediate buffers are re-created in place for every chunk, so pointers to them stay
+   * valid. */
+  Array<float> scratch(chunk_width * scratch_elem_len_);
+  Array<std::optional<MemoryBuffer>> buffers(last_index);
+  auto init_buffers = [&]() {
+    for (const int i : buffers.index_range()) {
+      const int num_channels = COM_data_type_num_channels(
+          operations_[i]->get_output_socket()->get_data_type());
+      buffers[i].emplace(&scratch[chunk_width * scratch_offsets_[i]], num_channels, chunk);
+    }
+  };
+  init_buffers();
+
+  Array<Vector<MemoryBuffer *>> ops_inputs(operations_.size());
+  for (const int i : operations_.index_range()) {
+    for (const InputSource &source : sources_[i]) {
+      ops_inputs[i].append(source.operation_index == -1 ? inputs[source.input_index] :
+                                                          &*buffers[source.operation_index]);
+    }
+  }
+
+  for (int y = area.ymin; y < area.ymax; y++) {
+    for (int x = area.xmin; x < area.xmax; x += chunk_width) {
+      BLI_rcti_init(&chunk, x, std::min(x + chunk_width, area.xmax), y, y + 1);
+      init_buffers();
+      for (const int i : operations_.index_range()) {
+        MemoryBuffer *op_output = i == last_index ? output : &*buffers[i];
+        operations_[i]->update_memory_buffer_partial(op_output, chunk, ops_inputs[i]);
+      }
+    }
+  }
+}
+
+}  // namespace blender::compositor
@@ -0,0 +1,63 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#pragma once
+
+#include "COM_MultiThreadedOperation.h"
+
+namespace blender::compositor {
+
+/**
+ * Evaluates a tree of pixel operations (see #NodeOperationFlags::is_pixel_operation) as a single
+ * operation. Intermediate results are only kept for a short chunk of a row at a time, in scratch
+ * memory small enough to stay in cache, instead of in full frame buffers.
+ */
+class FusedPixelOperation : public MultiThreadedOperation {
+ private:
+  struct InputSource {
+    /** Index of the fused operation writing the input, or -1 for an input of this operation. */
+    int operation_index;
+    /** Input socket index of this operation, when not written by a fused operation. */
+    int input_index;
+  };
+
+  /** Fused operations in evaluation order, the last one writes the output. */
+  Vector<MultiThreadedOperation *> operations_;
+  /** Sources of every input of every fused operation. */
+  Vector<Vector<InputSource>> sources_;
+  /** Fused operation inputs read through the inputs of this operation, in socket order. */
+  Vector<NodeOperationInput *> fused_inputs_;
+  /** Offsets in a scratch element of the intermediate results, all but the last operation. */
+  Vector<int> scratch_offsets_;
+  /** Number of floats needed to store all intermediate results of a pixel. */
+  int scratch_elem_len_;
+  /** Number of pixels evaluated at once. */
+  int chunk_width_;
+
+ public:
+  /**
+   * Take ownership of \a operations, which must be sorted by dependency and all be read by the
+   * last one, directly or through each other. Every input linked from outside of the fused
+   * operations becomes an input of this operation.
+   */
+  FusedPixelOperation(Span<NodeOperation *> operations);
+  ~FusedPixelOperation();
+
+  Span<NodeOperationInput *> get_fused_inputs() const
+  {
+    return fused_inputs_;
+  }
+
+  bool can_generate_result_hash() override;
+  std::optional<size_t> generate_result_hash(Span<size_t> input_hashes) override;
+
+  void init_data() override;
+  void init_execution() override;
+  void deinit_execution() override;
+
+ protected:
+  void update_memory_buffer_partial(MemoryBuffer *output,
+                                    const rcti &area,
+                                    Span<MemoryBuffer *> inputs) override;
+};
+
+}  // namespace blender::compositor
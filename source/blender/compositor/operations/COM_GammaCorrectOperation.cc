@@ -11,6 +11,7 @@ GammaCorrectOperation::GammaCorrectOperation()
   this->add_output_socket(DataType::Color);
   input_program_ = nullptr;
   flags_.can_be_constant = true;
+  flags_.is_pixel_operation = true;
 }
 void GammaCorrectOperation::init_execution()
 {
@@ -82,6 +83,7 @@ GammaUncorrectOperation::GammaUncorrectOperation()
   this->add_output_socket(DataType::Color);
   input_program_ = nullptr;
   flags_.can_be_constant = true;
+  flags_.is_pixel_operation = true;
 }
 void GammaUncorrectOperation::init_execution()
 {
@@ -146,4 +148,12 @@ void GammaUncorrectOperation::deinit_execution()
   input_program_ = nullptr;
 }
 
+void GammaCorrectOperation::hash_output_params()
+{
+}
+
+void GammaUncorrectOperation::hash_output_params()
+{
+}
+
 }  // namespace blender::compositor
@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: GPL-2.0-or-later
  * Copyright 2011 Blender Foundation. */
 
+#include "COM_FFTConvolution.h"
 #include "COM_GaussianBokehBlurOperation.h"
 
 #include "RE_pipeline.h"
@@ -10,6 +11,7 @@ namespace blender::compositor {
 GaussianBokehBlurOperation::GaussianBokehBlurOperation() : BlurBaseOperation(DataType::Color)
 {
   gausstab_ = nullptr;
+  use_fft_ = false;
 }
 
 void *GaussianBokehBlurOperation::initialize_tile_data(rcti * /*rect*/)
@@ -212,10 +214,36 @@ void GaussianBokehBlurOperation::get_area_of_interest(const int input_idx,
   r_input_area.ymin = output_area.ymin - rady_;
 }
 
+void GaussianBokehBlurOperation::update_memory_buffer_started(MemoryBuffer *output,
+                                                              const rcti &area,
+                                                              Span<MemoryBuffer *> inputs)
+{
+  const int kernel_width = 2 * radx_ + 1;
+  const int kernel_height = 2 * rady_ + 1;
+  use_fft_ = kernel_width >= FFT_CONVOLUTION_MIN_KERNEL_SIZE &&
+             kernel_height >= FFT_CONVOLUTION_MIN_KERNEL_SIZE;
+  if (!use_fft_) {
+    return;
+  }
+
+  ConvolutionKernel kernel;
+  kernel.data = Span<float>(gausstab_, kernel_width * kernel_height);
+  kernel.width = kernel_width;
+  kernel.height = kernel_height;
+  kernel.channels = 1;
+  kernel.center_x = radx_;
+  kernel.center_y = rady_;
+  fft_convolve(*inputs[IMAGE_INPUT_INDEX], kernel, *output, area, true);
+}
+
 void GaussianBokehBlurOperation::update_memory_buffer_partial(MemoryBuffer *output,
                                                               const rcti &area,
                                                               Span<MemoryBuffer *> inputs)
 {
+  if (use_fft_) {
+    return;
+  }
+
   const MemoryBuffer *input = inputs[IMAGE_INPUT_INDEX];
   BuffersIterator<float> it = output->iterate_with({}, area);
   const rcti &input_rect = input->get_rect();
@@ -15,6 +15,8 @@ class GaussianBokehBlurOperation : public BlurBaseOperation {
   int radx_, rady_;
   float radxf_;
   float radyf_;
+  /** Whether the image is convolved in frequency space, see #update_memory_buffer_started. */
+  bool use_fft_;
   void update_gauss();
 
  public:
@@ -37,6 +39,9 @@ class GaussianBokehBlurOperation : public BlurBaseOperation {
                                             rcti *output) override;
 
   void get_area_of_interest(int input_idx, const rcti &output_area, rcti &r_input_area) override;
+  void update_memory_buffer_started(MemoryBuffer *output,
+                                    const rcti &area,
+                                    Span<MemoryBuffer *> inputs) override;
   void update_memory_buffer_partial(MemoryBuffer *output,
                                     const rcti &area,
                                     Span<MemoryBuffer *> inputs) override;
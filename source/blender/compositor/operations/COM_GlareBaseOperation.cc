@@ -87,4 +87,14 @@ void GlareBaseOperation::update_memory_buffer(MemoryBuffer *output,
   }
 }
 
+void GlareBaseOperation::hash_output_params()
+{
+  hash_params(int(settings_->quality), int(settings_->type));
+  hash_params(int(settings_->iter), int(settings_->size));
+  hash_params(int(settings_->star_45), int(settings_->streaks));
+  hash_params(settings_->colmod, settings_->mix);
+  hash_params(settings_->threshold, settings_->fade);
+  hash_param(settings_->angle_ofs);
+}
+
 }  // namespace blender::compositor
@@ -69,6 +69,7 @@ class GlareBaseOperation : public SingleThreadedOperation {
                               const NodeGlare *settings) = 0;
 
   MemoryBuffer *create_memory_buffer(rcti *rect) override;
+  void hash_output_params() override;
 };
 
 }  // namespace blender::compositor
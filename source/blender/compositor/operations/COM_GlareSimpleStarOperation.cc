@@ -1,16 +1,74 @@
 /* SPDX-License-Identifier: GPL-2.0-or-later
  * Copyright 2011 Blender Foundation. */
 
+#include "BLI_task.hh"
+
 #include "COM_GlareSimpleStarOperation.h"
 
 namespace blender::compositor {
 
+/**
+ * Blend every pixel of \a buf in place with its neighbors at `(x - dx, y - dy)` and
+ * `(x + dx, y + dy)`, in forward or backward scan-line order.
+ *
+ * Pixels read neighbors already blended in this pass, so the order matters. It's kept for pixels
+ * depending on each other, while independent rows or columns are processed in parallel.
+ */
+static void simple_star_pass(
+    MemoryBuffer &buf, const int dx, const int dy, const float f1, const float f2, bool forward)
+{
+  const int width = buf.get_width();
+  const int height = buf.get_height();
+
+  auto blend_pixel = [&](const int x, const int y) {
+    float c[4], tc[4];
+    buf.read(c, x, y);
+    mul_v3_fl(c, f1);
+    buf.read(tc, x - dx, y - dy);
+    madd_v3_v3fl(c, tc, f2);
+    buf.read(tc, x + dx, y + dy);
+    madd_v3_v3fl(c, tc, f2);
+    c[3] = 1.0f;
+    buf.write_pixel(x, y, c);
+  };
+  auto blend_rows = [&](const IndexRange rows, const IndexRange columns) {
+    if (forward) {
+      for (int y = rows.first(); y <= rows.last(); y++) {
+        for (int x = columns.first(); x <= columns.last(); x++) {
+          blend_pixel(x, y);
+        }
+      }
+    }
+    else {
+      for (int y = rows.last(); y >= rows.first(); y--) {
+        for (int x = columns.last(); x >= columns.first(); x--) {
+          blend_pixel(x, y);
+        }
+      }
+    }
+  };
+
+  if (dy == 0) {
+    /* Only pixels of the same row depend on each other. */
+    threading::parallel_for(IndexRange(height), 8, [&](const IndexRange rows) {
+      blend_rows(rows, IndexRange(width));
+    });
+  }
+  else if (dx == 0) {
+    /* Only pixels of the same column depend on each other. */
+    threading::parallel_for(IndexRange(width), 64, [&](const IndexRange columns) {
+      blend_rows(IndexRange(height), columns);
+    });
+  }
+  else {
+    blend_rows(IndexRange(height), IndexRange(width));
+  }
+}
+
 void GlareSimpleStarOperation::generate_glare(float *data,
                                               MemoryBuffer *input_tile,
                                               const NodeGlare *settings)
 {
-  int i, x, y, ym, yp, xm, xp;
-  float c[4] = {0, 0, 0, 0}, tc[4] = {0, 0, 0, 0};
   const float f1 = 1.0f - settings->fade;
   const float f2 = (1.0f - f1) * 0.5f;
 
@@ -18,71 +76,26 @@ void GlareSimpleStarOperation::generate_glare(float *data,
   MemoryBuffer tbuf2(*input_tile);
 
   bool breaked = false;
-  for (i = 0; i < settings->iter && (!breaked); i++) {
-    //      // (x || x-1, y-1) to (x || x+1, y+1)
-    //      // F
-    for (y = 0; y < this->get_height() && (!breaked); y++) {
-      ym = y - i;
-      yp = y + i;
-      for (x = 0; x < this->get_width(); x++) {
-        xm = x - i;
-        xp = x + i;
-        tbuf1.read(c, x, y);
-        mul_v3_fl(c, f1);
-        tbuf1.read(tc, (settings->star_45 ? xm : x), ym);
-        madd_v3_v3fl(c, tc, f2);
-        tbuf1.read(tc, (settings->star_45 ? xp : x), yp);
-        madd_v3_v3fl(c, tc, f2);
-        c[3] = 1.0f;
-        tbuf1.write_pixel(x, y, c);
-
-        tbuf2.read(c, x, y);
-        mul_v3_fl(c, f1);
-        tbuf2.read(tc, xm, (settings->star_45 ? yp : y));
-        madd_v3_v3fl(c, tc, f2);
-        tbuf2.read(tc, xp, (settings->star_45 ? ym : y));
-        madd_v3_v3fl(c, tc, f2);
-        c[3] = 1.0f;
-        tbuf2.write_pixel(x, y, c);
-      }
-      if (is_braked()) {
-        breaked = true;
-      }
-    }
-    //      // B
-    for (y = this->get_height() - 1; y >= 0 && (!breaked); y--) {
-      ym = y - i;
-      yp = y + i;
-      for (x = this->get_width() - 1; x >= 0; x--) {
-        xm = x - i;
-        xp = x + i;
-        tbuf1.read(c, x, y);
-        mul_v3_fl(c, f1);
-        tbuf1.read(tc, (settings->star_45 ? xm : x), ym);
-        madd_v3_v3fl(c, tc, f2);
-        tbuf1.read(tc, (settings->star_45 ? xp : x), yp);
-        madd_v3_v3fl(c, tc, f2);
-        c[3] = 1.0f;
-        tbuf1.write_pixel(x, y, c);
-
-        tbuf2.read(c, x, y);
-        mul_v3_fl(c, f1);
-        tbuf2.read(tc, xm, (settings->star_45 ? yp : y));
-        madd_v3_v3fl(c, tc, f2);
-        tbuf2.read(tc, xp, (settings->star_45 ? ym : y));
-        madd_v3_v3fl(c, tc, f2);
-        c[3] = 1.0f;
-        tbuf2.write_pixel(x, y, c);
-      }
+  for (int i = 0; i < settings->iter && (!breaked); i++) {
+    /* Vertical (or diagonal) and horizontal (or anti-diagonal) streaks are independent. */
+    const int dx1 = settings->star_45 ? i : 0;
+    const int dy2 = settings->star_45 ? -i : 0;
+    for (const bool forward : {true, false}) {
+      threading::parallel_invoke([&]() { simple_star_pass(tbuf1, dx1, i, f1, f2, forward); },
+                                 [&]() { simple_star_pass(tbuf2, i, dy2, f1, f2, forward); });
       if (is_braked()) {
         breaked = true;
+        break;
       }
     }
   }
 
-  for (i = 0; i < this->get_width() * this->get_height() * 4; i++) {
-    data[i] = tbuf1.get_buffer()[i] + tbuf2.get_buffer()[i];
-  }
+  const int64_t size = int64_t(this->get_width()) * this->get_height() * 4;
+  threading::parallel_for(IndexRange(size), 1 << 16, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      data[i] = tbuf1.get_buffer()[i] + tbuf2.get_buffer()[i];
+    }
+  });
 }
 
 }  // namespace blender::compositor
@@ -79,6 +79,34 @@ void BaseImageOperation::init_execution()
   }
 }
 
+std::optional<size_t> BaseImageOperation::generate_result_hash(Span<size_t> /*input_hashes*/)
+{
+  size_t hash = get_default_hash_3(typeid(*this).hash_code(), image_, framenumber_);
+  combine_hashes(hash, get_default_hash(StringRef(view_name_ ? view_name_ : "")));
+  combine_hashes(hash, get_default_hash_4(canvas_.xmin, canvas_.xmax, canvas_.ymin, canvas_.ymax));
+
+  /* Images may be reloaded or painted at any time, identify them by their pixels. */
+  ImBuf *ibuf = get_im_buf();
+  if (ibuf) {
+    const size_t pixels_num = size_t(ibuf->x) * ibuf->y;
+    combine_hashes(hash, get_default_hash_4(ibuf->x, ibuf->y, ibuf->channels, ibuf->planes));
+    combine_hashes(hash,
+                   get_default_hash_2(ibuf->rect_colorspace, ibuf->float_colorspace));
+    if (ibuf->rect_float) {
+      combine_hashes(
+          hash, hash_buffer(ibuf->rect_float, sizeof(float) * ibuf->channels * pixels_num));
+    }
+    if (ibuf->rect) {
+      combine_hashes(hash, hash_buffer(ibuf->rect, sizeof(uint) * pixels_num));
+    }
+    if (ibuf->zbuf_float) {
+      combine_hashes(hash, hash_buffer(ibuf->zbuf_float, sizeof(float) * pixels_num));
+    }
+    BKE_image_release_ibuf(image_, ibuf, nullptr);
+  }
+  return hash;
+}
+
 void BaseImageOperation::deinit_execution()
 {
   image_float_buffer_ = nullptr;
@@ -46,6 +46,11 @@ class BaseImageOperation : public MultiThreadedOperation {
  public:
   void init_execution() override;
   void deinit_execution() override;
+  bool can_generate_result_hash() override
+  {
+    return true;
+  }
+  std::optional<size_t> generate_result_hash(Span<size_t> input_hashes) override;
   void set_image(Image *image)
   {
     image_ = image;
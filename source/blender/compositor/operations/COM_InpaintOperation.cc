@@ -3,6 +3,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "BLI_task.hh"
+
 #include "COM_InpaintOperation.h"
 
 namespace blender::compositor {
@@ -73,26 +75,6 @@ int InpaintSimpleOperation::mdist(int x, int y)
   return manhattan_distance_[y * width + x];
 }
 
-bool InpaintSimpleOperation::next_pixel(int &x, int &y, int &curr, int iters)
-{
-  int width = this->get_width();
-
-  if (curr >= area_size_) {
-    return false;
-  }
-
-  int r = pixelorder_[curr++];
-
-  x = r % width;
-  y = r / width;
-
-  if (this->mdist(x, y) > iters) {
-    return false;
-  }
-
-  return true;
-}
-
 void InpaintSimpleOperation::calc_manhattan_distance()
 {
   int width = this->get_width();
@@ -103,38 +85,41 @@ void InpaintSimpleOperation::calc_manhattan_distance()
   offsets = (int *)MEM_callocN(sizeof(int) * (width + height + 1),
                                "InpaintSimpleOperation offsets");
 
-  for (int j = 0; j < height; j++) {
-    for (int i = 0; i < width; i++) {
-      int r = 0;
-      /* no need to clamp here */
-      if (this->get_pixel(i, j)[3] < 1.0f) {
-        r = width + height;
-        if (i > 0) {
-          r = min_ii(r, m[j * width + i - 1] + 1);
+  /* Manhattan distance is separable: first find distances to known pixels within columns, then
+   * within rows from those. Columns and rows are independent. */
+  const int max_dist = width + height;
+  threading::parallel_for(IndexRange(width), 256, [&](const IndexRange columns) {
+    for (int j = 0; j < height; j++) {
+      for (const int i : columns) {
+        /* no need to clamp here */
+        if (this->get_pixel(i, j)[3] >= 1.0f) {
+          m[j * width + i] = 0;
         }
-        if (j > 0) {
-          r = min_ii(r, m[(j - 1) * width + i] + 1);
+        else {
+          m[j * width + i] = j > 0 ? min_ii(m[(j - 1) * width + i] + 1, max_dist) : max_dist;
         }
       }
-      m[j * width + i] = r;
     }
-  }
-
-  for (int j = height - 1; j >= 0; j--) {
-    for (int i = width - 1; i >= 0; i--) {
-      int r = m[j * width + i];
-
-      if (i + 1 < width) {
-        r = min_ii(r, m[j * width + i + 1] + 1);
+    for (int j = height - 2; j >= 0; j--) {
+      for (const int i : columns) {
+        m[j * width + i] = min_ii(m[j * width + i], m[(j + 1) * width + i] + 1);
       }
-      if (j + 1 < height) {
-        r = min_ii(r, m[(j + 1) * width + i] + 1);
+    }
+  });
+  threading::parallel_for(IndexRange(height), 16, [&](const IndexRange rows) {
+    for (const int j : rows) {
+      short *row = &m[j * width];
+      for (int i = 1; i < width; i++) {
+        row[i] = min_ii(row[i], row[i - 1] + 1);
+      }
+      for (int i = width - 2; i >= 0; i--) {
+        row[i] = min_ii(row[i], row[i + 1] + 1);
       }
-
-      m[j * width + i] = r;
-
-      offsets[r]++;
     }
+  });
+
+  for (int i = 0; i < width * height; i++) {
+    offsets[m[i]]++;
   }
 
   offsets[0] = 0;
@@ -197,6 +182,31 @@ void InpaintSimpleOperation::pix_step(int x, int y)
   }
 }
 
+void InpaintSimpleOperation::fill_unknown_pixels()
+{
+  const int width = this->get_width();
+
+  /* Pixels are ordered by distance, and only read pixels closer to known pixels, so pixels at
+   * the same distance are independent. */
+  int curr = 0;
+  while (curr < area_size_) {
+    const int dist = manhattan_distance_[pixelorder_[curr]];
+    if (dist > iterations_) {
+      break;
+    }
+    int end = curr + 1;
+    while (end < area_size_ && manhattan_distance_[pixelorder_[end]] == dist) {
+      end++;
+    }
+    threading::parallel_for(IndexRange(curr, end - curr), 1024, [&](const IndexRange range) {
+      for (const int i : range) {
+        this->pix_step(pixelorder_[i] % width, pixelorder_[i] / width);
+      }
+    });
+    curr = end;
+  }
+}
+
 void *InpaintSimpleOperation::initialize_tile_data(rcti *rect)
 {
   if (cached_buffer_ready_) {
@@ -209,12 +219,7 @@ void *InpaintSimpleOperation::initialize_tile_data(rcti *rect)
 
     this->calc_manhattan_distance();
 
-    int curr = 0;
-    int x, y;
-
-    while (this->next_pixel(x, y, curr, iterations_)) {
-      this->pix_step(x, y);
-    }
+    this->fill_unknown_pixels();
     cached_buffer_ready_ = true;
   }
 
@@ -293,11 +298,7 @@ void InpaintSimpleOperation::update_memory_buffer(MemoryBuffer *output,
 
     this->calc_manhattan_distance();
 
-    int curr = 0;
-    int x, y;
-    while (this->next_pixel(x, y, curr, iterations_)) {
-      this->pix_step(x, y);
-    }
+    this->fill_unknown_pixels();
     cached_buffer_ready_ = true;
   }
 
@@ -62,8 +62,9 @@ class InpaintSimpleOperation : public NodeOperation {
   void clamp_xy(int &x, int &y);
   float *get_pixel(int x, int y);
   int mdist(int x, int y);
-  bool next_pixel(int &x, int &y, int &curr, int iters);
   void pix_step(int x, int y);
+  /** Fill unknown pixels up to #iterations_ away from known ones, closest pixels first. */
+  void fill_unknown_pixels();
 };
 
 }  // namespace blender::compositor
@@ -16,6 +16,7 @@ MapRangeOperation::MapRangeOperation()
   input_operation_ = nullptr;
   use_clamp_ = false;
   flags_.can_be_constant = true;
+  flags_.is_pixel_operation = true;
 }
 
 void MapRangeOperation::init_execution()
@@ -11,6 +11,7 @@ MapValueOperation::MapValueOperation()
   this->add_output_socket(DataType::Value);
   input_operation_ = nullptr;
   flags_.can_be_constant = true;
+  flags_.is_pixel_operation = true;
 }
 
 void MapValueOperation::init_execution()
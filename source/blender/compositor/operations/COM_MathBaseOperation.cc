@@ -18,6 +18,7 @@ MathBaseOperation::MathBaseOperation()
   input_value3_operation_ = nullptr;
   use_clamp_ = false;
   flags_.can_be_constant = true;
+  flags_.is_pixel_operation = true;
 }
 
 void MathBaseOperation::init_execution()
@@ -1056,4 +1057,9 @@ void MathSmoothMaxOperation::update_memory_buffer_partial(BuffersIterator<float>
   }
 }
 
+void MathBaseOperation::hash_output_params()
+{
+  hash_param(use_clamp_);
+}
+
 }  // namespace blender::compositor
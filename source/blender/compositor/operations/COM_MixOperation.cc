@@ -19,6 +19,7 @@ MixBaseOperation::MixBaseOperation()
   this->set_use_value_alpha_multiply(false);
   this->set_use_clamp(false);
   flags_.can_be_constant = true;
+  flags_.is_pixel_operation = true;
 }
 
 void MixBaseOperation::init_execution()
@@ -1457,4 +1458,9 @@ void MixValueOperation::update_memory_buffer_row(PixelCursor &p)
   }
 }
 
+void MixBaseOperation::hash_output_params()
+{
+  hash_params(value_alpha_multiply_, use_clamp_);
+}
+
 }  // namespace blender::compositor
@@ -13,6 +13,7 @@ PosterizeOperation::PosterizeOperation()
   input_program_ = nullptr;
   input_steps_program_ = nullptr;
   flags_.can_be_constant = true;
+  flags_.is_pixel_operation = true;
 }
 
 void PosterizeOperation::init_execution()
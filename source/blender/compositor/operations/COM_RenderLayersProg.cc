@@ -21,6 +21,18 @@ RenderLayersProg::RenderLayersProg(const char *pass_name, DataType type, int ele
   this->add_output_socket(type);
 }
 
+float *RenderLayersProg::find_pass_buffer(RenderResult *rr)
+{
+  ViewLayer *view_layer = (ViewLayer *)BLI_findlink(&get_scene()->view_layers, get_layer_id());
+  if (view_layer) {
+    RenderLayer *rl = RE_GetRenderLayer(rr, view_layer->name);
+    if (rl) {
+      return RE_RenderLayerGetPass(rl, pass_name_.c_str(), view_name_);
+    }
+  }
+  return nullptr;
+}
+
 void RenderLayersProg::init_execution()
 {
   Scene *scene = this->get_scene();
@@ -32,16 +44,9 @@ void RenderLayersProg::init_execution()
   }
 
   if (rr) {
-    ViewLayer *view_layer = (ViewLayer *)BLI_findlink(&scene->view_layers, get_layer_id());
-    if (view_layer) {
-
-      RenderLayer *rl = RE_GetRenderLayer(rr, view_layer->name);
-      if (rl) {
-        input_buffer_ = RE_RenderLayerGetPass(rl, pass_name_.c_str(), view_name_);
-        if (input_buffer_) {
-          layer_buffer_ = new MemoryBuffer(input_buffer_, elementsize_, get_width(), get_height());
-        }
-      }
+    input_buffer_ = find_pass_buffer(rr);
+    if (input_buffer_) {
+      layer_buffer_ = new MemoryBuffer(input_buffer_, elementsize_, get_width(), get_height());
     }
   }
   if (re) {
@@ -50,6 +55,28 @@ void RenderLayersProg::init_execution()
   }
 }
 
+std::optional<size_t> RenderLayersProg::generate_result_hash(Span<size_t> /*input_hashes*/)
+{
+  size_t hash = get_default_hash_4(
+      typeid(*this).hash_code(), get_scene(), get_layer_id(), StringRef(pass_name_));
+  combine_hashes(hash, get_default_hash(StringRef(view_name_ ? view_name_ : "")));
+  combine_hashes(hash, get_default_hash_4(canvas_.xmin, canvas_.xmax, canvas_.ymin, canvas_.ymax));
+
+  /* The pass may be rendered again at any time, identify it by its pixels. */
+  Scene *scene = this->get_scene();
+  Render *re = (scene) ? RE_GetSceneRender(scene) : nullptr;
+  if (re) {
+    RenderResult *rr = RE_AcquireResultRead(re);
+    const float *buffer = rr ? find_pass_buffer(rr) : nullptr;
+    if (buffer) {
+      const size_t size = sizeof(float) * elementsize_ * rr->rectx * rr->recty;
+      combine_hashes(hash, hash_buffer(buffer, size));
+    }
+    RE_ReleaseResult(re);
+  }
+  return hash;
+}
+
 void RenderLayersProg::do_interpolation(float output[4], float x, float y, PixelSampler sampler)
 {
   uint offset;
@@ -70,6 +70,9 @@ class RenderLayersProg : public MultiThreadedOperation {
 
   void do_interpolation(float output[4], float x, float y, PixelSampler sampler);
 
+  /** Pixels of the pass in given render result, null when it doesn't exist. */
+  float *find_pass_buffer(RenderResult *rr);
+
  public:
   /**
    * Constructor
@@ -114,6 +117,12 @@ class RenderLayersProg : public MultiThreadedOperation {
 
   std::unique_ptr<MetaData> get_meta_data() override;
 
+  bool can_generate_result_hash() override
+  {
+    return true;
+  }
+  std::optional<size_t> generate_result_hash(Span<size_t> input_hashes) override;
+
   virtual void update_memory_buffer_partial(MemoryBuffer *output,
                                             const rcti &area,
                                             Span<MemoryBuffer *> inputs) override;
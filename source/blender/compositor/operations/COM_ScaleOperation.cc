@@ -116,6 +116,11 @@ void ScaleOperation::deinit_execution()
   input_yoperation_ = nullptr;
 }
 
+void ScaleOperation::hash_output_params()
+{
+  hash_params(sampler_, variable_size_);
+}
+
 void ScaleOperation::get_scale_offset(const rcti &input_canvas,
                                       const rcti &scale_canvas,
                                       float &r_scale_offset_x,
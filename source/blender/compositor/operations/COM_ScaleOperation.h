@@ -93,6 +93,8 @@ class ScaleOperation : public BaseScaleOperation {
   void determine_canvas(const rcti &preferred_area, rcti &r_area) override;
 
  protected:
+  void hash_output_params() override;
+
   virtual float get_relative_scale_x_factor(float width) = 0;
   virtual float get_relative_scale_y_factor(float height) = 0;
 
@@ -92,6 +92,12 @@ void TranslateOperation::set_wrapping(int wrapping_type)
   }
 }
 
+void TranslateOperation::hash_output_params()
+{
+  hash_params(factor_x_, factor_y_);
+  hash_params(x_extend_mode_, y_extend_mode_);
+}
+
 void TranslateOperation::get_area_of_interest(const int input_idx,
                                               const rcti &output_area,
                                               rcti &r_input_area)
@@ -420,6 +420,12 @@ void VariableSizeBokehBlurOperation::update_memory_buffer_partial(MemoryBuffer *
   }
 }
 
+void VariableSizeBokehBlurOperation::hash_output_params()
+{
+  hash_params(max_blur_, threshold_);
+  hash_param(do_size_scale_);
+}
+
 #ifdef COM_DEFOCUS_SEARCH
 /* #InverseSearchRadiusOperation. */
 InverseSearchRadiusOperation::InverseSearchRadiusOperation()
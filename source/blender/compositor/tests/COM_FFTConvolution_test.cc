@@ -0,0 +1,113 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include "testing/testing.h"
+
+#include "BLI_array.hh"
+#include "BLI_rand.hh"
+
+#include "COM_FFTConvolution.h"
+#include "COM_MemoryBuffer.h"
+
+namespace blender::compositor::tests {
+
+static void direct_convolve(const MemoryBuffer &input,
+                            const ConvolutionKernel &kernel,
+                            const int x,
+                            const int y,
+                            const bool normalize,
+                            float r_color[4])
+{
+  const rcti &rect = input.get_rect();
+  for (int c = 0; c < COM_DATA_TYPE_COLOR_CHANNELS; c++) {
+    double sum = 0.0;
+    double weight_sum = 0.0;
+    for (int j = 0; j < kernel.height; j++) {
+      for (int i = 0; i < kernel.width; i++) {
+        const int src_x = x + i - kernel.center_x;
+        const int src_y = y + j - kernel.center_y;
+        if (src_x < rect.xmin || src_x >= rect.xmax || src_y < rect.ymin || src_y >= rect.ymax) {
+          continue;
+        }
+        const float weight =
+            kernel.data[(j * kernel.width + i) * kernel.channels + (kernel.channels == 1 ? 0 : c)];
+        sum += weight * input.get_elem(src_x, src_y)[c];
+        weight_sum += weight;
+      }
+    }
+    r_color[c] = normalize ? (weight_sum > 0.0 ? sum / weight_sum : 0.0) : sum;
+  }
+}
+
+static void test_convolution(const int kernel_channels,
+                             const bool normalize,
+                             const int channels_num = COM_DATA_TYPE_COLOR_CHANNELS)
+{
+  RandomNumberGenerator rng(kernel_channels);
+
+  rcti input_rect;
+  BLI_rcti_init(&input_rect, 3, 160, 5, 90);
+  MemoryBuffer input(DataType::Color, input_rect);
+  for (int y = input_rect.ymin; y < input_rect.ymax; y++) {
+    for (int x = input_rect.xmin; x < input_rect.xmax; x++) {
+      for (int c = 0; c < COM_DATA_TYPE_COLOR_CHANNELS; c++) {
+        input.get_elem(x, y)[c] = rng.get_float();
+      }
+    }
+  }
+
+  Array<float> kernel_data(37 * 29 * kernel_channels);
+  for (float &weight : kernel_data) {
+    weight = rng.get_float();
+  }
+  ConvolutionKernel kernel;
+  kernel.data = kernel_data;
+  kernel.width = 37;
+  kernel.height = 29;
+  kernel.channels = kernel_channels;
+  kernel.center_x = 20;
+  kernel.center_y = 9;
+
+  /* Area extends beyond the input on all sides. */
+  rcti area;
+  BLI_rcti_init(&area, 0, 170, 0, 100);
+  MemoryBuffer output(DataType::Color, area);
+  fft_convolve(input, kernel, output, area, normalize, channels_num);
+
+  const float tolerance = normalize ? 1e-4f : 1e-2f;
+  for (int y = area.ymin; y < area.ymax; y++) {
+    for (int x = area.xmin; x < area.xmax; x++) {
+      float expected[4];
+      direct_convolve(input, kernel, x, y, normalize, expected);
+      for (int c = channels_num; c < COM_DATA_TYPE_COLOR_CHANNELS; c++) {
+        expected[c] = 0.0f;
+      }
+      EXPECT_V4_NEAR(output.get_elem(x, y), expected, tolerance);
+    }
+  }
+
+  fft_convolution_free_cache();
+}
+
+TEST(FFTConvolution, SingleChannelKernel)
+{
+  test_convolution(1, false);
+}
+
+TEST(FFTConvolution, ColorKernel)
+{
+  test_convolution(4, false);
+}
+
+TEST(FFTConvolution, Normalized)
+{
+  test_convolution(1, true);
+  test_convolution(4, true);
+}
+
+TEST(FFTConvolution, ColorChannelsOnly)
+{
+  test_convolution(1, false, 3);
+  test_convolution(4, true, 3);
+}
+
+}  // namespace blender::compositor::tests
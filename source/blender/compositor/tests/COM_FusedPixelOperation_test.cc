@@ -0,0 +1,220 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include "testing/testing.h"
+
+#include "BLI_rand.hh"
+
+#include "COM_CompositorContext.h"
+#include "COM_ConvertOperation.h"
+#include "COM_FusedPixelOperation.h"
+#include "COM_GammaCorrectOperation.h"
+#include "COM_MathBaseOperation.h"
+#include "COM_MixOperation.h"
+#include "COM_NodeOperationBuilder.h"
+#include "COM_SetColorOperation.h"
+#include "COM_SetValueOperation.h"
+
+namespace blender::compositor::tests {
+
+class FusedPixelOperationTest : public testing::Test {
+ protected:
+  /** Evaluates operations directly, like the execution model does for every thread. */
+  static void evaluate(NodeOperation *op,
+                       MemoryBuffer *output,
+                       const rcti &area,
+                       Span<MemoryBuffer *> inputs)
+  {
+    static_cast<MultiThreadedOperation *>(op)->update_memory_buffer_partial(output, area, inputs);
+  }
+
+  static void fuse_pixel_operations(NodeOperationBuilder &builder)
+  {
+    builder.fuse_pixel_operations();
+  }
+};
+
+/**
+ * Mix -> gamma -> convert -> math, the math operation also reads a constant. Operations are
+ * added to and linked by \a builder when given.
+ */
+static Vector<NodeOperation *> pixel_operations_new(const rcti &canvas,
+                                                    NodeOperationBuilder *builder = nullptr)
+{
+  MixBaseOperation *mix = new MixAddOperation();
+  GammaCorrectOperation *gamma = new GammaCorrectOperation();
+  ConvertColorToValueOperation *convert = new ConvertColorToValueOperation();
+  MathBaseOperation *math = new MathMultiplyOperation();
+
+  Vector<NodeOperation *> operations = {mix, gamma, convert, math};
+  for (const int i : operations.index_range()) {
+    operations[i]->set_canvas(canvas);
+    if (builder) {
+      builder->add_operation(operations[i]);
+    }
+    if (i == 0) {
+      continue;
+    }
+    NodeOperationOutput *from = operations[i - 1]->get_output_socket();
+    NodeOperationInput *to = operations[i]->get_input_socket(0);
+    if (builder) {
+      builder->add_link(from, to);
+    }
+    else {
+      to->set_link(from);
+    }
+  }
+  return operations;
+}
+
+static void fill_random(MemoryBuffer &buffer, RandomNumberGenerator &rng)
+{
+  for (BuffersIterator<float> it = buffer.iterate_with({}); !it.is_end(); ++it) {
+    for (int c = 0; c < buffer.get_num_channels(); c++) {
+      it.out[c] = rng.get_float() * 2.0f - 0.5f;
+    }
+  }
+}
+
+TEST_F(FusedPixelOperationTest, matches_separate_operations)
+{
+  RandomNumberGenerator rng(42);
+
+  /* Wider than a chunk so rows are split, starting at an offset. */
+  rcti canvas;
+  BLI_rcti_init(&canvas, 7, 2500, 3, 9);
+  rcti area;
+  BLI_rcti_init(&area, 10, 2400, 4, 9);
+
+  MemoryBuffer mix_value(DataType::Value, canvas);
+  MemoryBuffer mix_color1(DataType::Color, canvas);
+  MemoryBuffer mix_color2(DataType::Color, canvas);
+  MemoryBuffer math_value2(DataType::Value, canvas, true);
+  MemoryBuffer math_value3(DataType::Value, canvas, true);
+  fill_random(mix_value, rng);
+  fill_random(mix_color1, rng);
+  fill_random(mix_color2, rng);
+  *math_value2.get_buffer() = 0.75f;
+  *math_value3.get_buffer() = 0.0f;
+
+  /* Evaluate every operation separately into full buffers. */
+  Vector<NodeOperation *> operations = pixel_operations_new(canvas);
+  MemoryBuffer mix_result(DataType::Color, canvas);
+  MemoryBuffer gamma_result(DataType::Color, canvas);
+  MemoryBuffer convert_result(DataType::Value, canvas);
+  MemoryBuffer expected(DataType::Value, canvas);
+  evaluate(operations[0], &mix_result, area, {&mix_value, &mix_color1, &mix_color2});
+  evaluate(operations[1], &gamma_result, area, {&mix_result});
+  evaluate(operations[2], &convert_result, area, {&gamma_result});
+  evaluate(operations[3], &expected, area, {&convert_result, &math_value2, &math_value3});
+  for (NodeOperation *op : operations) {
+    delete op;
+  }
+
+  /* Inputs not written by fused operations become inputs of the fused operation. */
+  FusedPixelOperation fused_op(pixel_operations_new(canvas));
+  ASSERT_EQ(fused_op.get_number_of_input_sockets(), 5);
+  EXPECT_EQ(fused_op.get_output_socket()->get_data_type(), DataType::Value);
+
+  MemoryBuffer result(DataType::Value, canvas);
+  evaluate(
+      &fused_op, &result, area, {&mix_value, &mix_color1, &mix_color2, &math_value2, &math_value3});
+
+  for (int y = area.ymin; y < area.ymax; y++) {
+    for (int x = area.xmin; x < area.xmax; x++) {
+      ASSERT_EQ(*result.get_elem(x, y), *expected.get_elem(x, y)) << "x: " << x << ", y: " << y;
+    }
+  }
+}
+
+TEST_F(FusedPixelOperationTest, builder_fuses_pixel_operations)
+{
+  RandomNumberGenerator rng(7);
+
+  rcti canvas;
+  BLI_rcti_init(&canvas, 0, 300, 0, 4);
+
+  bNodeTree node_tree = {};
+  CompositorContext context;
+  context.set_bnodetree(&node_tree);
+  NodeOperationBuilder builder(&context, &node_tree, nullptr);
+
+  /* Inputs are constant operations, which are not pixel operations and are not fused. */
+  Vector<NodeOperation *> inputs = {new SetValueOperation(),
+                                    new SetColorOperation(),
+                                    new SetColorOperation(),
+                                    new SetValueOperation(),
+                                    new SetValueOperation()};
+  Map<NodeOperation *, MemoryBuffer *> input_buffers;
+  for (NodeOperation *op : inputs) {
+    op->set_canvas(canvas);
+    MemoryBuffer *buffer = new MemoryBuffer(op->get_output_socket()->get_data_type(), canvas);
+    fill_random(*buffer, rng);
+    input_buffers.add_new(op, buffer);
+    builder.add_operation(op);
+  }
+  Vector<NodeOperation *> chain = pixel_operations_new(canvas, &builder);
+  NodeOperation *mix = chain[0];
+  NodeOperation *math = chain[3];
+  for (const int i : IndexRange(3)) {
+    builder.add_link(inputs[i]->get_output_socket(), mix->get_input_socket(i));
+  }
+  for (const int i : IndexRange(1, 2)) {
+    builder.add_link(inputs[i + 2]->get_output_socket(), math->get_input_socket(i));
+  }
+
+  /* Evaluate the operations separately before they are fused. */
+  MemoryBuffer mix_result(DataType::Color, canvas);
+  MemoryBuffer gamma_result(DataType::Color, canvas);
+  MemoryBuffer convert_result(DataType::Value, canvas);
+  MemoryBuffer expected(DataType::Value, canvas);
+  evaluate(mix,
+           &mix_result,
+           canvas,
+           {input_buffers.lookup(inputs[0]),
+            input_buffers.lookup(inputs[1]),
+            input_buffers.lookup(inputs[2])});
+  evaluate(chain[1], &gamma_result, canvas, {&mix_result});
+  evaluate(chain[2], &convert_result, canvas, {&gamma_result});
+  evaluate(math,
+           &expected,
+           canvas,
+           {&convert_result, input_buffers.lookup(inputs[3]), input_buffers.lookup(inputs[4])});
+
+  fuse_pixel_operations(builder);
+
+  /* The chain is replaced by a single operation reading all inputs. */
+  Span<NodeOperation *> operations = builder.get_operations();
+  ASSERT_EQ(operations.size(), inputs.size() + 1);
+  for (NodeOperation *op : chain) {
+    EXPECT_FALSE(operations.contains(op));
+  }
+  FusedPixelOperation *fused_op = dynamic_cast<FusedPixelOperation *>(operations.last());
+  ASSERT_NE(fused_op, nullptr);
+  ASSERT_EQ(fused_op->get_number_of_input_sockets(), inputs.size());
+  EXPECT_EQ(builder.get_links().size(), inputs.size());
+  for (const NodeOperationBuilder::Link &link : builder.get_links()) {
+    EXPECT_EQ(&link.to()->get_operation(), fused_op);
+    EXPECT_TRUE(inputs.contains(&link.from()->get_operation()));
+  }
+
+  Vector<MemoryBuffer *> fused_input_buffers;
+  for (const int i : IndexRange(fused_op->get_number_of_input_sockets())) {
+    fused_input_buffers.append(input_buffers.lookup(fused_op->get_input_operation(i)));
+  }
+  MemoryBuffer result(DataType::Value, canvas);
+  evaluate(fused_op, &result, canvas, fused_input_buffers);
+  for (int y = canvas.ymin; y < canvas.ymax; y++) {
+    for (int x = canvas.xmin; x < canvas.xmax; x++) {
+      ASSERT_EQ(*result.get_elem(x, y), *expected.get_elem(x, y)) << "x: " << x << ", y: " << y;
+    }
+  }
+
+  for (MemoryBuffer *buffer : input_buffers.values()) {
+    delete buffer;
+  }
+  for (NodeOperation *op : operations) {
+    delete op;
+  }
+}
+
+}  // namespace blender::compositor::tests
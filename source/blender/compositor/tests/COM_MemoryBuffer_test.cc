@@ -0,0 +1,87 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include "testing/testing.h"
+
+#include <cmath>
+#include <limits>
+
+#include "COM_MemoryBuffer.h"
+
+namespace blender::compositor::tests {
+
+/** Pack and unpack a single row buffer containing \a values. */
+static Vector<float> pack_and_unpack(Span<float> values)
+{
+  rcti rect;
+  BLI_rcti_init(&rect, 0, values.size(), 0, 1);
+  MemoryBuffer buf(DataType::Value, rect);
+  for (const int i : values.index_range()) {
+    *buf.get_elem(i, 0) = values[i];
+  }
+
+  buf.pack_half();
+  EXPECT_TRUE(buf.is_packed());
+  EXPECT_EQ(buf.get_buffer(), nullptr);
+  buf.unpack_half();
+  EXPECT_FALSE(buf.is_packed());
+
+  Vector<float> result;
+  for (const int i : values.index_range()) {
+    result.append(*buf.get_elem(i, 0));
+  }
+  return result;
+}
+
+TEST(MemoryBuffer, pack_half_exact)
+{
+  /* Values representable in half float precision. */
+  const Vector<float> values = {
+      0.0f, -0.0f, 1.0f, -2.5f, 0.5f, 1024.0f, 65504.0f, -65504.0f, 0.000061035156f};
+  const Vector<float> result = pack_and_unpack(values);
+  for (const int i : values.index_range()) {
+    EXPECT_EQ(result[i], values[i]);
+    EXPECT_EQ(std::signbit(result[i]), std::signbit(values[i]));
+  }
+}
+
+TEST(MemoryBuffer, pack_half_rounding)
+{
+  Vector<float> values;
+  for (int i = 0; i < 1000; i++) {
+    values.append((i - 500) * 0.1234567f);
+  }
+  const Vector<float> result = pack_and_unpack(values);
+  for (const int i : values.index_range()) {
+    /* Half floats have 11 significant bits. */
+    EXPECT_NEAR(result[i], values[i], std::abs(values[i]) * (1.0f / 2048.0f));
+  }
+
+  /* Ties round to even. */
+  EXPECT_EQ(pack_and_unpack({1.0f + 1.0f / 2048.0f})[0], 1.0f);
+  EXPECT_EQ(pack_and_unpack({1.0f + 3.0f / 2048.0f})[0], 1.0f + 2.0f / 1024.0f);
+}
+
+TEST(MemoryBuffer, pack_half_special_values)
+{
+  const float infinity = std::numeric_limits<float>::infinity();
+  const Vector<float> result = pack_and_unpack({1e10f,
+                                                -1e10f,
+                                                65530.0f,
+                                                infinity,
+                                                -infinity,
+                                                std::numeric_limits<float>::quiet_NaN(),
+                                                1e-6f,
+                                                1e-9f});
+  /* Finite values are clamped. */
+  EXPECT_EQ(result[0], 65504.0f);
+  EXPECT_EQ(result[1], -65504.0f);
+  EXPECT_EQ(result[2], 65504.0f);
+  EXPECT_EQ(result[3], infinity);
+  EXPECT_EQ(result[4], -infinity);
+  EXPECT_TRUE(std::isnan(result[5]));
+  /* Sub-normal half floats. */
+  EXPECT_NEAR(result[6], 1e-6f, 1e-7f);
+  EXPECT_EQ(result[7], 0.0f);
+}
+
+}  // namespace blender::compositor::tests
@@ -151,4 +151,33 @@ TEST(NodeOperation, generate_hash)
   }
 }
 
+TEST(NodeOperation, generate_result_hash)
+{
+  NonHashedConstantOperation input_op1(1);
+  NonHashedConstantOperation input_op2(2);
+  std::optional<size_t> input_hash1 = input_op1.generate_result_hash({});
+  std::optional<size_t> input_hash2 = input_op2.generate_result_hash({});
+  EXPECT_NE(input_hash1, std::nullopt);
+  /* Results of constants only depend on their value, not on the operation. */
+  EXPECT_EQ(input_hash1, input_hash2);
+  input_op2.set_constant(3.0f);
+  input_hash2 = input_op2.generate_result_hash({});
+  EXPECT_NE(input_hash1, input_hash2);
+
+  HashedOperation op1(input_op1, 6, 4);
+  HashedOperation op2(input_op2, 6, 4);
+  const size_t hash1 = *op1.generate_result_hash({*input_hash1});
+  EXPECT_EQ(hash1, *op2.generate_result_hash({*input_hash1}));
+  EXPECT_NE(hash1, *op2.generate_result_hash({*input_hash2}));
+  op2.set_param1(-1);
+  EXPECT_NE(hash1, *op2.generate_result_hash({*input_hash1}));
+
+  EXPECT_TRUE(input_op1.can_generate_result_hash());
+  EXPECT_TRUE(op1.can_generate_result_hash());
+
+  NonHashedOperation non_hashed_op(3);
+  EXPECT_FALSE(non_hashed_op.can_generate_result_hash());
+  EXPECT_EQ(non_hashed_op.generate_result_hash({}), std::nullopt);
+}
+
 }  // namespace blender::compositor::tests
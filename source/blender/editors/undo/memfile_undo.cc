@@ -83,12 +83,32 @@ static bool memfile_undosys_step_encode(struct bContext * /*C*/,
     ED_editors_flush_edits_ex(bmain, false, true);
   }
 
+  /* Apply background compression of older steps which finished in the mean time,
+   * so the undo memory limit uses their compressed size. */
+  LISTBASE_FOREACH (UndoStep *, us_iter, &ustack->steps) {
+    if (us_iter == us_p || us_iter->type != BKE_UNDOSYS_TYPE_MEMFILE) {
+      continue;
+    }
+    MemFileUndoData *mfu = ((MemFileUndoStep *)us_iter)->data;
+    if (mfu != nullptr) {
+      BLO_memfile_compress_update(&mfu->memfile, false);
+      mfu->undo_size = mfu->memfile.size;
+      us_iter->data_size = mfu->undo_size;
+    }
+  }
+
   /* can be null, use when set. */
   MemFileUndoStep *us_prev = (MemFileUndoStep *)BKE_undosys_step_find_by_type(
       ustack, BKE_UNDOSYS_TYPE_MEMFILE);
   us->data = BKE_memfile_undo_encode(bmain, us_prev ? us_prev->data : nullptr);
   us->step.data_size = us->data->undo_size;
 
+  /* The previous step isn't the last one anymore, the chunks it doesn't share with the new step
+   * are unlikely to be used soon. */
+  if (us_prev != nullptr) {
+    BLO_memfile_compress_begin(&us_prev->data->memfile);
+  }
+
   /* Store the fact that we should not re-use old data with that undo step, and reset the Main
    * flag. */
   us->step.use_old_bmain_data = !bmain->use_memfile_full_barrier;
@@ -489,6 +489,12 @@ Vector<GVArray> evaluate_fields(ResourceScope &scope,
                                 const FieldContext &context,
                                 Span<GVMutableArray> dst_varrays = {});
 
+/**
+ * Number of elements that fields have been evaluated on by the calling thread so far. Used to
+ * attribute field evaluation to the node that caused it when profiling.
+ */
+int64_t evaluated_field_elements_num();
+
 /* -------------------------------------------------------------------- */
 /** \name Utility functions for simple field creation and evaluation
  * \{ */
@@ -9,6 +9,8 @@
  * another #Graph again).
  */
 
+#include <chrono>
+
 #include "BLI_vector.hh"
 #include "BLI_vector_set.hh"
 
@@ -35,6 +37,13 @@ class GraphExecutorLogger {
                                       const Params &params,
                                       const Context &context) const;
 
+  /**
+   * Called when a thread had to wait for another thread to get access to the state of a node.
+   */
+  virtual void log_node_wait(const Node &node,
+                             std::chrono::nanoseconds wait_time,
+                             const Context &context) const;
+
   virtual void dump_when_outputs_are_missing(const FunctionNode &node,
                                              Span<const OutputSocket *> missing_sockets,
                                              const Context &context) const;
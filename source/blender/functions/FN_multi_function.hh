@@ -138,6 +138,15 @@ class MultiFunction {
   virtual ExecutionHints get_execution_hints() const;
 };
 
+/**
+ * Add the parameters in \a full_params to \a r_sliced_params, so that index 0 of the sliced
+ * parameters references the start of \a slice_range. Vector parameters are not supported.
+ */
+void add_sliced_parameters(const Signature &signature,
+                           Params &full_params,
+                           IndexRange slice_range,
+                           ParamsBuilder &r_sliced_params);
+
 inline ParamsBuilder::ParamsBuilder(const MultiFunction &fn, int64_t mask_size)
     : ParamsBuilder(fn.signature(), IndexMask(mask_size))
 {
@@ -10,11 +10,19 @@
 
 namespace blender::fn::multi_function {
 
-/** A multi-function that executes a procedure internally. */
+/**
+ * A multi-function that executes a procedure internally.
+ *
+ * Every instruction is executed for all indices before moving on to the next one. To keep
+ * intermediate variables in the CPU cache, large masks are split into chunks for which the entire
+ * procedure is executed separately. Chunks are executed in parallel.
+ */
 class ProcedureExecutor : public MultiFunction {
  private:
   Signature signature_;
   const Procedure &procedure_;
+  /** Vector parameters can't be sliced, so procedures using them are executed at once. */
+  bool supports_chunks_;
 
  public:
   ProcedureExecutor(const Procedure &procedure);
@@ -22,6 +30,7 @@ class ProcedureExecutor : public MultiFunction {
   void call(IndexMask mask, Params params, Context context) const override;
 
  private:
+  void execute(IndexMask full_mask, Params params, const Context &context) const;
   ExecutionHints get_execution_hints() const override;
 };
 
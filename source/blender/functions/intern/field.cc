@@ -277,12 +277,21 @@ static void build_multi_function_procedure_for_fields(mf::Procedure &procedure,
   BLI_assert(procedure.validate());
 }
 
+static thread_local int64_t thread_evaluated_elements_num = 0;
+
+int64_t evaluated_field_elements_num()
+{
+  return thread_evaluated_elements_num;
+}
+
 Vector<GVArray> evaluate_fields(ResourceScope &scope,
                                 Span<GFieldRef> fields_to_evaluate,
                                 IndexMask mask,
                                 const FieldContext &context,
                                 Span<GVMutableArray> dst_varrays)
 {
+  thread_evaluated_elements_num += mask.size();
+
   Vector<GVArray> r_varrays(fields_to_evaluate.size());
   Array<bool> is_output_written_to_dst(fields_to_evaluate.size(), false);
   const int array_size = mask.min_array_size();
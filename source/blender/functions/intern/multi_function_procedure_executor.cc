@@ -3,15 +3,26 @@
 #include "FN_multi_function_procedure_executor.hh"
 
 #include "BLI_stack.hh"
+#include "BLI_task.hh"
 
 namespace blender::fn::multi_function {
 
+/**
+ * Number of indices the procedure is executed for at once. Intermediate variables of this size
+ * generally stay in the CPU cache while they are passed between instructions.
+ */
+static constexpr int64_t procedure_chunk_size = 4096;
+
 ProcedureExecutor::ProcedureExecutor(const Procedure &procedure) : procedure_(procedure)
 {
   SignatureBuilder builder("Procedure Executor", signature_);
 
+  supports_chunks_ = true;
   for (const ConstParameter &param : procedure.params()) {
     builder.add("Parameter", ParamType(param.type, param.variable->data_type()));
+    if (param.variable->data_type().is_vector()) {
+      supports_chunks_ = false;
+    }
   }
 
   this->set_signature(&signature_);
@@ -1170,6 +1181,36 @@ class InstructionScheduler {
 };
 
 void ProcedureExecutor::call(IndexMask full_mask, Params params, Context context) const
+{
+  if (full_mask.size() <= procedure_chunk_size || !supports_chunks_) {
+    this->execute(full_mask, params, context);
+    return;
+  }
+
+  const int64_t chunks_num = (full_mask.size() + procedure_chunk_size - 1) /
+                             procedure_chunk_size;
+  threading::parallel_for(IndexRange(chunks_num), 1, [&](const IndexRange chunks) {
+    for (const int64_t chunk : chunks) {
+      const int64_t start = chunk * procedure_chunk_size;
+      const IndexRange sub_range{start,
+                                 std::min(procedure_chunk_size, full_mask.size() - start)};
+      const IndexMask sliced_mask = full_mask.slice(sub_range);
+      const int64_t input_slice_start = sliced_mask[0];
+      const int64_t input_slice_size = sliced_mask.last() - input_slice_start + 1;
+      const IndexRange input_slice_range{input_slice_start, input_slice_size};
+
+      /* Offset indices so that variables only have to be allocated for the chunk. */
+      Vector<int64_t> offset_mask_indices;
+      const IndexMask offset_mask = full_mask.slice_and_offset(sub_range, offset_mask_indices);
+
+      ParamsBuilder sliced_params{*this, offset_mask.min_array_size()};
+      add_sliced_parameters(signature_, params, input_slice_range, sliced_params);
+      this->execute(offset_mask, sliced_params, context);
+    }
+  });
+}
+
+void ProcedureExecutor::execute(IndexMask full_mask, Params params, const Context &context) const
 {
   BLI_assert(procedure_.validate());
 
@@ -1256,7 +1297,8 @@ void ProcedureExecutor::call(IndexMask full_mask, Params params, Context context
 MultiFunction::ExecutionHints ProcedureExecutor::get_execution_hints() const
 {
   ExecutionHints hints;
-  hints.allocates_array = true;
+  /* Large masks are split up already, see #call. */
+  hints.allocates_array = !supports_chunks_;
   hints.min_grain_size = 10000;
   return hints;
 }
@@ -6,7 +6,9 @@
 #include "FN_lazy_function_graph.hh"
 #include "FN_lazy_function_graph_executor.hh"
 
+#include "BLI_lazy_threading.hh"
 #include "BLI_task.h"
+#include "BLI_task.hh"
 #include "BLI_timeit.hh"
 
 namespace blender::fn::lazy_function::tests {
@@ -176,4 +178,152 @@ TEST(lazy_function, GraphWithCycle)
   EXPECT_EQ(result, 10 * 2 * 5);
 }
 
+/**
+ * Passes its input to many outputs, which are set from multiple threads.
+ */
+class ParallelFanOutFunction : public LazyFunction {
+ public:
+  ParallelFanOutFunction(const int outputs_num)
+  {
+    debug_name_ = "Parallel Fan Out";
+    inputs_.append({"Value", CPPType::get<int>()});
+    for ([[maybe_unused]] const int i : IndexRange(outputs_num)) {
+      outputs_.append({"Value", CPPType::get<int>()});
+    }
+  }
+
+  void execute_impl(Params &params, const Context & /*context*/) const override
+  {
+    const int value = params.get_input<int>(0);
+    params.try_enable_multi_threading();
+    threading::parallel_for(outputs_.index_range(), 16, [&](const IndexRange range) {
+      for (const int i : range) {
+        params.set_output(i, value);
+      }
+    });
+  }
+};
+
+/**
+ * Like #AddLazyFunction, but tells the executor that it takes a while, to move other scheduled
+ * nodes to other threads.
+ */
+class AddWithHintFunction : public AddLazyFunction {
+ public:
+  void execute_impl(Params &params, const Context &context) const override
+  {
+    lazy_threading::send_hint();
+    AddLazyFunction::execute_impl(params, context);
+  }
+};
+
+/**
+ * Build a wide graph with many cheap nodes: the graph input is passed to \a width branches that
+ * add one \a depth times each, whose results are summed up again.
+ */
+static void build_wide_graph(Graph &graph,
+                             const int width,
+                             const int depth,
+                             const LazyFunction &fan_out_fn,
+                             const LazyFunction &add_fn,
+                             const LazyFunction &add_with_hint_fn,
+                             DummyNode *&r_input_node,
+                             DummyNode *&r_output_node)
+{
+  static const int value_1 = 1;
+  static const int value_0 = 0;
+
+  r_input_node = &graph.add_dummy({}, {&CPPType::get<int>()});
+  r_output_node = &graph.add_dummy({&CPPType::get<int>()}, {});
+  FunctionNode &fan_out_node = graph.add_function(fan_out_fn);
+  graph.add_link(r_input_node->output(0), fan_out_node.input(0));
+
+  Vector<OutputSocket *> branch_outputs;
+  for (const int branch : IndexRange(width)) {
+    OutputSocket *previous_output = &fan_out_node.output(branch);
+    for (const int i : IndexRange(depth)) {
+      /* Send hints from some nodes, so that nodes are moved between threads while others are
+       * still scheduling nodes. */
+      const bool use_hint = i == 0 && branch % 8 == 0;
+      FunctionNode &add_node = graph.add_function(use_hint ? add_with_hint_fn : add_fn);
+      graph.add_link(*previous_output, add_node.input(0));
+      add_node.input(1).set_default_value(&value_1);
+      previous_output = &add_node.output(0);
+    }
+    branch_outputs.append(previous_output);
+  }
+
+  /* Sum the results of all branches in a balanced tree. */
+  while (branch_outputs.size() > 1) {
+    Vector<OutputSocket *> sums;
+    for (int64_t i = 0; i < branch_outputs.size(); i += 2) {
+      FunctionNode &add_node = graph.add_function(add_fn);
+      graph.add_link(*branch_outputs[i], add_node.input(0));
+      if (i + 1 < branch_outputs.size()) {
+        graph.add_link(*branch_outputs[i + 1], add_node.input(1));
+      }
+      else {
+        add_node.input(1).set_default_value(&value_0);
+      }
+      sums.append(&add_node.output(0));
+    }
+    branch_outputs = std::move(sums);
+  }
+  graph.add_link(*branch_outputs[0], r_output_node->input(0));
+
+  graph.update_node_indices();
+}
+
+static int evaluate_wide_graph(const int width, const int depth, const int input)
+{
+  const ParallelFanOutFunction fan_out_fn{width};
+  const AddLazyFunction add_fn;
+  const AddWithHintFunction add_with_hint_fn;
+
+  Graph graph;
+  DummyNode *input_node;
+  DummyNode *output_node;
+  build_wide_graph(
+      graph, width, depth, fan_out_fn, add_fn, add_with_hint_fn, input_node, output_node);
+
+  GraphExecutor executor_fn{
+      graph, {&input_node->output(0)}, {&output_node->input(0)}, nullptr, nullptr};
+  int result = 0;
+  execute_lazy_function_eagerly(
+      executor_fn, nullptr, std::make_tuple(input), std::make_tuple(&result));
+  return result;
+}
+
+TEST(lazy_function, WideGraphMultiThreaded)
+{
+  BLI_task_scheduler_init();
+  const int width = 1000;
+  const int depth = 5;
+  /* Evaluate multiple times, because issues with thread synchronization may not show up every
+   * time. */
+  for (const int input : IndexRange(20)) {
+    EXPECT_EQ(evaluate_wide_graph(width, depth, input), width * (input + depth));
+  }
+}
+
+/**
+ * Set this to 1 to activate the benchmark. It is disabled by default, because it prints a lot.
+ * To compare scheduling changes in the executor, run it in builds before and after the change,
+ * and with different values of `OFFLOAD_SCHEDULED_NODES_MIN`.
+ */
+#if 0
+TEST(lazy_function, WideGraphBenchmark)
+{
+  BLI_task_scheduler_init();
+  for (const int width : {1000, 10000, 100000}) {
+    for (const int depth : {1, 10}) {
+      for ([[maybe_unused]] const int i : IndexRange(3)) {
+        SCOPED_TIMER("Width: " + std::to_string(width) + ", Depth: " + std::to_string(depth));
+        EXPECT_EQ(evaluate_wide_graph(width, depth, 0), width * depth);
+      }
+    }
+  }
+}
+#endif /* Benchmark */
+
 }  // namespace blender::fn::lazy_function::tests
@@ -408,4 +408,78 @@ TEST(multi_function_procedure, OutputBufferReplaced)
   EXPECT_EQ(output[2], output_value);
 }
 
+TEST(multi_function_procedure, LargeMask)
+{
+  /**
+   * procedure(int var1, int &var2, bool var3, int *var4) {
+   *   if (var3) {
+   *     var2 += 100;
+   *   }
+   *   var4 = var1 + var2;
+   * }
+   */
+
+  auto add_fn = build::SI2_SO<int, int, int>("add", [](int a, int b) { return a + b; });
+  auto add_100_fn = build::SM<int>("add_100", [](int &a) { a += 100; });
+
+  Procedure procedure;
+  ProcedureBuilder builder{procedure};
+
+  Variable *var1 = &builder.add_single_input_parameter<int>();
+  Variable *var2 = &builder.add_single_mutable_parameter<int>();
+  Variable *var3 = &builder.add_single_input_parameter<bool>();
+
+  ProcedureBuilder::Branch branch = builder.add_branch(*var3);
+  branch.branch_true.add_call(add_100_fn, {var2});
+  builder.set_cursor_after_branch(branch);
+  auto [var4] = builder.add_call<1>(add_fn, {var1, var2});
+  builder.add_destruct({var1, var3});
+  builder.add_return();
+  builder.add_output_parameter(*var4);
+
+  EXPECT_TRUE(procedure.validate());
+
+  ProcedureExecutor procedure_fn{procedure};
+
+  /* Use a mask large enough to be executed in multiple chunks, with gaps. */
+  const int size = 100000;
+  Vector<int64_t> indices;
+  for (int i = 3; i < size; i++) {
+    if (i % 7 != 0) {
+      indices.append(i);
+    }
+  }
+
+  Array<int> values_a(size);
+  Array<int> values_b(size);
+  Array<bool> values_cond(size);
+  for (const int i : IndexRange(size)) {
+    values_a[i] = i;
+    values_b[i] = i * 2;
+    values_cond[i] = i % 3 == 0;
+  }
+  Array<int> output(size, -1);
+
+  ParamsBuilder params(procedure_fn, size);
+  params.add_readonly_single_input(values_a.as_span());
+  params.add_single_mutable(values_b.as_mutable_span());
+  params.add_readonly_single_input(values_cond.as_span());
+  params.add_uninitialized_single_output(output.as_mutable_span());
+
+  ContextBuilder context;
+  procedure_fn.call(indices.as_span(), params, context);
+
+  for (const int i : IndexRange(size)) {
+    if (i < 3 || i % 7 == 0) {
+      EXPECT_EQ(values_b[i], i * 2);
+      EXPECT_EQ(output[i], -1);
+    }
+    else {
+      const int b = i * 2 + (i % 3 == 0 ? 100 : 0);
+      EXPECT_EQ(values_b[i], b);
+      EXPECT_EQ(output[i], i + b);
+    }
+  }
+}
+
 }  // namespace blender::fn::multi_function::tests
@@ -63,6 +63,7 @@ struct AttributeFallbacksArray {
    */
   Array<const void *> array;
 
+  AttributeFallbacksArray() = default;
   AttributeFallbacksArray(int size) : array(size, nullptr)
   {
   }
@@ -228,6 +229,41 @@ struct GatherOffsets {
   CurvesElementStartIndices curves_offsets;
 };
 
+/** Number of tasks and output elements that are added for some instances. */
+struct GatherCounts {
+  int pointcloud_tasks = 0;
+  int mesh_tasks = 0;
+  int curve_tasks = 0;
+  GatherOffsets elements;
+
+  void add(const GatherCounts &other)
+  {
+    this->pointcloud_tasks += other.pointcloud_tasks;
+    this->mesh_tasks += other.mesh_tasks;
+    this->curve_tasks += other.curve_tasks;
+    this->elements.pointcloud_offset += other.elements.pointcloud_offset;
+    this->elements.mesh_offsets.vertex += other.elements.mesh_offsets.vertex;
+    this->elements.mesh_offsets.edge += other.elements.mesh_offsets.edge;
+    this->elements.mesh_offsets.poly += other.elements.mesh_offsets.poly;
+    this->elements.mesh_offsets.loop += other.elements.mesh_offsets.loop;
+    this->elements.curves_offsets.point += other.elements.curves_offsets.point;
+    this->elements.curves_offsets.curve += other.elements.curves_offsets.curve;
+  }
+};
+
+/**
+ * Preprocessed information about an instance reference whose geometry does not contain instances
+ * itself. Tasks for all instances of such references are independent of each other, so they can
+ * be gathered in parallel.
+ */
+struct LeafReferenceInfo {
+  const PointCloudRealizeInfo *pointcloud_info = nullptr;
+  const MeshRealizeInfo *mesh_info = nullptr;
+  const RealizeCurveInfo *curve_info = nullptr;
+  /** Tasks and elements added for every instance of the reference. */
+  GatherCounts counts;
+};
+
 struct GatherTasksInfo {
   /** Static information about all geometries that are joined. */
   const AllPointCloudsInfo &pointclouds;
@@ -274,9 +310,16 @@ static void copy_transformed_positions(const Span<float3> src,
                                        const float4x4 &transform,
                                        MutableSpan<float3> dst)
 {
+  /* Multiply with the matrix columns directly instead of calling the generic matrix-vector
+   * multiplication for every position, which allows the compiler to vectorize the loop. */
+  const float3 x_axis = transform.values[0];
+  const float3 y_axis = transform.values[1];
+  const float3 z_axis = transform.values[2];
+  const float3 translation = transform.values[3];
   threading::parallel_for(src.index_range(), 1024, [&](const IndexRange range) {
     for (const int i : range) {
-      dst[i] = transform * src[i];
+      const float3 &position = src[i];
+      dst[i] = x_axis * position.x + y_axis * position.y + z_axis * position.z + translation;
     }
   });
 }
@@ -399,7 +442,10 @@ static Vector<std::pair<int, GSpan>> prepare_attribute_fallbacks(
           /* Convert the attribute on the instances component to the expected attribute type. */
           std::unique_ptr<GArray<>> temporary_array = std::make_unique<GArray<>>(
               to_type, instances.instances_num());
-          conversions.convert_to_initialized_n(span, temporary_array->as_mutable_span());
+          GMutableSpan converted = temporary_array->as_mutable_span();
+          threading::parallel_for(IndexRange(span.size()), 4096, [&](const IndexRange range) {
+            conversions.convert_to_initialized_n(span.slice(range), converted.slice(range));
+          });
           span = temporary_array->as_span();
           gather_info.r_temporary_arrays.append(std::move(temporary_array));
         }
@@ -453,6 +499,210 @@ static void foreach_geometry_in_reference(
   }
 }
 
+static uint32_t get_instance_id(const GatherTasksInfo &gather_info,
+                                const Span<int> stored_instance_ids,
+                                const uint32_t base_id,
+                                const int instance_index)
+{
+  uint32_t local_instance_id = 0;
+  if (gather_info.create_id_attribute_on_any_component) {
+    if (stored_instance_ids.is_empty()) {
+      local_instance_id = uint32_t(instance_index);
+    }
+    else {
+      local_instance_id = uint32_t(stored_instance_ids[instance_index]);
+    }
+  }
+  return noise::hash(base_id, local_instance_id);
+}
+
+/**
+ * Preprocess the instance references for #gather_realize_tasks_for_leaf_instances. None is
+ * returned when a reference contains nested instances or geometry that has to be gathered in
+ * order, like volumes.
+ */
+static std::optional<Array<LeafReferenceInfo>> prepare_leaf_references(
+    const GatherTasksInfo &gather_info, const Span<InstanceReference> references)
+{
+  Array<LeafReferenceInfo> leaf_references(references.size());
+  for (const int reference_index : references.index_range()) {
+    const InstanceReference &reference = references[reference_index];
+    if (reference.type() == InstanceReference::Type::None) {
+      continue;
+    }
+    if (reference.type() != InstanceReference::Type::GeometrySet) {
+      /* Geometry of objects and collections is only retrieved while gathering. */
+      return std::nullopt;
+    }
+    LeafReferenceInfo &leaf_reference = leaf_references[reference_index];
+    GatherCounts &counts = leaf_reference.counts;
+    const GeometrySet &geometry_set = reference.geometry_set();
+    for (const GeometryComponent *component : geometry_set.get_components_for_read()) {
+      switch (component->type()) {
+        case GEO_COMPONENT_TYPE_MESH: {
+          const Mesh *mesh = static_cast<const MeshComponent *>(component)->get_for_read();
+          if (mesh != nullptr && mesh->totvert > 0) {
+            const int mesh_index = gather_info.meshes.order.index_of(mesh);
+            leaf_reference.mesh_info = &gather_info.meshes.realize_info[mesh_index];
+            counts.mesh_tasks = 1;
+            counts.elements.mesh_offsets = {
+                mesh->totvert, mesh->totedge, mesh->totpoly, mesh->totloop};
+          }
+          break;
+        }
+        case GEO_COMPONENT_TYPE_POINT_CLOUD: {
+          const PointCloud *pointcloud =
+              static_cast<const PointCloudComponent *>(component)->get_for_read();
+          if (pointcloud != nullptr && pointcloud->totpoint > 0) {
+            const int pointcloud_index = gather_info.pointclouds.order.index_of(pointcloud);
+            leaf_reference.pointcloud_info =
+                &gather_info.pointclouds.realize_info[pointcloud_index];
+            counts.pointcloud_tasks = 1;
+            counts.elements.pointcloud_offset = pointcloud->totpoint;
+          }
+          break;
+        }
+        case GEO_COMPONENT_TYPE_CURVE: {
+          const Curves *curves = static_cast<const CurveComponent *>(component)->get_for_read();
+          if (curves != nullptr && curves->geometry.curve_num > 0) {
+            const int curve_index = gather_info.curves.order.index_of(curves);
+            leaf_reference.curve_info = &gather_info.curves.realize_info[curve_index];
+            counts.curve_tasks = 1;
+            counts.elements.curves_offsets = {curves->geometry.point_num,
+                                              curves->geometry.curve_num};
+          }
+          break;
+        }
+        default: {
+          return std::nullopt;
+        }
+      }
+    }
+  }
+  return leaf_references;
+}
+
+static void update_attribute_fallbacks(const AttributeFallbacksArray &base_fallbacks,
+                                       const Span<std::pair<int, GSpan>> attributes_to_override,
+                                       const int instance_index,
+                                       AttributeFallbacksArray &r_fallbacks)
+{
+  r_fallbacks = base_fallbacks;
+  for (const std::pair<int, GSpan> &pair : attributes_to_override) {
+    r_fallbacks.array[pair.first] = pair.second[instance_index];
+  }
+}
+
+/**
+ * Gather tasks for instances whose references don't contain nested instances. Since the number of
+ * tasks and elements of every instance is known in advance, this is done in two parallel passes
+ * over chunks of instances, which is much faster when there are millions of instances. The first
+ * pass counts the tasks and elements of every chunk, their prefix sum gives the offsets of each
+ * chunk. The second pass creates the tasks of every chunk at these offsets.
+ */
+static void gather_realize_tasks_for_leaf_instances(
+    GatherTasksInfo &gather_info,
+    const Instances &instances,
+    const Span<LeafReferenceInfo> leaf_references,
+    const float4x4 &base_transform,
+    const InstanceContext &base_instance_context,
+    const Span<int> stored_instance_ids,
+    const Span<std::pair<int, GSpan>> pointcloud_attributes_to_override,
+    const Span<std::pair<int, GSpan>> mesh_attributes_to_override,
+    const Span<std::pair<int, GSpan>> curve_attributes_to_override)
+{
+  const Span<int> handles = instances.reference_handles();
+  const Span<float4x4> transforms = instances.transforms();
+
+  const int instances_num = instances.instances_num();
+  const int chunk_size = 4096;
+  const int chunks_num = (instances_num + chunk_size - 1) / chunk_size;
+  auto chunk_instances = [&](const int chunk) {
+    const int start = chunk * chunk_size;
+    return IndexRange(start, std::min(chunk_size, instances_num - start));
+  };
+
+  Array<GatherCounts> chunk_offsets(chunks_num);
+  threading::parallel_for(IndexRange(chunks_num), 1, [&](const IndexRange chunk_range) {
+    for (const int chunk : chunk_range) {
+      GatherCounts counts;
+      for (const int i : chunk_instances(chunk)) {
+        counts.add(leaf_references[handles[i]].counts);
+      }
+      chunk_offsets[chunk] = counts;
+    }
+  });
+
+  GatherTasks &tasks = gather_info.r_tasks;
+  GatherCounts total_offset;
+  total_offset.pointcloud_tasks = tasks.pointcloud_tasks.size();
+  total_offset.mesh_tasks = tasks.mesh_tasks.size();
+  total_offset.curve_tasks = tasks.curve_tasks.size();
+  total_offset.elements = gather_info.r_offsets;
+  for (GatherCounts &chunk_offset : chunk_offsets) {
+    const GatherCounts counts = chunk_offset;
+    chunk_offset = total_offset;
+    total_offset.add(counts);
+  }
+  tasks.pointcloud_tasks.resize(total_offset.pointcloud_tasks);
+  tasks.mesh_tasks.resize(total_offset.mesh_tasks);
+  tasks.curve_tasks.resize(total_offset.curve_tasks);
+  gather_info.r_offsets = total_offset.elements;
+
+  MutableSpan<RealizePointCloudTask> pointcloud_tasks = tasks.pointcloud_tasks;
+  MutableSpan<RealizeMeshTask> mesh_tasks = tasks.mesh_tasks;
+  MutableSpan<RealizeCurveTask> curve_tasks = tasks.curve_tasks;
+  threading::parallel_for(IndexRange(chunks_num), 1, [&](const IndexRange chunk_range) {
+    for (const int chunk : chunk_range) {
+      GatherCounts offset = chunk_offsets[chunk];
+      for (const int i : chunk_instances(chunk)) {
+        const LeafReferenceInfo &leaf_reference = leaf_references[handles[i]];
+        if (!leaf_reference.pointcloud_info && !leaf_reference.mesh_info &&
+            !leaf_reference.curve_info) {
+          continue;
+        }
+        const float4x4 transform = base_transform * transforms[i];
+        const uint32_t id = get_instance_id(
+            gather_info, stored_instance_ids, base_instance_context.id, i);
+        if (leaf_reference.pointcloud_info) {
+          RealizePointCloudTask &task = pointcloud_tasks[offset.pointcloud_tasks];
+          task.start_index = offset.elements.pointcloud_offset;
+          task.pointcloud_info = leaf_reference.pointcloud_info;
+          task.transform = transform;
+          update_attribute_fallbacks(base_instance_context.pointclouds,
+                                     pointcloud_attributes_to_override,
+                                     i,
+                                     task.attribute_fallbacks);
+          task.id = id;
+        }
+        if (leaf_reference.mesh_info) {
+          RealizeMeshTask &task = mesh_tasks[offset.mesh_tasks];
+          task.start_indices = offset.elements.mesh_offsets;
+          task.mesh_info = leaf_reference.mesh_info;
+          task.transform = transform;
+          update_attribute_fallbacks(base_instance_context.meshes,
+                                     mesh_attributes_to_override,
+                                     i,
+                                     task.attribute_fallbacks);
+          task.id = id;
+        }
+        if (leaf_reference.curve_info) {
+          RealizeCurveTask &task = curve_tasks[offset.curve_tasks];
+          task.start_indices = offset.elements.curves_offsets;
+          task.curve_info = leaf_reference.curve_info;
+          task.transform = transform;
+          update_attribute_fallbacks(base_instance_context.curves,
+                                     curve_attributes_to_override,
+                                     i,
+                                     task.attribute_fallbacks);
+          task.id = id;
+        }
+        offset.add(leaf_reference.counts);
+      }
+    }
+  });
+}
+
 static void gather_realize_tasks_for_instances(GatherTasksInfo &gather_info,
                                                const Instances &instances,
                                                const float4x4 &base_transform,
@@ -479,6 +729,20 @@ static void gather_realize_tasks_for_instances(GatherTasksInfo &gather_info,
   Vector<std::pair<int, GSpan>> curve_attributes_to_override = prepare_attribute_fallbacks(
       gather_info, instances, gather_info.curves.attributes);
 
+  if (const std::optional<Array<LeafReferenceInfo>> leaf_references = prepare_leaf_references(
+          gather_info, references)) {
+    gather_realize_tasks_for_leaf_instances(gather_info,
+                                            instances,
+                                            *leaf_references,
+                                            base_transform,
+                                            base_instance_context,
+                                            stored_instance_ids,
+                                            pointcloud_attributes_to_override,
+                                            mesh_attributes_to_override,
+                                            curve_attributes_to_override);
+    return;
+  }
+
   for (const int i : transforms.index_range()) {
     const int handle = handles[i];
     const float4x4 &transform = transforms[i];
@@ -496,16 +760,8 @@ static void gather_realize_tasks_for_instances(GatherTasksInfo &gather_info,
       instance_context.curves.array[pair.first] = pair.second[i];
     }
 
-    uint32_t local_instance_id = 0;
-    if (gather_info.create_id_attribute_on_any_component) {
-      if (stored_instance_ids.is_empty()) {
-        local_instance_id = uint32_t(i);
-      }
-      else {
-        local_instance_id = uint32_t(stored_instance_ids[i]);
-      }
-    }
-    const uint32_t instance_id = noise::hash(base_instance_context.id, local_instance_id);
+    const uint32_t instance_id = get_instance_id(
+        gather_info, stored_instance_ids, base_instance_context.id, i);
 
     /* Add realize tasks for all referenced geometry sets recursively. */
     foreach_geometry_in_reference(reference,
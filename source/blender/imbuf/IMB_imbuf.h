@@ -183,6 +183,28 @@ size_t IMB_get_size_in_memory(struct ImBuf *ibuf);
  */
 size_t IMB_get_rect_len(const struct ImBuf *ibuf);
 
+/**
+ * Losslessly compressed copy of an image buffer, used to keep more frames in cache memory.
+ * Only the pixel buffers, their color spaces and the metadata are stored.
+ */
+struct ImBufCompressed;
+
+/**
+ * Compress pixels of the given image buffer, which itself is left untouched.
+ * Returns null when the buffer can't be compressed or compression saves too little memory.
+ *
+ * \attention Defined in compress.cc
+ */
+struct ImBufCompressed *IMB_compressed_from_imbuf(const struct ImBuf *ibuf);
+/**
+ * Restore a new image buffer with a single user from compressed data.
+ *
+ * \attention Defined in compress.cc
+ */
+struct ImBuf *IMB_compressed_to_imbuf(const struct ImBufCompressed *cbuf);
+size_t IMB_compressed_size_in_memory(const struct ImBufCompressed *cbuf);
+void IMB_compressed_free(struct ImBufCompressed *cbuf);
+
 /**
  * \attention Defined in rectop.c
  */
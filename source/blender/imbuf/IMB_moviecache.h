@@ -40,6 +40,14 @@ void IMB_moviecache_set_priority_callback(struct MovieCache *cache,
                                           MovieCacheGetPriorityDataFP getprioritydatafp,
                                           MovieCacheGetItemPriorityFP getitempriorityfp,
                                           MovieCachePriorityDeleterFP prioritydeleterfp);
+/**
+ * Keep buffers evicted by the cache limiter losslessly compressed in memory, counting their
+ * compressed size against the limit. They are decompressed when requested again.
+ *
+ * \note Compressed items have no #ImBuf, so #IMB_moviecache_cleanup callbacks and
+ * #IMB_moviecacheIter_getImBuf may receive null for them.
+ */
+void IMB_moviecache_set_compress(struct MovieCache *cache, bool compress);
 
 void IMB_moviecache_put(struct MovieCache *cache, void *userkey, struct ImBuf *ibuf);
 bool IMB_moviecache_put_if_possible(struct MovieCache *cache, void *userkey, struct ImBuf *ibuf);
@@ -14,6 +14,7 @@
 extern "C" {
 #endif
 
+struct ColormanageProcessor;
 struct ImBuf;
 struct OCIO_ConstCPUProcessorRcPtr;
 
@@ -117,6 +118,18 @@ void colorspace_set_default_role(char *colorspace, int size, int role);
 void colormanage_imbuf_set_default_spaces(struct ImBuf *ibuf);
 void colormanage_imbuf_make_linear(struct ImBuf *ibuf, const char *from_colorspace);
 
+/**
+ * Maximum difference with the exact transform at the validation samples of display LUTs, a
+ * quarter of the quantization step of byte display buffers. Relative for values above one.
+ */
+#define DISPLAY_LUT_TOLERANCE_DEFAULT (1.0f / 1024.0f)
+
+/**
+ * Tolerance display LUTs are baked with by processors created afterwards, zero disables them.
+ */
+void colormanage_display_lut_tolerance_set(float tolerance);
+bool colormanage_processor_uses_display_lut(const struct ColormanageProcessor *cm_processor);
+
 #ifdef __cplusplus
 }
 #endif
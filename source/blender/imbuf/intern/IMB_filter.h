@@ -8,6 +8,12 @@
 
 #pragma once
 
+#include "IMB_imbuf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 struct ImBuf;
 
 void imb_filterx(struct ImBuf *ibuf);
@@ -22,3 +28,27 @@ void IMB_unpremultiply_rect_float(float *rect_float, int channels, int w, int h)
  * Result in ibuf2, scaling should be done correctly.
  */
 void imb_onehalf_no_alloc(struct ImBuf *ibuf2, struct ImBuf *ibuf1);
+
+typedef enum eIMBResampleFilter {
+  /** Average of the covered area when scaling down, linear interpolation when scaling up. */
+  IMB_RESAMPLE_BOX = 0,
+  IMB_RESAMPLE_BILINEAR = 1,
+  /** Catmull-Rom spline, sharper than bilinear. */
+  IMB_RESAMPLE_BICUBIC = 2,
+  /** Sharpest, may cause ringing near edges. */
+  IMB_RESAMPLE_LANCZOS3 = 3,
+} eIMBResampleFilter;
+
+/**
+ * Resample the byte and float buffers of \a ibuf, filtering each axis separately.
+ * \attention Defined in resample.cc
+ */
+void imb_resample_buffers(struct ImBuf *ibuf,
+                          int newx,
+                          int newy,
+                          eIMBResampleFilter filter_x,
+                          eIMBResampleFilter filter_y);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,32 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup imbuf
+ * \brief Filter weights of the separable resampling in resample.cc
+ */
+
+#pragma once
+
+#include "BLI_array.hh"
+
+#include "IMB_filter.h"
+
+namespace blender::imbuf::resample {
+
+struct FilterWeights {
+  /** First source pixel used by every destination pixel. */
+  Array<int> start;
+  /** Number of weights per destination pixel, the same for all pixels to simplify the loops. */
+  int taps;
+  /** #taps weights for every destination pixel, zero for unused taps. */
+  Array<float> weights;
+};
+
+/**
+ * Weights to resample \a src_size pixels to \a dst_size pixels along one axis. All taps are
+ * inside the source and the weights of every destination pixel sum to one, so pixels near the
+ * edges are not darkened.
+ */
+FilterWeights filter_weights_compute(int src_size, int dst_size, eIMBResampleFilter filter);
+
+}  // namespace blender::imbuf::resample
@@ -30,6 +30,7 @@
 #include "BLI_math.h"
 #include "BLI_math_color.h"
 #include "BLI_rect.h"
+#include "BLI_simd.h"
 #include "BLI_string.h"
 #include "BLI_task.h"
 #include "BLI_threads.h"
@@ -88,12 +89,25 @@ float imbuf_aces_to_scene_linear[3][3] = {{0.0f}};
  */
 static pthread_mutex_t processor_lock = BLI_MUTEX_INITIALIZER;
 
+struct DisplayLut;
+
 typedef struct ColormanageProcessor {
   OCIO_ConstCPUProcessorRcPtr *cpu_processor;
   CurveMapping *curve_mapping;
   bool is_data_result;
+
+  /**
+   * Approximation of #cpu_processor for display processors, when accurate enough.
+   * Exposure and gamma are applied separately, see #display_lut_apply.
+   */
+  struct DisplayLut *display_lut;
+  float display_lut_scale;
+  float display_lut_exponent;
 } ColormanageProcessor;
 
+static void display_lut_release(struct DisplayLut *lut);
+static void display_luts_free(void);
+
 static struct global_gpu_state {
   /* GPU shader currently bound. */
   bool gpu_shader_bound;
@@ -727,6 +741,7 @@ void colormanagement_exit(void)
   memset(&global_gpu_state, 0, sizeof(global_gpu_state));
   memset(&global_color_picking_state, 0, sizeof(global_color_picking_state));
 
+  display_luts_free();
   colormanage_free_config();
 }
 
@@ -3777,6 +3792,420 @@ void IMB_partial_display_buffer_update_delayed(ImBuf *ibuf, int xmin, int ymin,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Display Transform LUT
+ *
+ * Running the OCIO processor of a view transform for every pixel is slow, so display processors
+ * bake the view transform into a 3D LUT on first use, cached for every look, view and display.
+ * Exposure and gamma are applied separately, so changing them doesn't require a new LUT.
+ *
+ * The LUT is indexed through a logarithmic shaper to cover the range of scene linear values,
+ * and uses tetrahedral interpolation. It's only used when its difference with the exact
+ * transform is below the tolerance it was baked with, pixels outside of its range use the exact
+ * transform.
+ *
+ * LUTs are freed when no processor uses them, keeping only the most recently used ones.
+ * \{ */
+
+/**
+ * Number of LUT samples along each axis. Four samples per stop, so values where transforms
+ * commonly clip (powers of two like 1.0) fall on samples.
+ */
+#define DISPLAY_LUT_SIZE 81
+/**
+ * Range of the shaper in stops, covering scene linear values from 0 to about 64.
+ * Values below the minimum are sampled linearly.
+ */
+#define DISPLAY_LUT_STOP_MIN -14
+#define DISPLAY_LUT_STOP_MAX 6
+#define DISPLAY_LUT_VALIDATION_SAMPLES 4096
+/** Number of LUTs kept when unused, each one takes about 8.5 MB. */
+#define DISPLAY_LUT_CACHE_MAX 4
+
+typedef struct DisplayLut {
+  struct DisplayLut *next, *prev;
+  char key[3 * MAX_COLORSPACE_NAME];
+  float tolerance;
+  /** Number of processors using the LUT, it can't be freed while used. */
+  int users;
+  /** Display color of every sample, NULL when the LUT isn't accurate enough. */
+  float (*table)[4];
+} DisplayLut;
+
+/** Most recently used first. */
+static ListBase display_luts = {NULL, NULL};
+static ThreadMutex display_lut_lock = BLI_MUTEX_INITIALIZER;
+static float display_lut_tolerance = DISPLAY_LUT_TOLERANCE_DEFAULT;
+
+/** Largest scene linear value covered by the LUT. */
+static float display_lut_value_max(void)
+{
+  return ldexpf(1.0f, DISPLAY_LUT_STOP_MAX) - ldexpf(1.0f, DISPLAY_LUT_STOP_MIN);
+}
+
+/**
+ * LUT coordinate of a scene linear value in [0, #display_lut_value_max].
+ *
+ * The shaper is an approximation of log2 using the float representation, with a polynomial for
+ * the mantissa. It doesn't need to be exact, only monotonic, see #display_lut_shaper_inverse.
+ */
+BLI_INLINE float display_lut_shaper(const float value)
+{
+  union {
+    float f;
+    int32_t i;
+  } bits = {value + ldexpf(1.0f, DISPLAY_LUT_STOP_MIN)};
+  const int exponent = (bits.i >> 23) - 127;
+  const float mantissa = (float)(bits.i & 0x7fffff) * (1.0f / (float)(1 << 23));
+  /* Approximation of log2(1 + mantissa), exact at 0 and 1. */
+  const float stops = (float)exponent +
+                      mantissa * (1.4208645f + mantissa * (-0.5772507f + mantissa * 0.1563862f));
+  return (stops - (float)DISPLAY_LUT_STOP_MIN) *
+         ((float)(DISPLAY_LUT_SIZE - 1) / (float)(DISPLAY_LUT_STOP_MAX - DISPLAY_LUT_STOP_MIN));
+}
+
+/** Scene linear value at LUT coordinate \a coord, the inverse of #display_lut_shaper. */
+static float display_lut_shaper_inverse(const float coord)
+{
+  float min = 0.0f, max = display_lut_value_max();
+  for (int i = 0; i < 64 && min < max; i++) {
+    const float mid = 0.5f * (min + max);
+    if (mid == min || mid == max) {
+      break;
+    }
+    if (display_lut_shaper(mid) < coord) {
+      min = mid;
+    }
+    else {
+      max = mid;
+    }
+  }
+  return (display_lut_shaper(max) - coord < coord - display_lut_shaper(min)) ? max : min;
+}
+
+/** Tetrahedral interpolation of the LUT at \a coord (in samples). */
+BLI_INLINE void display_lut_lookup(const float (*table)[4], const float coord[3], float r_rgb[3])
+{
+  const int size = DISPLAY_LUT_SIZE;
+  int index[3];
+  float fac[3];
+  for (int i = 0; i < 3; i++) {
+    index[i] = min_ii((int)coord[i], size - 2);
+    fac[i] = coord[i] - (float)index[i];
+  }
+
+  const int stride[3] = {1, size, size * size};
+  const float(*base)[4] = table + index[0] + index[1] * stride[1] + index[2] * stride[2];
+
+  /* Order the axes by decreasing factor, to find the tetrahedron containing the coordinate. */
+  int a, b, c;
+  if (fac[0] >= fac[1]) {
+    if (fac[1] >= fac[2]) {
+      a = 0, b = 1, c = 2;
+    }
+    else if (fac[0] >= fac[2]) {
+      a = 0, b = 2, c = 1;
+    }
+    else {
+      a = 2, b = 0, c = 1;
+    }
+  }
+  else {
+    if (fac[0] >= fac[2]) {
+      a = 1, b = 0, c = 2;
+    }
+    else if (fac[1] >= fac[2]) {
+      a = 1, b = 2, c = 0;
+    }
+    else {
+      a = 2, b = 1, c = 0;
+    }
+  }
+
+  const float *c0 = base[0];
+  const float *c1 = base[stride[a]];
+  const float *c2 = base[stride[a] + stride[b]];
+  const float *c3 = base[stride[a] + stride[b] + stride[c]];
+  const float w0 = 1.0f - fac[a], w1 = fac[a] - fac[b], w2 = fac[b] - fac[c], w3 = fac[c];
+
+#ifdef BLI_HAVE_SSE2
+  const __m128 result = _mm_add_ps(
+      _mm_add_ps(_mm_mul_ps(_mm_set1_ps(w0), _mm_loadu_ps(c0)),
+                 _mm_mul_ps(_mm_set1_ps(w1), _mm_loadu_ps(c1))),
+      _mm_add_ps(_mm_mul_ps(_mm_set1_ps(w2), _mm_loadu_ps(c2)),
+                 _mm_mul_ps(_mm_set1_ps(w3), _mm_loadu_ps(c3))));
+  float rgba[4];
+  _mm_storeu_ps(rgba, result);
+  copy_v3_v3(r_rgb, rgba);
+#else
+  for (int i = 0; i < 3; i++) {
+    r_rgb[i] = w0 * c0[i] + w1 * c1[i] + w2 * c2[i] + w3 * c3[i];
+  }
+#endif
+}
+
+/**
+ * \return True when \a rgb is in the range of the LUT, with \a r_coord set to its LUT coordinate.
+ */
+BLI_INLINE bool display_lut_coord(const float rgb[3], const float value_max, float r_coord[3])
+{
+  /* Also false for NaN. */
+  if (!(rgb[0] >= 0.0f && rgb[1] >= 0.0f && rgb[2] >= 0.0f && rgb[0] <= value_max &&
+        rgb[1] <= value_max && rgb[2] <= value_max)) {
+    return false;
+  }
+  for (int i = 0; i < 3; i++) {
+    r_coord[i] = display_lut_shaper(rgb[i]);
+  }
+  return true;
+}
+
+/**
+ * \param tolerance: Maximum difference with \a cpu_processor at the validation samples,
+ * relative for display values above one.
+ * \return The LUT, or NULL when it isn't accurate enough.
+ */
+static float (*display_lut_bake(OCIO_ConstCPUProcessorRcPtr *cpu_processor,
+                                const float tolerance))[4]
+{
+  const int size = DISPLAY_LUT_SIZE;
+  float(*table)[4] = MEM_mallocN(sizeof(*table) * size * size * size, "display LUT");
+
+  float samples[DISPLAY_LUT_SIZE];
+  for (int i = 0; i < size; i++) {
+    samples[i] = display_lut_shaper_inverse((float)i);
+  }
+  for (int b = 0; b < size; b++) {
+    for (int g = 0; g < size; g++) {
+      for (int r = 0; r < size; r++) {
+        float *value = table[(b * size + g) * size + r];
+        value[0] = samples[r];
+        value[1] = samples[g];
+        value[2] = samples[b];
+        value[3] = 1.0f;
+      }
+    }
+  }
+
+  OCIO_PackedImageDesc *img = OCIO_createOCIO_PackedImageDesc((float *)table,
+                                                              size * size,
+                                                              size,
+                                                              4,
+                                                              sizeof(float),
+                                                              4 * sizeof(float),
+                                                              4 * sizeof(float) * size * size);
+  OCIO_cpuProcessorApply(cpu_processor, img);
+  OCIO_PackedImageDescRelease(img);
+
+  /* Compare with the exact transform between samples, spread with a low discrepancy sequence
+   * (additive recurrence with the generalized golden ratio). */
+  const double phi = 1.2207440846057596;
+  const double alpha[3] = {1.0 / phi, 1.0 / (phi * phi), 1.0 / (phi * phi * phi)};
+  float(*exact)[4] = MEM_mallocN(sizeof(*exact) * DISPLAY_LUT_VALIDATION_SAMPLES, __func__);
+  for (int i = 0; i < DISPLAY_LUT_VALIDATION_SAMPLES; i++) {
+    for (int j = 0; j < 3; j++) {
+      const double t = fmod(0.5 + alpha[j] * (i + 1), 1.0);
+      exact[i][j] = display_lut_shaper_inverse((float)(t * (size - 1)));
+    }
+    exact[i][3] = 1.0f;
+  }
+  float(*approx)[4] = MEM_dupallocN(exact);
+
+  img = OCIO_createOCIO_PackedImageDesc((float *)exact,
+                                        DISPLAY_LUT_VALIDATION_SAMPLES,
+                                        1,
+                                        4,
+                                        sizeof(float),
+                                        4 * sizeof(float),
+                                        4 * sizeof(float) * DISPLAY_LUT_VALIDATION_SAMPLES);
+  OCIO_cpuProcessorApply(cpu_processor, img);
+  OCIO_PackedImageDescRelease(img);
+
+  const float value_max = display_lut_value_max();
+  float error_max = 0.0f;
+  for (int i = 0; i < DISPLAY_LUT_VALIDATION_SAMPLES; i++) {
+    float coord[3];
+    if (!display_lut_coord(approx[i], value_max, coord)) {
+      continue;
+    }
+    display_lut_lookup((const float(*)[4])table, coord, approx[i]);
+    for (int j = 0; j < 3; j++) {
+      /* Relative above one, for views that don't clip. NaN in the exact result also rejects
+       * the LUT. */
+      const float error = fabsf(approx[i][j] - exact[i][j]) / max_ff(fabsf(exact[i][j]), 1.0f);
+      error_max = (error <= error_max) ? error_max : error;
+    }
+  }
+
+  MEM_freeN(exact);
+  MEM_freeN(approx);
+
+  if (!(error_max <= tolerance)) {
+    MEM_freeN(table);
+    return NULL;
+  }
+  return table;
+}
+
+/** Free the least recently used LUTs over #DISPLAY_LUT_CACHE_MAX, unless they are used. */
+static void display_luts_trim(void)
+{
+  int index = 0;
+  LISTBASE_FOREACH_MUTABLE (DisplayLut *, lut, &display_luts) {
+    if (index++ >= DISPLAY_LUT_CACHE_MAX && lut->users == 0) {
+      BLI_remlink(&display_luts, lut);
+      MEM_SAFE_FREE(lut->table);
+      MEM_freeN(lut);
+    }
+  }
+}
+
+/**
+ * \return The LUT for the view transform with a new user, baked on first use,
+ * or NULL when it isn't accurate enough to be used.
+ */
+static DisplayLut *display_lut_ensure(const char *look,
+                                      const char *view_transform,
+                                      const char *display)
+{
+  char key[3 * MAX_COLORSPACE_NAME];
+  BLI_snprintf(key,
+               sizeof(key),
+               "%s/%s/%s",
+               display,
+               view_transform,
+               colormanage_use_look(look, view_transform) ? look : "");
+
+  BLI_mutex_lock(&display_lut_lock);
+
+  const float tolerance = display_lut_tolerance;
+  if (tolerance <= 0.0f) {
+    BLI_mutex_unlock(&display_lut_lock);
+    return NULL;
+  }
+
+  DisplayLut *lut = NULL;
+  LISTBASE_FOREACH (DisplayLut *, lut_iter, &display_luts) {
+    if (lut_iter->tolerance == tolerance && STREQ(lut_iter->key, key)) {
+      lut = lut_iter;
+      break;
+    }
+  }
+
+  if (lut) {
+    BLI_remlink(&display_luts, lut);
+  }
+  else {
+    lut = MEM_callocN(sizeof(DisplayLut), __func__);
+    STRNCPY(lut->key, key);
+    lut->tolerance = tolerance;
+    OCIO_ConstCPUProcessorRcPtr *cpu_processor = create_display_buffer_processor(
+        look, view_transform, display, 0.0f, 1.0f, global_role_scene_linear);
+    if (cpu_processor) {
+      lut->table = display_lut_bake(cpu_processor, tolerance);
+      OCIO_cpuProcessorRelease(cpu_processor);
+    }
+  }
+  BLI_addhead(&display_luts, lut);
+
+  if (lut->table) {
+    lut->users++;
+  }
+  else {
+    lut = NULL;
+  }
+  display_luts_trim();
+
+  BLI_mutex_unlock(&display_lut_lock);
+
+  return lut;
+}
+
+static void display_lut_release(DisplayLut *lut)
+{
+  BLI_mutex_lock(&display_lut_lock);
+  BLI_assert(lut->users > 0);
+  lut->users--;
+  display_luts_trim();
+  BLI_mutex_unlock(&display_lut_lock);
+}
+
+static void display_luts_free(void)
+{
+  LISTBASE_FOREACH_MUTABLE (DisplayLut *, lut, &display_luts) {
+    BLI_assert(lut->users == 0);
+    MEM_SAFE_FREE(lut->table);
+    MEM_freeN(lut);
+  }
+  BLI_listbase_clear(&display_luts);
+}
+
+void colormanage_display_lut_tolerance_set(const float tolerance)
+{
+  BLI_mutex_lock(&display_lut_lock);
+  display_lut_tolerance = tolerance;
+  /* LUTs baked with another tolerance are not used by new processors anymore. */
+  display_luts_trim();
+  BLI_mutex_unlock(&display_lut_lock);
+}
+
+bool colormanage_processor_uses_display_lut(const ColormanageProcessor *cm_processor)
+{
+  return cm_processor->display_lut != NULL;
+}
+
+/** Same as #OCIO_cpuProcessorApply for the display processor, using its LUT when possible. */
+static void display_lut_apply(const ColormanageProcessor *cm_processor,
+                              float *buffer,
+                              const size_t num_pixels,
+                              const int channels,
+                              const bool predivide)
+{
+  const float(*table)[4] = (const float(*)[4])cm_processor->display_lut->table;
+  const float scale = cm_processor->display_lut_scale;
+  const float exponent = cm_processor->display_lut_exponent;
+  const float value_max = display_lut_value_max();
+
+  float *pixel = buffer;
+  for (size_t i = 0; i < num_pixels; i++, pixel += channels) {
+    const float alpha = (channels == 4) ? pixel[3] : 1.0f;
+    const bool use_predivide = predivide && !ELEM(alpha, 0.0f, 1.0f);
+
+    float rgb[3], coord[3];
+    mul_v3_v3fl(rgb, pixel, use_predivide ? scale / alpha : scale);
+
+    if (!display_lut_coord(rgb, value_max, coord)) {
+      /* Out of range, use the exact transform. */
+      if (channels == 4) {
+        if (predivide) {
+          OCIO_cpuProcessorApplyRGBA_predivide(cm_processor->cpu_processor, pixel);
+        }
+        else {
+          OCIO_cpuProcessorApplyRGBA(cm_processor->cpu_processor, pixel);
+        }
+      }
+      else {
+        OCIO_cpuProcessorApplyRGB(cm_processor->cpu_processor, pixel);
+      }
+      continue;
+    }
+
+    display_lut_lookup(table, coord, rgb);
+
+    if (exponent != 1.0f) {
+      for (int j = 0; j < 3; j++) {
+        rgb[j] = powf(max_ff(rgb[j], 0.0f), exponent);
+      }
+    }
+    if (use_predivide) {
+      mul_v3_fl(rgb, alpha);
+    }
+    copy_v3_v3(pixel, rgb);
+  }
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Pixel Processor Functions
  * \{ */
@@ -3813,6 +4242,20 @@ ColormanageProcessor *IMB_colormanagement_display_processor_new(
       applied_view_settings->gamma,
       global_role_scene_linear);
 
+  if (cm_processor->cpu_processor) {
+    cm_processor->display_lut = display_lut_ensure(applied_view_settings->look,
+                                                   applied_view_settings->view_transform,
+                                                   display_settings->display_device);
+    /* Same as #create_display_buffer_processor. */
+    cm_processor->display_lut_scale = (applied_view_settings->exposure == 0.0f) ?
+                                          1.0f :
+                                          powf(2.0f, applied_view_settings->exposure);
+    cm_processor->display_lut_exponent = (applied_view_settings->gamma == 1.0f) ?
+                                             1.0f :
+                                             1.0f / max_ff(FLT_EPSILON,
+                                                           applied_view_settings->gamma);
+  }
+
   if (applied_view_settings->flag & COLORMANAGE_VIEW_USE_CURVES) {
     cm_processor->curve_mapping = BKE_curvemapping_copy(applied_view_settings->curve_mapping);
     BKE_curvemapping_premultiply(cm_processor->curve_mapping, false);
@@ -3917,7 +4360,10 @@ void IMB_colormanagement_processor_apply(ColormanageProcessor *cm_processor,
     }
   }
 
-  if (cm_processor->cpu_processor && channels >= 3) {
+  if (cm_processor->display_lut && channels >= 3) {
+    display_lut_apply(cm_processor, buffer, (size_t)width * height, channels, predivide);
+  }
+  else if (cm_processor->cpu_processor && channels >= 3) {
     OCIO_PackedImageDesc *img;
 
     /* apply OCIO processor */
@@ -3966,6 +4412,9 @@ void IMB_colormanagement_processor_free(ColormanageProcessor *cm_processor)
   if (cm_processor->cpu_processor) {
     OCIO_cpuProcessorRelease(cm_processor->cpu_processor);
   }
+  if (cm_processor->display_lut) {
+    display_lut_release(cm_processor->display_lut);
+  }
 
   MEM_freeN(cm_processor);
 }
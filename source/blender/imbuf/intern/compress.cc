@@ -0,0 +1,235 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup imbuf
+ *
+ * Lossless in-memory compression of image buffers, used by caches to keep frames around
+ * in a smaller form once they are evicted.
+ *
+ * Pixels are compressed with fast zstd. Float buffers are split into byte planes first
+ * (all lowest bytes, then all second bytes and so on), which groups the slowly changing
+ * sign and exponent bytes together and roughly doubles the ratio for typical renders.
+ */
+
+#include <cstring>
+
+#include <zstd.h>
+
+#include "BLI_math_vector.h"
+#include "BLI_task.hh"
+#include "BLI_utildefines.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+#include "IMB_metadata.h"
+
+/** Fastest zstd level, decompression speed is the same for all levels. */
+#define COMPRESS_LEVEL 1
+
+/** Don't keep compressed data which saves less than this fraction of the raw size. */
+#define COMPRESS_MIN_SAVING 0.1f
+
+struct ImBufCompressed {
+  int x, y;
+  unsigned char planes;
+  int channels;
+  int flags;
+  double ppm[2];
+  float dither;
+  struct IDProperty *metadata;
+  struct ColorSpace *rect_colorspace;
+  struct ColorSpace *float_colorspace;
+
+  /** Compressed pixels, null when the buffer doesn't exist. */
+  void *rect;
+  size_t rect_size;
+  void *rect_float;
+  size_t rect_float_size;
+};
+
+namespace blender::imbuf::compress {
+
+/* Loops are isolated, so callers may hold locks which are also used by other tasks. */
+
+static void shuffle_bytes(const uchar *src,
+                          uchar *dst,
+                          const size_t elem_num,
+                          const int elem_size)
+{
+  threading::isolate_task([&]() {
+    threading::parallel_for(IndexRange(elem_num), 1 << 16, [&](const IndexRange range) {
+      for (const int64_t i : range) {
+        for (int b = 0; b < elem_size; b++) {
+          dst[b * elem_num + i] = src[i * elem_size + b];
+        }
+      }
+    });
+  });
+}
+
+static void unshuffle_bytes(const uchar *src,
+                            uchar *dst,
+                            const size_t elem_num,
+                            const int elem_size)
+{
+  threading::isolate_task([&]() {
+    threading::parallel_for(IndexRange(elem_num), 1 << 16, [&](const IndexRange range) {
+      for (const int64_t i : range) {
+        for (int b = 0; b < elem_size; b++) {
+          dst[i * elem_size + b] = src[b * elem_num + i];
+        }
+      }
+    });
+  });
+}
+
+/**
+ * Compress `size_raw` bytes of `data` into a tightly sized allocation.
+ * Returns null when compression fails or doesn't save enough memory.
+ */
+static void *compress_data(const void *data, const size_t size_raw, size_t *r_size)
+{
+  const size_t size_bound = ZSTD_compressBound(size_raw);
+  void *buf = MEM_mallocN(size_bound, __func__);
+  const size_t size = ZSTD_compress(buf, size_bound, data, size_raw, COMPRESS_LEVEL);
+
+  if (ZSTD_isError(size) || size > size_raw * (1.0f - COMPRESS_MIN_SAVING)) {
+    MEM_freeN(buf);
+    return nullptr;
+  }
+
+  *r_size = size;
+  return MEM_reallocN(buf, size);
+}
+
+static bool decompress_data(const void *data, const size_t size, void *dst, const size_t size_raw)
+{
+  const size_t size_out = ZSTD_decompress(dst, size_raw, data, size);
+  return !ZSTD_isError(size_out) && size_out == size_raw;
+}
+
+}  // namespace blender::imbuf::compress
+
+using namespace blender::imbuf::compress;
+
+ImBufCompressed *IMB_compressed_from_imbuf(const ImBuf *ibuf)
+{
+  /* Only plain pixel buffers are supported, everything else can't be restored. */
+  if (ibuf == nullptr || (ibuf->rect == nullptr && ibuf->rect_float == nullptr) ||
+      ibuf->zbuf || ibuf->zbuf_float || ibuf->encodedbuffer) {
+    return nullptr;
+  }
+
+  const size_t pixels_num = IMB_get_rect_len(ibuf);
+  ImBufCompressed *cbuf = MEM_cnew<ImBufCompressed>(__func__);
+
+  if (ibuf->rect) {
+    cbuf->rect = compress_data(ibuf->rect, pixels_num * sizeof(uint), &cbuf->rect_size);
+    if (cbuf->rect == nullptr) {
+      IMB_compressed_free(cbuf);
+      return nullptr;
+    }
+  }
+
+  if (ibuf->rect_float) {
+    const size_t elem_num = pixels_num * ibuf->channels;
+    uchar *shuffled = static_cast<uchar *>(MEM_mallocN(elem_num * sizeof(float), __func__));
+    shuffle_bytes(
+        reinterpret_cast<const uchar *>(ibuf->rect_float), shuffled, elem_num, sizeof(float));
+    cbuf->rect_float = compress_data(shuffled, elem_num * sizeof(float), &cbuf->rect_float_size);
+    MEM_freeN(shuffled);
+    if (cbuf->rect_float == nullptr) {
+      IMB_compressed_free(cbuf);
+      return nullptr;
+    }
+  }
+
+  cbuf->x = ibuf->x;
+  cbuf->y = ibuf->y;
+  cbuf->planes = ibuf->planes;
+  cbuf->channels = ibuf->channels;
+  cbuf->flags = ibuf->flags & ~(IB_rect | IB_rectfloat);
+  copy_v2_v2_db(cbuf->ppm, ibuf->ppm);
+  cbuf->dither = ibuf->dither;
+  cbuf->rect_colorspace = ibuf->rect_colorspace;
+  cbuf->float_colorspace = ibuf->float_colorspace;
+
+  if (ibuf->metadata) {
+    ImBuf metadata_ibuf = {0};
+    IMB_metadata_copy(&metadata_ibuf, const_cast<ImBuf *>(ibuf));
+    cbuf->metadata = metadata_ibuf.metadata;
+  }
+
+  return cbuf;
+}
+
+ImBuf *IMB_compressed_to_imbuf(const ImBufCompressed *cbuf)
+{
+  ImBuf *ibuf = IMB_allocImBuf(cbuf->x, cbuf->y, cbuf->planes, 0);
+  if (ibuf == nullptr) {
+    return nullptr;
+  }
+
+  const size_t pixels_num = IMB_get_rect_len(ibuf);
+
+  ibuf->channels = cbuf->channels;
+  ibuf->flags |= cbuf->flags;
+  copy_v2_v2_db(ibuf->ppm, cbuf->ppm);
+  ibuf->dither = cbuf->dither;
+
+  if (cbuf->rect) {
+    if (!imb_addrectImBuf(ibuf) ||
+        !decompress_data(cbuf->rect, cbuf->rect_size, ibuf->rect, pixels_num * sizeof(uint))) {
+      IMB_freeImBuf(ibuf);
+      return nullptr;
+    }
+  }
+
+  if (cbuf->rect_float) {
+    const size_t elem_num = pixels_num * cbuf->channels;
+    uchar *shuffled = static_cast<uchar *>(MEM_mallocN(elem_num * sizeof(float), __func__));
+    const bool ok = imb_addrectfloatImBuf(ibuf, cbuf->channels) &&
+                    decompress_data(cbuf->rect_float,
+                                    cbuf->rect_float_size,
+                                    shuffled,
+                                    elem_num * sizeof(float));
+    if (ok) {
+      unshuffle_bytes(
+          shuffled, reinterpret_cast<uchar *>(ibuf->rect_float), elem_num, sizeof(float));
+    }
+    MEM_freeN(shuffled);
+    if (!ok) {
+      IMB_freeImBuf(ibuf);
+      return nullptr;
+    }
+  }
+
+  /* Assigned after allocation, which sets the default color spaces. */
+  ibuf->rect_colorspace = cbuf->rect_colorspace;
+  ibuf->float_colorspace = cbuf->float_colorspace;
+
+  if (cbuf->metadata) {
+    ImBuf metadata_ibuf = {0};
+    metadata_ibuf.metadata = cbuf->metadata;
+    IMB_metadata_copy(ibuf, &metadata_ibuf);
+  }
+
+  return ibuf;
+}
+
+size_t IMB_compressed_size_in_memory(const ImBufCompressed *cbuf)
+{
+  return sizeof(ImBufCompressed) + cbuf->rect_size + cbuf->rect_float_size;
+}
+
+void IMB_compressed_free(ImBufCompressed *cbuf)
+{
+  MEM_SAFE_FREE(cbuf->rect);
+  MEM_SAFE_FREE(cbuf->rect_float);
+  if (cbuf->metadata) {
+    IMB_metadata_free(cbuf->metadata);
+  }
+  MEM_freeN(cbuf);
+}
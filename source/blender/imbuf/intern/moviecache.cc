@@ -19,6 +19,7 @@
 #include "BLI_string.h"
 #include "BLI_threads.h"
 #include "BLI_utildefines.h"
+#include "BLI_vector.hh"
 
 #include "IMB_moviecache.h"
 
@@ -43,6 +44,11 @@ static MEM_CacheLimiterC *limitor = nullptr;
  * so regular mutex will not work here, hence the recursive lock. */
 static std::recursive_mutex limitor_lock;
 
+/* Items of caches with compression enabled, whose buffers were compressed by the limiter
+ * destructor. They are inserted back into the limiter once enforcing limits is finished,
+ * because the limiter can't be modified while it iterates its elements. */
+static blender::Vector<struct MovieCacheItem *> demoted_items;
+
 struct MovieCache {
   char name[64];
 
@@ -64,7 +70,9 @@ struct MovieCache {
   void *last_userkey;
 
   int totseg, *points, proxy, render_flags; /* for visual statistics optimization */
-  int pad;
+
+  /* Keep evicted buffers compressed in memory instead of freeing them. */
+  bool compress;
 };
 
 struct MovieCacheKey {
@@ -75,6 +83,8 @@ struct MovieCacheKey {
 struct MovieCacheItem {
   MovieCache *cache_owner;
   ImBuf *ibuf;
+  /* Compressed copy of the evicted #ibuf, only used when #ibuf is null. */
+  ImBufCompressed *cbuf;
   MEM_CacheLimiterHandleC *c_handle;
   void *priority_data;
   /* Indicates that #ibuf is null, because there was an error during load. */
@@ -117,11 +127,23 @@ static void moviecache_valfree(void *val)
     MEM_CacheLimiter_unmanage(item->c_handle);
     limitor_lock.unlock();
   }
+  else if (item->cbuf) {
+    limitor_lock.lock();
+    const int64_t index = demoted_items.first_index_of_try(item);
+    if (index != -1) {
+      demoted_items.remove_and_reorder(index);
+    }
+    limitor_lock.unlock();
+  }
 
   if (item->ibuf) {
     IMB_freeImBuf(item->ibuf);
   }
 
+  if (item->cbuf) {
+    IMB_compressed_free(item->cbuf);
+  }
+
   if (item->priority_data && cache->prioritydeleterfp) {
     cache->prioritydeleterfp(item->priority_data);
   }
@@ -147,7 +169,7 @@ static void check_unused_keys(MovieCache *cache)
       continue;
     }
 
-    bool remove = !item->ibuf;
+    bool remove = !item->ibuf && !item->cbuf;
 
     if (remove) {
       PRINT("%s: cache '%s' remove item %p without buffer\n", __func__, cache->name, item);
@@ -175,14 +197,59 @@ static void moviecache_destructor(void *p)
 
     PRINT("%s: cache '%s' destroy item %p buffer %p\n", __func__, cache->name, item, item->ibuf);
 
+    if (cache->compress) {
+      item->cbuf = IMB_compressed_from_imbuf(item->ibuf);
+    }
+
     IMB_freeImBuf(item->ibuf);
 
     item->ibuf = nullptr;
     item->c_handle = nullptr;
 
+    if (item->cbuf) {
+      demoted_items.append(item);
+    }
+
     /* force cached segments to be updated */
     MEM_SAFE_FREE(cache->points);
   }
+  else if (item && item->cbuf) {
+    MovieCache *cache = item->cache_owner;
+
+    PRINT("%s: cache '%s' destroy item %p compressed buffer %p\n",
+          __func__,
+          cache->name,
+          item,
+          item->cbuf);
+
+    IMB_compressed_free(item->cbuf);
+
+    item->cbuf = nullptr;
+    item->c_handle = nullptr;
+
+    MEM_SAFE_FREE(cache->points);
+  }
+}
+
+/**
+ * Enforce the limits, inserting items compressed by #moviecache_destructor back with their
+ * compressed size. That might exceed the limit again, in which case compressed items with the
+ * lowest priority are dropped. Every buffer is compressed at most once, so this terminates.
+ */
+static void moviecache_enforce_limits()
+{
+  MEM_CacheLimiter_enforce_limits(limitor);
+
+  while (!demoted_items.is_empty()) {
+    const blender::Vector<MovieCacheItem *> items = std::move(demoted_items);
+    demoted_items.clear();
+
+    for (MovieCacheItem *item : items) {
+      item->c_handle = MEM_CacheLimiter_insert(limitor, item);
+    }
+
+    MEM_CacheLimiter_enforce_limits(limitor);
+  }
 }
 
 static size_t get_size_in_memory(ImBuf *ibuf)
@@ -202,6 +269,9 @@ static size_t get_item_size(void *p)
   if (item->ibuf) {
     size += get_size_in_memory(item->ibuf);
   }
+  else if (item->cbuf) {
+    size += IMB_compressed_size_in_memory(item->cbuf);
+  }
 
   return size;
 }
@@ -306,6 +376,11 @@ void IMB_moviecache_set_priority_callback(struct MovieCache *cache,
   cache->prioritydeleterfp = prioritydeleterfp;
 }
 
+void IMB_moviecache_set_compress(struct MovieCache *cache, bool compress)
+{
+  cache->compress = compress;
+}
+
 static void do_moviecache_put(MovieCache *cache, void *userkey, ImBuf *ibuf, bool need_lock)
 {
   MovieCacheKey *key;
@@ -329,6 +404,7 @@ static void do_moviecache_put(MovieCache *cache, void *userkey, ImBuf *ibuf, boo
   PRINT("%s: cache '%s' put %p, item %p\n", __func__, cache->name, ibuf, item);
 
   item->ibuf = ibuf;
+  item->cbuf = nullptr;
   item->cache_owner = cache;
   item->c_handle = nullptr;
   item->priority_data = nullptr;
@@ -351,7 +427,7 @@ static void do_moviecache_put(MovieCache *cache, void *userkey, ImBuf *ibuf, boo
   item->c_handle = MEM_CacheLimiter_insert(limitor, item);
 
   MEM_CacheLimiter_ref(item->c_handle);
-  MEM_CacheLimiter_enforce_limits(limitor);
+  moviecache_enforce_limits();
   MEM_CacheLimiter_unref(item->c_handle);
 
   if (need_lock) {
@@ -421,6 +497,47 @@ ImBuf *IMB_moviecache_get(MovieCache *cache, void *userkey, bool *r_is_cached_em
 
       return item->ibuf;
     }
+    if (item->cbuf) {
+      /* Keep the compressed buffer alive by referencing the item, so that it isn't freed by
+       * another thread enforcing the limits while it is decompressed without holding the lock. */
+      limitor_lock.lock();
+      ImBufCompressed *cbuf = item->cbuf;
+      if (cbuf == nullptr || item->c_handle == nullptr) {
+        limitor_lock.unlock();
+        return nullptr;
+      }
+      MEM_CacheLimiter_ref(item->c_handle);
+      limitor_lock.unlock();
+
+      ImBuf *ibuf = IMB_compressed_to_imbuf(cbuf);
+
+      PRINT("%s: cache '%s' decompress item %p\n", __func__, cache->name, item);
+
+      limitor_lock.lock();
+      if (ibuf != nullptr && item->cbuf == cbuf) {
+        IMB_compressed_free(item->cbuf);
+        item->cbuf = nullptr;
+        item->ibuf = ibuf;
+        IMB_refImBuf(ibuf);
+
+        /* The item grew back to its full size. */
+        MEM_CacheLimiter_touch(item->c_handle);
+        moviecache_enforce_limits();
+      }
+      else if (item->ibuf != nullptr) {
+        /* Another thread decompressed the item in the meantime. */
+        if (ibuf != nullptr) {
+          IMB_freeImBuf(ibuf);
+        }
+        ibuf = item->ibuf;
+        IMB_refImBuf(ibuf);
+        MEM_CacheLimiter_touch(item->c_handle);
+      }
+      MEM_CacheLimiter_unref(item->c_handle);
+      limitor_lock.unlock();
+
+      return ibuf;
+    }
     if (r_is_cached_empty) {
       *r_is_cached_empty = true;
     }
@@ -516,7 +633,7 @@ void IMB_moviecache_get_cache_segments(
       MovieCacheItem *item = (MovieCacheItem *)BLI_ghashIterator_getValue(&gh_iter);
       int framenr, curproxy, curflags;
 
-      if (item->ibuf) {
+      if (item->ibuf || item->cbuf) {
         cache->getdatafp(key->userkey, &framenr, &curproxy, &curflags);
 
         if (curproxy == proxy && curflags == render_flags) {
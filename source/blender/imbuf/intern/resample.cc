@@ -0,0 +1,384 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup imbuf
+ *
+ * Separable image resampling.
+ *
+ * Filter weights are computed once for every destination column and row, then images are
+ * resampled in two passes (one per axis) through a float buffer. The pass reducing the most
+ * data runs first, rows are processed in parallel, four channels at a time with SSE.
+ */
+
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+#include "BLI_math_base.h"
+#include "BLI_simd.h"
+#include "BLI_task.hh"
+#include "BLI_utildefines.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+
+#include "IMB_filter.h"
+#include "IMB_resample.hh"
+
+namespace blender::imbuf::resample {
+
+/* -------------------------------------------------------------------- */
+/** \name Filter Weights
+ * \{ */
+
+/** Radius of the filter in source pixels, when not scaling down. */
+static float filter_radius(const eIMBResampleFilter filter)
+{
+  switch (filter) {
+    case IMB_RESAMPLE_BOX:
+      return 0.5f;
+    case IMB_RESAMPLE_BILINEAR:
+      return 1.0f;
+    case IMB_RESAMPLE_BICUBIC:
+      return 2.0f;
+    case IMB_RESAMPLE_LANCZOS3:
+      return 3.0f;
+  }
+  BLI_assert_unreachable();
+  return 1.0f;
+}
+
+static double sinc(const double x)
+{
+  if (x == 0.0) {
+    return 1.0;
+  }
+  return sin(M_PI * x) / (M_PI * x);
+}
+
+/**
+ * Weight of source pixel \a src_index for a destination pixel at \a center (in source pixels),
+ * with the filter stretched by \a filter_scale when scaling down.
+ */
+static double filter_weight(const eIMBResampleFilter filter,
+                            const int src_index,
+                            const double center,
+                            const double filter_scale)
+{
+  if (filter == IMB_RESAMPLE_BOX) {
+    /* Exact coverage of the source pixel, so scaling down averages the covered area. */
+    const double min = max_dd(double(src_index), center - filter_scale * 0.5);
+    const double max = min_dd(double(src_index + 1), center + filter_scale * 0.5);
+    return max_dd(max - min, 0.0);
+  }
+
+  const double x = fabs((double(src_index) + 0.5 - center) / filter_scale);
+  switch (filter) {
+    case IMB_RESAMPLE_BILINEAR:
+      return max_dd(1.0 - x, 0.0);
+    case IMB_RESAMPLE_BICUBIC: {
+      /* Catmull-Rom spline. */
+      if (x < 1.0) {
+        return (1.5 * x - 2.5) * x * x + 1.0;
+      }
+      if (x < 2.0) {
+        return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+      }
+      return 0.0;
+    }
+    case IMB_RESAMPLE_LANCZOS3:
+      return (x < 3.0) ? sinc(x) * sinc(x / 3.0) : 0.0;
+    case IMB_RESAMPLE_BOX:
+      break;
+  }
+  BLI_assert_unreachable();
+  return 0.0;
+}
+
+FilterWeights filter_weights_compute(const int src_size,
+                                     const int dst_size,
+                                     const eIMBResampleFilter filter)
+{
+  const double scale = double(src_size) / double(dst_size);
+  /* Stretch the filter when scaling down, so all source pixels contribute. */
+  const double filter_scale = max_dd(scale, 1.0);
+  const double radius = double(filter_radius(filter)) * filter_scale;
+
+  FilterWeights result;
+  result.taps = min_ii(int(ceil(radius * 2.0)) + 1, src_size);
+  result.start = Array<int>(dst_size);
+  result.weights = Array<float>(int64_t(dst_size) * result.taps, 0.0f);
+
+  for (const int i : IndexRange(dst_size)) {
+    const double center = (double(i) + 0.5) * scale;
+    const int first = max_ii(int(floor(center - radius)), 0);
+    const int last = min_ii(min_ii(int(ceil(center + radius)), src_size), first + result.taps);
+    /* Keep all taps inside the image, unused taps at the end get a zero weight. */
+    const int start = min_ii(first, src_size - result.taps);
+    float *weights = &result.weights[int64_t(i) * result.taps];
+
+    double sum = 0.0;
+    for (int j = first; j < last; j++) {
+      const double weight = filter_weight(filter, j, center, filter_scale);
+      weights[j - start] = float(weight);
+      sum += weight;
+    }
+
+    if (sum == 0.0) {
+      /* Can only happen for degenerate sizes, use the nearest pixel. */
+      const int nearest = clamp_i(int(center), start, start + result.taps - 1);
+      weights[nearest - start] = 1.0f;
+    }
+    else {
+      for (const int j : IndexRange(result.taps)) {
+        weights[j] = float(double(weights[j]) / sum);
+      }
+    }
+    result.start[i] = start;
+  }
+
+  return result;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Row Kernels
+ * \{ */
+
+#ifdef BLI_HAVE_SSE2
+BLI_INLINE __m128 load_float4(const float *src)
+{
+  return _mm_loadu_ps(src);
+}
+
+BLI_INLINE __m128 load_float4(const uchar *src)
+{
+  int32_t value;
+  memcpy(&value, src, sizeof(value));
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i value_i8 = _mm_cvtsi32_si128(value);
+  const __m128i value_i16 = _mm_unpacklo_epi8(value_i8, zero);
+  return _mm_cvtepi32_ps(_mm_unpacklo_epi16(value_i16, zero));
+}
+#endif
+
+/**
+ * Resample a row along X.
+ * \param dst: Row of #FilterWeights.start size times \a channels floats.
+ */
+template<typename T>
+static void resample_row_x(const T *src,
+                           float *dst,
+                           const FilterWeights &weights_x,
+                           const int channels)
+{
+  const int taps = weights_x.taps;
+  const float *weights = weights_x.weights.data();
+  const int dst_size = int(weights_x.start.size());
+
+#ifdef BLI_HAVE_SSE2
+  if (channels == 4) {
+    for (int i = 0; i < dst_size; i++, weights += taps) {
+      const T *src_pixel = src + int64_t(weights_x.start[i]) * 4;
+      __m128 sum = _mm_setzero_ps();
+      for (int k = 0; k < taps; k++) {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), load_float4(src_pixel + k * 4)));
+      }
+      _mm_storeu_ps(dst + int64_t(i) * 4, sum);
+    }
+    return;
+  }
+#endif
+
+  for (int i = 0; i < dst_size; i++, weights += taps) {
+    const T *src_pixel = src + int64_t(weights_x.start[i]) * channels;
+    float *dst_pixel = dst + int64_t(i) * channels;
+    for (int c = 0; c < channels; c++) {
+      float sum = 0.0f;
+      for (int k = 0; k < taps; k++) {
+        sum += weights[k] * float(src_pixel[k * channels + c]);
+      }
+      dst_pixel[c] = sum;
+    }
+  }
+}
+
+/**
+ * Resample a row along Y, combining \a taps rows of \a src starting at row \a start.
+ * \param len: Number of values in a row (pixels times channels).
+ */
+template<typename T>
+static void resample_row_y(const T *src,
+                           const int64_t len,
+                           const int start,
+                           const float *weights,
+                           const int taps,
+                           float *dst)
+{
+  const T *src_rows = src + int64_t(start) * len;
+  int64_t i = 0;
+
+#ifdef BLI_HAVE_SSE2
+  for (; i + 4 <= len; i += 4) {
+    __m128 sum = _mm_setzero_ps();
+    for (int k = 0; k < taps; k++) {
+      sum = _mm_add_ps(sum,
+                       _mm_mul_ps(_mm_set1_ps(weights[k]), load_float4(src_rows + k * len + i)));
+    }
+    _mm_storeu_ps(dst + i, sum);
+  }
+#endif
+
+  for (; i < len; i++) {
+    float sum = 0.0f;
+    for (int k = 0; k < taps; k++) {
+      sum += weights[k] * float(src_rows[k * len + i]);
+    }
+    dst[i] = sum;
+  }
+}
+
+/** Round and clamp a resampled row to bytes. */
+static void row_store(const float *src, uchar *dst, const int64_t len)
+{
+  int64_t i = 0;
+
+#ifdef BLI_HAVE_SSE2
+  const __m128 half = _mm_set1_ps(0.5f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 max = _mm_set1_ps(255.0f);
+  for (; i + 4 <= len; i += 4) {
+    const __m128 value = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_loadu_ps(src + i), half), zero),
+                                    max);
+    const __m128i value_i32 = _mm_cvttps_epi32(value);
+    const __m128i value_i16 = _mm_packs_epi32(value_i32, value_i32);
+    const int32_t value_i8 = _mm_cvtsi128_si32(_mm_packus_epi16(value_i16, value_i16));
+    memcpy(dst + i, &value_i8, sizeof(value_i8));
+  }
+#endif
+
+  for (; i < len; i++) {
+    dst[i] = uchar(clamp_f(src[i] + 0.5f, 0.0f, 255.0f));
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Image Resampling
+ * \{ */
+
+template<typename T>
+static T *resample_buffer(const T *src,
+                          const int src_x,
+                          const int src_y,
+                          const int channels,
+                          const FilterWeights &weights_x,
+                          const FilterWeights &weights_y)
+{
+  const int dst_x = int(weights_x.start.size());
+  const int dst_y = int(weights_y.start.size());
+  const int64_t src_len = int64_t(src_x) * channels;
+  const int64_t dst_len = int64_t(dst_x) * channels;
+
+  T *dst = static_cast<T *>(
+      MEM_mallocN(sizeof(T) * size_t(dst_len) * size_t(dst_y), "resampled image buffer"));
+
+  /* Float buffers store the final rows directly, byte rows are resampled into a buffer that is
+   * allocated once for every range of rows. */
+  auto row_buffer_new = [&]() {
+    return Array<float>(std::is_same_v<T, float> ? 0 : dst_len, NoInitialization());
+  };
+  auto store_row = [&](const int64_t y, Array<float> &row, const auto &resample_fn) {
+    T *dst_row = dst + y * dst_len;
+    if constexpr (std::is_same_v<T, float>) {
+      UNUSED_VARS(row);
+      resample_fn(dst_row);
+    }
+    else {
+      resample_fn(row.data());
+      row_store(row.data(), dst_row, dst_len);
+    }
+  };
+
+  /* Resample the axis reducing the data the most first, for a smaller intermediate buffer. */
+  if (int64_t(dst_x) * src_y <= int64_t(src_x) * dst_y) {
+    Array<float> tmp(dst_len * src_y, NoInitialization());
+    threading::parallel_for(IndexRange(src_y), 64, [&](const IndexRange range) {
+      for (const int64_t y : range) {
+        resample_row_x(src + y * src_len, &tmp[y * dst_len], weights_x, channels);
+      }
+    });
+    threading::parallel_for(IndexRange(dst_y), 32, [&](const IndexRange range) {
+      Array<float> row = row_buffer_new();
+      for (const int64_t y : range) {
+        store_row(y, row, [&](float *dst_row) {
+          resample_row_y(tmp.data(),
+                         dst_len,
+                         weights_y.start[y],
+                         &weights_y.weights[y * weights_y.taps],
+                         weights_y.taps,
+                         dst_row);
+        });
+      }
+    });
+  }
+  else {
+    Array<float> tmp(src_len * dst_y, NoInitialization());
+    threading::parallel_for(IndexRange(dst_y), 32, [&](const IndexRange range) {
+      Array<float> row = row_buffer_new();
+      for (const int64_t y : range) {
+        resample_row_y(src,
+                       src_len,
+                       weights_y.start[y],
+                       &weights_y.weights[y * weights_y.taps],
+                       weights_y.taps,
+                       &tmp[y * src_len]);
+        store_row(y, row, [&](float *dst_row) {
+          resample_row_x(&tmp[y * src_len], dst_row, weights_x, channels);
+        });
+      }
+    });
+  }
+
+  return dst;
+}
+
+/** \} */
+
+}  // namespace blender::imbuf::resample
+
+using namespace blender::imbuf::resample;
+
+void imb_resample_buffers(struct ImBuf *ibuf,
+                          const int newx,
+                          const int newy,
+                          const eIMBResampleFilter filter_x,
+                          const eIMBResampleFilter filter_y)
+{
+  BLI_assert(newx > 0 && newy > 0);
+
+  const FilterWeights weights_x = filter_weights_compute(ibuf->x, newx, filter_x);
+  const FilterWeights weights_y = filter_weights_compute(ibuf->y, newy, filter_y);
+
+  if (ibuf->rect) {
+    uchar *rect = resample_buffer(
+        reinterpret_cast<const uchar *>(ibuf->rect), ibuf->x, ibuf->y, 4, weights_x, weights_y);
+    imb_freerectImBuf(ibuf);
+    ibuf->mall |= IB_rect;
+    ibuf->rect = reinterpret_cast<uint *>(rect);
+  }
+  if (ibuf->rect_float) {
+    float *rect_float = resample_buffer(
+        ibuf->rect_float, ibuf->x, ibuf->y, ibuf->channels, weights_x, weights_y);
+    imb_freerectfloatImBuf(ibuf);
+    ibuf->mall |= IB_rectfloat;
+    ibuf->rect_float = rect_float;
+  }
+
+  ibuf->x = newx;
+  ibuf->y = newy;
+}
@@ -0,0 +1,118 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "testing/testing.h"
+
+#include "CLG_log.h"
+
+#include "BLI_math_base.h"
+#include "BLI_rand.hh"
+#include "BLI_string.h"
+#include "BLI_vector.hh"
+
+#include "BKE_appdir.h"
+
+#include "DNA_color_types.h"
+
+#include "IMB_colormanagement.h"
+#include "IMB_colormanagement_intern.h"
+#include "IMB_imbuf.h"
+
+namespace blender::imbuf::tests {
+
+class ColormanagementDisplayLutTest : public testing::Test {
+ public:
+  static void SetUpTestSuite()
+  {
+    CLG_init();
+    BKE_appdir_init();
+    IMB_init();
+  }
+
+  static void TearDownTestSuite()
+  {
+    IMB_exit();
+    BKE_appdir_exit();
+    CLG_exit();
+  }
+
+  void SetUp() override
+  {
+    STRNCPY(display_settings.display_device, IMB_colormanagement_display_get_default_name());
+    IMB_colormanagement_init_default_view_settings(&view_settings, &display_settings);
+  }
+
+  void TearDown() override
+  {
+    colormanage_display_lut_tolerance_set(DISPLAY_LUT_TOLERANCE_DEFAULT);
+  }
+
+  /** Apply the display transform, baking LUTs with \a tolerance. */
+  Vector<float> display_transform(const Span<float> pixels,
+                                  const float tolerance,
+                                  bool *r_uses_lut)
+  {
+    colormanage_display_lut_tolerance_set(tolerance);
+    ColormanageProcessor *cm_processor = IMB_colormanagement_display_processor_new(
+        &view_settings, &display_settings);
+    *r_uses_lut = colormanage_processor_uses_display_lut(cm_processor);
+
+    Vector<float> result(pixels);
+    IMB_colormanagement_processor_apply(
+        cm_processor, result.data(), result.size() / 4, 1, 4, true);
+    IMB_colormanagement_processor_free(cm_processor);
+    return result;
+  }
+
+  ColorManagedDisplaySettings display_settings = {};
+  ColorManagedViewSettings view_settings = {};
+};
+
+/** Scene linear pixels in the range of the LUT, with a few outside of it. */
+static Vector<float> test_pixels()
+{
+  RandomNumberGenerator rng(23);
+  Vector<float> pixels;
+  for (int i = 0; i < 4096; i++) {
+    const float scale = (i % 2) ? 1.0f : 16.0f;
+    pixels.extend({rng.get_float() * scale, rng.get_float() * scale, rng.get_float() * scale});
+    pixels.append((i % 3) ? 1.0f : rng.get_float());
+  }
+  pixels.extend({100.0f, 0.5f, 0.5f, 1.0f});
+  pixels.extend({-0.25f, 0.5f, 0.5f, 1.0f});
+  return pixels;
+}
+
+TEST_F(ColormanagementDisplayLutTest, within_tolerance)
+{
+  const Vector<float> pixels = test_pixels();
+  view_settings.exposure = 0.5f;
+
+  bool uses_lut;
+  const Vector<float> exact = display_transform(pixels, 0.0f, &uses_lut);
+  EXPECT_FALSE(uses_lut);
+  const Vector<float> result = display_transform(pixels, DISPLAY_LUT_TOLERANCE_DEFAULT, &uses_lut);
+  ASSERT_TRUE(uses_lut);
+
+  /* The tolerance is only checked at validation samples when baking, leave some margin for
+   * values in between. */
+  for (const int64_t i : pixels.index_range()) {
+    const float tolerance = DISPLAY_LUT_TOLERANCE_DEFAULT * 2.0f * max_ff(fabsf(exact[i]), 1.0f);
+    ASSERT_NEAR(result[i], exact[i], tolerance) << "index: " << i;
+  }
+}
+
+TEST_F(ColormanagementDisplayLutTest, falls_back_when_inaccurate)
+{
+  const Vector<float> pixels = test_pixels();
+
+  bool uses_lut;
+  const Vector<float> exact = display_transform(pixels, 0.0f, &uses_lut);
+  EXPECT_FALSE(uses_lut);
+
+  /* No LUT can be this accurate, the exact transform is used instead. */
+  const Vector<float> result = display_transform(pixels, 1e-12f, &uses_lut);
+  EXPECT_FALSE(uses_lut);
+  EXPECT_EQ(result, exact);
+}
+
+}  // namespace blender::imbuf::tests
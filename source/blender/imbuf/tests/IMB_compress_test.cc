@@ -0,0 +1,93 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "testing/testing.h"
+
+#include <cstring>
+
+#include "BLI_rand.h"
+
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+
+namespace blender::imbuf::tests {
+
+static ImBuf *create_test_imbuf(const int width, const int height, const int flags)
+{
+  ImBuf *ibuf = IMB_allocImBuf(width, height, 32, flags);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      const int i = y * width + x;
+      if (ibuf->rect) {
+        uchar *pixel = reinterpret_cast<uchar *>(&ibuf->rect[i]);
+        pixel[0] = uchar(x);
+        pixel[1] = uchar(y);
+        pixel[2] = uchar(x ^ y);
+        pixel[3] = 255;
+      }
+      if (ibuf->rect_float) {
+        float *pixel = &ibuf->rect_float[i * 4];
+        pixel[0] = float(x) / width;
+        pixel[1] = float(y) / height;
+        pixel[2] = (x + y) * 0.25f;
+        pixel[3] = 1.0f;
+      }
+    }
+  }
+  return ibuf;
+}
+
+TEST(imbuf_compress, RoundTrip)
+{
+  ImBuf *ibuf = create_test_imbuf(301, 157, IB_rect | IB_rectfloat);
+  ImBufCompressed *cbuf = IMB_compressed_from_imbuf(ibuf);
+  ASSERT_NE(cbuf, nullptr);
+  EXPECT_LT(IMB_compressed_size_in_memory(cbuf), IMB_get_size_in_memory(ibuf));
+
+  ImBuf *result = IMB_compressed_to_imbuf(cbuf);
+  ASSERT_NE(result, nullptr);
+  EXPECT_EQ(result->x, ibuf->x);
+  EXPECT_EQ(result->y, ibuf->y);
+  EXPECT_EQ(result->channels, ibuf->channels);
+  ASSERT_NE(result->rect, nullptr);
+  ASSERT_NE(result->rect_float, nullptr);
+
+  const size_t pixels_num = IMB_get_rect_len(ibuf);
+  EXPECT_EQ(memcmp(result->rect, ibuf->rect, pixels_num * sizeof(uint)), 0);
+  EXPECT_EQ(memcmp(result->rect_float, ibuf->rect_float, pixels_num * 4 * sizeof(float)), 0);
+
+  IMB_freeImBuf(result);
+  IMB_compressed_free(cbuf);
+  IMB_freeImBuf(ibuf);
+}
+
+TEST(imbuf_compress, RoundTripByteOnly)
+{
+  ImBuf *ibuf = create_test_imbuf(64, 64, IB_rect);
+  ImBufCompressed *cbuf = IMB_compressed_from_imbuf(ibuf);
+  ASSERT_NE(cbuf, nullptr);
+
+  ImBuf *result = IMB_compressed_to_imbuf(cbuf);
+  ASSERT_NE(result, nullptr);
+  EXPECT_EQ(result->rect_float, nullptr);
+  EXPECT_EQ(memcmp(result->rect, ibuf->rect, IMB_get_rect_len(ibuf) * sizeof(uint)), 0);
+
+  IMB_freeImBuf(result);
+  IMB_compressed_free(cbuf);
+  IMB_freeImBuf(ibuf);
+}
+
+TEST(imbuf_compress, Incompressible)
+{
+  /* Random pixels don't compress, those buffers are not kept. */
+  ImBuf *ibuf = IMB_allocImBuf(64, 64, 32, IB_rect);
+  RNG *rng = BLI_rng_new(0);
+  BLI_rng_get_char_n(
+      rng, reinterpret_cast<char *>(ibuf->rect), IMB_get_rect_len(ibuf) * sizeof(uint));
+  BLI_rng_free(rng);
+
+  EXPECT_EQ(IMB_compressed_from_imbuf(ibuf), nullptr);
+
+  IMB_freeImBuf(ibuf);
+}
+
+}  // namespace blender::imbuf::tests
@@ -0,0 +1,121 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "testing/testing.h"
+
+#include "BLI_math_vector_types.hh"
+
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+#include "IMB_resample.hh"
+
+namespace blender::imbuf::resample::tests {
+
+static const eIMBResampleFilter filters[] = {
+    IMB_RESAMPLE_BOX, IMB_RESAMPLE_BILINEAR, IMB_RESAMPLE_BICUBIC, IMB_RESAMPLE_LANCZOS3};
+
+/** Scaling down, up, to a single pixel, and sizes that are not multiples of each other. */
+static const int2 sizes[] = {
+    {64, 17}, {17, 64}, {5, 1}, {1, 5}, {7, 7}, {100, 3}, {3, 100}, {33, 32}};
+
+/**
+ * Image with every pixel set to \a value for the inner columns and \a edge_value for the
+ * \a edge_size outermost columns on both sides.
+ */
+static ImBuf *create_test_imbuf(const int width,
+                                const int height,
+                                const float value,
+                                const int edge_size,
+                                const float edge_value)
+{
+  ImBuf *ibuf = IMB_allocImBuf(width, height, 32, IB_rect | IB_rectfloat);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      const bool is_edge = x < edge_size || x >= width - edge_size;
+      const float pixel_value = is_edge ? edge_value : value;
+      const int i = y * width + x;
+      uchar *pixel = reinterpret_cast<uchar *>(&ibuf->rect[i]);
+      for (int c = 0; c < 4; c++) {
+        pixel[c] = uchar(pixel_value * 255.0f + 0.5f);
+        ibuf->rect_float[i * 4 + c] = pixel_value;
+      }
+    }
+  }
+  return ibuf;
+}
+
+TEST(imbuf_resample, WeightsSumToOne)
+{
+  for (const eIMBResampleFilter filter : filters) {
+    for (const int2 size : sizes) {
+      const FilterWeights weights = filter_weights_compute(size[0], size[1], filter);
+      ASSERT_EQ(weights.start.size(), size[1]);
+      for (const int i : IndexRange(size[1])) {
+        float sum = 0.0f;
+        for (const int k : IndexRange(weights.taps)) {
+          sum += weights.weights[i * weights.taps + k];
+        }
+        EXPECT_NEAR(sum, 1.0f, 1e-5f) << "filter: " << filter << ", " << size[0] << " to "
+                                      << size[1] << ", pixel: " << i;
+      }
+    }
+  }
+}
+
+TEST(imbuf_resample, TapsInsideSource)
+{
+  for (const eIMBResampleFilter filter : filters) {
+    for (const int2 size : sizes) {
+      const FilterWeights weights = filter_weights_compute(size[0], size[1], filter);
+      EXPECT_GT(weights.taps, 0);
+      for (const int start : weights.start) {
+        EXPECT_GE(start, 0);
+        EXPECT_LE(start + weights.taps, size[0]);
+      }
+    }
+  }
+}
+
+TEST(imbuf_resample, ConstantStaysConstant)
+{
+  for (const eIMBResampleFilter filter : filters) {
+    for (const int2 size : sizes) {
+      ImBuf *ibuf = create_test_imbuf(size[0], size[1], 0.3f, 0, 0.0f);
+      imb_resample_buffers(ibuf, size[1], size[0], filter, filter);
+      ASSERT_EQ(ibuf->x, size[1]);
+      ASSERT_EQ(ibuf->y, size[0]);
+
+      const uchar expected_byte = uchar(0.3f * 255.0f + 0.5f);
+      const uchar *rect = reinterpret_cast<const uchar *>(ibuf->rect);
+      for (const int64_t i : IndexRange(IMB_get_rect_len(ibuf) * 4)) {
+        ASSERT_EQ(rect[i], expected_byte) << "filter: " << filter << ", index: " << i;
+        ASSERT_NEAR(ibuf->rect_float[i], 0.3f, 1e-5f) << "filter: " << filter << ", index: " << i;
+      }
+      IMB_freeImBuf(ibuf);
+    }
+  }
+}
+
+TEST(imbuf_resample, EdgesClamp)
+{
+  /* The edge columns are wider than every filter, so the outermost pixels only see the edge
+   * value. Sampling outside the image as black would darken them. */
+  for (const eIMBResampleFilter filter : filters) {
+    for (const int2 size : {int2(64, 256), int2(256, 64), int2(64, 64)}) {
+      ImBuf *ibuf = create_test_imbuf(size[0], 4, 0.2f, 16, 0.9f);
+      imb_resample_buffers(ibuf, size[1], 4, filter, filter);
+
+      const uchar expected_byte = uchar(0.9f * 255.0f + 0.5f);
+      const uchar *rect = reinterpret_cast<const uchar *>(ibuf->rect);
+      for (const int y : IndexRange(ibuf->y)) {
+        for (const int x : {0, ibuf->x - 1}) {
+          const int64_t i = (int64_t(y) * ibuf->x + x) * 4;
+          EXPECT_EQ(rect[i], expected_byte) << "filter: " << filter << ", x: " << x;
+          EXPECT_NEAR(ibuf->rect_float[i], 0.9f, 1e-5f) << "filter: " << filter << ", x: " << x;
+        }
+      }
+      IMB_freeImBuf(ibuf);
+    }
+  }
+}
+
+}  // namespace blender::imbuf::resample::tests
@@ -667,6 +667,7 @@ typedef struct bNodeTree {
 
 /* tree is localized copy, free when deleting node groups */
 /* #define NTREE_IS_LOCALIZED           (1 << 5) */
+#define NTREE_COM_HALF_BUFFERS (1 << 6) /* Use half float intermediate buffers. */
 
 /* tree->execution_mode */
 typedef enum eNodeTreeExecutionMode {
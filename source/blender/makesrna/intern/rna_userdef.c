@@ -31,6 +31,8 @@
 
 #include "GPU_platform.h"
 
+#include "SEQ_render.h"
+
 #include "UI_interface_icons.h"
 
 #include "rna_internal.h"
@@ -5501,6 +5503,15 @@ static void rna_def_userdef_system(BlenderRNA *brna)
   RNA_def_property_enum_sdna(prop, NULL, "sequencer_proxy_setup");
   RNA_def_property_ui_text(prop, "Proxy Setup", "When and how proxies are created");
 
+  prop = RNA_def_property(srna, "sequencer_prefetch_threads", PROP_INT, PROP_NONE);
+  RNA_def_property_int_sdna(prop, NULL, "sequencer_prefetch_threads");
+  RNA_def_property_range(prop, 1, SEQ_PREFETCH_RENDERERS_MAX);
+  RNA_def_property_ui_text(
+      prop,
+      "Prefetch Threads",
+      "Number of frames rendered at the same time when prefetching frames. Each thread uses its "
+      "own copy of the scene");
+
   prop = RNA_def_property(srna, "scrollback", PROP_INT, PROP_UNSIGNED);
   RNA_def_property_int_sdna(prop, NULL, "scrollback");
   RNA_def_property_range(prop, 32, 32768);
@@ -6433,6 +6444,13 @@ static void rna_def_userdef_experimental(BlenderRNA *brna)
                            "Enable the new Workbench codebase, requires "
                            "restart");
 
+  prop = RNA_def_property(srna, "use_geometry_nodes_result_cache", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, NULL, "use_geometry_nodes_result_cache", 1);
+  RNA_def_property_ui_text(prop,
+                           "Geometry Nodes Result Cache",
+                           "Reuse results of geometry nodes whose inputs did not change since the "
+                           "previous evaluation, at the cost of additional memory usage");
+
   prop = RNA_def_property(srna, "use_viewport_debug", PROP_BOOLEAN, PROP_NONE);
   RNA_def_property_boolean_sdna(prop, NULL, "use_viewport_debug", 1);
   RNA_def_property_ui_text(prop,
@@ -6447,6 +6465,20 @@ static void rna_def_userdef_experimental(BlenderRNA *brna)
       "All Linked Data Direct",
       "Forces all linked data to be considered as directly linked. Workaround for current "
       "issues/limitations in BAT (Blender studio pipeline tool)");
+
+  prop = RNA_def_property(srna, "use_mapped_file_data", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_ui_text(prop,
+                           "Memory-Mapped File Data",
+                           "Keep large mesh attribute arrays of uncompressed files in the "
+                           "memory-mapped file instead of reading them, until they are modified. "
+                           "Files stay mapped until Blender exits");
+
+  prop = RNA_def_property(srna, "use_delta_save", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_ui_text(prop,
+                           "Delta Save",
+                           "When saving an uncompressed file again, copy the data which didn't "
+                           "change since the previous save from the existing file instead of "
+                           "writing it");
 }
 
 static void rna_def_userdef_addon_collection(BlenderRNA *brna, PropertyRNA *cprop)
@@ -144,7 +144,9 @@ static void deformVerts(ModifierData *md,
 
     if (collmd->time_xnew == -1000) { /* first time */
 
-      collmd->x = MEM_dupallocN(BKE_mesh_vert_positions(mesh_src)); /* frame start position */
+      /* Frame start position. */
+      collmd->x = MEM_malloc_arrayN(mvert_num, sizeof(float[3]), __func__);
+      memcpy(collmd->x, BKE_mesh_vert_positions(mesh_src), sizeof(float[3]) * mvert_num);
 
       for (uint i = 0; i < mvert_num; i++) {
         /* we save global positions */
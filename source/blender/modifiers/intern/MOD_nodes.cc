@@ -33,6 +33,7 @@
 #include "DNA_scene_types.h"
 #include "DNA_screen_types.h"
 #include "DNA_space_types.h"
+#include "DNA_userdef_types.h"
 #include "DNA_view3d_types.h"
 #include "DNA_windowmanager_types.h"
 
@@ -84,6 +85,7 @@
 #include "ED_viewer_path.hh"
 
 #include "NOD_geometry.h"
+#include "NOD_geometry_nodes_cache.hh"
 #include "NOD_geometry_nodes_lazy_function.hh"
 #include "NOD_node_declaration.hh"
 
@@ -1149,6 +1151,12 @@ static GeometrySet compute_geometry(
   blender::nodes::GeoNodesModifierData geo_nodes_modifier_data;
   geo_nodes_modifier_data.depsgraph = ctx->depsgraph;
   geo_nodes_modifier_data.self_object = ctx->object;
+  geo_nodes_modifier_data.use_result_cache = USER_EXPERIMENTAL_TEST(
+      &U, use_geometry_nodes_result_cache);
+  if (!geo_nodes_modifier_data.use_result_cache) {
+    /* Free memory as soon as the cache is disabled. */
+    blender::nodes::geo_eval_cache::clear();
+  }
   auto eval_log = std::make_unique<GeoModifierLog>();
 
   Set<blender::ComputeContextHash> socket_log_contexts;
@@ -12,6 +12,16 @@ extern struct bNodeTreeType *ntreeType_Geometry;
 
 void register_node_type_geo_custom_group(bNodeType *ntype);
 
+/**
+ * Start recording the evaluation of geometry nodes, see `NOD_geometry_nodes_profile.hh`.
+ */
+void NOD_geometry_nodes_profile_begin(void);
+/**
+ * Stop recording and write the profile to \a filepath, does nothing when not recording.
+ * \return False when writing the file failed.
+ */
+bool NOD_geometry_nodes_profile_end(const char *filepath);
+
 #ifdef __cplusplus
 }
 #endif
@@ -16,6 +16,10 @@
 
 namespace blender::nodes {
 
+namespace geo_eval_cache {
+class NodeLog;
+}
+
 using bke::AnonymousAttributeFieldInput;
 using bke::AnonymousAttributeID;
 using bke::AnonymousAttributePropagationInfo;
@@ -66,18 +70,22 @@ class GeoNodeExecParams {
   const lf::Context &lf_context_;
   const Map<StringRef, int> &lf_input_for_output_bsocket_usage_;
   const Map<StringRef, int> &lf_input_for_attribute_propagation_to_output_;
+  /** Collects warnings that are logged again when the outputs of the node are reused. */
+  geo_eval_cache::NodeLog *cache_log_;
 
  public:
   GeoNodeExecParams(const bNode &node,
                     lf::Params &params,
                     const lf::Context &lf_context,
                     const Map<StringRef, int> &lf_input_for_output_bsocket_usage,
-                    const Map<StringRef, int> &lf_input_for_attribute_propagation_to_output)
+                    const Map<StringRef, int> &lf_input_for_attribute_propagation_to_output,
+                    geo_eval_cache::NodeLog *cache_log = nullptr)
       : node_(node),
         params_(params),
         lf_context_(lf_context),
         lf_input_for_output_bsocket_usage_(lf_input_for_output_bsocket_usage),
-        lf_input_for_attribute_propagation_to_output_(lf_input_for_attribute_propagation_to_output)
+        lf_input_for_attribute_propagation_to_output_(lf_input_for_attribute_propagation_to_output),
+        cache_log_(cache_log)
   {
   }
 
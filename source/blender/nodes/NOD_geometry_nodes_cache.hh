@@ -0,0 +1,97 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#pragma once
+
+/**
+ * Outputs of geometry nodes are kept between evaluations of a modifier, so that nodes whose inputs
+ * did not change are not executed again. This helps when e.g. only a node at the end of a large
+ * tree is tweaked, or when the result of an expensive node is used in an animated tree.
+ *
+ * Outputs are stored per node and compute context, together with a copy of the inputs they have
+ * been computed from. Those are compared to the inputs of the next execution:
+ * - Geometry components that own their data are compared by identity. As long as they are
+ *   referenced by the cache they are immutable, so the same component still contains the same
+ *   data. Other geometry, like the original mesh passed into the modifier, is hashed.
+ * - Fields are compared with #GField::operator==, which compares most field nodes by identity.
+ *   Cached field outputs are reused as well, so nodes depending on them can be reused too.
+ * - All other values are compared by value.
+ *
+ * Nodes whose outputs depend on more than their inputs and properties (e.g. the scene time or
+ * other data-blocks) are never cached, and neither are nodes that request their inputs lazily.
+ */
+
+#include <mutex>
+#include <optional>
+
+#include "BLI_function_ref.hh"
+#include "BLI_vector.hh"
+
+#include "FN_lazy_function.hh"
+
+#include "NOD_geometry_nodes_log.hh"
+
+struct bNode;
+
+namespace blender::nodes::geo_eval_cache {
+
+using geo_eval_log::NamedAttributeUsage;
+using geo_eval_log::NodeWarningType;
+
+/**
+ * Identifies a lazy-function of a node tree between evaluations, while its lazy-function graph
+ * may be rebuilt in between.
+ */
+struct FunctionKey {
+  /** Identifier of the node the function has been created for. */
+  int32_t node_id;
+  /** Unique within the node tree, functions of the same node (e.g. conversions) differ. */
+  uint64_t id;
+  /** Hash of everything besides the inputs that the outputs depend on, e.g. node properties. */
+  uint64_t properties_hash;
+};
+
+/**
+ * Warnings and named attribute usages reported by a node while it is executed. They are logged
+ * again when its outputs are reused. Nodes may report from multiple threads.
+ */
+class NodeLog {
+ private:
+  std::mutex mutex_;
+
+ public:
+  Vector<std::pair<NodeWarningType, std::string>> warnings;
+  Vector<std::pair<std::string, NamedAttributeUsage>> used_named_attributes;
+
+  void add_warning(NodeWarningType type, StringRef message);
+  void add_used_named_attribute(StringRef attribute_name, NamedAttributeUsage usage);
+};
+
+/**
+ * Hash the properties of a node, or return none when they can't be compared between evaluations.
+ */
+std::optional<uint64_t> hash_node_properties(const bNode &node);
+
+/**
+ * True when the outputs of the node only depend on its inputs and properties, which is not the
+ * case for e.g. the Scene Time and Object Info nodes.
+ */
+bool node_is_cacheable(const bNode &node);
+
+/**
+ * Execute a lazy-function with \a execute_fn, or set its outputs to copies of the outputs of a
+ * previous execution with the same inputs. The function is always executed when \a key is none
+ * or the cache is disabled for the evaluation.
+ *
+ * \param execute_fn: Computes the outputs using the passed in params. The passed log is null when
+ * the outputs won't be cached.
+ */
+void execute(const lf::LazyFunction &fn,
+             const std::optional<FunctionKey> &key,
+             lf::Params &params,
+             const lf::Context &context,
+             FunctionRef<void(lf::Params &params, NodeLog *log)> execute_fn);
+
+/** Free all cached outputs. */
+void clear();
+
+}  // namespace blender::nodes::geo_eval_cache
@@ -57,6 +57,11 @@ struct GeoNodesModifierData {
    * If this is null, all socket values will be logged.
    */
   const Set<ComputeContextHash> *socket_log_contexts = nullptr;
+  /**
+   * Reuse outputs of nodes from previous evaluations when their inputs did not change, see
+   * #geo_eval_cache.
+   */
+  bool use_result_cache = false;
 };
 
 /**
@@ -219,6 +224,9 @@ class GeometryNodesLazyFunctionLogger : public fn::lazy_function::GraphExecutor:
   void log_before_node_execute(const lf::FunctionNode &node,
                                const lf::Params &params,
                                const lf::Context &context) const override;
+  void log_node_wait(const lf::Node &node,
+                     std::chrono::nanoseconds wait_time,
+                     const lf::Context &context) const override;
 };
 
 /**
@@ -0,0 +1,59 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#pragma once
+
+/**
+ * Optional profiling of geometry nodes evaluation, to find the bottlenecks of production node
+ * trees. While enabled, every execution of a geometry node is recorded with:
+ * - The thread it ran on and its run time.
+ * - The memory of the geometry it created, i.e. the growth of its output geometry compared to the
+ *   geometry passed into it. Geometry referenced by instances is not counted.
+ * - The number of elements fields have been evaluated on by its thread during the execution.
+ *
+ * Additionally, the time that threads waited for each other in the lazy-function graph executor
+ * is recorded.
+ *
+ * The profile is written as a Chrome trace (viewable in `chrome://tracing` or
+ * https://ui.perfetto.dev) that contains a summary per node, frame and thread as well, see
+ * #NOD_geometry_nodes_profile_begin. Recording is lock free, but profiling should not be started
+ * or stopped while geometry nodes are evaluated.
+ */
+
+#include <atomic>
+#include <chrono>
+
+#include "BLI_function_ref.hh"
+
+#include "FN_lazy_function.hh"
+
+struct bNode;
+
+namespace blender::nodes::geo_eval_profile {
+
+extern std::atomic<bool> is_enabled_flag;
+
+inline bool is_enabled()
+{
+  return is_enabled_flag.load(std::memory_order_relaxed);
+}
+
+/**
+ * Execute the lazy-function of a geometry node with \a execute_fn, and record the execution when
+ * profiling is enabled.
+ */
+void execute_node(const lf::LazyFunction &fn,
+                  const bNode &node,
+                  lf::Params &params,
+                  const lf::Context &context,
+                  FunctionRef<void(lf::Params &params)> execute_fn);
+
+/**
+ * Record that the current thread waited for access to the state of a node in the lazy-function
+ * graph executor. \a node is null when the lazy-function node does not correspond to a node.
+ */
+void record_wait(const lf::Node &lf_node,
+                 const bNode *node,
+                 std::chrono::nanoseconds wait_time,
+                 const lf::Context &context);
+
+}  // namespace blender::nodes::geo_eval_profile
@@ -0,0 +1,709 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include "NOD_geometry_nodes_lazy_function.hh"
+
+#include "BLI_hash.hh"
+#include "BLI_hash_mm2a.h"
+#include "BLI_linear_allocator.hh"
+#include "BLI_listbase.h"
+#include "BLI_map.hh"
+#include "BLI_set.hh"
+
+#include "DNA_color_types.h"
+#include "DNA_curves_types.h"
+#include "DNA_genfile.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_node_types.h"
+#include "DNA_object_types.h"
+#include "DNA_pointcloud_types.h"
+#include "DNA_sdna_types.h"
+
+#include "BKE_anonymous_attribute_id.hh"
+#include "BKE_attribute.hh"
+#include "BKE_customdata.h"
+#include "BKE_geometry_set.hh"
+#include "BKE_node.h"
+#include "BKE_node_runtime.hh"
+
+#include "DEG_depsgraph_query.h"
+
+#include "FN_field_cpp_type.hh"
+
+#include "MEM_guardedalloc.h"
+
+#include "geometry_nodes_cache_intern.hh"
+
+namespace blender::nodes::geo_eval_cache {
+
+using fn::ValueOrField;
+using fn::ValueOrFieldCPPType;
+
+/** Outputs of functions whose inputs changed this many times in a row are not cached anymore. */
+static constexpr int VOLATILE_MISSES_NUM = 2;
+/** Number of executions of a volatile function until its inputs are compared again. */
+static constexpr int VOLATILE_RETRY_INTERVAL = 8;
+/** Rough size of values that don't contain geometry, e.g. fields. */
+static constexpr int64_t VALUE_SIZE_ESTIMATE = 64;
+
+void NodeLog::add_warning(const NodeWarningType type, const StringRef message)
+{
+  std::lock_guard lock{mutex_};
+  this->warnings.append({type, message});
+}
+
+void NodeLog::add_used_named_attribute(const StringRef attribute_name,
+                                       const NamedAttributeUsage usage)
+{
+  std::lock_guard lock{mutex_};
+  this->used_named_attributes.append({attribute_name, usage});
+}
+
+/* -------------------------------------------------------------------- */
+/** \name Node Properties
+ * \{ */
+
+bool node_is_cacheable(const bNode &node)
+{
+  if (node.typeinfo->geometry_node_execute_supports_laziness) {
+    return false;
+  }
+  /* Nodes reading the depsgraph, scene or other state that isn't part of their inputs. */
+  static const Set<StringRef> context_dependent_node_types = {
+      "GeometryNodeCollectionInfo",
+      "GeometryNodeDeformCurvesOnSurface",
+      "GeometryNodeDistributePointsInVolume",
+      "GeometryNodeImageTexture",
+      "GeometryNodeInputSceneTime",
+      "GeometryNodeIsViewport",
+      "GeometryNodeMeshToVolume",
+      "GeometryNodeObjectInfo",
+      "GeometryNodeSelfObject",
+      "GeometryNodeTransform",
+      "GeometryNodeVolumeToMesh",
+  };
+  if (context_dependent_node_types.contains(node.idname)) {
+    return false;
+  }
+  for (const bNodeSocket *socket : node.input_sockets()) {
+    /* The data of referenced data-blocks can change without the pointer changing. */
+    if (socket->is_available() &&
+        ELEM(socket->type, SOCK_OBJECT, SOCK_COLLECTION, SOCK_IMAGE, SOCK_TEXTURE)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * \return True when the DNA struct contains pointers, directly or in nested structs.
+ */
+static bool dna_struct_has_pointers(const SDNA &sdna, const int struct_nr)
+{
+  const SDNA_Struct &struct_info = *sdna.structs[struct_nr];
+  for (const SDNA_StructMember &member : Span(struct_info.members, struct_info.members_len)) {
+    const char *name = sdna.names[member.name];
+    if (ELEM(name[0], '*', '(')) {
+      return true;
+    }
+    const int member_struct_nr = DNA_struct_find_nr(&sdna, sdna.types[member.type]);
+    if (member_struct_nr != -1 && dna_struct_has_pointers(sdna, member_struct_nr)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static uint64_t hash_curve_mapping(const CurveMapping &curve_mapping)
+{
+  /* Only hash the settings and points, the tables are evaluated from those. */
+  CurveMapping settings = curve_mapping;
+  uint64_t hash = 0;
+  for (CurveMap &curve_map : settings.cm) {
+    hash = get_default_hash_2(
+        hash, hash_buffer(curve_map.curve, sizeof(CurveMapPoint) * curve_map.totpoint));
+    curve_map.curve = nullptr;
+    curve_map.table = nullptr;
+    curve_map.premultable = nullptr;
+  }
+  return get_default_hash_2(hash, hash_buffer(&settings, sizeof(settings)));
+}
+
+std::optional<uint64_t> hash_node_properties(const bNode &node)
+{
+  if (node.id != nullptr) {
+    /* The referenced data-block can change without the node changing. */
+    return std::nullopt;
+  }
+  uint64_t hash = get_default_hash_4(node.typeinfo, node.custom1, node.custom2, node.custom3);
+  hash = get_default_hash_2(hash, node.custom4);
+  if (node.storage == nullptr) {
+    return hash;
+  }
+  /* Pointers in the storage aren't compared, structs with pointers have to hash the data they
+   * point to instead. */
+  const StringRef storage_name = node.typeinfo->storagename;
+  if (storage_name == "CurveMapping") {
+    return get_default_hash_2(hash,
+                              hash_curve_mapping(*static_cast<const CurveMapping *>(node.storage)));
+  }
+  if (storage_name == "NodeInputString") {
+    const NodeInputString &storage = *static_cast<const NodeInputString *>(node.storage);
+    return get_default_hash_2(hash, StringRef(storage.string ? storage.string : ""));
+  }
+  const SDNA &sdna = *DNA_sdna_current_get();
+  const int struct_nr = DNA_struct_find_nr(&sdna, node.typeinfo->storagename);
+  if (struct_nr == -1 || dna_struct_has_pointers(sdna, struct_nr)) {
+    return std::nullopt;
+  }
+  return get_default_hash_2(
+      hash, hash_buffer(node.storage, size_t(sdna.types_size[sdna.structs[struct_nr]->type])));
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Geometry Comparison
+ * \{ */
+
+static std::optional<uint64_t> hash_custom_data(const CustomData &data, const int elems_num)
+{
+  uint64_t hash = get_default_hash(elems_num);
+  for (const CustomDataLayer &layer : Span(data.layers, data.totlayer)) {
+    hash = get_default_hash_4(hash, layer.type, layer.flag, StringRef(layer.name));
+    hash = get_default_hash_4(hash, layer.active, layer.active_rnd, layer.active_mask);
+    if (layer.type == CD_MDEFORMVERT) {
+      const Span<MDeformVert> dverts(static_cast<const MDeformVert *>(layer.data), elems_num);
+      for (const MDeformVert &dvert : dverts) {
+        hash = get_default_hash_2(
+            hash,
+            BLI_hash_mm2(reinterpret_cast<const uchar *>(dvert.dw),
+                         sizeof(MDeformWeight) * dvert.totweight,
+                         0));
+      }
+    }
+    else if (CustomData_layertype_is_dynamic(layer.type)) {
+      return std::nullopt;
+    }
+    else {
+      hash = get_default_hash_2(
+          hash, hash_buffer(layer.data, size_t(elems_num) * CustomData_sizeof(layer.type)));
+    }
+  }
+  return hash;
+}
+
+static uint64_t hash_materials(const Material *const *materials, const int materials_num)
+{
+  return hash_buffer(materials, sizeof(Material *) * materials_num);
+}
+
+static std::optional<uint64_t> hash_mesh(const Mesh &mesh)
+{
+  uint64_t hash = get_default_hash_4(mesh.totvert, mesh.totedge, mesh.totpoly, mesh.totloop);
+  for (const auto &[data, elems_num] : {std::pair(&mesh.vdata, mesh.totvert),
+                                       std::pair(&mesh.edata, mesh.totedge),
+                                       std::pair(&mesh.pdata, mesh.totpoly),
+                                       std::pair(&mesh.ldata, mesh.totloop)}) {
+    const std::optional<uint64_t> data_hash = hash_custom_data(*data, elems_num);
+    if (!data_hash) {
+      return std::nullopt;
+    }
+    hash = get_default_hash_2(hash, *data_hash);
+  }
+  hash = get_default_hash_4(
+      hash, hash_materials(mesh.mat, mesh.totcol), mesh.flag, mesh.smoothresh);
+  LISTBASE_FOREACH (const bDeformGroup *, group, &mesh.vertex_group_names) {
+    hash = get_default_hash_2(hash, StringRef(group->name));
+  }
+  hash = get_default_hash_3(
+      hash,
+      StringRef(mesh.active_color_attribute ? mesh.active_color_attribute : ""),
+      StringRef(mesh.default_color_attribute ? mesh.default_color_attribute : ""));
+  return hash;
+}
+
+static std::optional<uint64_t> hash_curves(const Curves &curves_id)
+{
+  const ::CurvesGeometry &curves = curves_id.geometry;
+  uint64_t hash = get_default_hash_3(
+      hash_materials(curves_id.mat, curves_id.totcol), curves_id.surface, curves.curve_num);
+  hash = get_default_hash_2(
+      hash, hash_buffer(curves.curve_offsets, sizeof(int) * (curves.curve_num + 1)));
+  for (const auto &[data, elems_num] : {std::pair(&curves.point_data, curves.point_num),
+                                       std::pair(&curves.curve_data, curves.curve_num)}) {
+    const std::optional<uint64_t> data_hash = hash_custom_data(*data, elems_num);
+    if (!data_hash) {
+      return std::nullopt;
+    }
+    hash = get_default_hash_2(hash, *data_hash);
+  }
+  return hash;
+}
+
+static std::optional<uint64_t> hash_point_cloud(const PointCloud &pointcloud)
+{
+  const std::optional<uint64_t> data_hash = hash_custom_data(pointcloud.pdata,
+                                                             pointcloud.totpoint);
+  if (!data_hash) {
+    return std::nullopt;
+  }
+  return get_default_hash_2(*data_hash, hash_materials(pointcloud.mat, pointcloud.totcol));
+}
+
+/**
+ * Hash the data of a component that doesn't own it, because then the data may change without the
+ * component changing.
+ */
+static std::optional<uint64_t> hash_component_data(const GeometryComponent &component)
+{
+  switch (component.type()) {
+    case GEO_COMPONENT_TYPE_MESH: {
+      const Mesh *mesh = static_cast<const MeshComponent &>(component).get_for_read();
+      return mesh ? hash_mesh(*mesh) : 0;
+    }
+    case GEO_COMPONENT_TYPE_CURVE: {
+      const Curves *curves = static_cast<const CurveComponent &>(component).get_for_read();
+      return curves ? hash_curves(*curves) : 0;
+    }
+    case GEO_COMPONENT_TYPE_POINT_CLOUD: {
+      const PointCloud *pointcloud =
+          static_cast<const PointCloudComponent &>(component).get_for_read();
+      return pointcloud ? hash_point_cloud(*pointcloud) : 0;
+    }
+    default:
+      return std::nullopt;
+  }
+}
+
+bool geometries_equal(const GeometrySet &a, const GeometrySet &b)
+{
+  for (const int i : IndexRange(GEO_COMPONENT_TYPE_ENUM_SIZE)) {
+    const GeometryComponentType type = GeometryComponentType(i);
+    if (a.get_component_for_read(type) != b.get_component_for_read(type)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Cached Results
+ * \{ */
+
+Result::~Result()
+{
+  for (GMutablePointer value : inputs) {
+    value.destruct();
+  }
+  for (GMutablePointer value : outputs) {
+    if (value.get() != nullptr) {
+      value.destruct();
+    }
+  }
+}
+
+bool Result::add_geometry_input(const GeometrySet &geometry, GeometrySet &fingerprint)
+{
+  for (const GeometryComponent *component : geometry.get_components_for_read()) {
+    if (component->owns_direct_data()) {
+      fingerprint.add(*component);
+      continue;
+    }
+    const std::optional<uint64_t> hash = hash_component_data(*component);
+    if (!hash) {
+      return false;
+    }
+    this->input_hashes.append(*hash);
+  }
+  this->size += fingerprint.attributes_size_in_bytes();
+  return true;
+}
+
+bool Result::add_input(const CPPType &type, const void *value)
+{
+  void *buffer = this->allocator.allocate(type.size(), type.alignment());
+  this->size += VALUE_SIZE_ESTIMATE;
+  if (type.is<GeometrySet>()) {
+    GeometrySet &fingerprint = *new (buffer) GeometrySet();
+    this->inputs.append({type, buffer});
+    return this->add_geometry_input(*static_cast<const GeometrySet *>(value), fingerprint);
+  }
+  if (type.is<Vector<GeometrySet>>()) {
+    Vector<GeometrySet> &fingerprints = *new (buffer) Vector<GeometrySet>();
+    this->inputs.append({type, buffer});
+    for (const GeometrySet &geometry : *static_cast<const Vector<GeometrySet> *>(value)) {
+      fingerprints.append({});
+      if (!this->add_geometry_input(geometry, fingerprints.last())) {
+        return false;
+      }
+    }
+    return true;
+  }
+  type.copy_construct(value, buffer);
+  this->inputs.append({type, buffer});
+  return true;
+}
+
+void Result::add_output(const CPPType &type, const int index, const void *value)
+{
+  if (type.is<GeometrySet>()) {
+    const GeometrySet &geometry = *static_cast<const GeometrySet *>(value);
+    if (!geometry.owns_direct_data()) {
+      this->outputs_are_cacheable = false;
+      return;
+    }
+    this->size += geometry.attributes_size_in_bytes();
+  }
+  void *buffer = this->allocator.allocate(type.size(), type.alignment());
+  type.copy_construct(value, buffer);
+  this->outputs[index] = {type, buffer};
+  this->size += VALUE_SIZE_ESTIMATE;
+}
+
+template<typename T>
+static bool value_or_fields_equal(const ValueOrField<T> &a, const ValueOrField<T> &b)
+{
+  if (a.is_field() || b.is_field()) {
+    return a.is_field() && b.is_field() && a.field == b.field;
+  }
+  return a.value == b.value;
+}
+
+bool inputs_equal(const CPPType &type, const void *a, const void *b)
+{
+  if (type.is<GeometrySet>()) {
+    return geometries_equal(*static_cast<const GeometrySet *>(a),
+                            *static_cast<const GeometrySet *>(b));
+  }
+  if (type.is<Vector<GeometrySet>>()) {
+    const Span<GeometrySet> a_geometries = *static_cast<const Vector<GeometrySet> *>(a);
+    const Span<GeometrySet> b_geometries = *static_cast<const Vector<GeometrySet> *>(b);
+    if (a_geometries.size() != b_geometries.size()) {
+      return false;
+    }
+    for (const int i : a_geometries.index_range()) {
+      if (!geometries_equal(a_geometries[i], b_geometries[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+  if (type.is<Vector<ValueOrField<std::string>>>()) {
+    const Span<ValueOrField<std::string>> a_strings =
+        *static_cast<const Vector<ValueOrField<std::string>> *>(a);
+    const Span<ValueOrField<std::string>> b_strings =
+        *static_cast<const Vector<ValueOrField<std::string>> *>(b);
+    if (a_strings.size() != b_strings.size()) {
+      return false;
+    }
+    for (const int i : a_strings.index_range()) {
+      if (!value_or_fields_equal(a_strings[i], b_strings[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+  if (type.is<bke::AnonymousAttributeSet>()) {
+    const auto &a_set = static_cast<const bke::AnonymousAttributeSet *>(a)->names;
+    const auto &b_set = static_cast<const bke::AnonymousAttributeSet *>(b)->names;
+    if (!a_set || !b_set) {
+      return !a_set && !b_set;
+    }
+    if (a_set->size() != b_set->size()) {
+      return false;
+    }
+    for (const std::string &name : *a_set) {
+      if (!b_set->contains(name)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  if (const ValueOrFieldCPPType *field_type = ValueOrFieldCPPType::get_from_self(type)) {
+    const bool a_is_field = field_type->is_field(a);
+    const bool b_is_field = field_type->is_field(b);
+    if (a_is_field || b_is_field) {
+      return a_is_field && b_is_field &&
+             *field_type->get_field_ptr(a) == *field_type->get_field_ptr(b);
+    }
+    return field_type->value.is_equal_or_false(field_type->get_value_ptr(a),
+                                               field_type->get_value_ptr(b));
+  }
+  return type.is_equal_or_false(a, b);
+}
+
+bool results_have_equal_inputs(const Result &a, const Result &b)
+{
+  if (a.inputs.size() != b.inputs.size() || a.input_hashes != b.input_hashes) {
+    return false;
+  }
+  for (const int i : a.inputs.index_range()) {
+    const CPPType &type = *a.inputs[i].type();
+    if (type != *b.inputs[i].type()) {
+      return false;
+    }
+    if (!inputs_equal(type, a.inputs[i].get(), b.inputs[i].get())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Forwards to the params of the executed lazy-function, but copies outputs into a #Result when
+ * they are set. They can't be copied after the execution, because the caller may move them away
+ * as soon as they are set.
+ */
+class CachingParams : public lf::Params {
+ private:
+  lf::Params &params_;
+  Result &result_;
+  Array<void *> output_ptrs_;
+  std::mutex mutex_;
+
+ public:
+  CachingParams(const lf::LazyFunction &fn, lf::Params &params, Result &result)
+      : lf::Params(fn, true), params_(params), result_(result), output_ptrs_(fn.outputs().size())
+  {
+  }
+
+ private:
+  void *try_get_input_data_ptr_impl(const int index) const override
+  {
+    return params_.try_get_input_data_ptr(index);
+  }
+
+  void *try_get_input_data_ptr_or_request_impl(const int index) override
+  {
+    return params_.try_get_input_data_ptr_or_request(index);
+  }
+
+  void *get_output_data_ptr_impl(const int index) override
+  {
+    void *value = params_.get_output_data_ptr(index);
+    output_ptrs_[index] = value;
+    return value;
+  }
+
+  void output_set_impl(const int index) override
+  {
+    {
+      std::lock_guard lock{mutex_};
+      result_.add_output(*fn_.outputs()[index].type, index, output_ptrs_[index]);
+    }
+    params_.output_set(index);
+  }
+
+  bool output_was_set_impl(const int index) const override
+  {
+    return params_.output_was_set(index);
+  }
+
+  lf::ValueUsage get_output_usage_impl(const int index) const override
+  {
+    return params_.get_output_usage(index);
+  }
+
+  void set_input_unused_impl(const int index) override
+  {
+    params_.set_input_unused(index);
+  }
+
+  bool try_enable_multi_threading_impl() override
+  {
+    return params_.try_enable_multi_threading();
+  }
+};
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Cache
+ * \{ */
+
+static Cache g_cache;
+
+static void remove_result(Cache &cache, CacheEntry &entry)
+{
+  if (entry.result) {
+    cache.size -= entry.result->size;
+    entry.result.reset();
+  }
+}
+
+void store_result(Cache &cache,
+                  const CacheKey &key,
+                  std::shared_ptr<const Result> result,
+                  const bool inputs_changed)
+{
+  /* Free outside of the lock. */
+  std::shared_ptr<const Result> old_result;
+  Vector<std::shared_ptr<const Result>> evicted_results;
+
+  std::lock_guard lock{cache.mutex};
+  CacheEntry &entry = cache.entries.lookup_or_add_default(key);
+  if (entry.result) {
+    old_result = entry.result;
+    remove_result(cache, entry);
+    if (inputs_changed && ++entry.misses_num >= VOLATILE_MISSES_NUM) {
+      entry.skips_num = VOLATILE_RETRY_INTERVAL;
+      return;
+    }
+  }
+  if (!result->outputs_are_cacheable || result->size > cache.max_size) {
+    return;
+  }
+
+  /* Evict least recently used results. */
+  while (cache.size + result->size > cache.max_size) {
+    CacheEntry *lru_entry = nullptr;
+    for (CacheEntry &other_entry : cache.entries.values()) {
+      if (other_entry.result && (!lru_entry || other_entry.last_used < lru_entry->last_used)) {
+        lru_entry = &other_entry;
+      }
+    }
+    evicted_results.append(lru_entry->result);
+    remove_result(cache, *lru_entry);
+  }
+
+  cache.size += result->size;
+  entry.result = std::move(result);
+  entry.last_used = ++cache.clock;
+}
+
+void use_result(Cache &cache, const CacheKey &key)
+{
+  std::lock_guard lock{cache.mutex};
+  if (CacheEntry *entry = cache.entries.lookup_ptr(key)) {
+    entry->last_used = ++cache.clock;
+    entry->misses_num = 0;
+  }
+}
+
+/** Log the warnings of a node again when its outputs are reused. */
+static void log_reused_result(const Result &result,
+                              const int32_t node_id,
+                              const GeoNodesLFUserData &user_data)
+{
+  geo_eval_log::GeoModifierLog *modifier_log = user_data.modifier_data->eval_log;
+  const NodeLog &log = result.log;
+  if (modifier_log == nullptr ||
+      (log.warnings.is_empty() && log.used_named_attributes.is_empty())) {
+    return;
+  }
+  geo_eval_log::GeoTreeLogger &tree_logger = modifier_log->get_local_tree_logger(
+      *user_data.compute_context);
+  for (const auto &[type, message] : log.warnings) {
+    tree_logger.node_warnings.append(
+        {node_id, {type, tree_logger.allocator->copy_string(message)}});
+  }
+  for (const auto &[attribute_name, usage] : log.used_named_attributes) {
+    tree_logger.used_named_attributes.append(
+        {node_id, tree_logger.allocator->copy_string(attribute_name), usage});
+  }
+}
+
+/**
+ * Set all outputs that are still needed to copies of the cached ones. Returns false without
+ * setting any output when one of them has not been cached.
+ */
+static bool try_reuse_outputs(const lf::LazyFunction &fn,
+                              const Result &result,
+                              lf::Params &params)
+{
+  Vector<int> outputs_to_set;
+  for (const int i : fn.outputs().index_range()) {
+    if (params.output_was_set(i) || params.get_output_usage(i) == lf::ValueUsage::Unused) {
+      continue;
+    }
+    if (result.outputs[i].get() == nullptr) {
+      return false;
+    }
+    outputs_to_set.append(i);
+  }
+  for (const int i : outputs_to_set) {
+    result.outputs[i].type()->copy_construct(result.outputs[i].get(),
+                                             params.get_output_data_ptr(i));
+    params.output_set(i);
+  }
+  return true;
+}
+
+void execute(const lf::LazyFunction &fn,
+             const std::optional<FunctionKey> &key,
+             lf::Params &params,
+             const lf::Context &context,
+             const FunctionRef<void(lf::Params &params, NodeLog *log)> execute_fn)
+{
+  const GeoNodesLFUserData *user_data = dynamic_cast<const GeoNodesLFUserData *>(
+      context.user_data);
+  if (!key || user_data == nullptr || user_data->modifier_data == nullptr ||
+      !user_data->modifier_data->use_result_cache ||
+      user_data->modifier_data->self_object == nullptr) {
+    execute_fn(params, nullptr);
+    return;
+  }
+  const Depsgraph *depsgraph = user_data->modifier_data->depsgraph;
+  const CacheKey cache_key{user_data->modifier_data->self_object->id.session_uuid,
+                           depsgraph ? int(DEG_get_mode(depsgraph)) : -1,
+                           user_data->compute_context->hash(),
+                           key->id};
+
+  std::shared_ptr<const Result> old_result;
+  bool skip_comparison = false;
+  {
+    std::lock_guard lock{g_cache.mutex};
+    if (CacheEntry *entry = g_cache.entries.lookup_ptr(cache_key)) {
+      /* Don't spend time on comparing inputs that change all the time. */
+      skip_comparison = entry->skips_num > 0;
+      entry->skips_num = std::max(entry->skips_num - 1, 0);
+      old_result = entry->result;
+    }
+  }
+  if (skip_comparison) {
+    execute_fn(params, nullptr);
+    return;
+  }
+
+  /* Copy the inputs before the execution, which may move them. */
+  auto result = std::make_shared<Result>();
+  result->input_hashes.append(key->properties_hash);
+  for (const int i : fn.inputs().index_range()) {
+    const void *value = params.try_get_input_data_ptr(i);
+    if (value == nullptr || !result->add_input(*fn.inputs()[i].type, value)) {
+      execute_fn(params, nullptr);
+      return;
+    }
+  }
+
+  /* Outputs may not be reused with equal inputs when an output needed now was not cached. */
+  const bool inputs_changed = !old_result || !results_have_equal_inputs(*old_result, *result);
+  if (!inputs_changed && try_reuse_outputs(fn, *old_result, params)) {
+    use_result(g_cache, cache_key);
+    log_reused_result(*old_result, key->node_id, *user_data);
+    return;
+  }
+
+  result->outputs.resize(fn.outputs().size());
+  CachingParams caching_params{fn, params, *result};
+  execute_fn(caching_params, &result->log);
+  store_result(g_cache, cache_key, std::move(result), inputs_changed);
+}
+
+void clear()
+{
+  Map<CacheKey, CacheEntry> entries;
+  {
+    std::lock_guard lock{g_cache.mutex};
+    entries = std::move(g_cache.entries);
+    g_cache.entries.clear();
+    g_cache.size = 0;
+  }
+}
+
+/** \} */
+
+}  // namespace blender::nodes::geo_eval_cache
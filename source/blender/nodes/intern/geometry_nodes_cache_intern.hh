@@ -0,0 +1,114 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#pragma once
+
+/**
+ * Internals of the geometry nodes cache, see #NOD_geometry_nodes_cache.hh.
+ */
+
+#include <memory>
+#include <mutex>
+
+#include "BLI_compute_context.hh"
+#include "BLI_generic_pointer.hh"
+#include "BLI_linear_allocator.hh"
+#include "BLI_map.hh"
+
+#include "NOD_geometry_nodes_cache.hh"
+
+struct GeometrySet;
+
+namespace blender::nodes::geo_eval_cache {
+
+/** Memory budget of the cached outputs and the inputs kept to compare with. */
+constexpr int64_t CACHE_MAX_BYTES = int64_t(1) << 30;
+
+/** Outputs of an execution and a copy of the inputs they have been computed from. */
+struct Result {
+  LinearAllocator<> allocator;
+  /**
+   * Geometries only contain the components that own their data. The data of other components is
+   * hashed in #input_hashes instead.
+   */
+  Vector<GMutablePointer> inputs;
+  Vector<uint64_t> input_hashes;
+  /** Outputs that have been set, others are null. */
+  Vector<GMutablePointer> outputs;
+  NodeLog log;
+  int64_t size = 0;
+  /** False when an output can't be kept after the evaluation. */
+  bool outputs_are_cacheable = true;
+
+  ~Result();
+
+  /** Copy an input value. Returns false when it can't be compared between evaluations. */
+  bool add_input(const CPPType &type, const void *value);
+  void add_output(const CPPType &type, int index, const void *value);
+
+ private:
+  bool add_geometry_input(const GeometrySet &geometry, GeometrySet &fingerprint);
+};
+
+/**
+ * Geometries are equal when they contain the same components, compared by identity.
+ */
+bool geometries_equal(const GeometrySet &a, const GeometrySet &b);
+/**
+ * Compare input values of two executions, see #Result::inputs.
+ */
+bool inputs_equal(const CPPType &type, const void *a, const void *b);
+bool results_have_equal_inputs(const Result &a, const Result &b);
+
+struct CacheKey {
+  uint32_t object_session_uuid;
+  /** Viewport and render evaluation can give different results, e.g. because of simplify. */
+  int evaluation_mode;
+  ComputeContextHash context_hash;
+  uint64_t function_id;
+
+  uint64_t hash() const
+  {
+    return get_default_hash_4(object_session_uuid, evaluation_mode, context_hash, function_id);
+  }
+
+  friend bool operator==(const CacheKey &a, const CacheKey &b)
+  {
+    return a.object_session_uuid == b.object_session_uuid &&
+           a.evaluation_mode == b.evaluation_mode && a.context_hash == b.context_hash &&
+           a.function_id == b.function_id;
+  }
+};
+
+struct CacheEntry {
+  /** Null when the function is volatile or its outputs could not be cached. */
+  std::shared_ptr<const Result> result;
+  uint64_t last_used = 0;
+  /** Number of executions in a row whose inputs differed from the cached ones. */
+  int misses_num = 0;
+  /** Number of executions left until the inputs are compared again. */
+  int skips_num = 0;
+};
+
+struct Cache {
+  std::mutex mutex;
+  Map<CacheKey, CacheEntry> entries;
+  int64_t size = 0;
+  int64_t max_size = CACHE_MAX_BYTES;
+  uint64_t clock = 0;
+};
+
+/**
+ * Replace the result of a function, evicting the least recently used results of others to stay
+ * within the memory budget. When \a inputs_changed, the function is considered volatile after
+ * changing a few times in a row and is not cached anymore for a while.
+ */
+void store_result(Cache &cache,
+                  const CacheKey &key,
+                  std::shared_ptr<const Result> result,
+                  bool inputs_changed);
+/**
+ * Mark the result of a function as used, after its outputs have been reused.
+ */
+void use_result(Cache &cache, const CacheKey &key);
+
+}  // namespace blender::nodes::geo_eval_cache
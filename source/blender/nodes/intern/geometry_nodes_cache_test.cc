@@ -0,0 +1,237 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include "testing/testing.h"
+
+#include "CLG_log.h"
+
+#include "DNA_color_types.h"
+#include "DNA_genfile.h"
+#include "DNA_node_types.h"
+
+#include "RNA_define.h"
+
+#include "BKE_colortools.h"
+#include "BKE_cpp_types.h"
+#include "BKE_geometry_set.hh"
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+#include "BKE_node.h"
+#include "BKE_node_runtime.hh"
+#include "BKE_pointcloud.h"
+
+#include "FN_field_cpp_type.hh"
+
+#include "geometry_nodes_cache_intern.hh"
+
+namespace blender::nodes::geo_eval_cache::tests {
+
+class GeometryNodesCacheTest : public testing::Test {
+ public:
+  static void SetUpTestSuite()
+  {
+    CLG_init();
+    DNA_sdna_current_init();
+    BKE_cpp_types_init();
+    BKE_idtype_init();
+    RNA_init();
+    BKE_node_system_init();
+  }
+
+  static void TearDownTestSuite()
+  {
+    BKE_node_system_exit();
+    RNA_exit();
+    DNA_sdna_current_free();
+    CLG_exit();
+  }
+
+  void SetUp() override
+  {
+    tree = ntreeAddTree(nullptr, "Test", "GeometryNodeTree");
+  }
+
+  void TearDown() override
+  {
+    BKE_id_free(nullptr, &tree->id);
+  }
+
+  bNode &add_node(const char *idname)
+  {
+    bNode *node = nodeAddNode(nullptr, tree, idname);
+    tree->ensure_topology_cache();
+    return *node;
+  }
+
+  bNodeTree *tree;
+};
+
+/* -------------------------------------------------------------------- */
+/** \name Node Properties
+ * \{ */
+
+TEST_F(GeometryNodesCacheTest, hash_node_properties_storage)
+{
+  bNode &node = add_node("GeometryNodeCurvePrimitiveQuadrilateral");
+  NodeGeometryCurvePrimitiveQuad &storage = *static_cast<NodeGeometryCurvePrimitiveQuad *>(
+      node.storage);
+  storage.mode = GEO_NODE_CURVE_PRIMITIVE_QUAD_MODE_RECTANGLE;
+  const std::optional<uint64_t> hash = hash_node_properties(node);
+  ASSERT_TRUE(hash.has_value());
+  EXPECT_EQ(hash_node_properties(node), hash);
+
+  storage.mode = GEO_NODE_CURVE_PRIMITIVE_QUAD_MODE_TRAPEZOID;
+  EXPECT_NE(hash_node_properties(node), hash);
+  storage.mode = GEO_NODE_CURVE_PRIMITIVE_QUAD_MODE_RECTANGLE;
+  EXPECT_EQ(hash_node_properties(node), hash);
+
+  node.custom1++;
+  EXPECT_NE(hash_node_properties(node), hash);
+}
+
+TEST_F(GeometryNodesCacheTest, hash_node_properties_curve_mapping)
+{
+  bNode &node = add_node("ShaderNodeFloatCurve");
+  CurveMapping &curve_mapping = *static_cast<CurveMapping *>(node.storage);
+  const std::optional<uint64_t> hash = hash_node_properties(node);
+  ASSERT_TRUE(hash.has_value());
+
+  /* Tables are evaluated from the points and are not hashed. */
+  BKE_curvemapping_init(&curve_mapping);
+  EXPECT_EQ(hash_node_properties(node), hash);
+
+  curve_mapping.cm[0].curve[0].y += 0.25f;
+  EXPECT_NE(hash_node_properties(node), hash);
+  curve_mapping.cm[0].curve[0].y -= 0.25f;
+  EXPECT_EQ(hash_node_properties(node), hash);
+
+  curve_mapping.flag ^= CUMA_EXTEND_EXTRAPOLATE;
+  EXPECT_NE(hash_node_properties(node), hash);
+}
+
+TEST_F(GeometryNodesCacheTest, node_is_cacheable)
+{
+  EXPECT_TRUE(node_is_cacheable(add_node("GeometryNodeMeshCube")));
+  EXPECT_TRUE(node_is_cacheable(add_node("GeometryNodeCurvePrimitiveQuadrilateral")));
+  /* Reads the object transform, which isn't an input. */
+  EXPECT_FALSE(node_is_cacheable(add_node("GeometryNodeObjectInfo")));
+  /* Not listed as context dependent, but has an image socket. */
+  EXPECT_FALSE(node_is_cacheable(add_node("GeometryNodeImageInfo")));
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Input Comparison
+ * \{ */
+
+TEST_F(GeometryNodesCacheTest, geometries_equal)
+{
+  const GeometrySet empty;
+  const GeometrySet geometry = GeometrySet::create_with_pointcloud(BKE_pointcloud_new_nomain(4));
+  /* Components are compared by identity, not by their data. */
+  const GeometrySet other_geometry = GeometrySet::create_with_pointcloud(
+      BKE_pointcloud_new_nomain(4));
+  const GeometrySet geometry_copy = geometry;
+
+  EXPECT_TRUE(geometries_equal(empty, GeometrySet()));
+  EXPECT_TRUE(geometries_equal(geometry, geometry_copy));
+  EXPECT_FALSE(geometries_equal(geometry, other_geometry));
+  EXPECT_FALSE(geometries_equal(geometry, empty));
+  EXPECT_FALSE(geometries_equal(empty, geometry));
+
+  const CPPType &type = CPPType::get<Vector<GeometrySet>>();
+  const Vector<GeometrySet> geometries = {geometry, other_geometry};
+  const Vector<GeometrySet> geometries_copy = geometries;
+  const Vector<GeometrySet> geometries_reversed = {other_geometry, geometry};
+  const Vector<GeometrySet> geometries_fewer = {geometry};
+  EXPECT_TRUE(inputs_equal(type, &geometries, &geometries_copy));
+  EXPECT_FALSE(inputs_equal(type, &geometries, &geometries_reversed));
+  EXPECT_FALSE(inputs_equal(type, &geometries, &geometries_fewer));
+}
+
+TEST_F(GeometryNodesCacheTest, inputs_equal)
+{
+  const CPPType &int_type = CPPType::get<int>();
+  const int a = 1;
+  const int b = 1;
+  const int c = 2;
+  EXPECT_TRUE(inputs_equal(int_type, &a, &b));
+  EXPECT_FALSE(inputs_equal(int_type, &a, &c));
+
+  const CPPType &type = CPPType::get<fn::ValueOrField<float>>();
+  const fn::ValueOrField<float> value(1.0f);
+  const fn::ValueOrField<float> same_value(1.0f);
+  const fn::ValueOrField<float> other_value(2.0f);
+  EXPECT_TRUE(inputs_equal(type, &value, &same_value));
+  EXPECT_FALSE(inputs_equal(type, &value, &other_value));
+
+  const fn::Field<float> field{std::make_shared<fn::IndexFieldInput>()};
+  const fn::ValueOrField<float> field_input(field);
+  const fn::ValueOrField<float> same_field_input(field);
+  EXPECT_TRUE(inputs_equal(type, &field_input, &same_field_input));
+  EXPECT_FALSE(inputs_equal(type, &field_input, &value));
+  EXPECT_FALSE(inputs_equal(type, &value, &field_input));
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Cache
+ * \{ */
+
+static CacheKey cache_key(const uint64_t function_id)
+{
+  return {0, 0, {}, function_id};
+}
+
+static std::shared_ptr<const Result> result_new(const int64_t size)
+{
+  std::shared_ptr<Result> result = std::make_shared<Result>();
+  result->size = size;
+  return result;
+}
+
+TEST_F(GeometryNodesCacheTest, evict_least_recently_used)
+{
+  Cache cache;
+  cache.max_size = 100;
+  store_result(cache, cache_key(1), result_new(40), true);
+  store_result(cache, cache_key(2), result_new(40), true);
+  use_result(cache, cache_key(1));
+  EXPECT_EQ(cache.size, 80);
+
+  store_result(cache, cache_key(3), result_new(40), true);
+  EXPECT_EQ(cache.size, 80);
+  EXPECT_NE(cache.entries.lookup(cache_key(1)).result, nullptr);
+  EXPECT_EQ(cache.entries.lookup(cache_key(2)).result, nullptr);
+  EXPECT_NE(cache.entries.lookup(cache_key(3)).result, nullptr);
+
+  /* Results over the budget are not stored. */
+  store_result(cache, cache_key(4), result_new(101), true);
+  EXPECT_EQ(cache.entries.lookup(cache_key(4)).result, nullptr);
+  EXPECT_EQ(cache.size, 80);
+}
+
+TEST_F(GeometryNodesCacheTest, only_changed_inputs_are_misses)
+{
+  Cache cache;
+  /* Outputs that could not be reused with equal inputs, e.g. because they were not needed when
+   * they were cached, don't make a function volatile. */
+  for (int i = 0; i < 4; i++) {
+    store_result(cache, cache_key(1), result_new(1), false);
+  }
+  EXPECT_EQ(cache.entries.lookup(cache_key(1)).misses_num, 0);
+  EXPECT_NE(cache.entries.lookup(cache_key(1)).result, nullptr);
+
+  /* Inputs changing twice in a row make the function volatile. */
+  store_result(cache, cache_key(1), result_new(1), true);
+  EXPECT_NE(cache.entries.lookup(cache_key(1)).result, nullptr);
+  store_result(cache, cache_key(1), result_new(1), true);
+  EXPECT_GT(cache.entries.lookup(cache_key(1)).skips_num, 0);
+  EXPECT_EQ(cache.entries.lookup(cache_key(1)).result, nullptr);
+  EXPECT_EQ(cache.size, 0);
+}
+
+/** \} */
+
+}  // namespace blender::nodes::geo_eval_cache::tests
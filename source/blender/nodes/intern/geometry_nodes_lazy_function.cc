@@ -12,7 +12,9 @@
  */
 
 #include "NOD_geometry_exec.hh"
+#include "NOD_geometry_nodes_cache.hh"
 #include "NOD_geometry_nodes_lazy_function.hh"
+#include "NOD_geometry_nodes_profile.hh"
 #include "NOD_multi_function.hh"
 #include "NOD_node_declaration.hh"
 
@@ -104,12 +106,29 @@ static void lazy_function_interface_from_node(const bNode &node,
   }
 }
 
+/**
+ * Key used to reuse outputs of a node from previous evaluations, or none if they can't be reused.
+ */
+static std::optional<geo_eval_cache::FunctionKey> node_cache_key(const bNode &node)
+{
+  if (!geo_eval_cache::node_is_cacheable(node)) {
+    return std::nullopt;
+  }
+  const std::optional<uint64_t> properties_hash = geo_eval_cache::hash_node_properties(node);
+  if (!properties_hash) {
+    return std::nullopt;
+  }
+  return geo_eval_cache::FunctionKey{
+      node.identifier, get_default_hash(node.identifier), *properties_hash};
+}
+
 /**
  * Used for most normal geometry nodes like Subdivision Surface and Set Position.
  */
 class LazyFunctionForGeometryNode : public LazyFunction {
  private:
   const bNode &node_;
+  std::optional<geo_eval_cache::FunctionKey> cache_key_;
 
  public:
   /**
@@ -125,7 +144,7 @@ class LazyFunctionForGeometryNode : public LazyFunction {
   LazyFunctionForGeometryNode(const bNode &node,
                               Vector<const bNodeSocket *> &r_used_inputs,
                               Vector<const bNodeSocket *> &r_used_outputs)
-      : node_(node)
+      : node_(node), cache_key_(node_cache_key(node))
   {
     BLI_assert(node.typeinfo->geometry_node_execute != nullptr);
     debug_name_ = node.name;
@@ -163,14 +182,23 @@ class LazyFunctionForGeometryNode : public LazyFunction {
     GeoNodesLFUserData *user_data = dynamic_cast<GeoNodesLFUserData *>(context.user_data);
     BLI_assert(user_data != nullptr);
 
-    GeoNodeExecParams geo_params{node_,
-                                 params,
-                                 context,
-                                 lf_input_for_output_bsocket_usage_,
-                                 lf_input_for_attribute_propagation_to_output_};
-
     geo_eval_log::TimePoint start_time = geo_eval_log::Clock::now();
-    node_.typeinfo->geometry_node_execute(geo_params);
+    geo_eval_profile::execute_node(*this, node_, params, context, [&](lf::Params &params) {
+      geo_eval_cache::execute(
+          *this,
+          cache_key_,
+          params,
+          context,
+          [&](lf::Params &params, geo_eval_cache::NodeLog *cache_log) {
+            GeoNodeExecParams geo_params{node_,
+                                         params,
+                                         context,
+                                         lf_input_for_output_bsocket_usage_,
+                                         lf_input_for_attribute_propagation_to_output_,
+                                         cache_log};
+            node_.typeinfo->geometry_node_execute(geo_params);
+          });
+    });
     geo_eval_log::TimePoint end_time = geo_eval_log::Clock::now();
 
     if (geo_eval_log::GeoModifierLog *modifier_log = user_data->modifier_data->eval_log) {
@@ -467,29 +495,38 @@ class LazyFunctionForMultiFunctionConversion : public LazyFunction {
   const MultiFunction &fn_;
   const ValueOrFieldCPPType &from_type_;
   const ValueOrFieldCPPType &to_type_;
+  geo_eval_cache::FunctionKey cache_key_;
 
  public:
   LazyFunctionForMultiFunctionConversion(const MultiFunction &fn,
                                          const ValueOrFieldCPPType &from,
-                                         const ValueOrFieldCPPType &to)
-      : fn_(fn), from_type_(from), to_type_(to)
+                                         const ValueOrFieldCPPType &to,
+                                         const geo_eval_cache::FunctionKey &cache_key)
+      : fn_(fn), from_type_(from), to_type_(to), cache_key_(cache_key)
   {
     debug_name_ = "Convert";
     inputs_.append({"From", from.self});
     outputs_.append({"To", to.self});
   }
 
-  void execute_impl(lf::Params &params, const lf::Context & /*context*/) const override
+  void execute_impl(lf::Params &params, const lf::Context &context) const override
   {
-    const void *from_value = params.try_get_input_data_ptr(0);
-    void *to_value = params.get_output_data_ptr(0);
-    BLI_assert(from_value != nullptr);
-    BLI_assert(to_value != nullptr);
+    geo_eval_cache::execute(
+        *this,
+        cache_key_,
+        params,
+        context,
+        [&](lf::Params &params, geo_eval_cache::NodeLog * /*cache_log*/) {
+          const void *from_value = params.try_get_input_data_ptr(0);
+          void *to_value = params.get_output_data_ptr(0);
+          BLI_assert(from_value != nullptr);
+          BLI_assert(to_value != nullptr);
 
-    execute_multi_function_on_value_or_field(
-        fn_, {}, {&from_type_}, {&to_type_}, {from_value}, {to_value});
+          execute_multi_function_on_value_or_field(
+              fn_, {}, {&from_type_}, {&to_type_}, {from_value}, {to_value});
 
-    params.output_set(0);
+          params.output_set(0);
+        });
   }
 };
 
@@ -501,13 +538,14 @@ class LazyFunctionForMultiFunctionNode : public LazyFunction {
   const NodeMultiFunctions::Item fn_item_;
   Vector<const ValueOrFieldCPPType *> input_types_;
   Vector<const ValueOrFieldCPPType *> output_types_;
+  std::optional<geo_eval_cache::FunctionKey> cache_key_;
 
  public:
   LazyFunctionForMultiFunctionNode(const bNode &node,
                                    NodeMultiFunctions::Item fn_item,
                                    Vector<const bNodeSocket *> &r_used_inputs,
                                    Vector<const bNodeSocket *> &r_used_outputs)
-      : fn_item_(std::move(fn_item))
+      : fn_item_(std::move(fn_item)), cache_key_(node_cache_key(node))
   {
     BLI_assert(fn_item_.fn != nullptr);
     debug_name_ = node.name;
@@ -520,7 +558,19 @@ class LazyFunctionForMultiFunctionNode : public LazyFunction {
     }
   }
 
-  void execute_impl(lf::Params &params, const lf::Context & /*context*/) const override
+  void execute_impl(lf::Params &params, const lf::Context &context) const override
+  {
+    geo_eval_cache::execute(
+        *this,
+        cache_key_,
+        params,
+        context,
+        [&](lf::Params &params, geo_eval_cache::NodeLog * /*cache_log*/) {
+          this->execute_multi_function(params);
+        });
+  }
+
+  void execute_multi_function(lf::Params &params) const
   {
     Vector<const void *> input_values(inputs_.size());
     Vector<void *> output_values(outputs_.size());
@@ -548,20 +598,30 @@ class LazyFunctionForImplicitInput : public LazyFunction {
    * The function that generates the implicit input. The passed in memory is uninitialized.
    */
   std::function<void(void *)> init_fn_;
+  std::optional<geo_eval_cache::FunctionKey> cache_key_;
 
  public:
-  LazyFunctionForImplicitInput(const CPPType &type, std::function<void(void *)> init_fn)
-      : init_fn_(std::move(init_fn))
+  LazyFunctionForImplicitInput(const CPPType &type,
+                               std::function<void(void *)> init_fn,
+                               const std::optional<geo_eval_cache::FunctionKey> &cache_key)
+      : init_fn_(std::move(init_fn)), cache_key_(cache_key)
   {
     debug_name_ = "Input";
     outputs_.append({"Output", type});
   }
 
-  void execute_impl(lf::Params &params, const lf::Context & /*context*/) const override
+  void execute_impl(lf::Params &params, const lf::Context &context) const override
   {
-    void *value = params.get_output_data_ptr(0);
-    init_fn_(value);
-    params.output_set(0);
+    geo_eval_cache::execute(
+        *this,
+        cache_key_,
+        params,
+        context,
+        [&](lf::Params &params, geo_eval_cache::NodeLog * /*cache_log*/) {
+          void *value = params.get_output_data_ptr(0);
+          init_fn_(value);
+          params.output_set(0);
+        });
   }
 };
 
@@ -1638,7 +1698,7 @@ struct GeometryNodesLazyFunctionGraphBuilder {
       const Span<const bNodeLink *> links = type_with_links.links;
 
       lf::OutputSocket *converted_from_lf_socket = this->insert_type_conversion_if_necessary(
-          from_lf_socket, to_type);
+          from_bsocket, from_lf_socket, to_type);
 
       auto make_input_link_or_set_default = [&](lf::InputSocket &to_lf_socket) {
         if (converted_from_lf_socket == nullptr) {
@@ -1690,7 +1750,8 @@ struct GeometryNodesLazyFunctionGraphBuilder {
     }
   }
 
-  lf::OutputSocket *insert_type_conversion_if_necessary(lf::OutputSocket &from_socket,
+  lf::OutputSocket *insert_type_conversion_if_necessary(const bNodeSocket &from_bsocket,
+                                                        lf::OutputSocket &from_socket,
                                                         const CPPType &to_type)
   {
     const CPPType &from_type = from_socket.type();
@@ -1704,8 +1765,13 @@ struct GeometryNodesLazyFunctionGraphBuilder {
         const MultiFunction &multi_fn = *conversions_->get_conversion_multi_function(
             mf::DataType::ForSingle(from_field_type->value),
             mf::DataType::ForSingle(to_field_type->value));
+        const int32_t node_id = from_bsocket.owner_node().identifier;
+        const geo_eval_cache::FunctionKey cache_key{
+            node_id,
+            get_default_hash_4(node_id, from_bsocket.in_out, from_bsocket.index(), &to_type),
+            get_default_hash_2(&multi_fn, &to_type)};
         auto fn = std::make_unique<LazyFunctionForMultiFunctionConversion>(
-            multi_fn, *from_field_type, *to_field_type);
+            multi_fn, *from_field_type, *to_field_type, cache_key);
         lf::Node &conversion_node = lf_graph_->add_function(*fn);
         lf_graph_info_->functions.append(std::move(fn));
         lf_graph_->add_link(from_socket, conversion_node.input(0));
@@ -1764,7 +1830,17 @@ struct GeometryNodesLazyFunctionGraphBuilder {
       (*implicit_input_fn)(bnode, r_value);
     };
     const CPPType &type = input_lf_socket.type();
-    auto lazy_function = std::make_unique<LazyFunctionForImplicitInput>(type, std::move(init_fn));
+    std::optional<geo_eval_cache::FunctionKey> cache_key;
+    if (const std::optional<uint64_t> properties_hash = geo_eval_cache::hash_node_properties(
+            bnode)) {
+      cache_key = geo_eval_cache::FunctionKey{
+          bnode.identifier,
+          get_default_hash_4(
+              bnode.identifier, input_bsocket.in_out, input_bsocket.index(), &type),
+          *properties_hash};
+    }
+    auto lazy_function = std::make_unique<LazyFunctionForImplicitInput>(
+        type, std::move(init_fn), cache_key);
     lf::Node &lf_node = lf_graph_->add_function(*lazy_function);
     lf_graph_info_->functions.append(std::move(lazy_function));
     lf_graph_->add_link(lf_node.output(0), input_lf_socket);
@@ -2914,6 +2990,23 @@ GeometryNodesLazyFunctionGraphInfo::~GeometryNodesLazyFunctionGraphInfo()
   }
 }
 
+/** Find the node that a lazy-function node has been created for, based on the socket mapping. */
+static const bNode *find_bnode(const GeometryNodesLazyFunctionGraphInfo &lf_graph_info,
+                              const lf::Node &node)
+{
+  for (const Span<const lf::Socket *> lf_sockets :
+       {node.inputs().cast<const lf::Socket *>(), node.outputs().cast<const lf::Socket *>()}) {
+    for (const lf::Socket *lf_socket : lf_sockets) {
+      const Span<const bNodeSocket *> bsockets =
+          lf_graph_info.mapping.bsockets_by_lf_socket_map.lookup(lf_socket);
+      if (!bsockets.is_empty()) {
+        return &bsockets[0]->owner_node();
+      }
+    }
+  }
+  return nullptr;
+}
+
 [[maybe_unused]] static void add_thread_id_debug_message(
     const GeometryNodesLazyFunctionGraphInfo &lf_graph_info,
     const lf::FunctionNode &node,
@@ -2931,25 +3024,9 @@ GeometryNodesLazyFunctionGraphInfo::~GeometryNodesLazyFunctionGraphInfo()
   geo_eval_log::GeoTreeLogger &tree_logger =
       user_data->modifier_data->eval_log->get_local_tree_logger(*user_data->compute_context);
 
-  /* Find corresponding node based on the socket mapping. */
-  auto check_sockets = [&](const Span<const lf::Socket *> lf_sockets) {
-    for (const lf::Socket *lf_socket : lf_sockets) {
-      const Span<const bNodeSocket *> bsockets =
-          lf_graph_info.mapping.bsockets_by_lf_socket_map.lookup(lf_socket);
-      if (!bsockets.is_empty()) {
-        const bNodeSocket &bsocket = *bsockets[0];
-        const bNode &bnode = bsocket.owner_node();
-        tree_logger.debug_messages.append({bnode.identifier, thread_id_str});
-        return true;
-      }
-    }
-    return false;
-  };
-
-  if (check_sockets(node.inputs().cast<const lf::Socket *>())) {
-    return;
+  if (const bNode *bnode = find_bnode(lf_graph_info, node)) {
+    tree_logger.debug_messages.append({bnode->identifier, thread_id_str});
   }
-  check_sockets(node.outputs().cast<const lf::Socket *>());
 }
 
 void GeometryNodesLazyFunctionLogger::log_before_node_execute(const lf::FunctionNode &node,
@@ -2962,4 +3039,13 @@ void GeometryNodesLazyFunctionLogger::log_before_node_execute(const lf::Function
   }
 }
 
+void GeometryNodesLazyFunctionLogger::log_node_wait(const lf::Node &node,
+                                                    const std::chrono::nanoseconds wait_time,
+                                                    const lf::Context &context) const
+{
+  if (geo_eval_profile::is_enabled()) {
+    geo_eval_profile::record_wait(node, find_bnode(lf_graph_info_, node), wait_time, context);
+  }
+}
+
 }  // namespace blender::nodes
@@ -0,0 +1,519 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup nodes
+ *
+ * Geometry nodes profiling, writing the Chrome trace event format:
+ * https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "NOD_geometry.h"
+#include "NOD_geometry_nodes_lazy_function.hh"
+#include "NOD_geometry_nodes_profile.hh"
+
+#include "BLI_fileops.h"
+#include "BLI_map.hh"
+#include "BLI_set.hh"
+#include "BLI_string.h"
+#include "BLI_task_trace.hh"
+#include "BLI_vector.hh"
+
+#include "DNA_node_types.h"
+
+#include "BKE_attribute.hh"
+#include "BKE_geometry_set.hh"
+#include "BKE_node_runtime.hh"
+
+#include "DEG_depsgraph_query.h"
+
+#include "FN_field.hh"
+
+namespace blender::nodes::geo_eval_profile {
+
+using threading::trace::time_ns;
+
+std::atomic<bool> is_enabled_flag = false;
+
+/** Names are copied, because node trees may be freed before the profile is written. */
+struct NodeInfo {
+  std::string tree_name;
+  std::string node_name;
+  std::string idname;
+};
+
+struct Event {
+  /** Index in #ThreadProfile::node_infos. */
+  int node_info_index;
+  /** True when the thread waited in the graph executor, otherwise the node was executed. */
+  bool is_wait;
+  float frame;
+  uint64_t start_ns;
+  uint64_t end_ns;
+  int64_t created_bytes;
+  int64_t field_elements_num;
+};
+
+/** Everything recorded by a single thread, so that recording doesn't need locks. */
+struct ThreadProfile {
+  int thread_index;
+  Map<const void *, int> node_info_indices;
+  Vector<NodeInfo> node_infos;
+  Vector<Event> events;
+};
+
+/** Protects everything below, only used when starting & stopping and for new threads. */
+static std::mutex profile_mutex;
+static uint64_t profile_begin_ns = 0;
+/** Kept (and reused) until exit, because threads keep pointers to them. */
+static std::vector<std::unique_ptr<ThreadProfile>> thread_profiles;
+
+static thread_local ThreadProfile *thread_profile = nullptr;
+
+static ThreadProfile &thread_profile_get()
+{
+  if (UNLIKELY(thread_profile == nullptr)) {
+    std::lock_guard lock{profile_mutex};
+    std::unique_ptr<ThreadProfile> profile = std::make_unique<ThreadProfile>();
+    profile->thread_index = int(thread_profiles.size());
+    thread_profile = profile.get();
+    thread_profiles.push_back(std::move(profile));
+  }
+  return *thread_profile;
+}
+
+static int node_info_index(ThreadProfile &profile,
+                           const void *key,
+                           const FunctionRef<NodeInfo()> create_fn)
+{
+  return profile.node_info_indices.lookup_or_add_cb(key, [&]() {
+    profile.node_infos.append(create_fn());
+    return int(profile.node_infos.size() - 1);
+  });
+}
+
+static int node_info_index(ThreadProfile &profile, const bNode &node)
+{
+  return node_info_index(profile, &node, [&]() {
+    return NodeInfo{node.owner_tree().id.name + 2, node.name, node.idname};
+  });
+}
+
+static float current_frame(const lf::Context &context)
+{
+  const GeoNodesLFUserData *user_data = dynamic_cast<GeoNodesLFUserData *>(context.user_data);
+  if (user_data == nullptr || user_data->modifier_data->depsgraph == nullptr) {
+    return 0.0f;
+  }
+  return DEG_get_ctime(user_data->modifier_data->depsgraph);
+}
+
+/* -------------------------------------------------------------------- */
+/** \name Recording
+ * \{ */
+
+static void foreach_component(const CPPType &type,
+                              const void *value,
+                              const FunctionRef<void(const GeometryComponent &component)> fn)
+{
+  auto foreach_geometry_component = [&](const GeometrySet &geometry) {
+    for (const GeometryComponent *component : geometry.get_components_for_read()) {
+      fn(*component);
+    }
+  };
+  if (type.is<GeometrySet>()) {
+    foreach_geometry_component(*static_cast<const GeometrySet *>(value));
+  }
+  else if (type.is<Vector<GeometrySet>>()) {
+    for (const GeometrySet &geometry : *static_cast<const Vector<GeometrySet> *>(value)) {
+      foreach_geometry_component(geometry);
+    }
+  }
+}
+
+/**
+ * Forwards to the params of the node, and measures the geometry passed to the outputs compared
+ * to the geometry that has been passed in.
+ */
+class ProfilingParams : public lf::Params {
+ private:
+  lf::Params &params_;
+  /** Size of the input components when the execution started. */
+  const Map<const GeometryComponent *, int64_t> &input_sizes_;
+  Array<void *> output_ptrs_;
+
+ public:
+  std::atomic<int64_t> created_bytes = 0;
+
+  ProfilingParams(const lf::LazyFunction &fn,
+                  lf::Params &params,
+                  const Map<const GeometryComponent *, int64_t> &input_sizes)
+      : lf::Params(fn, true),
+        params_(params),
+        input_sizes_(input_sizes),
+        output_ptrs_(fn.outputs().size())
+  {
+  }
+
+ private:
+  void *try_get_input_data_ptr_impl(const int index) const override
+  {
+    return params_.try_get_input_data_ptr(index);
+  }
+
+  void *try_get_input_data_ptr_or_request_impl(const int index) override
+  {
+    return params_.try_get_input_data_ptr_or_request(index);
+  }
+
+  void *get_output_data_ptr_impl(const int index) override
+  {
+    void *value = params_.get_output_data_ptr(index);
+    output_ptrs_[index] = value;
+    return value;
+  }
+
+  void output_set_impl(const int index) override
+  {
+    int64_t bytes = 0;
+    foreach_component(
+        *fn_.outputs()[index].type, output_ptrs_[index], [&](const GeometryComponent &component) {
+          const int64_t input_size = input_sizes_.lookup_default(&component, 0);
+          bytes += std::max<int64_t>(component.attributes_size_in_bytes() - input_size, 0);
+        });
+    this->created_bytes += bytes;
+    params_.output_set(index);
+  }
+
+  bool output_was_set_impl(const int index) const override
+  {
+    return params_.output_was_set(index);
+  }
+
+  lf::ValueUsage get_output_usage_impl(const int index) const override
+  {
+    return params_.get_output_usage(index);
+  }
+
+  void set_input_unused_impl(const int index) override
+  {
+    params_.set_input_unused(index);
+  }
+
+  bool try_enable_multi_threading_impl() override
+  {
+    return params_.try_enable_multi_threading();
+  }
+};
+
+void execute_node(const lf::LazyFunction &fn,
+                  const bNode &node,
+                  lf::Params &params,
+                  const lf::Context &context,
+                  const FunctionRef<void(lf::Params &params)> execute_fn)
+{
+  if (!is_enabled()) {
+    execute_fn(params);
+    return;
+  }
+
+  /* Inputs that are requested lazily during the execution are not taken into account. */
+  Map<const GeometryComponent *, int64_t> input_sizes;
+  for (const int i : fn.inputs().index_range()) {
+    if (const void *value = params.try_get_input_data_ptr(i)) {
+      foreach_component(*fn.inputs()[i].type, value, [&](const GeometryComponent &component) {
+        input_sizes.add(&component, component.attributes_size_in_bytes());
+      });
+    }
+  }
+  ProfilingParams profiling_params{fn, params, input_sizes};
+
+  const int64_t field_elements_start = fn::evaluated_field_elements_num();
+  const uint64_t start_ns = time_ns();
+  execute_fn(profiling_params);
+  const uint64_t end_ns = time_ns();
+
+  ThreadProfile &profile = thread_profile_get();
+  profile.events.append({node_info_index(profile, node),
+                         false,
+                         current_frame(context),
+                         start_ns,
+                         end_ns,
+                         profiling_params.created_bytes.load(),
+                         fn::evaluated_field_elements_num() - field_elements_start});
+}
+
+void record_wait(const lf::Node &lf_node,
+                 const bNode *node,
+                 const std::chrono::nanoseconds wait_time,
+                 const lf::Context &context)
+{
+  if (!is_enabled()) {
+    return;
+  }
+  const uint64_t end_ns = time_ns();
+  ThreadProfile &profile = thread_profile_get();
+  const int info_index = node ? node_info_index(profile, *node) :
+                                node_info_index(profile, &lf_node, [&]() {
+                                  return NodeInfo{"", lf_node.name(), ""};
+                                });
+  profile.events.append(
+      {info_index, true, current_frame(context), end_ns - wait_time.count(), end_ns, 0, 0});
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Writing
+ * \{ */
+
+static std::string json_escape(const StringRef str)
+{
+  std::string result;
+  for (const char c : str) {
+    if (ELEM(c, '"', '\\')) {
+      result += '\\';
+      result += c;
+    }
+    else if (uint8_t(c) < 0x20) {
+      char buffer[8];
+      SNPRINTF(buffer, "\\u%04x", int(c));
+      result += buffer;
+    }
+    else {
+      result += c;
+    }
+  }
+  return result;
+}
+
+static double ns_to_ms(const uint64_t ns)
+{
+  return double(ns) / 1e6;
+}
+
+struct NodeSummary {
+  const NodeInfo *info;
+  int64_t executions_num = 0;
+  uint64_t run_ns = 0;
+  uint64_t max_run_ns = 0;
+  uint64_t wait_ns = 0;
+  int64_t created_bytes = 0;
+  int64_t field_elements_num = 0;
+  Set<int> threads;
+};
+
+struct FrameSummary {
+  float frame;
+  int64_t executions_num = 0;
+  uint64_t run_ns = 0;
+  uint64_t wait_ns = 0;
+};
+
+struct ThreadSummary {
+  int thread_index;
+  int64_t executions_num = 0;
+  uint64_t run_ns = 0;
+  uint64_t wait_ns = 0;
+};
+
+static void write_trace_events(FILE *file)
+{
+  fprintf(file,
+          "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+          "\"args\":{\"name\":\"Geometry Nodes\"}}");
+  for (const std::unique_ptr<ThreadProfile> &profile : thread_profiles) {
+    if (profile->events.is_empty()) {
+      continue;
+    }
+    fprintf(file,
+            ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+            "\"args\":{\"name\":\"Thread %d\"}}",
+            profile->thread_index,
+            profile->thread_index);
+    for (const Event &event : profile->events) {
+      const NodeInfo &info = profile->node_infos[event.node_info_index];
+      const double ts_us = double(int64_t(event.start_ns - profile_begin_ns)) / 1000.0;
+      const double dur_us = double(event.end_ns - event.start_ns) / 1000.0;
+      fprintf(file,
+              ",\n{\"name\":\"%s%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+              "\"pid\":1,\"tid\":%d,\"args\":{\"tree\":\"%s\",\"type\":\"%s\",\"frame\":%g,"
+              "\"created_bytes\":%lld,\"field_elements\":%lld}}",
+              event.is_wait ? "Wait: " : "",
+              json_escape(info.node_name).c_str(),
+              event.is_wait ? "geometry_nodes_wait" : "geometry_nodes",
+              ts_us,
+              dur_us,
+              profile->thread_index,
+              json_escape(info.tree_name).c_str(),
+              info.idname.c_str(),
+              double(event.frame),
+              (long long)event.created_bytes,
+              (long long)event.field_elements_num);
+    }
+  }
+}
+
+/** Summary of all events per node, sorted by run time, per frame and per thread. */
+static void write_summary(FILE *file, const uint64_t end_ns)
+{
+  Map<std::pair<StringRef, StringRef>, NodeSummary> node_summaries;
+  Map<float, FrameSummary> frame_summaries;
+  Vector<ThreadSummary> thread_summaries;
+  for (const std::unique_ptr<ThreadProfile> &profile : thread_profiles) {
+    if (profile->events.is_empty()) {
+      continue;
+    }
+    thread_summaries.append({profile->thread_index});
+    ThreadSummary &thread_summary = thread_summaries.last();
+    for (const Event &event : profile->events) {
+      const NodeInfo &info = profile->node_infos[event.node_info_index];
+      NodeSummary &node_summary = node_summaries.lookup_or_add_cb(
+          {info.tree_name, info.node_name}, [&]() { return NodeSummary{&info}; });
+      FrameSummary &frame_summary = frame_summaries.lookup_or_add_cb(
+          event.frame, [&]() { return FrameSummary{event.frame}; });
+      const uint64_t duration_ns = event.end_ns - event.start_ns;
+      if (event.is_wait) {
+        node_summary.wait_ns += duration_ns;
+        frame_summary.wait_ns += duration_ns;
+        thread_summary.wait_ns += duration_ns;
+        continue;
+      }
+      node_summary.executions_num++;
+      node_summary.run_ns += duration_ns;
+      node_summary.max_run_ns = std::max(node_summary.max_run_ns, duration_ns);
+      node_summary.created_bytes += event.created_bytes;
+      node_summary.field_elements_num += event.field_elements_num;
+      node_summary.threads.add(profile->thread_index);
+      frame_summary.executions_num++;
+      frame_summary.run_ns += duration_ns;
+      thread_summary.executions_num++;
+      thread_summary.run_ns += duration_ns;
+    }
+  }
+
+  Vector<const NodeSummary *> sorted_nodes;
+  for (const NodeSummary &node_summary : node_summaries.values()) {
+    sorted_nodes.append(&node_summary);
+  }
+  std::sort(sorted_nodes.begin(),
+            sorted_nodes.end(),
+            [](const NodeSummary *a, const NodeSummary *b) { return a->run_ns > b->run_ns; });
+  Vector<const FrameSummary *> sorted_frames;
+  for (const FrameSummary &frame_summary : frame_summaries.values()) {
+    sorted_frames.append(&frame_summary);
+  }
+  std::sort(sorted_frames.begin(),
+            sorted_frames.end(),
+            [](const FrameSummary *a, const FrameSummary *b) { return a->frame < b->frame; });
+
+  const uint64_t duration_ns = end_ns - profile_begin_ns;
+  fprintf(file, "\"geometryNodes\":{\"duration_ms\":%.3f,\"nodes\":[", ns_to_ms(duration_ns));
+  for (const int i : sorted_nodes.index_range()) {
+    const NodeSummary &node = *sorted_nodes[i];
+    fprintf(file,
+            "%s\n{\"tree\":\"%s\",\"node\":\"%s\",\"type\":\"%s\",\"executions\":%lld,"
+            "\"time_ms\":%.3f,\"max_time_ms\":%.3f,\"wait_ms\":%.3f,\"created_bytes\":%lld,"
+            "\"field_elements\":%lld,\"threads\":%lld}",
+            i == 0 ? "" : ",",
+            json_escape(node.info->tree_name).c_str(),
+            json_escape(node.info->node_name).c_str(),
+            node.info->idname.c_str(),
+            (long long)node.executions_num,
+            ns_to_ms(node.run_ns),
+            ns_to_ms(node.max_run_ns),
+            ns_to_ms(node.wait_ns),
+            (long long)node.created_bytes,
+            (long long)node.field_elements_num,
+            (long long)node.threads.size());
+  }
+  fprintf(file, "],\"frames\":[");
+  for (const int i : sorted_frames.index_range()) {
+    const FrameSummary &frame = *sorted_frames[i];
+    fprintf(file,
+            "%s\n{\"frame\":%g,\"executions\":%lld,\"time_ms\":%.3f,\"wait_ms\":%.3f}",
+            i == 0 ? "" : ",",
+            double(frame.frame),
+            (long long)frame.executions_num,
+            ns_to_ms(frame.run_ns),
+            ns_to_ms(frame.wait_ns));
+  }
+  /* Utilization is the part of the profile duration that the thread spent executing nodes. */
+  fprintf(file, "],\"threads\":[");
+  for (const int i : thread_summaries.index_range()) {
+    const ThreadSummary &thread = thread_summaries[i];
+    fprintf(file,
+            "%s\n{\"thread\":%d,\"executions\":%lld,\"time_ms\":%.3f,\"wait_ms\":%.3f,"
+            "\"utilization\":%.4f}",
+            i == 0 ? "" : ",",
+            thread.thread_index,
+            (long long)thread.executions_num,
+            ns_to_ms(thread.run_ns),
+            ns_to_ms(thread.wait_ns),
+            duration_ns > 0 ? double(thread.run_ns) / double(duration_ns) : 0.0);
+  }
+  fprintf(file, "]}");
+}
+
+static bool profile_write(const char *filepath, const uint64_t end_ns)
+{
+  FILE *file = BLI_fopen(filepath, "w");
+  if (file == nullptr) {
+    fprintf(stderr, "Geometry nodes profile: unable to write '%s'\n", filepath);
+    return false;
+  }
+
+  /* Trace viewers ignore the additional summary. */
+  fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  write_trace_events(file);
+  fprintf(file, "\n],\n");
+  write_summary(file, end_ns);
+  fprintf(file, "\n}\n");
+
+  const bool success = (ferror(file) == 0);
+  fclose(file);
+  return success;
+}
+
+static void profile_clear()
+{
+  for (std::unique_ptr<ThreadProfile> &profile : thread_profiles) {
+    profile->node_info_indices.clear_and_shrink();
+    profile->node_infos.clear_and_shrink();
+    profile->events.clear_and_shrink();
+  }
+}
+
+/** \} */
+
+}  // namespace blender::nodes::geo_eval_profile
+
+using namespace blender::nodes::geo_eval_profile;
+
+void NOD_geometry_nodes_profile_begin()
+{
+  std::lock_guard lock{profile_mutex};
+  profile_clear();
+  profile_begin_ns = time_ns();
+  is_enabled_flag.store(true, std::memory_order_release);
+}
+
+bool NOD_geometry_nodes_profile_end(const char *filepath)
+{
+  if (!is_enabled()) {
+    return true;
+  }
+  is_enabled_flag.store(false, std::memory_order_release);
+  const uint64_t end_ns = time_ns();
+
+  std::lock_guard lock{profile_mutex};
+  const bool success = profile_write(filepath, end_ns);
+  profile_clear();
+  return success;
+}
@@ -8,6 +8,7 @@
 #include "BKE_type_conversions.hh"
 
 #include "NOD_geometry_exec.hh"
+#include "NOD_geometry_nodes_cache.hh"
 
 #include "BLI_hash_md5.h"
 
@@ -46,6 +47,9 @@ std::string NodeAnonymousAttributeID::user_name() const
 void GeoNodeExecParams::error_message_add(const NodeWarningType type,
                                           const StringRef message) const
 {
+  if (cache_log_ != nullptr) {
+    cache_log_->add_warning(type, message);
+  }
   if (geo_eval_log::GeoTreeLogger *tree_logger = this->get_local_tree_logger()) {
     tree_logger->node_warnings.append(
         {node_.identifier, {type, tree_logger->allocator->copy_string(message)}});
@@ -55,6 +59,9 @@ void GeoNodeExecParams::error_message_add(const NodeWarningType type,
 void GeoNodeExecParams::used_named_attribute(const StringRef attribute_name,
                                              const NamedAttributeUsage usage)
 {
+  if (cache_log_ != nullptr) {
+    cache_log_->add_used_named_attribute(attribute_name, usage);
+  }
   if (geo_eval_log::GeoTreeLogger *tree_logger = this->get_local_tree_logger()) {
     tree_logger->used_named_attributes.append(
         {node_.identifier, tree_logger->allocator->copy_string(attribute_name), usage});
@@ -19,9 +19,16 @@ struct Scene;
 struct Sequence;
 struct rctf;
 
+/** Maximum number of frames the prefetch job renders concurrently. */
+#define SEQ_PREFETCH_RENDERERS_MAX 16
+
 typedef enum eSeqTaskId {
   SEQ_TASK_MAIN_RENDER,
+  /* Images read from disk cache ahead of the playhead. */
+  SEQ_TASK_READ_AHEAD,
+  /* Each prefetch renderer uses its own ID, counting up from this one. */
   SEQ_TASK_PREFETCH_RENDER,
+  SEQ_TASK_ID_MAX = SEQ_TASK_PREFETCH_RENDER + SEQ_PREFETCH_RENDERERS_MAX,
 } eSeqTaskId;
 
 typedef struct SeqRenderData {
@@ -9,8 +9,12 @@
 #include <stddef.h>
 #include <time.h>
 
+#include <zstd.h>
+
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "DNA_scene_types.h"
 #include "DNA_sequence_types.h"
 #include "DNA_space_types.h" /* for FILE_MAX. */
@@ -28,6 +32,7 @@
 #include "BLI_listbase.h"
 #include "BLI_mempool.h"
 #include "BLI_path_util.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 
 #include "BKE_main.h"
@@ -59,6 +64,12 @@
  * size specified in user preferences.
  * To distinguish 2 blend files with same name, scene->ed->disk_cache_timestamp
  * is used as UID. Blend file can still be copied manually which may cause conflict.
+ *
+ * Images are compressed and written by background tasks, so rendering doesn't wait for disk.
+ * When too many writes are pending, the image is written by the calling thread instead.
+ * Headers of cache files are kept in memory once read, so looking up an image doesn't need to
+ * read the header from disk again. Image data of different entries can be read in parallel,
+ * writing and deleting files is exclusive.
  */
 
 /* Format string:
@@ -67,6 +78,8 @@
 #define DCACHE_IMAGES_PER_FILE 100
 #define DCACHE_CURRENT_VERSION 2
 #define COLORSPACE_NAME_MAX 64 /* XXX: defined in IMB intern. */
+/* Maximum number of images waiting to be written by background tasks. */
+#define DCACHE_WRITE_QUEUE_MAX 8
 
 typedef struct DiskCacheHeaderEntry {
   uchar encoding;
@@ -85,8 +98,13 @@ typedef struct SeqDiskCache {
   Main *bmain;
   int64_t timestamp;
   ListBase files;
+  /* Protects list of files and their headers. */
   ThreadMutex read_write_mutex;
+  /* Shared while reading image data, exclusive while writing or deleting files. */
+  ThreadRWMutex file_lock;
   size_t size_total;
+  TaskPool *write_pool;
+  int32_t writes_pending;
 } SeqDiskCache;
 
 typedef struct DiskCacheFile {
@@ -101,9 +119,15 @@ typedef struct DiskCacheFile {
   int render_size;
   int view_id;
   int start_frame;
+  /* Copy of the file header, read on first access. */
+  DiskCacheHeader *header;
 } DiskCacheFile;
 
-static ThreadMutex cache_create_lock = BLI_MUTEX_INITIALIZER;
+typedef struct DiskCacheWriteTask {
+  char filepath[FILE_MAX];
+  uint64_t frameno;
+  ImBuf *ibuf;
+} DiskCacheWriteTask;
 
 static char *seq_disk_cache_base_dir(void)
 {
@@ -199,6 +223,14 @@ static void seq_disk_cache_get_files(SeqDiskCache *disk_cache, char *path)
   BLI_filelist_free(filelist, filelist_num);
 }
 
+static void seq_disk_cache_free_files(SeqDiskCache *disk_cache)
+{
+  LISTBASE_FOREACH (DiskCacheFile *, cache_file, &disk_cache->files) {
+    MEM_SAFE_FREE(cache_file->header);
+  }
+  BLI_freelistN(&disk_cache->files);
+}
+
 static DiskCacheFile *seq_disk_cache_get_oldest_file(SeqDiskCache *disk_cache)
 {
   DiskCacheFile *oldest_file = disk_cache->files.first;
@@ -219,11 +251,13 @@ static void seq_disk_cache_delete_file(SeqDiskCache *disk_cache, DiskCacheFile *
   disk_cache->size_total -= file->fstat.st_size;
   BLI_delete(file->path, false, false);
   BLI_remlink(&disk_cache->files, file);
+  MEM_SAFE_FREE(file->header);
   MEM_freeN(file);
 }
 
 bool seq_disk_cache_enforce_limits(SeqDiskCache *disk_cache)
 {
+  BLI_rw_mutex_lock(&disk_cache->file_lock, THREAD_LOCK_WRITE);
   BLI_mutex_lock(&disk_cache->read_write_mutex);
   while (disk_cache->size_total > seq_disk_cache_size_limit()) {
     DiskCacheFile *oldest_file = seq_disk_cache_get_oldest_file(disk_cache);
@@ -236,7 +270,7 @@ bool seq_disk_cache_enforce_limits(SeqDiskCache *disk_cache)
 
     if (BLI_exists(oldest_file->path) == 0) {
       /* File may have been manually deleted during runtime, do re-scan. */
-      BLI_freelistN(&disk_cache->files);
+      seq_disk_cache_free_files(disk_cache);
       seq_disk_cache_get_files(disk_cache, seq_disk_cache_base_dir());
       continue;
     }
@@ -244,11 +278,13 @@ bool seq_disk_cache_enforce_limits(SeqDiskCache *disk_cache)
     seq_disk_cache_delete_file(disk_cache, oldest_file);
   }
   BLI_mutex_unlock(&disk_cache->read_write_mutex);
+  BLI_rw_mutex_unlock(&disk_cache->file_lock);
 
   return true;
 }
 
-static DiskCacheFile *seq_disk_cache_get_file_entry_by_path(SeqDiskCache *disk_cache, char *path)
+static DiskCacheFile *seq_disk_cache_get_file_entry_by_path(SeqDiskCache *disk_cache,
+                                                            const char *path)
 {
   DiskCacheFile *cache_file = disk_cache->files.first;
 
@@ -262,7 +298,7 @@ static DiskCacheFile *seq_disk_cache_get_file_entry_by_path(SeqDiskCache *disk_c
 }
 
 /* Update file size and timestamp. */
-static void seq_disk_cache_update_file(SeqDiskCache *disk_cache, char *path)
+static void seq_disk_cache_update_file(SeqDiskCache *disk_cache, const char *path)
 {
   DiskCacheFile *cache_file;
   int64_t size_before;
@@ -410,6 +446,10 @@ void seq_disk_cache_invalidate(SeqDiskCache *disk_cache,
   int start;
   int end;
 
+  /* Images queued before invalidation must not end up on disk after it. */
+  BLI_task_pool_work_and_wait(disk_cache->write_pool);
+
+  BLI_rw_mutex_lock(&disk_cache->file_lock, THREAD_LOCK_WRITE);
   BLI_mutex_lock(&disk_cache->read_write_mutex);
 
   start = SEQ_time_left_handle_frame_get(scene, seq_changed) - DCACHE_IMAGES_PER_FILE;
@@ -418,23 +458,58 @@ void seq_disk_cache_invalidate(SeqDiskCache *disk_cache,
   seq_disk_cache_delete_invalid_files(disk_cache, scene, seq, invalidate_types, start, end);
 
   BLI_mutex_unlock(&disk_cache->read_write_mutex);
+  BLI_rw_mutex_unlock(&disk_cache->file_lock);
 }
 
-static size_t deflate_imbuf_to_file(ImBuf *ibuf,
-                                    FILE *file,
-                                    int level,
-                                    DiskCacheHeaderEntry *header_entry)
+static size_t seq_disk_cache_imbuf_size(ImBuf *ibuf)
 {
-  void *data = (ibuf->rect != NULL) ? (void *)ibuf->rect : (void *)ibuf->rect_float;
+  if (ibuf->rect) {
+    return (size_t)ibuf->x * ibuf->y * ibuf->channels;
+  }
+  return (size_t)ibuf->x * ibuf->y * ibuf->channels * 4;
+}
+
+/**
+ * Compress image data in memory, so the file only needs to be locked while the result is
+ * written. Returns NULL when data should be written without compression.
+ */
+static void *deflate_imbuf_to_mem(ImBuf *ibuf, int level, size_t *r_size)
+{
+  if (level <= 0) {
+    return NULL;
+  }
+
+  const void *data = (ibuf->rect != NULL) ? (void *)ibuf->rect : (void *)ibuf->rect_float;
+  const size_t size_raw = seq_disk_cache_imbuf_size(ibuf);
+  const size_t size_bound = ZSTD_compressBound(size_raw);
+  void *buf = MEM_mallocN(size_bound, __func__);
 
-  /* Apply compression if wanted, otherwise just write directly to the file. */
-  if (level > 0) {
-    return BLI_file_zstd_from_mem_at_pos(
-        data, header_entry->size_raw, file, header_entry->offset, level);
+  const size_t size_compressed = ZSTD_compress(buf, size_bound, data, size_raw, level);
+  if (ZSTD_isError(size_compressed)) {
+    MEM_freeN(buf);
+    return NULL;
+  }
+
+  *r_size = size_compressed;
+  return buf;
+}
+
+static size_t write_imbuf_data_to_file(ImBuf *ibuf,
+                                       const void *data_compressed,
+                                       size_t size_compressed,
+                                       FILE *file,
+                                       DiskCacheHeaderEntry *header_entry)
+{
+  const void *data = (ibuf->rect != NULL) ? (void *)ibuf->rect : (void *)ibuf->rect_float;
+  size_t size = header_entry->size_raw;
+
+  if (data_compressed != NULL) {
+    data = data_compressed;
+    size = size_compressed;
   }
 
   fseek(file, header_entry->offset, SEEK_SET);
-  return fwrite(data, 1, header_entry->size_raw, file);
+  return fwrite(data, 1, size, file);
 }
 
 static size_t inflate_file_to_imbuf(ImBuf *ibuf, FILE *file, DiskCacheHeaderEntry *header_entry)
@@ -483,7 +558,7 @@ static size_t seq_disk_cache_write_header(FILE *file, DiskCacheHeader *header)
   return fwrite(header, sizeof(*header), 1, file);
 }
 
-static int seq_disk_cache_add_header_entry(SeqCacheKey *key, ImBuf *ibuf, DiskCacheHeader *header)
+static int seq_disk_cache_add_header_entry(uint64_t frameno, ImBuf *ibuf, DiskCacheHeader *header)
 {
   int i;
   uint64_t offset = sizeof(*header);
@@ -516,16 +591,15 @@ static int seq_disk_cache_add_header_entry(SeqCacheKey *key, ImBuf *ibuf, DiskCa
   }
 
   header->entry[i].offset = offset;
-  header->entry[i].frameno = key->frame_index;
+  header->entry[i].frameno = frameno;
+  header->entry[i].size_raw = seq_disk_cache_imbuf_size(ibuf);
 
   /* Store colorspace name of ibuf. */
   const char *colorspace_name;
   if (ibuf->rect) {
-    header->entry[i].size_raw = ibuf->x * ibuf->y * ibuf->channels;
     colorspace_name = IMB_colormanagement_get_rect_colorspace(ibuf);
   }
   else {
-    header->entry[i].size_raw = ibuf->x * ibuf->y * ibuf->channels * 4;
     colorspace_name = IMB_colormanagement_get_float_colorspace(ibuf);
   }
   BLI_strncpy(
@@ -545,85 +619,160 @@ static int seq_disk_cache_get_header_entry(SeqCacheKey *key, DiskCacheHeader *he
   return -1;
 }
 
-bool seq_disk_cache_write_file(SeqDiskCache *disk_cache, SeqCacheKey *key, ImBuf *ibuf)
+/**
+ * Get header of cache file, it is read from the file on first access.
+ * Must be called with #SeqDiskCache.read_write_mutex locked.
+ */
+static DiskCacheHeader *seq_disk_cache_file_header_get(DiskCacheFile *cache_file, FILE *file)
 {
-  BLI_mutex_lock(&disk_cache->read_write_mutex);
+  if (cache_file->header != NULL) {
+    return cache_file->header;
+  }
 
-  char filepath[FILE_MAX];
+  DiskCacheHeader *header = MEM_callocN(sizeof(*header), "DiskCacheHeader");
+  /* #BLI_make_existing_file() may create an empty file. This is fine, don't attempt reading
+   * the header in that case. */
+  if (cache_file->fstat.st_size != 0 && !seq_disk_cache_read_header(file, header)) {
+    MEM_freeN(header);
+    return NULL;
+  }
 
-  seq_disk_cache_get_file_path(disk_cache, key, filepath, sizeof(filepath));
+  cache_file->header = header;
+  return header;
+}
+
+static bool seq_disk_cache_write_file_ex(SeqDiskCache *disk_cache,
+                                         const char *filepath,
+                                         uint64_t frameno,
+                                         ImBuf *ibuf)
+{
+  size_t size_compressed = 0;
+  void *data_compressed = deflate_imbuf_to_mem(
+      ibuf, seq_disk_cache_compression_level(), &size_compressed);
+
+  BLI_rw_mutex_lock(&disk_cache->file_lock, THREAD_LOCK_WRITE);
+  BLI_mutex_lock(&disk_cache->read_write_mutex);
+
+  bool success = false;
   BLI_make_existing_file(filepath);
 
   FILE *file = BLI_fopen(filepath, "rb+");
   if (!file) {
     file = BLI_fopen(filepath, "wb+");
-    if (!file) {
-      BLI_mutex_unlock(&disk_cache->read_write_mutex);
-      return false;
+    if (file) {
+      seq_disk_cache_add_file_to_list(disk_cache, filepath);
     }
-    seq_disk_cache_add_file_to_list(disk_cache, filepath);
   }
 
-  DiskCacheFile *cache_file = seq_disk_cache_get_file_entry_by_path(disk_cache, filepath);
-  DiskCacheHeader header;
-  memset(&header, 0, sizeof(header));
-  /* #BLI_make_existing_file() above may create an empty file. This is fine, don't attempt reading
-   * the header in that case. */
-  if (cache_file->fstat.st_size != 0 && !seq_disk_cache_read_header(file, &header)) {
-    fclose(file);
-    seq_disk_cache_delete_file(disk_cache, cache_file);
-    BLI_mutex_unlock(&disk_cache->read_write_mutex);
-    return false;
+  if (file) {
+    DiskCacheFile *cache_file = seq_disk_cache_get_file_entry_by_path(disk_cache, filepath);
+    DiskCacheHeader *header = seq_disk_cache_file_header_get(cache_file, file);
+    if (header == NULL) {
+      fclose(file);
+      seq_disk_cache_delete_file(disk_cache, cache_file);
+    }
+    else {
+      int entry_index = seq_disk_cache_add_header_entry(frameno, ibuf, header);
+
+      size_t bytes_written = write_imbuf_data_to_file(
+          ibuf, data_compressed, size_compressed, file, &header->entry[entry_index]);
+
+      if (bytes_written != 0) {
+        /* Last step is writing header, as image data can be overwritten,
+         * but missing data would cause problems.
+         */
+        header->entry[entry_index].size_compressed = bytes_written;
+        seq_disk_cache_write_header(file, header);
+        success = true;
+      }
+      else {
+        /* Entry was not written, keep the header in sync with the file. */
+        MEM_SAFE_FREE(cache_file->header);
+      }
+      fclose(file);
+      seq_disk_cache_update_file(disk_cache, filepath);
+    }
   }
-  int entry_index = seq_disk_cache_add_header_entry(key, ibuf, &header);
 
-  size_t bytes_written = deflate_imbuf_to_file(
-      ibuf, file, seq_disk_cache_compression_level(), &header.entry[entry_index]);
+  BLI_mutex_unlock(&disk_cache->read_write_mutex);
+  BLI_rw_mutex_unlock(&disk_cache->file_lock);
 
-  if (bytes_written != 0) {
-    /* Last step is writing header, as image data can be overwritten,
-     * but missing data would cause problems.
-     */
-    header.entry[entry_index].size_compressed = bytes_written;
-    seq_disk_cache_write_header(file, &header);
-    seq_disk_cache_update_file(disk_cache, filepath);
-    fclose(file);
+  MEM_SAFE_FREE(data_compressed);
+  return success;
+}
+
+static void seq_disk_cache_write_task(TaskPool *__restrict pool, void *taskdata)
+{
+  SeqDiskCache *disk_cache = BLI_task_pool_user_data(pool);
+  DiskCacheWriteTask *task = taskdata;
+
+  seq_disk_cache_write_file_ex(disk_cache, task->filepath, task->frameno, task->ibuf);
+  seq_disk_cache_enforce_limits(disk_cache);
+
+  IMB_freeImBuf(task->ibuf);
+  atomic_sub_and_fetch_int32(&disk_cache->writes_pending, 1);
+}
+
+bool seq_disk_cache_write_file(SeqDiskCache *disk_cache, SeqCacheKey *key, ImBuf *ibuf)
+{
+  char filepath[FILE_MAX];
+  seq_disk_cache_get_file_path(disk_cache, key, filepath, sizeof(filepath));
 
-    BLI_mutex_unlock(&disk_cache->read_write_mutex);
-    return true;
+  /* Write in calling thread when the disk can't keep up, so queued images don't pile up in
+   * memory. */
+  if (atomic_add_and_fetch_int32(&disk_cache->writes_pending, 1) > DCACHE_WRITE_QUEUE_MAX) {
+    atomic_sub_and_fetch_int32(&disk_cache->writes_pending, 1);
+    const bool success = seq_disk_cache_write_file_ex(
+        disk_cache, filepath, key->frame_index, ibuf);
+    seq_disk_cache_enforce_limits(disk_cache);
+    return success;
   }
 
-  BLI_mutex_unlock(&disk_cache->read_write_mutex);
-  return false;
+  DiskCacheWriteTask *task = MEM_mallocN(sizeof(*task), "DiskCacheWriteTask");
+  STRNCPY(task->filepath, filepath);
+  task->frameno = key->frame_index;
+  task->ibuf = ibuf;
+  IMB_refImBuf(ibuf);
+
+  BLI_task_pool_push(disk_cache->write_pool, seq_disk_cache_write_task, task, true, NULL);
+  return true;
 }
 
 ImBuf *seq_disk_cache_read_file(SeqDiskCache *disk_cache, SeqCacheKey *key)
 {
-  BLI_mutex_lock(&disk_cache->read_write_mutex);
-
   char filepath[FILE_MAX];
-  DiskCacheHeader header;
 
   seq_disk_cache_get_file_path(disk_cache, key, filepath, sizeof(filepath));
   BLI_make_existing_file(filepath);
 
+  BLI_rw_mutex_lock(&disk_cache->file_lock, THREAD_LOCK_READ);
+
   FILE *file = BLI_fopen(filepath, "rb");
   if (!file) {
-    BLI_mutex_unlock(&disk_cache->read_write_mutex);
+    BLI_rw_mutex_unlock(&disk_cache->file_lock);
     return NULL;
   }
 
-  if (!seq_disk_cache_read_header(file, &header)) {
-    fclose(file);
-    BLI_mutex_unlock(&disk_cache->read_write_mutex);
-    return NULL;
+  BLI_mutex_lock(&disk_cache->read_write_mutex);
+  DiskCacheFile *cache_file = seq_disk_cache_get_file_entry_by_path(disk_cache, filepath);
+  DiskCacheHeader *header = NULL;
+  DiskCacheHeaderEntry header_entry;
+  int entry_index = -1;
+  if (cache_file != NULL) {
+    header = seq_disk_cache_file_header_get(cache_file, file);
   }
-  int entry_index = seq_disk_cache_get_header_entry(key, &header);
+  if (header != NULL) {
+    entry_index = seq_disk_cache_get_header_entry(key, header);
+  }
+  if (entry_index >= 0) {
+    header_entry = header->entry[entry_index];
+  }
+  BLI_mutex_unlock(&disk_cache->read_write_mutex);
 
   /* Item not found. */
   if (entry_index < 0) {
     fclose(file);
-    BLI_mutex_unlock(&disk_cache->read_write_mutex);
+    BLI_rw_mutex_unlock(&disk_cache->file_lock);
     return NULL;
   }
 
@@ -632,36 +781,38 @@ ImBuf *seq_disk_cache_read_file(SeqDiskCache *disk_cache, SeqCacheKey *key)
   uint64_t size_float = (uint64_t)key->context.rectx * key->context.recty * 16;
   size_t expected_size;
 
-  if (header.entry[entry_index].size_raw == size_char) {
+  if (header_entry.size_raw == size_char) {
     expected_size = size_char;
     ibuf = IMB_allocImBuf(key->context.rectx, key->context.recty, 32, IB_rect);
-    IMB_colormanagement_assign_rect_colorspace(ibuf, header.entry[entry_index].colorspace_name);
+    IMB_colormanagement_assign_rect_colorspace(ibuf, header_entry.colorspace_name);
   }
-  else if (header.entry[entry_index].size_raw == size_float) {
+  else if (header_entry.size_raw == size_float) {
     expected_size = size_float;
     ibuf = IMB_allocImBuf(key->context.rectx, key->context.recty, 32, IB_rectfloat);
-    IMB_colormanagement_assign_float_colorspace(ibuf, header.entry[entry_index].colorspace_name);
+    IMB_colormanagement_assign_float_colorspace(ibuf, header_entry.colorspace_name);
   }
   else {
     fclose(file);
-    BLI_mutex_unlock(&disk_cache->read_write_mutex);
+    BLI_rw_mutex_unlock(&disk_cache->file_lock);
     return NULL;
   }
 
-  size_t bytes_read = inflate_file_to_imbuf(ibuf, file, &header.entry[entry_index]);
+  size_t bytes_read = inflate_file_to_imbuf(ibuf, file, &header_entry);
+  fclose(file);
 
   /* Sanity check. */
   if (bytes_read != expected_size) {
-    fclose(file);
     IMB_freeImBuf(ibuf);
-    BLI_mutex_unlock(&disk_cache->read_write_mutex);
+    BLI_rw_mutex_unlock(&disk_cache->file_lock);
     return NULL;
   }
+
+  BLI_mutex_lock(&disk_cache->read_write_mutex);
   BLI_file_touch(filepath);
   seq_disk_cache_update_file(disk_cache, filepath);
-  fclose(file);
-
   BLI_mutex_unlock(&disk_cache->read_write_mutex);
+
+  BLI_rw_mutex_unlock(&disk_cache->file_lock);
   return ibuf;
 }
 
@@ -670,16 +821,20 @@ SeqDiskCache *seq_disk_cache_create(Main *bmain, Scene *scene)
   SeqDiskCache *disk_cache = MEM_callocN(sizeof(SeqDiskCache), "SeqDiskCache");
   disk_cache->bmain = bmain;
   BLI_mutex_init(&disk_cache->read_write_mutex);
+  BLI_rw_mutex_init(&disk_cache->file_lock);
+  disk_cache->write_pool = BLI_task_pool_create(disk_cache, TASK_PRIORITY_LOW);
   seq_disk_cache_handle_versioning(disk_cache);
   seq_disk_cache_get_files(disk_cache, seq_disk_cache_base_dir());
   disk_cache->timestamp = scene->ed->disk_cache_timestamp;
-  BLI_mutex_unlock(&cache_create_lock);
   return disk_cache;
 }
 
 void seq_disk_cache_free(SeqDiskCache *disk_cache)
 {
-  BLI_freelistN(&disk_cache->files);
+  BLI_task_pool_work_and_wait(disk_cache->write_pool);
+  BLI_task_pool_free(disk_cache->write_pool);
+  seq_disk_cache_free_files(disk_cache);
+  BLI_rw_mutex_end(&disk_cache->file_lock);
   BLI_mutex_end(&disk_cache->read_write_mutex);
   MEM_freeN(disk_cache);
 }
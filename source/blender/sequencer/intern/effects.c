@@ -3295,6 +3295,8 @@ static int early_out_text(Sequence *seq, float UNUSED(fac))
   return EARLY_NO_INPUT;
 }
 
+static ThreadMutex text_render_mutex = BLI_MUTEX_INITIALIZER;
+
 static ImBuf *do_text_effect(const SeqRenderData *context,
                              Sequence *seq,
                              float UNUSED(timeline_frame),
@@ -3314,6 +3316,9 @@ static ImBuf *do_text_effect(const SeqRenderData *context,
   int y_ofs, x, y;
   double proxy_size_comp;
 
+  /* Fonts are shared between scene copies of concurrent prefetch renderers. */
+  BLI_mutex_lock(&text_render_mutex);
+
   if (data->text_blf_id == SEQ_FONT_NOT_LOADED) {
     data->text_blf_id = -1;
 
@@ -3411,6 +3416,8 @@ static ImBuf *do_text_effect(const SeqRenderData *context,
 
   BLF_disable(font, font_flags);
 
+  BLI_mutex_unlock(&text_render_mutex);
+
   return out;
 }
 
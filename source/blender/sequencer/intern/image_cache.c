@@ -28,6 +28,7 @@
 #include "BLI_listbase.h"
 #include "BLI_mempool.h"
 #include "BLI_path_util.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 
 #include "BKE_main.h"
@@ -61,15 +62,29 @@
  * Entries are linked in order as they are put into cache.
  * Only permanent (is_temp_cache = 0) cache entries are linked.
  * Putting #SEQ_CACHE_STORE_FINAL_OUT will reset linking
+ * Every render task (main thread and each prefetch renderer) builds its own chain, so frames
+ * rendered concurrently don't get linked together.
  *
  * Only entire frame can be freed to release resources for new entries (recycling).
  * Once again, this is to reduce number of iterations, but also more controllable than removing
  * entries one by one in reverse order to their creation.
  *
  * User can exclude caching of some images. Such entries will have is_temp_cache set.
+ *
+ * Compressed entries: When a frame is recycled, its final image is not freed, but kept losslessly
+ * compressed in the same entry, unless the image is still used elsewhere. Such entries are
+ * unlinked and only recycled once no uncompressed frame is left. Compressed images are
+ * decompressed in place when requested again. Images are compressed without holding the cache
+ * lock, so that other threads are not blocked meanwhile.
+ *
+ * Disk cache read-ahead: When the main thread requests a final image and disk cache is enabled,
+ * images of following frames are read from disk into RAM by background tasks. Read-ahead never
+ * recycles entries, it only uses free memory.
  */
 
 #define THUMB_CACHE_LIMIT 5000
+/* Number of frames ahead of the requested one that are read from disk cache. */
+#define READ_AHEAD_FRAMES 16
 
 typedef struct SeqCache {
   Main *bmain;
@@ -77,14 +92,27 @@ typedef struct SeqCache {
   ThreadMutex iterator_mutex;
   struct BLI_mempool *keys_pool;
   struct BLI_mempool *items_pool;
-  struct SeqCacheKey *last_key;
+  /** Last linked key of each render task, indexed by #eSeqTaskId. */
+  struct SeqCacheKey *last_key[SEQ_TASK_ID_MAX];
   struct SeqDiskCache *disk_cache;
   int thumbnail_count;
+  struct TaskPool *read_ahead_pool;
+  /* Strip and last frame for which read-ahead has been scheduled. */
+  struct Sequence *read_ahead_seq;
+  float read_ahead_frame;
 } SeqCache;
 
+typedef struct SeqCacheReadAheadTask {
+  SeqRenderData context;
+  Sequence *seq;
+  float timeline_frame;
+} SeqCacheReadAheadTask;
+
 typedef struct SeqCacheItem {
   struct SeqCache *cache_owner;
   struct ImBuf *ibuf;
+  /** Compressed copy of recycled final image, only used when #ibuf is NULL. */
+  struct ImBufCompressed *cbuf;
 } SeqCacheItem;
 
 static ThreadMutex cache_create_lock = BLI_MUTEX_INITIALIZER;
@@ -180,6 +208,11 @@ static void seq_cache_unlock(Scene *scene)
   }
 }
 
+static void seq_cache_reset_linking(SeqCache *cache)
+{
+  memset(cache->last_key, 0, sizeof(cache->last_key));
+}
+
 static size_t seq_cache_get_mem_total(void)
 {
   return ((size_t)U.memcachelimit) * 1024 * 1024;
@@ -199,6 +232,10 @@ static void seq_cache_valfree(void *val)
     IMB_freeImBuf(item->ibuf);
   }
 
+  if (item->cbuf) {
+    IMB_compressed_free(item->cbuf);
+  }
+
   BLI_mempool_free(item->cache_owner->items_pool, item);
 }
 
@@ -225,36 +262,39 @@ static void seq_cache_put_ex(Scene *scene, SeqCacheKey *key, ImBuf *ibuf)
   item = BLI_mempool_alloc(cache->items_pool);
   item->cache_owner = cache;
   item->ibuf = ibuf;
+  item->cbuf = NULL;
 
   const int stored_types_flag = get_stored_types_flag(scene, key);
 
+  SeqCacheKey **last_key = &cache->last_key[key->task_id];
+
   /* Item stored for later use. */
   if (stored_types_flag & key->type) {
     key->is_temp_cache = false;
-    key->link_prev = cache->last_key;
+    key->link_prev = *last_key;
   }
 
   /* Store pointer to last cached key. */
-  SeqCacheKey *temp_last_key = cache->last_key;
+  SeqCacheKey *temp_last_key = *last_key;
 
   if (BLI_ghash_reinsert(cache->hash, key, item, seq_cache_keyfree, seq_cache_valfree)) {
     IMB_refImBuf(ibuf);
 
     if (!key->is_temp_cache || key->type != SEQ_CACHE_STORE_THUMBNAIL) {
-      cache->last_key = key;
+      *last_key = key;
     }
   }
 
   /* Set last_key's reference to this key so we can look up chain backwards.
-   * Item is already put in cache, so cache->last_key points to current key.
+   * Item is already put in cache, so last_key points to current key.
    */
   if (!key->is_temp_cache && temp_last_key) {
-    temp_last_key->link_next = cache->last_key;
+    temp_last_key->link_next = *last_key;
   }
 
   /* Reset linking. */
   if (key->type == SEQ_CACHE_STORE_FINAL_OUT) {
-    cache->last_key = NULL;
+    *last_key = NULL;
   }
 }
 
@@ -268,9 +308,102 @@ static ImBuf *seq_cache_get_ex(SeqCache *cache, SeqCacheKey *key)
     return item->ibuf;
   }
 
+  if (item && item->cbuf) {
+    ImBuf *ibuf = IMB_compressed_to_imbuf(item->cbuf);
+    if (ibuf == NULL) {
+      return NULL;
+    }
+
+    IMB_compressed_free(item->cbuf);
+    item->cbuf = NULL;
+    item->ibuf = ibuf;
+    IMB_refImBuf(ibuf);
+
+    return ibuf;
+  }
+
   return NULL;
 }
 
+/**
+ * Final image of a recycled frame that is compressed after the cache lock has been released.
+ * The key is copied, because the entry may be removed from the cache in the meantime.
+ */
+typedef struct SeqCacheCompressTask {
+  struct SeqCacheCompressTask *next, *prev;
+  SeqCacheKey key;
+  ImBuf *ibuf;
+  struct ImBufCompressed *cbuf;
+} SeqCacheCompressTask;
+
+/**
+ * Schedule replacing the final image of a recycled frame by its compressed copy, see
+ * #seq_cache_compress_images. The entry stays in the cache with its image until then.
+ * Returns false if the entry should be removed instead.
+ */
+static bool seq_cache_compress_item_begin(SeqCacheKey *key,
+                                          SeqCacheItem *item,
+                                          ListBase *r_compress_tasks)
+{
+  /* Compressing an image that is used elsewhere wouldn't release any memory. */
+  if (r_compress_tasks == NULL || key->type != SEQ_CACHE_STORE_FINAL_OUT || item->ibuf == NULL ||
+      item->ibuf->refcounter > 0) {
+    return false;
+  }
+
+  SeqCacheCompressTask *task = MEM_callocN(sizeof(SeqCacheCompressTask), __func__);
+  task->key = *key;
+  task->ibuf = item->ibuf;
+  IMB_refImBuf(task->ibuf);
+  BLI_addtail(r_compress_tasks, task);
+
+  key->link_prev = NULL;
+  key->link_next = NULL;
+  return true;
+}
+
+/**
+ * Compress the images of the tasks without holding the cache lock, then replace the cached
+ * images by their compressed copies. Entries whose image has been removed or is used elsewhere
+ * in the meantime are left alone.
+ */
+static void seq_cache_compress_images(Scene *scene, ListBase *compress_tasks)
+{
+  if (BLI_listbase_is_empty(compress_tasks)) {
+    return;
+  }
+
+  LISTBASE_FOREACH (SeqCacheCompressTask *, task, compress_tasks) {
+    task->cbuf = IMB_compressed_from_imbuf(task->ibuf);
+  }
+
+  seq_cache_lock(scene);
+  SeqCache *cache = seq_cache_get_from_scene(scene);
+  LISTBASE_FOREACH_MUTABLE (SeqCacheCompressTask *, task, compress_tasks) {
+    SeqCacheItem *item = cache ? BLI_ghash_lookup(cache->hash, &task->key) : NULL;
+    /* Only the cache and this task reference the image. */
+    if (item != NULL && item->ibuf == task->ibuf && task->ibuf->refcounter == 1) {
+      if (task->cbuf != NULL) {
+        item->cbuf = task->cbuf;
+        item->ibuf = NULL;
+        task->cbuf = NULL;
+        /* Release the reference of the cache. */
+        IMB_freeImBuf(task->ibuf);
+      }
+      else {
+        BLI_ghash_remove(cache->hash, &task->key, seq_cache_keyfree, seq_cache_valfree);
+      }
+    }
+    if (task->cbuf != NULL) {
+      IMB_compressed_free(task->cbuf);
+    }
+    IMB_freeImBuf(task->ibuf);
+    MEM_freeN(task);
+  }
+  BLI_listbase_clear(compress_tasks);
+  seq_cache_unlock(scene);
+}
+
 static void seq_cache_relink_keys(SeqCacheKey *link_next, SeqCacheKey *link_prev)
 {
   if (link_next) {
@@ -344,7 +477,11 @@ static SeqCacheKey *seq_cache_choose_key(Scene *scene, SeqCacheKey *lkey, SeqCac
   return finalkey;
 }
 
-static void seq_cache_recycle_linked(Scene *scene, SeqCacheKey *base)
+/**
+ * Recycle the chain of \a base. Final images are scheduled for compression in
+ * \a r_compress_tasks, or removed when it is null.
+ */
+static void seq_cache_recycle_linked(Scene *scene, SeqCacheKey *base, ListBase *r_compress_tasks)
 {
   SeqCache *cache = seq_cache_get_from_scene(scene);
   if (!cache) {
@@ -365,7 +502,10 @@ static void seq_cache_recycle_linked(Scene *scene, SeqCacheKey *base)
       break;
     }
 
-    BLI_ghash_remove(cache->hash, base, seq_cache_keyfree, seq_cache_valfree);
+    if (!seq_cache_compress_item_begin(
+            base, BLI_ghash_lookup(cache->hash, base), r_compress_tasks)) {
+      BLI_ghash_remove(cache->hash, base, seq_cache_keyfree, seq_cache_valfree);
+    }
     base = prev;
   }
 
@@ -382,7 +522,10 @@ static void seq_cache_recycle_linked(Scene *scene, SeqCacheKey *base)
       break;
     }
 
-    BLI_ghash_remove(cache->hash, base, seq_cache_keyfree, seq_cache_valfree);
+    if (!seq_cache_compress_item_begin(
+            base, BLI_ghash_lookup(cache->hash, base), r_compress_tasks)) {
+      BLI_ghash_remove(cache->hash, base, seq_cache_keyfree, seq_cache_valfree);
+    }
     base = next;
   }
 }
@@ -395,6 +538,9 @@ static SeqCacheKey *seq_cache_get_item_for_removal(Scene *scene)
   SeqCacheKey *lkey = NULL;
   /* Rightmost key. */
   SeqCacheKey *rkey = NULL;
+  /* Leftmost and rightmost compressed keys, recycled only when no other key is left. */
+  SeqCacheKey *compressed_lkey = NULL;
+  SeqCacheKey *compressed_rkey = NULL;
   SeqCacheKey *key = NULL;
 
   GHashIterator gh_iter;
@@ -406,9 +552,19 @@ static SeqCacheKey *seq_cache_get_item_for_removal(Scene *scene)
     SeqCacheItem *item = BLI_ghashIterator_getValue(&gh_iter);
     BLI_ghashIterator_step(&gh_iter);
 
+    if (item->cbuf) {
+      if (compressed_lkey == NULL || key->timeline_frame < compressed_lkey->timeline_frame) {
+        compressed_lkey = key;
+      }
+      if (compressed_rkey == NULL || key->timeline_frame > compressed_rkey->timeline_frame) {
+        compressed_rkey = key;
+      }
+      continue;
+    }
+
     /* This shouldn't happen, but better be safe than sorry. */
     if (!item->ibuf) {
-      seq_cache_recycle_linked(scene, key);
+      seq_cache_recycle_linked(scene, key, NULL);
       /* Can not continue iterating after linked remove. */
       BLI_ghashIterator_init(&gh_iter, cache->hash);
       continue;
@@ -440,6 +596,10 @@ static SeqCacheKey *seq_cache_get_item_for_removal(Scene *scene)
 
   finalkey = seq_cache_choose_key(scene, lkey, rkey);
 
+  if (finalkey == NULL) {
+    finalkey = seq_cache_choose_key(scene, compressed_lkey, compressed_rkey);
+  }
+
   return finalkey;
 }
 
@@ -450,21 +610,27 @@ bool seq_cache_recycle_item(Scene *scene)
     return false;
   }
 
-  seq_cache_lock(scene);
-
-  while (seq_cache_is_full()) {
-    SeqCacheKey *finalkey = seq_cache_get_item_for_removal(scene);
+  while (true) {
+    ListBase compress_tasks = {NULL, NULL};
 
-    if (finalkey) {
-      seq_cache_recycle_linked(scene, finalkey);
+    seq_cache_lock(scene);
+    if (!seq_cache_is_full()) {
+      seq_cache_unlock(scene);
+      return true;
     }
-    else {
+
+    SeqCacheKey *finalkey = seq_cache_get_item_for_removal(scene);
+    if (finalkey == NULL) {
       seq_cache_unlock(scene);
       return false;
     }
+
+    seq_cache_recycle_linked(scene, finalkey, &compress_tasks);
+    seq_cache_unlock(scene);
+
+    /* Compression takes a while, other threads can use the cache in the meantime. */
+    seq_cache_compress_images(scene, &compress_tasks);
   }
-  seq_cache_unlock(scene);
-  return true;
 }
 
 static void seq_cache_set_temp_cache_linked(Scene *scene, SeqCacheKey *base)
@@ -499,7 +665,7 @@ static void seq_cache_create(Main *bmain, Scene *scene)
     cache->keys_pool = BLI_mempool_create(sizeof(SeqCacheKey), 0, 64, BLI_MEMPOOL_NOP);
     cache->items_pool = BLI_mempool_create(sizeof(SeqCacheItem), 0, 64, BLI_MEMPOOL_NOP);
     cache->hash = BLI_ghash_new(seq_cache_hashhash, seq_cache_hashcmp, "SeqCache hash");
-    cache->last_key = NULL;
+    seq_cache_reset_linking(cache);
     cache->bmain = bmain;
     cache->thumbnail_count = 0;
     BLI_mutex_init(&cache->iterator_mutex);
@@ -542,6 +708,126 @@ static SeqCacheKey *seq_cache_allocate_key(SeqCache *cache,
   return key;
 }
 
+static struct SeqDiskCache *seq_cache_disk_cache_ensure(SeqCache *cache,
+                                                        const SeqRenderData *context)
+{
+  BLI_mutex_lock(&cache_create_lock);
+  if (cache->disk_cache == NULL) {
+    cache->disk_cache = seq_disk_cache_create(context->bmain, context->scene);
+  }
+  BLI_mutex_unlock(&cache_create_lock);
+  return cache->disk_cache;
+}
+
+static void seq_cache_read_ahead_task(TaskPool *__restrict pool, void *taskdata)
+{
+  SeqCacheReadAheadTask *task = taskdata;
+  Scene *scene = task->context.scene;
+  SeqCache *cache = BLI_task_pool_user_data(pool);
+
+  if (BLI_task_pool_current_canceled(pool) || seq_cache_is_full()) {
+    return;
+  }
+
+  SeqCacheKey key;
+  seq_cache_populate_key(
+      &key, &task->context, task->seq, task->timeline_frame, SEQ_CACHE_STORE_FINAL_OUT);
+
+  seq_cache_lock(scene);
+  const bool is_cached = BLI_ghash_haskey(cache->hash, &key);
+  seq_cache_unlock(scene);
+
+  if (is_cached) {
+    return;
+  }
+
+  ImBuf *ibuf = seq_disk_cache_read_file(cache->disk_cache, &key);
+  if (ibuf == NULL) {
+    return;
+  }
+
+  seq_cache_lock(scene);
+  if (!seq_cache_is_full() && !BLI_ghash_haskey(cache->hash, &key)) {
+    SeqCacheKey *new_key = seq_cache_allocate_key(
+        cache, &task->context, task->seq, task->timeline_frame, SEQ_CACHE_STORE_FINAL_OUT);
+    seq_cache_put_ex(scene, new_key, ibuf);
+  }
+  seq_cache_unlock(scene);
+
+  IMB_freeImBuf(ibuf);
+}
+
+/**
+ * Get the frames following `timeline_frame` to read from disk cache, which haven't been scheduled
+ * yet. Must be called with cache locked.
+ *
+ * \return false when there are no frames to read.
+ */
+static bool seq_cache_read_ahead_frames_get(SeqCache *cache,
+                                            const SeqRenderData *context,
+                                            Sequence *seq,
+                                            float timeline_frame,
+                                            float *r_frame_first,
+                                            float *r_frame_last)
+{
+  const float frame_last = min_ff(timeline_frame + READ_AHEAD_FRAMES,
+                                  SEQ_time_right_handle_frame_get(context->scene, seq) - 1);
+  float frame = timeline_frame + 1;
+
+  /* Don't schedule frames again, when read-ahead window just moved. */
+  if (seq == cache->read_ahead_seq && cache->read_ahead_frame >= timeline_frame &&
+      cache->read_ahead_frame <= frame_last) {
+    frame = cache->read_ahead_frame + 1;
+  }
+
+  if (frame > frame_last) {
+    return false;
+  }
+
+  /* Background pool, so tasks never run in the pushing thread (e.g. with a single thread). */
+  if (cache->read_ahead_pool == NULL) {
+    cache->read_ahead_pool = BLI_task_pool_create_background(cache, TASK_PRIORITY_LOW);
+  }
+
+  cache->read_ahead_seq = seq;
+  cache->read_ahead_frame = frame_last;
+  *r_frame_first = frame;
+  *r_frame_last = frame_last;
+  return true;
+}
+
+/**
+ * Schedule reading final images of frames from disk cache.
+ * Must be called with cache unlocked, because the tasks lock it.
+ */
+static void seq_cache_read_ahead(SeqCache *cache,
+                                 const SeqRenderData *context,
+                                 Sequence *seq,
+                                 const float frame_first,
+                                 const float frame_last)
+{
+  for (float frame = frame_first; frame <= frame_last; frame++) {
+    SeqCacheReadAheadTask *task = MEM_mallocN(sizeof(*task), "SeqCacheReadAheadTask");
+    task->context = *context;
+    task->context.task_id = SEQ_TASK_READ_AHEAD;
+    task->seq = seq;
+    task->timeline_frame = frame;
+    BLI_task_pool_push(cache->read_ahead_pool, seq_cache_read_ahead_task, task, true, NULL);
+  }
+}
+
+/**
+ * Stop read-ahead, must be called before entries are removed because tasks reference strips.
+ * Must be called with cache unlocked.
+ */
+static void seq_cache_read_ahead_cancel(SeqCache *cache)
+{
+  if (cache->read_ahead_pool != NULL) {
+    BLI_task_pool_cancel(cache->read_ahead_pool);
+  }
+  cache->read_ahead_seq = NULL;
+}
+
 /* ***************************** API ****************************** */
 
 void seq_cache_free_temp_cache(Scene *scene, short id, int timeline_frame)
@@ -580,6 +866,11 @@ void seq_cache_destruct(Scene *scene)
     return;
   }
 
+  if (cache->read_ahead_pool != NULL) {
+    BLI_task_pool_cancel(cache->read_ahead_pool);
+    BLI_task_pool_free(cache->read_ahead_pool);
+  }
+
   BLI_ghash_free(cache->hash, seq_cache_keyfree, seq_cache_valfree);
   BLI_mempool_destroy(cache->keys_pool);
   BLI_mempool_destroy(cache->items_pool);
@@ -608,6 +899,7 @@ void SEQ_cache_cleanup(Scene *scene)
     return;
   }
 
+  seq_cache_read_ahead_cancel(cache);
   seq_cache_lock(scene);
 
   GHashIterator gh_iter;
@@ -618,7 +910,7 @@ void SEQ_cache_cleanup(Scene *scene)
     BLI_ghashIterator_step(&gh_iter);
     BLI_ghash_remove(cache->hash, key, seq_cache_keyfree, seq_cache_valfree);
   }
-  cache->last_key = NULL;
+  seq_cache_reset_linking(cache);
   cache->thumbnail_count = 0;
   seq_cache_unlock(scene);
 }
@@ -634,6 +926,8 @@ void seq_cache_cleanup_sequence(Scene *scene,
     return;
   }
 
+  seq_cache_read_ahead_cancel(cache);
+
   if (seq_disk_cache_is_enabled(cache->bmain) && cache->disk_cache != NULL) {
     seq_disk_cache_invalidate(cache->disk_cache, scene, seq, seq_changed, invalidate_types);
   }
@@ -678,7 +972,7 @@ void seq_cache_cleanup_sequence(Scene *scene,
       BLI_ghash_remove(cache->hash, key, seq_cache_keyfree, seq_cache_valfree);
     }
   }
-  cache->last_key = NULL;
+  seq_cache_reset_linking(cache);
   seq_cache_unlock(scene);
 }
 
@@ -719,7 +1013,7 @@ void seq_cache_thumbnail_cleanup(Scene *scene, rctf *view_area_safe)
       cache->thumbnail_count--;
     }
   }
-  cache->last_key = NULL;
+  seq_cache_reset_linking(cache);
 }
 
 struct ImBuf *seq_cache_get(const SeqRenderData *context,
@@ -733,8 +1027,9 @@ struct ImBuf *seq_cache_get(const SeqRenderData *context,
   }
 
   Scene *scene = context->scene;
+  const bool is_prefetch_render = context->is_prefetch_render;
 
-  if (context->is_prefetch_render) {
+  if (is_prefetch_render) {
     context = seq_prefetch_get_original_context(context);
     scene = context->scene;
     seq = seq_prefetch_get_original_sequence(seq, scene);
@@ -748,8 +1043,13 @@ struct ImBuf *seq_cache_get(const SeqRenderData *context,
     seq_cache_create(context->bmain, scene);
   }
 
-  seq_cache_lock(scene);
+  const bool use_disk_cache = seq_disk_cache_is_enabled(context->bmain);
   SeqCache *cache = seq_cache_get_from_scene(scene);
+  if (use_disk_cache) {
+    seq_cache_disk_cache_ensure(cache, context);
+  }
+
+  seq_cache_lock(scene);
   ImBuf *ibuf = NULL;
   SeqCacheKey key;
 
@@ -758,18 +1058,27 @@ struct ImBuf *seq_cache_get(const SeqRenderData *context,
     seq_cache_populate_key(&key, context, seq, timeline_frame, type);
     ibuf = seq_cache_get_ex(cache, &key);
   }
+
+  /* Playback of frames cached on disk only shouldn't wait for reading each of them. */
+  bool use_read_ahead = false;
+  float read_ahead_first, read_ahead_last;
+  if (use_disk_cache && type == SEQ_CACHE_STORE_FINAL_OUT && !is_prefetch_render &&
+      context->task_id == SEQ_TASK_MAIN_RENDER) {
+    use_read_ahead = seq_cache_read_ahead_frames_get(
+        cache, context, seq, timeline_frame, &read_ahead_first, &read_ahead_last);
+  }
   seq_cache_unlock(scene);
 
+  if (use_read_ahead) {
+    seq_cache_read_ahead(cache, context, seq, read_ahead_first, read_ahead_last);
+  }
+
   if (ibuf) {
     return ibuf;
   }
 
   /* Try disk cache: */
-  if (seq_disk_cache_is_enabled(context->bmain)) {
-    if (cache->disk_cache == NULL) {
-      cache->disk_cache = seq_disk_cache_create(context->bmain, context->scene);
-    }
-
+  if (use_disk_cache) {
     ibuf = seq_disk_cache_read_file(cache->disk_cache, &key);
 
     if (ibuf == NULL) {
@@ -778,8 +1087,12 @@ struct ImBuf *seq_cache_get(const SeqRenderData *context,
 
     /* Store read image in RAM. Only recycle item for final type. */
     if (key.type != SEQ_CACHE_STORE_FINAL_OUT || seq_cache_recycle_item(scene)) {
-      SeqCacheKey *new_key = seq_cache_allocate_key(cache, context, seq, timeline_frame, type);
-      seq_cache_put_ex(scene, new_key, ibuf);
+      seq_cache_lock(scene);
+      if (!BLI_ghash_haskey(cache->hash, &key)) {
+        SeqCacheKey *new_key = seq_cache_allocate_key(cache, context, seq, timeline_frame, type);
+        seq_cache_put_ex(scene, new_key, ibuf);
+      }
+      seq_cache_unlock(scene);
     }
   }
 
@@ -806,8 +1119,9 @@ bool seq_cache_put_if_possible(
     return true;
   }
 
-  seq_cache_set_temp_cache_linked(scene, scene->ed->cache->last_key);
-  scene->ed->cache->last_key = NULL;
+  SeqCacheKey **last_key = &scene->ed->cache->last_key[context->task_id];
+  seq_cache_set_temp_cache_linked(scene, *last_key);
+  *last_key = NULL;
   return false;
 }
 
@@ -875,17 +1189,27 @@ void seq_cache_put(
   seq_cache_lock(scene);
   SeqCache *cache = seq_cache_get_from_scene(scene);
   SeqCacheKey *key = seq_cache_allocate_key(cache, context, seq, timeline_frame, type);
+
+  /* Another render task may have put the same image since the lookup above. Still end the chain
+   * of linked keys at the final image, like #seq_cache_put_ex does. */
+  if (BLI_ghash_haskey(cache->hash, key)) {
+    if (key->type == SEQ_CACHE_STORE_FINAL_OUT) {
+      cache->last_key[key->task_id] = NULL;
+    }
+    BLI_mempool_free(cache->keys_pool, key);
+    seq_cache_unlock(scene);
+    return;
+  }
+
   seq_cache_put_ex(scene, key, i);
+  /* Key may be recycled by another thread once cache is unlocked. */
+  SeqCacheKey key_copy = *key;
   seq_cache_unlock(scene);
 
-  if (!key->is_temp_cache) {
+  if (!key_copy.is_temp_cache) {
     if (seq_disk_cache_is_enabled(context->bmain)) {
-      if (cache->disk_cache == NULL) {
-        seq_disk_cache_create(context->bmain, context->scene);
-      }
-
-      seq_disk_cache_write_file(cache->disk_cache, key, i);
-      seq_disk_cache_enforce_limits(cache->disk_cache);
+      struct SeqDiskCache *disk_cache = seq_cache_disk_cache_ensure(cache, context);
+      seq_disk_cache_write_file(disk_cache, &key_copy, i);
     }
   }
 }
@@ -914,7 +1238,7 @@ void SEQ_cache_iterate(
     interrupt = callback_iter(userdata, key->seq, key->timeline_frame, key->type);
   }
 
-  cache->last_key = NULL;
+  seq_cache_reset_linking(cache);
   seq_cache_unlock(scene);
 }
 
@@ -922,3 +1246,8 @@ bool seq_cache_is_full(void)
 {
   return seq_cache_get_mem_total() < MEM_get_memory_in_use();
 }
+
+bool seq_cache_can_fit(size_t size)
+{
+  return MEM_get_memory_in_use() + size <= seq_cache_get_mem_total();
+}
@@ -15,9 +15,11 @@
 #include "DNA_scene_types.h"
 #include "DNA_screen_types.h"
 #include "DNA_sequence_types.h"
+#include "DNA_userdef_types.h"
 #include "DNA_windowmanager_types.h"
 
 #include "BLI_listbase.h"
+#include "BLI_math_base.h"
 #include "BLI_threads.h"
 
 #include "IMB_imbuf.h"
@@ -48,30 +50,50 @@
 #include "prefetch.h"
 #include "render.h"
 
+/**
+ * Renders frames for the prefetch job. Each renderer evaluates its own copy of the scene, so
+ * multiple renderers can work on different frames at the same time.
+ */
+typedef struct PrefetchRenderer {
+  struct PrefetchJob *pfjob;
+
+  struct Depsgraph *depsgraph;
+  struct Scene *scene_eval;
+
+  /* context */
+  struct SeqRenderData context;
+  struct SeqRenderData context_cpy;
+
+  /* Frame currently rendered by this renderer. */
+  float timeline_frame;
+} PrefetchRenderer;
+
 typedef struct PrefetchJob {
   struct PrefetchJob *next, *prev;
 
   struct Main *bmain;
   struct Main *bmain_eval;
   struct Scene *scene;
-  struct Scene *scene_eval;
-  struct Depsgraph *depsgraph;
 
   ThreadMutex prefetch_suspend_mutex;
   ThreadCondition prefetch_suspend_cond;
 
   ListBase threads;
 
-  /* context */
-  struct SeqRenderData context;
-  struct SeqRenderData context_cpy;
-  struct ListBase *seqbasep;
-  struct ListBase *seqbasep_cpy;
+  PrefetchRenderer renderers[SEQ_PREFETCH_RENDERERS_MAX];
+  int renderers_num;
+  int renderers_running;
+  int renderers_waiting;
 
   /* prefetch area */
   float cfra;
   int num_frames_prefetched;
 
+  /* Frames claimed by renderers, that are not finished yet. */
+  int frames_in_flight;
+  /* Memory needed by one rendered frame, used to limit number of frames in flight. */
+  size_t frame_mem_size;
+
   /* control */
   bool running;
   bool waiting;
@@ -153,11 +175,19 @@ Sequence *seq_prefetch_get_original_sequence(Sequence *seq, Scene *scene)
   return sequencer_prefetch_get_original_sequence(seq, &ed->seqbase);
 }
 
+static PrefetchRenderer *seq_prefetch_renderer_get(PrefetchJob *pfjob,
+                                                   const SeqRenderData *context)
+{
+  const int index = context->task_id - SEQ_TASK_PREFETCH_RENDER;
+  BLI_assert(index >= 0 && index < pfjob->renderers_num);
+  return &pfjob->renderers[index];
+}
+
 SeqRenderData *seq_prefetch_get_original_context(const SeqRenderData *context)
 {
   PrefetchJob *pfjob = seq_prefetch_job_get(context->scene);
 
-  return &pfjob->context;
+  return &seq_prefetch_renderer_get(pfjob, context)->context;
 }
 
 static bool seq_prefetch_is_cache_full(Scene *scene)
@@ -175,9 +205,9 @@ static float seq_prefetch_cfra(PrefetchJob *pfjob)
 {
   return pfjob->cfra + pfjob->num_frames_prefetched;
 }
-static AnimationEvalContext seq_prefetch_anim_eval_context(PrefetchJob *pfjob)
+static AnimationEvalContext seq_prefetch_anim_eval_context(PrefetchRenderer *renderer)
 {
-  return BKE_animsys_eval_context_construct(pfjob->depsgraph, seq_prefetch_cfra(pfjob));
+  return BKE_animsys_eval_context_construct(renderer->depsgraph, renderer->timeline_frame);
 }
 
 void seq_prefetch_get_time_range(Scene *scene, int *start, int *end)
@@ -188,37 +218,37 @@ void seq_prefetch_get_time_range(Scene *scene, int *start, int *end)
   *end = seq_prefetch_cfra(pfjob);
 }
 
-static void seq_prefetch_free_depsgraph(PrefetchJob *pfjob)
+static void seq_prefetch_free_depsgraph(PrefetchRenderer *renderer)
 {
-  if (pfjob->depsgraph != NULL) {
-    DEG_graph_free(pfjob->depsgraph);
+  if (renderer->depsgraph != NULL) {
+    DEG_graph_free(renderer->depsgraph);
   }
-  pfjob->depsgraph = NULL;
-  pfjob->scene_eval = NULL;
+  renderer->depsgraph = NULL;
+  renderer->scene_eval = NULL;
 }
 
-static void seq_prefetch_update_depsgraph(PrefetchJob *pfjob)
+static void seq_prefetch_update_depsgraph(PrefetchRenderer *renderer)
 {
-  DEG_evaluate_on_framechange(pfjob->depsgraph, seq_prefetch_cfra(pfjob));
+  DEG_evaluate_on_framechange(renderer->depsgraph, renderer->timeline_frame);
 }
 
-static void seq_prefetch_init_depsgraph(PrefetchJob *pfjob)
+static void seq_prefetch_init_depsgraph(PrefetchRenderer *renderer)
 {
-  Main *bmain = pfjob->bmain_eval;
-  Scene *scene = pfjob->scene;
+  Main *bmain = renderer->pfjob->bmain_eval;
+  Scene *scene = renderer->pfjob->scene;
   ViewLayer *view_layer = BKE_view_layer_default_render(scene);
 
-  pfjob->depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_RENDER);
-  DEG_debug_name_set(pfjob->depsgraph, "SEQUENCER PREFETCH");
+  renderer->depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_RENDER);
+  DEG_debug_name_set(renderer->depsgraph, "SEQUENCER PREFETCH");
 
   /* Make sure there is a correct evaluated scene pointer. */
-  DEG_graph_build_for_render_pipeline(pfjob->depsgraph);
+  DEG_graph_build_for_render_pipeline(renderer->depsgraph);
 
   /* Update immediately so we have proper evaluated scene. */
-  seq_prefetch_update_depsgraph(pfjob);
+  seq_prefetch_update_depsgraph(renderer);
 
-  pfjob->scene_eval = DEG_get_evaluated_scene(pfjob->depsgraph);
-  pfjob->scene_eval->ed->cache_flag = 0;
+  renderer->scene_eval = DEG_get_evaluated_scene(renderer->depsgraph);
+  renderer->scene_eval->ed->cache_flag = 0;
 }
 
 static void seq_prefetch_update_area(PrefetchJob *pfjob)
@@ -231,15 +261,15 @@ static void seq_prefetch_update_area(PrefetchJob *pfjob)
     pfjob->cfra = cfra;
     pfjob->num_frames_prefetched -= delta;
 
-    if (pfjob->num_frames_prefetched <= 1) {
-      pfjob->num_frames_prefetched = 1;
+    if (pfjob->num_frames_prefetched <= 0) {
+      pfjob->num_frames_prefetched = 0;
     }
   }
 
   /* reset */
   if (cfra < pfjob->cfra) {
     pfjob->cfra = cfra;
-    pfjob->num_frames_prefetched = 1;
+    pfjob->num_frames_prefetched = 0;
   }
 }
 
@@ -263,41 +293,41 @@ void SEQ_prefetch_stop(Scene *scene)
   pfjob->stop = true;
 
   while (pfjob->running) {
-    BLI_condition_notify_one(&pfjob->prefetch_suspend_cond);
+    BLI_condition_notify_all(&pfjob->prefetch_suspend_cond);
   }
 }
 
-static void seq_prefetch_update_context(const SeqRenderData *context)
+static void seq_prefetch_update_context(PrefetchRenderer *renderer, const SeqRenderData *context)
 {
-  PrefetchJob *pfjob;
-  pfjob = seq_prefetch_job_get(context->scene);
+  PrefetchJob *pfjob = renderer->pfjob;
+  const eSeqTaskId task_id = SEQ_TASK_PREFETCH_RENDER + (int)(renderer - pfjob->renderers);
 
   SEQ_render_new_render_data(pfjob->bmain_eval,
-                             pfjob->depsgraph,
-                             pfjob->scene_eval,
+                             renderer->depsgraph,
+                             renderer->scene_eval,
                              context->rectx,
                              context->recty,
                              context->preview_render_size,
                              false,
-                             &pfjob->context_cpy);
-  pfjob->context_cpy.is_prefetch_render = true;
-  pfjob->context_cpy.task_id = SEQ_TASK_PREFETCH_RENDER;
+                             &renderer->context_cpy);
+  renderer->context_cpy.is_prefetch_render = true;
+  renderer->context_cpy.task_id = task_id;
 
   SEQ_render_new_render_data(pfjob->bmain,
-                             pfjob->depsgraph,
+                             renderer->depsgraph,
                              pfjob->scene,
                              context->rectx,
                              context->recty,
                              context->preview_render_size,
                              false,
-                             &pfjob->context);
-  pfjob->context.is_prefetch_render = false;
+                             &renderer->context);
+  renderer->context.is_prefetch_render = false;
 
   /* Same ID as prefetch context, because context will be swapped, but we still
    * want to assign this ID to cache entries created in this thread.
-   * This is to allow "temp cache" work correctly for both threads.
+   * This is to allow "temp cache" work correctly for all threads.
    */
-  pfjob->context.task_id = SEQ_TASK_PREFETCH_RENDER;
+  renderer->context.task_id = task_id;
 }
 
 static void seq_prefetch_update_scene(Scene *scene)
@@ -309,17 +339,26 @@ static void seq_prefetch_update_scene(Scene *scene)
   }
 
   pfjob->scene = scene;
-  seq_prefetch_free_depsgraph(pfjob);
-  seq_prefetch_init_depsgraph(pfjob);
+  for (int i = 0; i < SEQ_PREFETCH_RENDERERS_MAX; i++) {
+    PrefetchRenderer *renderer = &pfjob->renderers[i];
+    seq_prefetch_free_depsgraph(renderer);
+
+    /* Scene copies of unused renderers are not kept around, they can take a lot of memory. */
+    if (i < pfjob->renderers_num) {
+      renderer->timeline_frame = seq_prefetch_cfra(pfjob);
+      seq_prefetch_init_depsgraph(renderer);
+    }
+  }
 }
 
-static void seq_prefetch_update_active_seqbase(PrefetchJob *pfjob)
+static void seq_prefetch_update_active_seqbase(PrefetchRenderer *renderer)
 {
-  MetaStack *ms_orig = SEQ_meta_stack_active_get(SEQ_editing_get(pfjob->scene));
-  Editing *ed_eval = SEQ_editing_get(pfjob->scene_eval);
+  MetaStack *ms_orig = SEQ_meta_stack_active_get(SEQ_editing_get(renderer->pfjob->scene));
+  Editing *ed_eval = SEQ_editing_get(renderer->scene_eval);
 
   if (ms_orig != NULL) {
-    Sequence *meta_eval = seq_prefetch_get_original_sequence(ms_orig->parseq, pfjob->scene_eval);
+    Sequence *meta_eval = seq_prefetch_get_original_sequence(ms_orig->parseq,
+                                                             renderer->scene_eval);
     SEQ_seqbase_active_set(ed_eval, &meta_eval->seqbase);
   }
   else {
@@ -331,8 +370,8 @@ static void seq_prefetch_resume(Scene *scene)
 {
   PrefetchJob *pfjob = seq_prefetch_job_get(scene);
 
-  if (pfjob && pfjob->waiting) {
-    BLI_condition_notify_one(&pfjob->prefetch_suspend_cond);
+  if (pfjob && pfjob->renderers_waiting > 0) {
+    BLI_condition_notify_all(&pfjob->prefetch_suspend_cond);
   }
 }
 
@@ -345,22 +384,26 @@ void seq_prefetch_free(Scene *scene)
 
   SEQ_prefetch_stop(scene);
 
-  BLI_threadpool_remove(&pfjob->threads, pfjob);
+  for (int i = 0; i < SEQ_PREFETCH_RENDERERS_MAX; i++) {
+    BLI_threadpool_remove(&pfjob->threads, &pfjob->renderers[i]);
+  }
   BLI_threadpool_end(&pfjob->threads);
   BLI_mutex_end(&pfjob->prefetch_suspend_mutex);
   BLI_condition_end(&pfjob->prefetch_suspend_cond);
-  seq_prefetch_free_depsgraph(pfjob);
+  for (int i = 0; i < SEQ_PREFETCH_RENDERERS_MAX; i++) {
+    seq_prefetch_free_depsgraph(&pfjob->renderers[i]);
+  }
   BKE_main_free(pfjob->bmain_eval);
   MEM_freeN(pfjob);
   scene->ed->prefetch_job = NULL;
 }
 
-static bool seq_prefetch_seq_has_disk_cache(PrefetchJob *pfjob,
+static bool seq_prefetch_seq_has_disk_cache(PrefetchRenderer *renderer,
                                             Sequence *seq,
                                             bool can_have_final_image)
 {
-  SeqRenderData *ctx = &pfjob->context_cpy;
-  float cfra = seq_prefetch_cfra(pfjob);
+  SeqRenderData *ctx = &renderer->context_cpy;
+  float cfra = renderer->timeline_frame;
 
   ImBuf *ibuf = seq_cache_get(ctx, seq, cfra, SEQ_CACHE_STORE_PREPROCESSED);
   if (ibuf != NULL) {
@@ -387,27 +430,28 @@ static bool seq_prefetch_seq_has_disk_cache(PrefetchJob *pfjob,
   return false;
 }
 
-static bool seq_prefetch_scene_strip_is_rendered(PrefetchJob *pfjob,
+static bool seq_prefetch_scene_strip_is_rendered(PrefetchRenderer *renderer,
                                                  ListBase *channels,
                                                  ListBase *seqbase,
                                                  SeqCollection *scene_strips,
                                                  bool is_recursive_check)
 {
-  float cfra = seq_prefetch_cfra(pfjob);
+  float cfra = renderer->timeline_frame;
   Sequence *seq_arr[MAXSEQ + 1];
-  int count = seq_get_shown_sequences(pfjob->scene_eval, channels, seqbase, cfra, 0, seq_arr);
+  int count = seq_get_shown_sequences(renderer->scene_eval, channels, seqbase, cfra, 0, seq_arr);
 
   /* Iterate over rendered strips. */
   for (int i = 0; i < count; i++) {
     Sequence *seq = seq_arr[i];
     if (seq->type == SEQ_TYPE_META &&
-        seq_prefetch_scene_strip_is_rendered(pfjob, channels, &seq->seqbase, scene_strips, true)) {
+        seq_prefetch_scene_strip_is_rendered(
+            renderer, channels, &seq->seqbase, scene_strips, true)) {
       return true;
     }
 
     /* Disable prefetching 3D scene strips, but check for disk cache. */
     if (seq->type == SEQ_TYPE_SCENE && (seq->flag & SEQ_SCENE_STRIPS) == 0 &&
-        !seq_prefetch_seq_has_disk_cache(pfjob, seq, !is_recursive_check)) {
+        !seq_prefetch_seq_has_disk_cache(renderer, seq, !is_recursive_check)) {
       return true;
     }
 
@@ -435,10 +479,12 @@ static SeqCollection *query_scene_strips(ListBase *seqbase)
 
 /* Prefetch must avoid rendering scene strips, because rendering in background locks UI and can
  * make it unresponsive for long time periods. */
-static bool seq_prefetch_must_skip_frame(PrefetchJob *pfjob, ListBase *channels, ListBase *seqbase)
+static bool seq_prefetch_must_skip_frame(PrefetchRenderer *renderer,
+                                         ListBase *channels,
+                                         ListBase *seqbase)
 {
   SeqCollection *scene_strips = query_scene_strips(seqbase);
-  if (seq_prefetch_scene_strip_is_rendered(pfjob, channels, seqbase, scene_strips, false)) {
+  if (seq_prefetch_scene_strip_is_rendered(renderer, channels, seqbase, scene_strips, false)) {
     SEQ_collection_free(scene_strips);
     return true;
   }
@@ -446,37 +492,89 @@ static bool seq_prefetch_must_skip_frame(PrefetchJob *pfjob, ListBase *channels,
   return false;
 }
 
+/* Don't start rendering another frame, when images of all frames in flight may not fit into the
+ * cache. This keeps concurrent renderers from pushing memory usage far above the cache limit. */
+static bool seq_prefetch_is_memory_limited(PrefetchJob *pfjob)
+{
+  if (pfjob->frames_in_flight == 0) {
+    return false;
+  }
+
+  return !seq_cache_can_fit((size_t)(pfjob->frames_in_flight + 1) * pfjob->frame_mem_size);
+}
+
 static bool seq_prefetch_need_suspend(PrefetchJob *pfjob)
 {
-  return seq_prefetch_is_cache_full(pfjob->scene) || seq_prefetch_is_scrubbing(pfjob->bmain) ||
+  return seq_prefetch_is_cache_full(pfjob->scene) || seq_prefetch_is_memory_limited(pfjob) ||
+         seq_prefetch_is_scrubbing(pfjob->bmain) ||
          (seq_prefetch_cfra(pfjob) >= pfjob->scene->r.efra);
 }
 
-static void seq_prefetch_do_suspend(PrefetchJob *pfjob)
+static bool seq_prefetch_is_stopped(PrefetchJob *pfjob)
 {
+  return !(pfjob->scene->ed->cache_flag & SEQ_CACHE_PREFETCH_ENABLE) || pfjob->stop;
+}
+
+/**
+ * Assign next frame to be prefetched to the renderer. Suspend thread if there is nothing to be
+ * prefetched.
+ *
+ * \return false when prefetching has been stopped.
+ */
+static bool seq_prefetch_claim_frame(PrefetchRenderer *renderer)
+{
+  PrefetchJob *pfjob = renderer->pfjob;
+
   BLI_mutex_lock(&pfjob->prefetch_suspend_mutex);
-  while (seq_prefetch_need_suspend(pfjob) &&
-         (pfjob->scene->ed->cache_flag & SEQ_CACHE_PREFETCH_ENABLE) && !pfjob->stop) {
-    pfjob->waiting = true;
+  seq_prefetch_update_area(pfjob);
+  while (seq_prefetch_need_suspend(pfjob) && !seq_prefetch_is_stopped(pfjob)) {
+    pfjob->renderers_waiting++;
+    pfjob->waiting = pfjob->renderers_waiting == pfjob->renderers_running;
     BLI_condition_wait(&pfjob->prefetch_suspend_cond, &pfjob->prefetch_suspend_mutex);
+    pfjob->renderers_waiting--;
+    pfjob->waiting = false;
     seq_prefetch_update_area(pfjob);
   }
-  pfjob->waiting = false;
+
+  const bool is_claimed = !seq_prefetch_is_stopped(pfjob);
+  if (is_claimed) {
+    pfjob->num_frames_prefetched++;
+    pfjob->frames_in_flight++;
+    renderer->timeline_frame = seq_prefetch_cfra(pfjob);
+  }
+  BLI_mutex_unlock(&pfjob->prefetch_suspend_mutex);
+
+  return is_claimed;
+}
+
+static void seq_prefetch_frame_done(PrefetchRenderer *renderer, ImBuf *ibuf)
+{
+  PrefetchJob *pfjob = renderer->pfjob;
+
+  BLI_mutex_lock(&pfjob->prefetch_suspend_mutex);
+  if (ibuf != NULL) {
+    pfjob->frame_mem_size = max_zz(pfjob->frame_mem_size, IMB_get_size_in_memory(ibuf));
+  }
+  pfjob->frames_in_flight--;
   BLI_mutex_unlock(&pfjob->prefetch_suspend_mutex);
+
+  /* Renderers held back by memory limit can continue. */
+  BLI_condition_notify_all(&pfjob->prefetch_suspend_cond);
 }
 
-static void *seq_prefetch_frames(void *job)
+static void *seq_prefetch_frames(void *data)
 {
-  PrefetchJob *pfjob = (PrefetchJob *)job;
+  PrefetchRenderer *renderer = (PrefetchRenderer *)data;
+  PrefetchJob *pfjob = renderer->pfjob;
 
-  while (seq_prefetch_cfra(pfjob) <= pfjob->scene->r.efra) {
-    pfjob->scene_eval->ed->prefetch_job = NULL;
+  while (seq_prefetch_claim_frame(renderer)) {
+    renderer->scene_eval->ed->prefetch_job = NULL;
 
-    seq_prefetch_update_depsgraph(pfjob);
-    AnimData *adt = BKE_animdata_from_id(&pfjob->context_cpy.scene->id);
-    AnimationEvalContext anim_eval_context = seq_prefetch_anim_eval_context(pfjob);
+    seq_prefetch_update_depsgraph(renderer);
+    AnimData *adt = BKE_animdata_from_id(&renderer->context_cpy.scene->id);
+    AnimationEvalContext anim_eval_context = seq_prefetch_anim_eval_context(renderer);
     BKE_animsys_evaluate_animdata(
-        &pfjob->context_cpy.scene->id, adt, &anim_eval_context, ADT_RECALC_ALL, false);
+        &renderer->context_cpy.scene->id, adt, &anim_eval_context, ADT_RECALC_ALL, false);
 
     /* This is quite hacky solution:
      * We need cross-reference original scene with copy for cache.
@@ -484,39 +582,34 @@ static void *seq_prefetch_frames(void *job)
      * Scene copy don't reference original scene. Perhaps, this could be done by depsgraph.
      * Set to NULL before return!
      */
-    pfjob->scene_eval->ed->prefetch_job = pfjob;
+    renderer->scene_eval->ed->prefetch_job = pfjob;
 
-    ListBase *seqbase = SEQ_active_seqbase_get(SEQ_editing_get(pfjob->scene_eval));
-    ListBase *channels = SEQ_channels_displayed_get(SEQ_editing_get(pfjob->scene_eval));
-    if (seq_prefetch_must_skip_frame(pfjob, channels, seqbase)) {
-      pfjob->num_frames_prefetched++;
+    ListBase *seqbase = SEQ_active_seqbase_get(SEQ_editing_get(renderer->scene_eval));
+    ListBase *channels = SEQ_channels_displayed_get(SEQ_editing_get(renderer->scene_eval));
+    if (seq_prefetch_must_skip_frame(renderer, channels, seqbase)) {
+      seq_prefetch_frame_done(renderer, NULL);
       continue;
     }
 
-    ImBuf *ibuf = SEQ_render_give_ibuf(&pfjob->context_cpy, seq_prefetch_cfra(pfjob), 0);
-    seq_cache_free_temp_cache(pfjob->scene, pfjob->context.task_id, seq_prefetch_cfra(pfjob));
+    ImBuf *ibuf = SEQ_render_give_ibuf(&renderer->context_cpy, renderer->timeline_frame, 0);
+    seq_cache_free_temp_cache(pfjob->scene, renderer->context.task_id, renderer->timeline_frame);
+    seq_prefetch_frame_done(renderer, ibuf);
     IMB_freeImBuf(ibuf);
 
-    /* Suspend thread if there is nothing to be prefetched. */
-    seq_prefetch_do_suspend(pfjob);
-
     /* Avoid "collision" with main thread, but make sure to fetch at least few frames */
     if (pfjob->num_frames_prefetched > 5 &&
-        (seq_prefetch_cfra(pfjob) - pfjob->scene->r.cfra) < 2) {
-      break;
-    }
-
-    if (!(pfjob->scene->ed->cache_flag & SEQ_CACHE_PREFETCH_ENABLE) || pfjob->stop) {
+        (renderer->timeline_frame - pfjob->scene->r.cfra) < 2) {
       break;
     }
-
-    seq_prefetch_update_area(pfjob);
-    pfjob->num_frames_prefetched++;
   }
 
-  seq_cache_free_temp_cache(pfjob->scene, pfjob->context.task_id, seq_prefetch_cfra(pfjob));
-  pfjob->running = false;
-  pfjob->scene_eval->ed->prefetch_job = NULL;
+  seq_cache_free_temp_cache(pfjob->scene, renderer->context.task_id, renderer->timeline_frame);
+  renderer->scene_eval->ed->prefetch_job = NULL;
+
+  BLI_mutex_lock(&pfjob->prefetch_suspend_mutex);
+  pfjob->renderers_running--;
+  pfjob->running = pfjob->renderers_running > 0;
+  BLI_mutex_unlock(&pfjob->prefetch_suspend_mutex);
 
   return NULL;
 }
@@ -530,30 +623,46 @@ static PrefetchJob *seq_prefetch_start_ex(const SeqRenderData *context, float cf
       pfjob = (PrefetchJob *)MEM_callocN(sizeof(PrefetchJob), "PrefetchJob");
       context->scene->ed->prefetch_job = pfjob;
 
-      BLI_threadpool_init(&pfjob->threads, seq_prefetch_frames, 1);
+      BLI_threadpool_init(&pfjob->threads, seq_prefetch_frames, SEQ_PREFETCH_RENDERERS_MAX);
       BLI_mutex_init(&pfjob->prefetch_suspend_mutex);
       BLI_condition_init(&pfjob->prefetch_suspend_cond);
 
       pfjob->bmain_eval = BKE_main_new();
       pfjob->scene = context->scene;
-      seq_prefetch_init_depsgraph(pfjob);
+      for (int i = 0; i < SEQ_PREFETCH_RENDERERS_MAX; i++) {
+        pfjob->renderers[i].pfjob = pfjob;
+      }
     }
   }
+
+  /* Threads of previous run have finished, but must be joined before their data is updated. */
+  for (int i = 0; i < SEQ_PREFETCH_RENDERERS_MAX; i++) {
+    BLI_threadpool_remove(&pfjob->threads, &pfjob->renderers[i]);
+  }
+
   pfjob->bmain = context->bmain;
+  pfjob->renderers_num = clamp_i(U.sequencer_prefetch_threads, 1, SEQ_PREFETCH_RENDERERS_MAX);
 
   pfjob->cfra = cfra;
-  pfjob->num_frames_prefetched = 1;
+  pfjob->num_frames_prefetched = 0;
+  pfjob->frames_in_flight = 0;
+  pfjob->frame_mem_size = 0;
 
+  pfjob->renderers_running = pfjob->renderers_num;
+  pfjob->renderers_waiting = 0;
   pfjob->waiting = false;
   pfjob->stop = false;
   pfjob->running = true;
 
   seq_prefetch_update_scene(context->scene);
-  seq_prefetch_update_context(context);
-  seq_prefetch_update_active_seqbase(pfjob);
+  for (int i = 0; i < pfjob->renderers_num; i++) {
+    seq_prefetch_update_context(&pfjob->renderers[i], context);
+    seq_prefetch_update_active_seqbase(&pfjob->renderers[i]);
+  }
 
-  BLI_threadpool_remove(&pfjob->threads, pfjob);
-  BLI_threadpool_insert(&pfjob->threads, pfjob);
+  for (int i = 0; i < pfjob->renderers_num; i++) {
+    BLI_threadpool_insert(&pfjob->threads, &pfjob->renderers[i]);
+  }
 
   return pfjob;
 }
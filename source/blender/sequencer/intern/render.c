@@ -1987,17 +1987,19 @@ ImBuf *SEQ_render_give_ibuf(const SeqRenderData *context, float timeline_frame,
   SEQ_relations_free_all_anim_ibufs(context->scene, timeline_frame);
 
   if (count && !out) {
-    BLI_mutex_lock(&seq_render_mutex);
-    out = seq_render_strip_stack(context, &state, channels, seqbasep, timeline_frame, chanshown);
-
+    /* Prefetch renderers each own a copy of the scene, so they don't need to be serialized with
+     * other renders. Shared data (cache, fonts) is locked where it is used. */
     if (context->is_prefetch_render) {
+      out = seq_render_strip_stack(context, &state, channels, seqbasep, timeline_frame, chanshown);
       seq_cache_put(context, seq_arr[count - 1], timeline_frame, SEQ_CACHE_STORE_FINAL_OUT, out);
     }
     else {
+      BLI_mutex_lock(&seq_render_mutex);
+      out = seq_render_strip_stack(context, &state, channels, seqbasep, timeline_frame, chanshown);
       seq_cache_put_if_possible(
           context, seq_arr[count - 1], timeline_frame, SEQ_CACHE_STORE_FINAL_OUT, out);
+      BLI_mutex_unlock(&seq_render_mutex);
     }
-    BLI_mutex_unlock(&seq_render_mutex);
   }
 
   seq_prefetch_start(context, timeline_frame);
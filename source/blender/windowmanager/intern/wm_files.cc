@@ -1876,6 +1876,7 @@ static bool wm_file_write(bContext *C,
   blend_write_params.remap_mode = remap_mode;
   blend_write_params.use_save_versions = true;
   blend_write_params.use_save_as_copy = use_save_as_copy;
+  blend_write_params.use_delta = USER_EXPERIMENTAL_TEST(&U, use_delta_save);
   blend_write_params.thumb = thumb;
   if (BLO_write_file(bmain, filepath, fileflags, &blend_write_params, reports)) {
     const bool do_history_file_update = (G.background == false) &&
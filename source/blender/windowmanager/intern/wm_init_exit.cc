@@ -33,6 +33,7 @@
 #include "BLI_timer.h"
 #include "BLI_utildefines.h"
 
+#include "BLO_readfile.h"
 #include "BLO_undofile.h"
 #include "BLO_writefile.h"
 
@@ -559,6 +560,8 @@ void WM_exit_ex0(bContext *C, const bool do_python)
   UI_exit();
   BKE_blender_free(); /* blender.c, does entire library and spacetypes */
                       //  BKE_material_copybuf_free();
+  BLO_read_data_views_free();
+  BLO_write_delta_save_free();
 
   /* Free the GPU subdivision data after the database to ensure that subdivision structs used by
    * the modifiers were garbage collected. */
@@ -808,6 +811,8 @@ void WM_exit_ex(bContext *C, const bool do_python)
 
   BKE_blender_globals_clear();
   BKE_blender_free();
+  BLO_read_data_views_free();
+  BLO_write_delta_save_free();
   /* free gizmo-maps after freeing blender,
    * so no deleted data get accessed during cleaning up of areas. */
   wm_gizmomaptypes_free();
@@ -26,6 +26,7 @@
 #  include "BLI_string.h"
 #  include "BLI_string_utf8.h"
 #  include "BLI_system.h"
+#  include "BLI_task.h"
 #  include "BLI_threads.h"
 #  include "BLI_utildefines.h"
 
@@ -42,8 +43,12 @@
 #  include "BKE_scene.h"
 #  include "BKE_sound.h"
 
+#  include "DNA_object_types.h"
+
 #  include "GPU_context.h"
 
+#  include "NOD_geometry.h"
+
 #  ifdef WITH_FFMPEG
 #    include "IMB_imbuf.h"
 #  endif
@@ -567,6 +572,8 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_args_print_arg_doc(ba, "--debug-cycles");
 #  endif
   BLI_args_print_arg_doc(ba, "--debug-memory");
+  BLI_args_print_arg_doc(ba, "--debug-task-trace");
+  BLI_args_print_arg_doc(ba, "--profile-geometry-nodes");
   BLI_args_print_arg_doc(ba, "--debug-jobs");
   BLI_args_print_arg_doc(ba, "--debug-python");
   BLI_args_print_arg_doc(ba, "--debug-depsgraph");
@@ -1081,6 +1088,21 @@ static int arg_handle_debug_mode_memory_set(int UNUSED(argc),
   return 0;
 }
 
+static const char arg_handle_debug_task_trace_set_doc[] =
+    "<filepath>\n"
+    "\tRecord the execution of tasks on all threads, written on exit to <filepath>\n"
+    "\tas a Chrome trace (view in 'chrome://tracing' or 'ui.perfetto.dev').";
+static int arg_handle_debug_task_trace_set(int argc, const char **argv, void *UNUSED(data))
+{
+  const char *arg_id = "--debug-task-trace";
+  if (argc > 1) {
+    BLI_task_trace_begin(argv[1]);
+    return 1;
+  }
+  fprintf(stderr, "\nError: '%s' no args given.\n", arg_id);
+  return 0;
+}
+
 static const char arg_handle_debug_value_set_doc[] =
     "<value>\n"
     "\tSet debug value of <value> on startup.";
@@ -1711,6 +1733,51 @@ static int arg_handle_render_animation(int UNUSED(argc), const char **UNUSED(arg
   return 0;
 }
 
+static const char arg_handle_profile_geometry_nodes_doc[] =
+    "<filepath>\n"
+    "\tEvaluate the scene for every frame from start to end (inclusive) and write a profile of\n"
+    "\tthe geometry nodes evaluation to <filepath>. It contains the run time, thread, created\n"
+    "\tmemory and field evaluation size of every node execution as a Chrome trace (view in\n"
+    "\t'chrome://tracing' or 'ui.perfetto.dev'), with a summary per node, frame and thread.\n"
+    "\tExits with an error when the profile can't be written.";
+static int arg_handle_profile_geometry_nodes(int argc, const char **argv, void *data)
+{
+  const char *arg_id = "--profile-geometry-nodes";
+  bContext *C = data;
+  Scene *scene = CTX_data_scene(C);
+  if (scene) {
+    if (argc > 1) {
+      Main *bmain = CTX_data_main(C);
+      Depsgraph *depsgraph = CTX_data_ensure_evaluated_depsgraph(C);
+      const int frame_orig = scene->r.cfra;
+      const int frame_step = scene->r.frame_step > 0 ? scene->r.frame_step : 1;
+
+      /* Also evaluate geometry that doesn't change over time in the first frame. */
+      LISTBASE_FOREACH (Object *, ob, &bmain->objects) {
+        DEG_id_tag_update(&ob->id, ID_RECALC_GEOMETRY);
+      }
+
+      NOD_geometry_nodes_profile_begin();
+      for (int frame = scene->r.sfra; frame <= scene->r.efra; frame += frame_step) {
+        scene->r.cfra = frame;
+        BKE_scene_graph_update_for_newframe(depsgraph);
+      }
+      if (!NOD_geometry_nodes_profile_end(argv[1])) {
+        fprintf(stderr, "\nError: failed to write profile '%s'.\n", argv[1]);
+        exit(1);
+      }
+
+      scene->r.cfra = frame_orig;
+      BKE_scene_graph_update_for_newframe(depsgraph);
+      return 1;
+    }
+    fprintf(stderr, "\nError: you must specify a path after '%s'.\n", arg_id);
+    return 0;
+  }
+  fprintf(stderr, "\nError: no blend loaded. cannot use '%s'.\n", arg_id);
+  return 0;
+}
+
 static const char arg_handle_scene_set_doc[] =
     "<name>\n"
     "\tSet the active scene <name> for rendering.";
@@ -2137,6 +2204,8 @@ void main_args_setup(bContext *C, bArgs *ba)
   BLI_args_add(ba, NULL, "--log-show-backtrace", CB(arg_handle_log_show_backtrace_set), ba);
   BLI_args_add(ba, NULL, "--log-show-timestamp", CB(arg_handle_log_show_timestamp_set), ba);
   BLI_args_add(ba, NULL, "--log-file", CB(arg_handle_log_file_set), ba);
+  /* Early, so the startup is included in the trace. */
+  BLI_args_add(ba, NULL, "--debug-task-trace", CB(arg_handle_debug_task_trace_set), NULL);
 
   /* GPU backend selection should be part of ARG_PASS_ENVIRONMENT for correct GPU context selection
    * for anim player. */
@@ -2324,6 +2393,7 @@ void main_args_setup(bContext *C, bArgs *ba)
   BLI_args_pass_set(ba, ARG_PASS_FINAL);
   BLI_args_add(ba, "-f", "--render-frame", CB(arg_handle_render_frame), C);
   BLI_args_add(ba, "-a", "--render-anim", CB(arg_handle_render_animation), C);
+  BLI_args_add(ba, NULL, "--profile-geometry-nodes", CB(arg_handle_profile_geometry_nodes), C);
   BLI_args_add(ba, "-S", "--scene", CB(arg_handle_scene_set), C);
   BLI_args_add(ba, "-s", "--frame-start", CB(arg_handle_frame_start_set), C);
   BLI_args_add(ba, "-e", "--frame-end", CB(arg_handle_frame_end_set), C);
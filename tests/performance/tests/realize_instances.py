@@ -0,0 +1,109 @@
+# SPDX-License-Identifier: Apache-2.0
+
+import api
+
+
+def _run(args):
+    import bpy
+    import time
+
+    # Build a node tree that scatters many small instances with an instance attribute and
+    # realizes them, like scattered pebbles.
+    group = bpy.data.node_groups.new("Realize Instances", 'GeometryNodeTree')
+    group.outputs.new('NodeSocketGeometry', "Geometry")
+    nodes = group.nodes
+    links = group.links
+
+    points = nodes.new('GeometryNodePoints')
+    points.inputs['Count'].default_value = args['count']
+    random_position = nodes.new('FunctionNodeRandomValue')
+    random_position.data_type = 'FLOAT_VECTOR'
+    random_position.inputs['Max'].default_value = (100.0, 100.0, 100.0)
+    links.new(random_position.outputs[0], points.inputs['Position'])
+
+    if args['instance'] == 'MESH':
+        instance = nodes.new('GeometryNodeMeshIcoSphere')
+        instance.inputs['Subdivisions'].default_value = 1
+    else:
+        instance = nodes.new('GeometryNodePoints')
+        instance.inputs['Count'].default_value = 8
+
+    instance_on_points = nodes.new('GeometryNodeInstanceOnPoints')
+    random_rotation = nodes.new('FunctionNodeRandomValue')
+    random_rotation.data_type = 'FLOAT_VECTOR'
+    links.new(points.outputs['Geometry'], instance_on_points.inputs['Points'])
+    links.new(instance.outputs[0], instance_on_points.inputs['Instance'])
+    links.new(random_rotation.outputs[0], instance_on_points.inputs['Rotation'])
+
+    store_attribute = nodes.new('GeometryNodeStoreNamedAttribute')
+    store_attribute.data_type = 'FLOAT'
+    store_attribute.domain = 'INSTANCE'
+    store_attribute.inputs['Name'].default_value = "pebble"
+    random_value = nodes.new('FunctionNodeRandomValue')
+    value_input = next(socket for socket in store_attribute.inputs
+                       if socket.name == 'Value' and socket.enabled)
+    links.new(random_value.outputs[1], value_input)
+    links.new(instance_on_points.outputs['Instances'], store_attribute.inputs['Geometry'])
+
+    realize_instances = nodes.new('GeometryNodeRealizeInstances')
+    group_output = nodes.new('NodeGroupOutput')
+    links.new(store_attribute.outputs['Geometry'], realize_instances.inputs['Geometry'])
+    links.new(realize_instances.outputs['Geometry'], group_output.inputs['Geometry'])
+
+    mesh = bpy.data.meshes.new("Realize Instances")
+    ob = bpy.data.objects.new("Realize Instances", mesh)
+    bpy.context.scene.collection.objects.link(ob)
+    modifier = ob.modifiers.new("Realize Instances", 'NODES')
+    modifier.node_group = group
+
+    # Evaluate once first, to avoid any possible lazy evaluation later.
+    bpy.context.view_layer.update()
+
+    test_time_start = time.time()
+    measured_times = []
+
+    min_measurements = 5
+    max_measurements = 100
+    timeout = 5
+
+    while True:
+        ob.update_tag()
+
+        start_time = time.time()
+        bpy.context.view_layer.update()
+        elapsed_time = time.time() - start_time
+        measured_times.append(elapsed_time)
+
+        if len(measured_times) >= min_measurements and test_time_start + timeout < time.time():
+            break
+        if len(measured_times) >= max_measurements:
+            break
+
+    average_time = sum(measured_times) / len(measured_times)
+    result = {'time': average_time}
+    return result
+
+
+class RealizeInstancesTest(api.Test):
+    def __init__(self, instance, count):
+        self.instance = instance
+        self.count = count
+
+    def name(self):
+        return f"realize_{self.instance.lower()}_instances_{self.count}"
+
+    def category(self):
+        return "geometry_nodes"
+
+    def run(self, env, device_id):
+        args = {'instance': self.instance, 'count': self.count}
+
+        result, _ = env.run_in_blender(_run, args)
+
+        return result
+
+
+def generate(env):
+    return [RealizeInstancesTest(instance, count)
+            for instance in ('MESH', 'POINTCLOUD')
+            for count in (10000, 1000000)]